@@ -69,6 +69,7 @@ const_params="
   --max_bytes_for_level_multiplier=8 \
   \
   --statistics=1 \
+  --nvm_stats=1 \
   --stats_per_interval=1 \
   --stats_interval_seconds=60 \
   --histogram=1 \
@@ -197,7 +198,6 @@ function run_filluniquerandom {
 }
 
 function run_readrandom {
-  ./nvm_bench readrandom
   echo "Reading $num_keys random keys"
   out_name="benchmark_readrandom.t${num_threads}.log"
   cmd="./db_bench --benchmarks=readrandom \
@@ -77,13 +77,18 @@ Status BuildTable(
     unique_ptr<WritableFileWriter> file_writer;
     {
       unique_ptr<WritableFile> file;
-      s = env->NewWritableFile(fname, &file, env_options);
+      EnvOptions table_env_options(env_options);
+      if (table_env_options.write_hint == kWriteLifeTimeNotSet) {
+        table_env_options.write_hint = kWriteLifeTimeMedium;
+      }
+      s = env->NewWritableFile(fname, &file, table_env_options);
       if (!s.ok()) {
         return s;
       }
       file->SetIOPriority(io_priority);
 
-      file_writer.reset(new WritableFileWriter(std::move(file), env_options));
+      file_writer.reset(
+          new WritableFileWriter(std::move(file), table_env_options));
 
       builder = NewTableBuilder(
           ioptions, internal_comparator, int_tbl_prop_collector_factories,
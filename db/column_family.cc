@@ -111,6 +111,21 @@ Status CheckCompressionSupported(const ColumnFamilyOptions& cf_options) {
   return Status::OK();
 }
 
+Status CheckConcurrentWritesSupported(const ColumnFamilyOptions& cf_options) {
+  if (cf_options.inplace_update_support) {
+    return Status::InvalidArgument(
+        "In-place memtable updates (inplace_update_support) is not compatible "
+        "with concurrent writes (allow_concurrent_memtable_write)");
+  }
+  if (cf_options.memtable_factory == nullptr ||
+      !cf_options.memtable_factory->IsInsertConcurrentlySupported()) {
+    return Status::InvalidArgument(
+        "Memtable doesn't allow concurrent writes "
+        "(allow_concurrent_memtable_write)");
+  }
+  return Status::OK();
+}
+
 ColumnFamilyOptions SanitizeOptions(const DBOptions& db_options,
                                     const InternalKeyComparator* icmp,
                                     const ColumnFamilyOptions& src) {
@@ -803,9 +818,11 @@ ColumnFamilyHandle* ColumnFamilyMemTablesImpl::GetColumnFamilyHandle() {
 }
 
 void ColumnFamilyMemTablesImpl::CheckMemtableFull() {
-  if (current_ != nullptr && current_->mem()->ShouldScheduleFlush()) {
+  if (current_ != nullptr && current_->mem()->ShouldScheduleFlush() &&
+      current_->mem()->MarkFlushScheduled()) {
+    // MarkFlushScheduled() lets only one of the concurrent writers of a
+    // write group schedule the flush
     flush_scheduler_->ScheduleFlush(current_);
-    current_->mem()->MarkFlushScheduled();
   }
 }
 
@@ -767,7 +767,17 @@ Status CompactionJob::OpenCompactionOutputFile() {
   unique_ptr<WritableFile> writable_file;
   std::string fname = TableFileName(db_options_.db_paths, file_number,
                                     compact_->compaction->output_path_id());
-  Status s = env_->NewWritableFile(fname, &writable_file, env_options_);
+  // Data of the lower levels is rewritten less often; let the Env keep it
+  // apart from the short lived files of the upper levels.
+  EnvOptions output_env_options(env_options_);
+  if (bottommost_level_) {
+    output_env_options.write_hint = kWriteLifeTimeExtreme;
+  } else if (compact_->compaction->output_level() <= 1) {
+    output_env_options.write_hint = kWriteLifeTimeMedium;
+  } else {
+    output_env_options.write_hint = kWriteLifeTimeLong;
+  }
+  Status s = env_->NewWritableFile(fname, &writable_file, output_env_options);
   if (!s.ok()) {
     Log(InfoLogLevel::ERROR_LEVEL, db_options_.info_log,
         "[%s] [JOB %d] OpenCompactionOutputFiles for table #%" PRIu64
@@ -789,7 +799,7 @@ Status CompactionJob::OpenCompactionOutputFile() {
   writable_file->SetPreallocationBlockSize(
       static_cast<size_t>(compact_->compaction->OutputFilePreallocationSize()));
   compact_->outfile.reset(
-      new WritableFileWriter(std::move(writable_file), env_options_));
+      new WritableFileWriter(std::move(writable_file), output_env_options));
 
   ColumnFamilyData* cfd = compact_->compaction->column_family_data();
   bool skip_filters = false;
@@ -247,6 +247,14 @@ DEFINE_bool(enable_numa, false,
 DEFINE_int64(db_write_buffer_size, rocksdb::Options().db_write_buffer_size,
              "Number of bytes to buffer in all memtables before compacting");
 
+DEFINE_int64(memtable_block_pool_size,
+             rocksdb::Options().memtable_block_pool_size,
+             "Bytes of flushed memtables' arena blocks kept for reuse");
+
+DEFINE_int64(memtable_block_pool_huge_page_size,
+             rocksdb::Options().memtable_block_pool_huge_page_size,
+             "Huge page size to map the memtable block pool from, or 0");
+
 DEFINE_int64(write_buffer_size, rocksdb::Options().write_buffer_size,
              "Number of bytes to buffer in memtable before compacting");
 
@@ -320,6 +328,23 @@ DEFINE_int64(cache_size, -1, "Number of bytes to use as a cache of uncompressed"
 DEFINE_bool(cache_index_and_filter_blocks, false,
             "Cache index/filter blocks in block cache.");
 
+DEFINE_bool(partition_index_and_filters, false,
+            "Partition the index and the filter blocks (kTwoLevelIndexSearch "
+            "and partition_filters).");
+
+DEFINE_int64(metadata_block_size,
+             rocksdb::BlockBasedTableOptions().metadata_block_size,
+             "Target size of the index and filter partitions when "
+             "--partition_index_and_filters is set.");
+
+DEFINE_bool(use_data_block_hash_index, false,
+            "Append a hash index to the data blocks for point lookups "
+            "(kDataBlockBinaryAndHash).");
+
+DEFINE_double(data_block_hash_table_util_ratio,
+              rocksdb::BlockBasedTableOptions().data_block_hash_table_util_ratio,
+              "Keys per bucket of the data block hash index.");
+
 DEFINE_int32(block_size,
              static_cast<int32_t>(rocksdb::BlockBasedTableOptions().block_size),
              "Number of bytes in a block.");
@@ -344,6 +369,9 @@ DEFINE_int32(bloom_bits, -1, "Bloom filter bits per key. Negative means"
              " use default settings.");
 DEFINE_int32(memtable_bloom_bits, 0, "Bloom filter bits per key for memtable. "
              "Negative means no bloom filter.");
+DEFINE_bool(memtable_whole_key_filtering, false, "Add whole keys to the "
+            "memtable bloom filter, so that point lookups can skip memtables "
+            "without a prefix extractor.");
 
 DEFINE_bool(use_existing_db, false, "If true, do not destroy the existing"
             " database.  If you set this flag and also specify a benchmark that"
@@ -497,6 +525,11 @@ DEFINE_string(compression_type, "snappy",
 static enum rocksdb::CompressionType FLAGS_compression_type_e =
     rocksdb::kSnappyCompression;
 
+DEFINE_string(wal_compression, "none",
+              "Algorithm to use to compress the records of the WAL");
+static enum rocksdb::CompressionType FLAGS_wal_compression_e =
+    rocksdb::kNoCompression;
+
 DEFINE_int32(compression_level, -1,
              "Compression level. For zlib this should be -1 for the "
              "default level, or between 0 and 9.");
@@ -530,6 +563,12 @@ static bool ValidateTableCacheNumshardbits(const char* flagname,
 DEFINE_int32(table_cache_numshardbits, 4, "");
 
 DEFINE_string(hdfs, "", "Name of hdfs environment");
+
+DEFINE_bool(nvm_stats, false, "Report the counters of the open-channel (NVM)"
+            " device after every benchmark: pages written, gc relocations,"
+            " erases, write amplification, FTL saves and per lun queue depth."
+            " Needs a db_bench built with ENV=NVM; run the same benchmarks on"
+            " a POSIX build to compare.");
 // posix or hdfs environment
 static rocksdb::Env* FLAGS_env = rocksdb::Env::Default();
 
@@ -630,6 +669,15 @@ DEFINE_bool(use_tailing_iterator, false,
 DEFINE_bool(use_adaptive_mutex, rocksdb::Options().use_adaptive_mutex,
             "Use adaptive mutex");
 
+DEFINE_bool(allow_concurrent_memtable_write,
+            rocksdb::Options().allow_concurrent_memtable_write,
+            "Let the writers of a write group insert into the memtables "
+            "concurrently");
+
+DEFINE_bool(enable_pipelined_write, rocksdb::Options().enable_pipelined_write,
+            "Overlap the WAL write of a write group with the memtable "
+            "inserts of the previous ones");
+
 DEFINE_uint64(bytes_per_sync,  rocksdb::Options().bytes_per_sync,
               "Allows OS to incrementally sync SST files to disk while they are"
               " being written, in the background. Issue one request for every"
@@ -675,7 +723,8 @@ enum RepFactory {
   kPrefixHash,
   kVectorRep,
   kHashLinkedList,
-  kCuckoo
+  kCuckoo,
+  kKeyPrefixSkipList
 };
 
 namespace {
@@ -692,6 +741,8 @@ enum RepFactory StringToRepFactory(const char* ctype) {
     return kHashLinkedList;
   else if (!strcasecmp(ctype, "cuckoo"))
     return kCuckoo;
+  else if (!strcasecmp(ctype, "key_prefix_skip_list"))
+    return kKeyPrefixSkipList;
 
   fprintf(stdout, "Cannot parse memreptable %s\n", ctype);
   return kSkipList;
@@ -711,6 +762,13 @@ DEFINE_bool(use_hash_search, false, "if use kHashSearch "
 DEFINE_bool(use_block_based_filter, false, "if use kBlockBasedFilter "
             "instead of kFullFilter for filter block. "
             "This is valid if only we use BlockTable");
+DEFINE_bool(use_blocked_bloom_filter, false, "if use the register blocked "
+            "bloom filter (NewBlockedBloomFilterPolicy) for full filters. "
+            "This is valid if only we use BlockTable");
+DEFINE_bool(use_xor_filter, false, "if use the xor filter "
+            "(NewXorFilterPolicy) for full filters, ignoring bloom_bits "
+            "other than to enable filters. "
+            "This is valid if only we use BlockTable");
 DEFINE_string(merge_operator, "", "The merge operator to use with the database."
               "If a new merge operator is specified, be sure to use fresh"
               " database The possible merge operators are defined in"
@@ -1469,6 +1527,9 @@ class Benchmark {
       case kCuckoo:
         fprintf(stdout, "Memtablerep: cuckoo\n");
         break;
+      case kKeyPrefixSkipList:
+        fprintf(stdout, "Memtablerep: key_prefix_skip_list\n");
+        break;
     }
     fprintf(stdout, "Perf Level: %d\n", FLAGS_perf_level);
 
@@ -1602,8 +1663,14 @@ class Benchmark {
                                      : NewLRUCache(FLAGS_compressed_cache_size))
                               : nullptr),
         filter_policy_(FLAGS_bloom_bits >= 0
-                           ? NewBloomFilterPolicy(FLAGS_bloom_bits,
-                                                  FLAGS_use_block_based_filter)
+                           ? (FLAGS_use_xor_filter
+                                  ? NewXorFilterPolicy()
+                                  : FLAGS_use_blocked_bloom_filter
+                                  ? NewBlockedBloomFilterPolicy(
+                                        FLAGS_bloom_bits)
+                                  : NewBloomFilterPolicy(
+                                        FLAGS_bloom_bits,
+                                        FLAGS_use_block_based_filter))
                            : nullptr),
         prefix_extractor_(NewFixedPrefixTransform(FLAGS_prefix_size)),
         num_(FLAGS_num),
@@ -1980,6 +2047,11 @@ class Benchmark {
                                              FLAGS_report_interval_seconds));
     }
 
+    std::vector<uint64_t> nvm_tickers_before;
+    if (FLAGS_nvm_stats) {
+      nvm_tickers_before = GetNVMTickers();
+    }
+
     ThreadArg* arg = new ThreadArg[n];
 
     for (int i = 0; i < n; i++) {
@@ -2028,12 +2100,48 @@ class Benchmark {
     }
     merge_stats.Report(name);
 
+    if (FLAGS_nvm_stats) {
+      PrintNVMStats(nvm_tickers_before);
+    }
+
     for (int i = 0; i < n; i++) {
       delete arg[i].thread;
     }
     delete[] arg;
   }
 
+  static std::vector<uint64_t> GetNVMTickers() {
+    return {dbstats->getTickerCount(NVM_USER_PAGES_WRITTEN),
+            dbstats->getTickerCount(NVM_GC_PAGES_RELOCATED),
+            dbstats->getTickerCount(NVM_BLOCKS_ERASED),
+            dbstats->getTickerCount(NVM_FTL_SAVES),
+            dbstats->getTickerCount(NVM_FTL_SAVE_MICROS)};
+  }
+
+  // Device counters of the last benchmark followed by the totals the Env
+  // keeps since it was created.
+  void PrintNVMStats(const std::vector<uint64_t>& before) {
+    std::vector<uint64_t> after = GetNVMTickers();
+    uint64_t user_pages = after[0] - before[0];
+    uint64_t gc_pages = after[1] - before[1];
+    uint64_t ftl_saves = after[3] - before[3];
+
+    fprintf(stdout,
+            "NVM: %" PRIu64 " pages written, %" PRIu64 " relocated by gc, "
+            "%" PRIu64 " blocks erased, write amplification %.2f\n",
+            user_pages, gc_pages, after[2] - before[2],
+            user_pages > 0 ? static_cast<double>(user_pages + gc_pages) /
+                                 user_pages
+                           : 0.0);
+    fprintf(stdout, "NVM: %" PRIu64 " FTL saves, %" PRIu64 " micros\n",
+            ftl_saves, after[4] - before[4]);
+
+    std::string device_stats;
+    if (FLAGS_env->GetDeviceStats(&device_stats).ok()) {
+      fprintf(stdout, "%s", device_stats.c_str());
+    }
+  }
+
   void Crc32c(ThreadState* thread) {
     // Checksum about 500MB of data total
     const int size = 4096;
@@ -2223,6 +2331,9 @@ class Benchmark {
     options.create_if_missing = !FLAGS_use_existing_db;
     options.create_missing_column_families = FLAGS_num_column_families > 1;
     options.db_write_buffer_size = FLAGS_db_write_buffer_size;
+    options.memtable_block_pool_size = FLAGS_memtable_block_pool_size;
+    options.memtable_block_pool_huge_page_size =
+        FLAGS_memtable_block_pool_huge_page_size;
     options.write_buffer_size = FLAGS_write_buffer_size;
     options.max_write_buffer_number = FLAGS_max_write_buffer_number;
     options.min_write_buffer_number_to_merge =
@@ -2244,6 +2355,7 @@ class Benchmark {
       }
     }
     options.memtable_prefix_bloom_bits = FLAGS_memtable_bloom_bits;
+    options.memtable_whole_key_filtering = FLAGS_memtable_whole_key_filtering;
     options.bloom_locality = FLAGS_bloom_locality;
     options.max_open_files = FLAGS_open_files;
     options.statistics = dbstats;
@@ -2319,6 +2431,9 @@ class Benchmark {
         options.memtable_factory.reset(NewHashCuckooRepFactory(
             options.write_buffer_size, FLAGS_key_size + FLAGS_value_size));
         break;
+      case kKeyPrefixSkipList:
+        options.memtable_factory.reset(NewKeyPrefixSkipListRepFactory());
+        break;
 #else
       default:
         fprintf(stderr, "Only skip list is supported in lite mode\n");
@@ -2375,6 +2490,11 @@ class Benchmark {
           exit(1);
         }
         block_based_options.index_type = BlockBasedTableOptions::kHashSearch;
+      } else if (FLAGS_partition_index_and_filters) {
+        block_based_options.index_type =
+            BlockBasedTableOptions::kTwoLevelIndexSearch;
+        block_based_options.partition_filters = true;
+        block_based_options.metadata_block_size = FLAGS_metadata_block_size;
       } else {
         block_based_options.index_type = BlockBasedTableOptions::kBinarySearch;
       }
@@ -2385,6 +2505,12 @@ class Benchmark {
           FLAGS_cache_index_and_filter_blocks;
       block_based_options.block_cache = cache_;
       block_based_options.block_cache_compressed = compressed_cache_;
+      if (FLAGS_use_data_block_hash_index) {
+        block_based_options.data_block_index_type =
+            BlockBasedTableOptions::kDataBlockBinaryAndHash;
+        block_based_options.data_block_hash_table_util_ratio =
+            FLAGS_data_block_hash_table_util_ratio;
+      }
       block_based_options.block_size = FLAGS_block_size;
       block_based_options.block_restart_interval = FLAGS_block_restart_interval;
       block_based_options.filter_policy = filter_policy_;
@@ -2442,8 +2568,12 @@ class Benchmark {
     options.advise_random_on_open = FLAGS_advise_random_on_open;
     options.access_hint_on_compaction_start = FLAGS_compaction_fadvice_e;
     options.use_adaptive_mutex = FLAGS_use_adaptive_mutex;
+    options.allow_concurrent_memtable_write =
+        FLAGS_allow_concurrent_memtable_write;
+    options.enable_pipelined_write = FLAGS_enable_pipelined_write;
     options.bytes_per_sync = FLAGS_bytes_per_sync;
     options.wal_bytes_per_sync = FLAGS_wal_bytes_per_sync;
+    options.wal_compression = FLAGS_wal_compression_e;
 
     // merge operator options
     options.merge_operator = MergeOperators::CreateFromStringId(
@@ -3819,7 +3949,7 @@ int main(int argc, char** argv) {
   ParseCommandLineFlags(&argc, &argv, true);
 
   FLAGS_compaction_style_e = (rocksdb::CompactionStyle) FLAGS_compaction_style;
-  if (FLAGS_statistics) {
+  if (FLAGS_statistics || FLAGS_nvm_stats) {
     dbstats = rocksdb::CreateDBStatistics();
   }
 
@@ -3836,11 +3966,21 @@ int main(int argc, char** argv) {
 
   FLAGS_compression_type_e =
     StringToCompressionType(FLAGS_compression_type.c_str());
+  FLAGS_wal_compression_e =
+    StringToCompressionType(FLAGS_wal_compression.c_str());
 
   if (!FLAGS_hdfs.empty()) {
     FLAGS_env  = new rocksdb::HdfsEnv(FLAGS_hdfs);
   }
 
+  if (FLAGS_nvm_stats) {
+    std::string device_stats;
+    if (FLAGS_env->GetDeviceStats(&device_stats).IsNotSupported()) {
+      fprintf(stderr, "--nvm_stats needs db_bench built with ENV=NVM\n");
+      exit(1);
+    }
+  }
+
   if (!strcasecmp(FLAGS_compaction_fadvice.c_str(), "NONE"))
     FLAGS_compaction_fadvice_e = rocksdb::Options::NONE;
   else if (!strcasecmp(FLAGS_compaction_fadvice.c_str(), "NORMAL"))
@@ -17,6 +17,7 @@
 #include <algorithm>
 #include <climits>
 #include <cstdio>
+#include <deque>
 #include <set>
 #include <stdexcept>
 #include <stdint.h>
@@ -41,11 +42,13 @@
 #include "db/memtable_list.h"
 #include "db/merge_context.h"
 #include "db/merge_helper.h"
+#include "db/multiget_context.h"
 #include "db/table_cache.h"
 #include "db/table_properties_collector.h"
 #include "db/forward_iterator.h"
 #include "db/transaction_log_impl.h"
 #include "db/version_set.h"
+#include "db/wal_replay.h"
 #include "db/writebuffer.h"
 #include "db/write_batch_internal.h"
 #include "db/write_callback.h"
@@ -228,9 +231,13 @@ DBImpl::DBImpl(const DBOptions& options, const std::string& dbname)
       total_log_size_(0),
       max_total_in_memory_state_(0),
       is_snapshot_supported_(true),
-      write_buffer_(options.db_write_buffer_size),
+      write_buffer_(options.db_write_buffer_size,
+                    options.memtable_block_pool_size,
+                    options.memtable_block_pool_huge_page_size,
+                    options.statistics.get()),
       write_controller_(options.delayed_write_rate),
       last_batch_group_size_(0),
+      last_allocated_sequence_(0),
       unscheduled_flushes_(0),
       unscheduled_compactions_(0),
       bg_compaction_scheduled_(0),
@@ -305,6 +312,10 @@ DBImpl::~DBImpl() {
     versions_->GetColumnFamilySet()->FreeDeadColumnFamilies();
   }
   mutex_.Unlock();
+  if (opened_successfully_) {
+    // the rate limiter and statistics may go away with this DB
+    env_->SetGarbageCollectionOptions(nullptr, nullptr);
+  }
   // CancelAllBackgroundWork called with false means we just set the shutdown
   // marker. After this we do a variant of the waiting and unschedule work
   // (to consider: moving all the waiting into CancelAllBackgroundWork(true))
@@ -613,7 +624,7 @@ void DBImpl::FindObsoleteFiles(JobContext* job_context, bool force,
 
 Status DBImpl::SyncLog(log::Writer* log) {
   assert(log);
-  return log->file()->Sync(db_options_.use_fsync);
+  return log->Sync(db_options_.use_fsync);
 }
 
 namespace {
@@ -1038,6 +1049,30 @@ Status DBImpl::RecoverLogFiles(const std::vector<uint64_t>& log_numbers,
     stream.EndArray();
   }
 
+  // With wal_recovery_threads > 1 the logs are read ahead, applied by
+  // applier and full memtables written to level-0 in the background
+  std::unique_ptr<WalBatchApplier> applier;
+  RecoveryFlushes recovery_flushes;
+  // Background table writes use version_edits, so they are waited for on
+  // every way out
+  struct RecoveryFlushesWaiter {
+    DBImpl* db;
+    RecoveryFlushes* flushes;
+    ~RecoveryFlushesWaiter() { db->WaitForRecoveryFlushes(flushes); }
+  } recovery_flushes_waiter{this, &recovery_flushes};
+  if (db_options_.wal_recovery_threads > 1) {
+    bool concurrent_memtable_writes = true;
+    for (auto cfd : *versions_->GetColumnFamilySet()) {
+      if (!CheckConcurrentWritesSupported(*cfd->options()).ok()) {
+        concurrent_memtable_writes = false;
+      }
+    }
+    applier.reset(new WalBatchApplier(
+        versions_->GetColumnFamilySet(), &flush_scheduler_,
+        db_options_.wal_recovery_threads, concurrent_memtable_writes,
+        !read_only, [this](Status* s) { MaybeIgnoreError(s); }));
+  }
+
   bool continue_replay_log = true;
   for (auto log_number : log_numbers) {
     // The previous incarnation may not have written any MANIFEST
@@ -1115,7 +1150,38 @@ Status DBImpl::RecoverLogFiles(const std::vector<uint64_t>& log_numbers,
       }
     }
 
-    while (continue_replay_log &&
+    if (continue_replay_log && applier != nullptr) {
+      // The reading thread reports corruption to a status of its own,
+      // which is taken over once the log is exhausted
+      Status read_status;
+      if (reporter.status != nullptr) {
+        reporter.status = &read_status;
+      }
+      WalReadAhead read_ahead(&reader, &reporter, reporter.status,
+                              report_eof_inconsistency);
+      std::vector<std::string> records;
+      mutex_.Unlock();
+      while (read_ahead.Next(&records)) {
+        size_t next = 0;
+        while (next < records.size()) {
+          status = applier->Apply(records, &next, log_number, max_sequence);
+          mutex_.Lock();
+          if (status.ok() && !read_only) {
+            status = ScheduleRecoveryFlushes(job_id, log_number,
+                                             *max_sequence, &version_edits,
+                                             &recovery_flushes);
+          }
+          if (!status.ok()) {
+            return status;
+          }
+          mutex_.Unlock();
+        }
+      }
+      mutex_.Lock();
+      status = read_status;
+    }
+
+    while (continue_replay_log && applier == nullptr &&
            reader.ReadRecord(&record, &scratch, report_eof_inconsistency) &&
            status.ok()) {
       if (record.size() < 12) {
@@ -1197,6 +1263,11 @@ Status DBImpl::RecoverLogFiles(const std::vector<uint64_t>& log_numbers,
     }
   }
 
+  WaitForRecoveryFlushes(&recovery_flushes);
+  if (!recovery_flushes.status.ok()) {
+    return recovery_flushes.status;
+  }
+
   if (!read_only) {
     // no need to refcount since client still doesn't have access
     // to the DB and can not drop column families while we iterate
@@ -1255,6 +1326,85 @@ Status DBImpl::RecoverLogFiles(const std::vector<uint64_t>& log_numbers,
   return status;
 }
 
+struct DBImpl::RecoveryFlushJob {
+  DBImpl* db;
+  int job_id;
+  ColumnFamilyData* cfd;
+  MemTable* mem;
+  VersionEdit* edit;
+  RecoveryFlushes* flushes;
+};
+
+Status DBImpl::ScheduleRecoveryFlushes(
+    int job_id, uint64_t log_number, SequenceNumber max_sequence,
+    std::unordered_map<int, VersionEdit>* version_edits,
+    RecoveryFlushes* flushes) {
+  mutex_.AssertHeld();
+  // the background flush threads write the tables, so as many may be
+  // pending as there are such threads
+  const int max_pending = std::max(db_options_.max_background_flushes, 1);
+  ColumnFamilyData* cfd;
+  while ((cfd = flush_scheduler_.GetNextColumnFamily()) != nullptr) {
+    // If this asserts, it means that InsertInto failed in
+    // filtering updates to already-flushed column families
+    assert(cfd->GetLogNumber() <= log_number);
+    auto iter = version_edits->find(cfd->GetID());
+    assert(iter != version_edits->end());
+
+    while (flushes->pending >= max_pending && flushes->status.ok()) {
+      bg_cv_.Wait();
+    }
+    if (!flushes->status.ok()) {
+      cfd->Unref();
+      break;
+    }
+
+    // the job keeps the reference to cfd taken by the flush scheduler, and
+    // one to the memtable it writes
+    RecoveryFlushJob* job = new RecoveryFlushJob;
+    job->db = this;
+    job->job_id = job_id;
+    job->cfd = cfd;
+    job->mem = cfd->mem();
+    job->edit = &iter->second;
+    job->flushes = flushes;
+    job->mem->Ref();
+    cfd->CreateNewMemtable(*cfd->GetLatestMutableCFOptions(), max_sequence);
+
+    flushes->pending++;
+    env_->Schedule(&DBImpl::BGWorkRecoveryFlush, job,
+                   db_options_.max_background_flushes > 0
+                       ? Env::Priority::HIGH
+                       : Env::Priority::LOW);
+  }
+  return flushes->status;
+}
+
+void DBImpl::BGWorkRecoveryFlush(void* arg) {
+  RecoveryFlushJob* job = reinterpret_cast<RecoveryFlushJob*>(arg);
+  DBImpl* db = job->db;
+  {
+    InstrumentedMutexLock l(&db->mutex_);
+    Status s = db->WriteLevel0TableForRecovery(job->job_id, job->cfd,
+                                               job->mem, job->edit);
+    if (!s.ok() && job->flushes->status.ok()) {
+      job->flushes->status = s;
+    }
+    delete job->mem->Unref();
+    job->cfd->Unref();
+    job->flushes->pending--;
+    db->bg_cv_.SignalAll();
+  }
+  delete job;
+}
+
+void DBImpl::WaitForRecoveryFlushes(RecoveryFlushes* flushes) {
+  mutex_.AssertHeld();
+  while (flushes->pending > 0) {
+    bg_cv_.Wait();
+  }
+}
+
 Status DBImpl::WriteLevel0TableForRecovery(int job_id, ColumnFamilyData* cfd,
                                            MemTable* mem, VersionEdit* edit) {
   mutex_.AssertHeld();
@@ -2046,14 +2196,13 @@ Status DBImpl::FlushMemTable(ColumnFamilyData* cfd,
       return Status::OK();
     }
 
-    WriteThread::Writer w(&mutex_);
-    write_thread_.EnterWriteThread(&w);
-    assert(!w.done);  // Nobody should do our job
+    WriteThread::Writer w;
+    write_thread_.EnterUnbatched(&w, &mutex_);
 
     // SwitchMemtable() will release and reacquire mutex
     // during execution
     s = SwitchMemtable(cfd, &context);
-    write_thread_.ExitWriteThread(&w, &w, s);
+    write_thread_.ExitUnbatched(&w);
 
     cfd->imm()->FlushRequested();
 
@@ -2860,6 +3009,7 @@ std::vector<Status> DBImpl::MultiGet(
   struct MultiGetColumnFamilyData {
     ColumnFamilyData* cfd;
     SuperVersion* super_version;
+    MultiGetKeys keys;
   };
   std::unordered_map<uint32_t, MultiGetColumnFamilyData*> multiget_cf_data;
   // fill up and allocate outside of mutex
@@ -2886,45 +3036,49 @@ std::vector<Status> DBImpl::MultiGet(
   }
   mutex_.Unlock();
 
-  // Contain a list of merge operations if merge occurs.
-  MergeContext merge_context;
-
   // Note: this always resizes the values array
   size_t num_keys = keys.size();
   std::vector<Status> stat_list(num_keys);
   values->resize(num_keys);
 
-  // Keep track of bytes that we read for statistics-recording later
-  uint64_t bytes_read = 0;
-  PERF_TIMER_STOP(get_snapshot_time);
-
-  // For each of the given keys, apply the entire "get" process as follows:
-  // First look in the memtable, then in the immutable memtable (if any).
-  // s is both in/out. When in, s could either be OK or MergeInProgress.
-  // merge_operands will contain the sequence of merges in the latter case.
+  // LookupKey cannot be moved, hence the deque
+  std::deque<MultiGetKeyContext> key_contexts;
   for (size_t i = 0; i < num_keys; ++i) {
-    merge_context.Clear();
-    Status& s = stat_list[i];
-    std::string* value = &(*values)[i];
-
-    LookupKey lkey(keys[i], snapshot);
+    key_contexts.emplace_back(keys[i], snapshot, &(*values)[i], &stat_list[i]);
     auto cfh = reinterpret_cast<ColumnFamilyHandleImpl*>(column_family[i]);
     auto mgd_iter = multiget_cf_data.find(cfh->cfd()->GetID());
     assert(mgd_iter != multiget_cf_data.end());
-    auto mgd = mgd_iter->second;
+    mgd_iter->second->keys.push_back(&key_contexts.back());
+  }
+
+  // Keep track of bytes that we read for statistics-recording later
+  uint64_t bytes_read = 0;
+  PERF_TIMER_STOP(get_snapshot_time);
+
+  // The keys of each column family go through the "get" process together,
+  // in key order: first the memtable, then the immutable memtables (if
+  // any), then the levels. Each step skips the keys that an earlier one
+  // found; the status of the others is either OK or MergeInProgress, with
+  // the merge operands in their merge context in the latter case.
+  for (auto mgd_iter : multiget_cf_data) {
+    auto mgd = mgd_iter.second;
     auto super_version = mgd->super_version;
-    if (super_version->mem->Get(lkey, value, &s, &merge_context)) {
-      // Done
-    } else if (super_version->imm->Get(lkey, value, &s, &merge_context)) {
-      // Done
-    } else {
-      PERF_TIMER_GUARD(get_from_output_files_time);
-      super_version->current->Get(read_options, lkey, value, &s,
-                                  &merge_context);
-    }
+    const Comparator* ucmp = mgd->cfd->user_comparator();
+    std::sort(mgd->keys.begin(), mgd->keys.end(),
+              [ucmp](const MultiGetKeyContext* a, const MultiGetKeyContext* b) {
+                return ucmp->Compare(a->lkey.user_key(), b->lkey.user_key()) <
+                       0;
+              });
+
+    super_version->mem->MultiGet(mgd->keys);
+    super_version->imm->MultiGet(mgd->keys);
+    PERF_TIMER_GUARD(get_from_output_files_time);
+    super_version->current->MultiGet(read_options, mgd->keys);
+  }
 
-    if (s.ok()) {
-      bytes_read += value->size();
+  for (size_t i = 0; i < num_keys; ++i) {
+    if (stat_list[i].ok()) {
+      bytes_read += (*values)[i].size();
     }
   }
 
@@ -2965,6 +3119,9 @@ Status DBImpl::CreateColumnFamily(const ColumnFamilyOptions& cf_options,
   *handle = nullptr;
 
   s = CheckCompressionSupported(cf_options);
+  if (s.ok() && db_options_.allow_concurrent_memtable_write) {
+    s = CheckConcurrentWritesSupported(cf_options);
+  }
   if (!s.ok()) {
     return s;
   }
@@ -2987,15 +3144,14 @@ Status DBImpl::CreateColumnFamily(const ColumnFamilyOptions& cf_options,
     // ColumnFamilyData object
     Options opt(db_options_, cf_options);
     {  // write thread
-      WriteThread::Writer w(&mutex_);
-      write_thread_.EnterWriteThread(&w);
-      assert(!w.done);  // Nobody should do our job
+      WriteThread::Writer w;
+      write_thread_.EnterUnbatched(&w, &mutex_);
       // LogAndApply will both write the creation in MANIFEST and create
       // ColumnFamilyData object
       s = versions_->LogAndApply(
           nullptr, MutableCFOptions(opt, ImmutableCFOptions(opt)), &edit,
           &mutex_, directories_.GetDbDir(), false, &cf_options);
-      write_thread_.ExitWriteThread(&w, &w, s);
+      write_thread_.ExitUnbatched(&w);
     }
     if (s.ok()) {
       single_column_family_mode_ = false;
@@ -3049,12 +3205,11 @@ Status DBImpl::DropColumnFamily(ColumnFamilyHandle* column_family) {
     }
     if (s.ok()) {
       // we drop column family from a single write thread
-      WriteThread::Writer w(&mutex_);
-      write_thread_.EnterWriteThread(&w);
-      assert(!w.done);  // Nobody should do our job
+      WriteThread::Writer w;
+      write_thread_.EnterUnbatched(&w, &mutex_);
       s = versions_->LogAndApply(cfd, *cfd->GetLatestMutableCFOptions(),
                                  &edit, &mutex_);
-      write_thread_.ExitWriteThread(&w, &w, s);
+      write_thread_.ExitUnbatched(&w);
     }
 
     if (!cf_support_snapshot) {
@@ -3354,42 +3509,50 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
   }
 
   PERF_TIMER_GUARD(write_pre_and_post_process_time);
-  WriteThread::Writer w(&mutex_);
+  WriteThread::Writer w;
   w.batch = my_batch;
   w.sync = write_options.sync;
   w.disableWAL = write_options.disableWAL;
   w.in_batch_group = false;
-  w.done = false;
   w.has_callback = (callback != nullptr) ? true : false;
 
   if (!write_options.disableWAL) {
     RecordTick(stats_, WRITE_WITH_WAL);
+    default_cf_internal_stats_->AddDBStats(InternalStats::WRITE_WITH_WAL, 1);
   }
 
   StopWatch write_sw(env_, db_options_.statistics.get(), DB_WRITE);
 
   WriteContext context;
-  mutex_.Lock();
-
-  if (!write_options.disableWAL) {
-    default_cf_internal_stats_->AddDBStats(InternalStats::WRITE_WITH_WAL, 1);
-  }
 
-  write_thread_.EnterWriteThread(&w);
-  if (w.done) {  // write was done by someone else
+  write_thread_.JoinBatchGroup(&w);
+  if (w.state == WriteThread::STATE_PARALLEL_FOLLOWER) {
+    // The leader of our write group wrote our batch to the WAL and handed
+    // the memtable insert back to us
+    ColumnFamilyMemTablesImpl column_family_memtables(
+        versions_->GetColumnFamilySet(), &flush_scheduler_);
+    Status s = WriteBatchInternal::InsertInto(
+        my_batch, &column_family_memtables,
+        write_options.ignore_missing_column_families, 0, this, false, true);
+    write_thread_.CompleteParallelWorker(&w, s);
+  }
+  if (w.state == WriteThread::STATE_COMPLETED) {
+    // write was done by someone else
     default_cf_internal_stats_->AddDBStats(InternalStats::WRITE_DONE_BY_OTHER,
                                            1);
-    mutex_.Unlock();
     RecordTick(stats_, WRITE_DONE_BY_OTHER);
     return w.status;
   }
 
+  assert(w.state == WriteThread::STATE_GROUP_LEADER);
+  mutex_.Lock();
+
   RecordTick(stats_, WRITE_DONE_BY_SELF);
   default_cf_internal_stats_->AddDBStats(InternalStats::WRITE_DONE_BY_SELF, 1);
 
   // Once reaches this point, the current writer "w" will try to do its write
-  // job.  It may also pick up some of the remaining writers in the "writers_"
-  // when it finds suitable, and finish them in the same write batch.
+  // job.  It may also pick up some of the remaining writers in the writer
+  // queue when it finds suitable, and finish them in the same write batch.
   // This is how a write job could be done by the other writer.
   assert(!single_column_family_mode_ ||
          versions_->GetColumnFamilySet()->NumberOfColumnFamilies() == 1);
@@ -3406,6 +3569,7 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
         "Flushing all column families with data in WAL number %" PRIu64
         ". Total log size is %" PRIu64 " while max_total_wal_size is %" PRIu64,
         flush_column_family_if_log_file, total_log_size_, max_total_wal_size);
+    write_thread_.WaitForMemTableWriters(&mutex_);
     // no need to refcount because drop is happening in write thread, so can't
     // happen while we're in the write thread
     for (auto cfd : *versions_->GetColumnFamilySet()) {
@@ -3427,6 +3591,7 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
         "Flushing all column families. Write buffer is using %" PRIu64
         " bytes out of a total of %" PRIu64 ".",
         write_buffer_.memory_usage(), write_buffer_.buffer_size());
+    write_thread_.WaitForMemTableWriters(&mutex_);
     // no need to refcount because drop is happening in write thread, so can't
     // happen while we're in the write thread
     for (auto cfd : *versions_->GetColumnFamilySet()) {
@@ -3450,6 +3615,9 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
   }
 
   if (UNLIKELY(status.ok() && !flush_scheduler_.Empty())) {
+    // a pipelined group may still be inserting into the memtables that
+    // are about to be switched
+    write_thread_.WaitForMemTableWriters(&mutex_);
     status = ScheduleFlushes(&context);
   }
 
@@ -3465,14 +3633,21 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
     PERF_TIMER_START(write_pre_and_post_process_time);
   }
 
-  uint64_t last_sequence = versions_->LastSequence();
+  // With pipelined writes the groups ahead of this one may still be
+  // applying to the memtables, so their sequence numbers are allocated
+  // but not yet published.
+  uint64_t last_sequence =
+      std::max(versions_->LastSequence(), last_allocated_sequence_);
+  SequenceNumber current_sequence = 0;
   WriteThread::Writer* last_writer = &w;
   autovector<WriteBatch*> write_batch_group;
+  autovector<WriteThread::Writer*> write_group;
   bool need_wal_sync = !write_options.disableWAL && write_options.sync;
+  bool pipelined = false;
 
   if (status.ok()) {
-    last_batch_group_size_ =
-        write_thread_.BuildBatchGroup(&last_writer, &write_batch_group);
+    last_batch_group_size_ = write_thread_.BuildBatchGroup(
+        &w, &last_writer, &write_batch_group, &write_group);
 
     if (need_wal_sync) {
       while (logs_.front().getting_synced) {
@@ -3489,6 +3664,12 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
     // and protects against concurrent loggers and concurrent writes
     // into memtables
 
+    if (callback != nullptr) {
+      // The callback looks for conflicts in the memtables, so the pipelined
+      // groups ahead of this one have to be in them already
+      write_thread_.WaitForMemTableWriters(&mutex_);
+    }
+
     mutex_.Unlock();
 
     if (callback != nullptr) {
@@ -3513,7 +3694,7 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
         }
       }
 
-      const SequenceNumber current_sequence = last_sequence + 1;
+      current_sequence = last_sequence + 1;
       WriteBatchInternal::SetSequence(updates, current_sequence);
       int my_batch_count = WriteBatchInternal::Count(updates);
       last_sequence += my_batch_count;
@@ -3561,12 +3742,15 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
           log_dir_synced_ = true;
         }
       }
-      if (status.ok()) {
+      // Once its WAL record is written, a pipelined group applies to the
+      // memtables after handing the writer queue to the next leader
+      pipelined = status.ok() && db_options_.enable_pipelined_write;
+      if (status.ok() && !pipelined) {
         PERF_TIMER_GUARD(write_memtable_time);
 
-        status = WriteBatchInternal::InsertInto(
-            updates, column_family_memtables_.get(),
-            write_options.ignore_missing_column_families, 0, this, false);
+        status = InsertBatchGroup(write_options, write_group,
+                                  write_batch_group, updates, current_sequence,
+                                  column_family_memtables_.get());
         // A non-OK status here indicates iteration failure (either in-memory
         // writebatch corruption (very bad), or the client specified invalid
         // column family).  This will later on trigger bg_error_.
@@ -3594,7 +3778,7 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
         default_cf_internal_stats_->AddDBStats(
             InternalStats::WAL_FILE_BYTES, log_size);
       }
-      if (status.ok()) {
+      if (status.ok() && !pipelined) {
         versions_->SetLastSequence(last_sequence);
       }
   } else {
@@ -3621,13 +3805,95 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
     log_sync_cv_.SignalAll();
   }
 
-  write_thread_.ExitWriteThread(&w, last_writer, status);
+  if (pipelined) {
+    last_allocated_sequence_ = last_sequence;
+    mutex_.Unlock();
+    write_thread_.EnterMemTableWriter(&w, last_writer);
+    TEST_SYNC_POINT("DBImpl::WriteImpl:BeforePipelinedMemTableWrite");
 
-  mutex_.Unlock();
+    // the writer queue may hand column_family_memtables_ to the next
+    // leader, so the group seeks its own
+    ColumnFamilyMemTablesImpl column_family_memtables(
+        versions_->GetColumnFamilySet(), &flush_scheduler_);
+    {
+      PERF_TIMER_GUARD(write_memtable_time);
+      status = InsertBatchGroup(write_options, write_group,
+                                write_batch_group, nullptr, current_sequence,
+                                &column_family_memtables);
+      SetTickerCount(stats_, SEQUENCE_NUMBER, last_sequence);
+    }
+
+    mutex_.Lock();
+    // groups leave the memtable stage in WAL order, which keeps the
+    // published sequence monotonic
+    if (status.ok()) {
+      versions_->SetLastSequence(last_sequence);
+    }
+    if (db_options_.paranoid_checks && !status.ok() &&
+        !status.IsBusy() && bg_error_.ok()) {
+      bg_error_ = status;
+    }
+    mutex_.Unlock();
+    write_thread_.ExitMemTableWriter(write_group, status);
+  } else {
+    mutex_.Unlock();
+    write_thread_.ExitWriteThread(&w, last_writer, status);
+  }
 
   return status;
 }
 
+Status DBImpl::InsertBatchGroup(
+    const WriteOptions& write_options,
+    const autovector<WriteThread::Writer*>& write_group,
+    const autovector<WriteBatch*>& write_batch_group, WriteBatch* updates,
+    SequenceNumber sequence, ColumnFamilyMemTables* memtables) {
+  bool parallel = db_options_.allow_concurrent_memtable_write &&
+                  write_group.size() > 1;
+
+  if (parallel || updates == nullptr) {
+    // Every batch of the group is inserted on its own, starting at the
+    // sequence number its entries got in the WAL record.
+    for (auto* batch : write_batch_group) {
+      WriteBatchInternal::SetSequence(batch, sequence);
+      sequence += WriteBatchInternal::Count(batch);
+    }
+  }
+
+  if (parallel) {
+    // Every writer of the group inserts its own batch. The group only
+    // becomes visible once all of them are done, through the caller's
+    // SetLastSequence().
+    WriteThread::ParallelGroup pg;
+    write_thread_.LaunchParallelFollowers(&pg, write_group);
+
+    WriteThread::Writer* leader = write_group[0];
+    Status s = WriteBatchInternal::InsertInto(
+        leader->batch, memtables, write_options.ignore_missing_column_families,
+        0, this, false, true);
+
+    write_thread_.CompleteParallelWorker(leader, s);
+    return pg.status;
+  }
+
+  if (updates != nullptr) {
+    return WriteBatchInternal::InsertInto(
+        updates, memtables, write_options.ignore_missing_column_families, 0,
+        this, false);
+  }
+
+  Status s;
+  for (auto* batch : write_batch_group) {
+    s = WriteBatchInternal::InsertInto(
+        batch, memtables, write_options.ignore_missing_column_families, 0,
+        this, false);
+    if (!s.ok()) {
+      break;
+    }
+  }
+  return s;
+}
+
 // REQUIRES: mutex_ is held
 // REQUIRES: this thread is currently at the front of the writer queue
 Status DBImpl::DelayWrite(uint64_t num_bytes) {
@@ -3696,6 +3962,7 @@ Status DBImpl::SwitchMemtable(ColumnFamilyData* cfd, WriteContext* context) {
     if (creating_new_log) {
       EnvOptions opt_env_opt =
           env_->OptimizeForLogWrite(env_options_, db_options_);
+      opt_env_opt.write_hint = kWriteLifeTimeShort;
       s = env_->NewWritableFile(
           LogFileName(db_options_.wal_dir, new_log_number), &lfile,
           opt_env_opt);
@@ -3706,7 +3973,8 @@ Status DBImpl::SwitchMemtable(ColumnFamilyData* cfd, WriteContext* context) {
             1.1 * mutable_cf_options.write_buffer_size);
         unique_ptr<WritableFileWriter> file_writer(
             new WritableFileWriter(std::move(lfile), opt_env_opt));
-        new_log = new log::Writer(std::move(file_writer));
+        new_log = new log::Writer(std::move(file_writer),
+                                  db_options_.wal_compression);
         log_dir_synced_ = false;
       }
     }
@@ -4224,6 +4492,9 @@ Status DB::Open(const DBOptions& db_options, const std::string& dbname,
 
   for (auto& cfd : column_families) {
     s = CheckCompressionSupported(cfd.options);
+    if (s.ok() && db_options.allow_concurrent_memtable_write) {
+      s = CheckConcurrentWritesSupported(cfd.options);
+    }
     if (!s.ok()) {
       return s;
     }
@@ -4281,6 +4552,7 @@ Status DB::Open(const DBOptions& db_options, const std::string& dbname,
     EnvOptions soptions(db_options);
     EnvOptions opt_env_options =
         impl->db_options_.env->OptimizeForLogWrite(soptions, impl->db_options_);
+    opt_env_options.write_hint = kWriteLifeTimeShort;
     s = impl->db_options_.env->NewWritableFile(
         LogFileName(impl->db_options_.wal_dir, new_log_number), &lfile,
         opt_env_options);
@@ -4291,8 +4563,8 @@ Status DB::Open(const DBOptions& db_options, const std::string& dbname,
           new WritableFileWriter(std::move(lfile), opt_env_options));
       impl->logs_.emplace_back(
           new_log_number,
-          std::unique_ptr<log::Writer>(
-            new log::Writer(std::move(file_writer))));
+          std::unique_ptr<log::Writer>(new log::Writer(
+              std::move(file_writer), impl->db_options_.wal_compression)));
 
       // set column family handles
       for (auto cf : column_families) {
@@ -4371,6 +4643,9 @@ Status DB::Open(const DBOptions& db_options, const std::string& dbname,
   if (s.ok()) {
     Log(InfoLogLevel::INFO_LEVEL, impl->db_options_.info_log, "DB pointer %p",
         impl);
+    impl->env_->SetGarbageCollectionOptions(
+        impl->db_options_.rate_limiter.get(),
+        impl->db_options_.statistics.get());
     *dbptr = impl;
   } else {
     for (auto* h : *handles) {
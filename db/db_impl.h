@@ -15,6 +15,7 @@
 #include <list>
 #include <utility>
 #include <list>
+#include <unordered_map>
 #include <vector>
 #include <string>
 
@@ -437,10 +438,42 @@ class DBImpl : public DB {
   Status WriteLevel0TableForRecovery(int job_id, ColumnFamilyData* cfd,
                                      MemTable* mem, VersionEdit* edit);
 
+  // Level-0 tables written in the background while the WAL is replayed
+  // with DBOptions::wal_recovery_threads > 1. Protected by mutex_.
+  struct RecoveryFlushes {
+    int pending = 0;
+    // first failure among the table writes
+    Status status;
+  };
+  struct RecoveryFlushJob;
+
+  // Hands the memtables that flush_scheduler_ reports full to background
+  // WriteLevel0TableForRecovery calls, and gives their column families new
+  // memtables. Waits while too many table writes are pending. Returns the
+  // first failure of the background writes so far.
+  // REQUIRES: mutex_ held, no memtable insert running
+  Status ScheduleRecoveryFlushes(
+      int job_id, uint64_t log_number, SequenceNumber max_sequence,
+      std::unordered_map<int, VersionEdit>* version_edits,
+      RecoveryFlushes* flushes);
+  static void BGWorkRecoveryFlush(void* arg);
+  // REQUIRES: mutex_ held
+  void WaitForRecoveryFlushes(RecoveryFlushes* flushes);
+
   // num_bytes: for slowdown case, delay time is calculated based on
   //            `num_bytes` going through.
   Status DelayWrite(uint64_t num_bytes);
 
+  // Inserts the batches of a write group, whose WAL record starts at
+  // sequence, into the memtables. updates is the group merged into a single
+  // batch, or nullptr to insert the batches one by one.
+  // REQUIRES: mutex_ not held, write_group[0] is the group's leader
+  Status InsertBatchGroup(const WriteOptions& write_options,
+                          const autovector<WriteThread::Writer*>& write_group,
+                          const autovector<WriteBatch*>& write_batch_group,
+                          WriteBatch* updates, SequenceNumber sequence,
+                          ColumnFamilyMemTables* memtables);
+
   Status ScheduleFlushes(WriteContext* context);
 
   Status SwitchMemtable(ColumnFamilyData* cfd, WriteContext* context);
@@ -602,6 +635,11 @@ class DBImpl : public DB {
   // sleep if it uses up the quota.
   uint64_t last_batch_group_size_;
 
+  // Last sequence number handed to a write group whose memtable inserts may
+  // still be pending (enable_pipelined_write). Written by the head of the
+  // writer queue.
+  SequenceNumber last_allocated_sequence_;
+
   FlushScheduler flush_scheduler_;
 
   SnapshotList snapshots_;
@@ -13,6 +13,7 @@
 #if !(defined NDEBUG) || !defined(OS_WIN)
 
 #include "port/stack_trace.h"
+#include "util/compression.h"
 #include "util/db_test_util.h"
 
 namespace rocksdb {
@@ -226,6 +227,48 @@ TEST_F(DBTestXactLogIterator, TransactionLogIteratorBatchOperations) {
   } while (ChangeCompactOptions());
 }
 
+TEST_F(DBTestXactLogIterator, TransactionLogIteratorCompressedWal) {
+  if (!Zlib_Supported()) {
+    return;
+  }
+  Options options = OptionsForLogIterTest();
+  options.wal_compression = kZlibCompression;
+  DestroyAndReopen(options);
+  for (int i = 0; i < 100; i++) {
+    ASSERT_OK(Put(Key(i), DummyString(1024)));
+  }
+  VectorLogPtr wal_files;
+  ASSERT_OK(dbfull()->GetSortedWalFiles(wal_files));
+  uint64_t wal_size = 0;
+  for (const auto& wal : wal_files) {
+    wal_size += wal->SizeFileBytes();
+  }
+  ASSERT_LT(wal_size, 100U * 1024U / 4U);
+  {
+    auto iter = OpenTransactionLogIter(0);
+    ExpectRecords(100, iter);
+  }
+  {
+    auto iter = OpenTransactionLogIter(50);
+    BatchResult res = iter->GetBatch();
+    ASSERT_EQ(50U, res.sequence);
+    ASSERT_EQ(1, res.writeBatchPtr->Count());
+  }
+
+  // The data survives recovery, and compressed and uncompressed logs can
+  // follow each other
+  options.wal_compression = kNoCompression;
+  Reopen(options);
+  ASSERT_OK(Put(Key(100), DummyString(1024)));
+  options.wal_compression = kZlibCompression;
+  Reopen(options);
+  for (int i = 0; i <= 100; i++) {
+    ASSERT_EQ(DummyString(1024), Get(Key(i)));
+  }
+  auto iter = OpenTransactionLogIter(0);
+  ExpectRecords(101, iter);
+}
+
 TEST_F(DBTestXactLogIterator, TransactionLogIteratorBlobs) {
   Options options = OptionsForLogIterTest();
   DestroyAndReopen(options);
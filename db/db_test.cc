@@ -418,6 +418,50 @@ TEST_F(DBTest, ParanoidFileChecks) {
             TestGetTickerCount(options, BLOCK_CACHE_ADD));
 }
 
+TEST_F(DBTest, MmapReadsPinBlocksInCache) {
+  Options options = CurrentOptions();
+  options.allow_mmap_reads = true;
+  options.compression = kNoCompression;
+  options.statistics = rocksdb::CreateDBStatistics();
+  BlockBasedTableOptions table_options;
+  table_options.block_cache = NewLRUCache(8 << 20);
+  table_options.block_size = 1024;
+  options.table_factory.reset(new BlockBasedTableFactory(table_options));
+  DestroyAndReopen(options);
+
+  const int N = 1000;
+  for (int i = 0; i < N; i++) {
+    ASSERT_OK(Put(Key(i), "v" + ToString(i)));
+  }
+  ASSERT_OK(Flush());
+
+  // Uncompressed blocks of a mapped file are cached in place
+  for (int i = 0; i < N; i++) {
+    ASSERT_EQ("v" + ToString(i), Get(Key(i)));
+  }
+  uint64_t added = TestGetTickerCount(options, BLOCK_CACHE_ADD);
+  ASSERT_GT(added, 0U);
+
+  SetPerfLevel(kEnableCount);
+  perf_context.Reset();
+  for (int i = 0; i < N; i++) {
+    ASSERT_EQ("v" + ToString(i), Get(Key(i)));
+  }
+  ASSERT_EQ(0U, perf_context.block_read_count);
+  SetPerfLevel(kDisable);
+  ASSERT_EQ(added, TestGetTickerCount(options, BLOCK_CACHE_ADD));
+  ASSERT_GE(TestGetTickerCount(options, BLOCK_CACHE_HIT),
+            static_cast<uint64_t>(N));
+
+  // The table is closed and deleted while its blocks are still cached
+  dbfull()->TEST_CompactRange(0, nullptr, nullptr);
+  for (int i = 0; i < N; i++) {
+    ASSERT_EQ("v" + ToString(i), Get(Key(i)));
+  }
+  Close();
+  table_options.block_cache->SetCapacity(0);
+}
+
 TEST_F(DBTest, GetPropertiesOfAllTablesTest) {
   Options options = CurrentOptions();
   options.level0_file_num_compaction_trigger = 8;
@@ -988,6 +1032,127 @@ TEST_F(DBTest, GetFilterByPrefixBloom) {
   ASSERT_EQ(TestGetTickerCount(options, BLOOM_FILTER_USEFUL), 2);
 }
 
+TEST_F(DBTest, MemtableWholeKeyBloom) {
+  // Without a prefix extractor, then with one whose prefixes all the keys
+  // share, so that only whole keys can tell them apart
+  for (bool use_prefix : {false, true}) {
+    Options options = CurrentOptions();
+    options.memtable_prefix_bloom_bits = 16 * 1024;
+    options.memtable_whole_key_filtering = true;
+    if (use_prefix) {
+      options.prefix_extractor.reset(NewFixedPrefixTransform(3));
+    }
+    DestroyAndReopen(options);
+
+    for (int i = 0; i < 100; ++i) {
+      ASSERT_OK(Put(Key(i), "v" + ToString(i)));
+    }
+
+    SetPerfLevel(kEnableCount);
+    perf_context.Reset();
+    for (int i = 0; i < 100; ++i) {
+      ASSERT_EQ("v" + ToString(i), Get(Key(i)));
+    }
+    ASSERT_EQ(100U, perf_context.bloom_memtable_hit_count);
+    ASSERT_EQ(0U, perf_context.bloom_memtable_miss_count);
+
+    perf_context.Reset();
+    for (int i = 100; i < 1100; ++i) {
+      ASSERT_EQ("NOT_FOUND", Get(Key(i)));
+    }
+    // a few false positives at most
+    ASSERT_GT(perf_context.bloom_memtable_miss_count, 990U);
+    ASSERT_EQ(1000U, perf_context.bloom_memtable_hit_count +
+                         perf_context.bloom_memtable_miss_count);
+
+    // Batched lookups consult the bloom as well
+    perf_context.Reset();
+    std::vector<std::string> key_data = {Key(7), Key(5000), Key(42)};
+    std::vector<Slice> keys(key_data.begin(), key_data.end());
+    std::vector<std::string> values;
+    std::vector<Status> statuses = db_->MultiGet(ReadOptions(), keys, &values);
+    ASSERT_OK(statuses[0]);
+    ASSERT_EQ("v7", values[0]);
+    ASSERT_TRUE(statuses[1].IsNotFound());
+    ASSERT_OK(statuses[2]);
+    ASSERT_EQ("v42", values[2]);
+    ASSERT_EQ(3U, perf_context.bloom_memtable_hit_count +
+                      perf_context.bloom_memtable_miss_count);
+    SetPerfLevel(kDisable);
+  }
+}
+
+TEST_F(DBTest, KeyPrefixSkipListOrder) {
+  // Keys that tie on their first 8 bytes, differ only in their padding or
+  // differ in a high byte, in both bytewise orders
+  std::vector<std::string> keys = {
+      "",          std::string("\0", 1), std::string("a\0", 2), "a",
+      "ab",        "abcdefgh",            "abcdefgh0",           "abcdefgh1",
+      "abcdefgi",  "abcdefg",             "\xff",                "\xff\xff",
+      "\x7f\xff",  "zzzzzzzzzzzz",        "zzzzzzzz",            "b"};
+  for (const Comparator* comparator :
+       {BytewiseComparator(), ReverseBytewiseComparator()}) {
+    Options options = CurrentOptions();
+    options.comparator = comparator;
+    options.memtable_factory.reset(NewKeyPrefixSkipListRepFactory());
+    DestroyAndReopen(options);
+
+    Random rnd(301);
+    std::vector<std::string> shuffled = keys;
+    std::random_shuffle(shuffled.begin(), shuffled.end(),
+                        [&](int n) { return rnd.Uniform(n); });
+    for (const auto& key : shuffled) {
+      ASSERT_OK(Put(key, "v" + key));
+    }
+    std::vector<std::string> sorted = keys;
+    std::sort(sorted.begin(), sorted.end(),
+              [&](const std::string& a, const std::string& b) {
+                return comparator->Compare(a, b) < 0;
+              });
+
+    std::unique_ptr<Iterator> iter(db_->NewIterator(ReadOptions()));
+    size_t i = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++i) {
+      ASSERT_LT(i, sorted.size());
+      ASSERT_EQ(sorted[i], iter->key().ToString());
+    }
+    ASSERT_EQ(sorted.size(), i);
+    for (const auto& key : sorted) {
+      iter->Seek(key);
+      ASSERT_TRUE(iter->Valid());
+      ASSERT_EQ(key, iter->key().ToString());
+      ASSERT_EQ("v" + key, Get(key));
+    }
+    ASSERT_EQ("NOT_FOUND", Get("abcdefgh2"));
+  }
+}
+
+TEST_F(DBTest, MemtableBlockPool) {
+  Options options = CurrentOptions();
+  options.statistics = rocksdb::CreateDBStatistics();
+  options.write_buffer_size = 64 * 1024;
+  options.arena_block_size = 8 * 1024;
+  options.memtable_block_pool_size = 1024 * 1024;
+  DestroyAndReopen(options);
+
+  // Each flushed memtable leaves its blocks to the next ones
+  Random rnd(301);
+  std::vector<std::string> values;
+  for (int i = 0; i < 5; i++) {
+    for (int j = 0; j < 50; j++) {
+      values.push_back(RandomString(&rnd, 1000));
+      ASSERT_OK(Put(Key(i * 50 + j), values.back()));
+    }
+    ASSERT_OK(Flush());
+  }
+  for (int i = 0; i < 250; i++) {
+    ASSERT_EQ(values[i], Get(Key(i)));
+  }
+  uint64_t hits = TestGetTickerCount(options, MEMTABLE_BLOCK_POOL_HIT);
+  uint64_t misses = TestGetTickerCount(options, MEMTABLE_BLOCK_POOL_MISS);
+  ASSERT_GT(hits, 3 * misses);
+}
+
 TEST_F(DBTest, WholeKeyFilterProp) {
   Options options = last_options_;
   options.prefix_extractor.reset(NewFixedPrefixTransform(3));
@@ -3759,6 +3924,176 @@ TEST_F(DBTest, BloomFilter) {
   } while (ChangeCompactOptions());
 }
 
+TEST_F(DBTest, BlockedBloomFilter) {
+  Options options = CurrentOptions();
+  options.statistics = rocksdb::CreateDBStatistics();
+  BlockBasedTableOptions table_options;
+  table_options.filter_policy.reset(NewBlockedBloomFilterPolicy(10));
+  options.table_factory.reset(NewBlockBasedTableFactory(table_options));
+  DestroyAndReopen(options);
+
+  const int N = 10000;
+  for (int i = 0; i < N; i += 2) {
+    ASSERT_OK(Put(Key(i), "v" + ToString(i)));
+  }
+  Flush();
+
+  for (int i = 0; i < N; i += 2) {
+    ASSERT_EQ("v" + ToString(i), Get(Key(i)));
+  }
+  ASSERT_EQ(0, TestGetTickerCount(options, BLOOM_FILTER_USEFUL));
+  for (int i = 1; i < N; i += 2) {
+    ASSERT_EQ("NOT_FOUND", Get(Key(i)));
+  }
+  // a few false positives at most
+  ASSERT_GT(TestGetTickerCount(options, BLOOM_FILTER_USEFUL), N / 2 * 97 / 100);
+
+  // MultiGet probes the filter with the whole batch
+  options.statistics = rocksdb::CreateDBStatistics();
+  Reopen(options);
+  std::vector<std::string> key_data;
+  for (int i = 0; i < 200; ++i) {
+    key_data.push_back(Key(i));
+  }
+  std::vector<Slice> keys(key_data.begin(), key_data.end());
+  std::vector<std::string> values;
+  std::vector<Status> statuses = db_->MultiGet(ReadOptions(), keys, &values);
+  for (int i = 0; i < 200; ++i) {
+    if (i % 2 == 0) {
+      ASSERT_OK(statuses[i]);
+      ASSERT_EQ("v" + ToString(i), values[i]);
+    } else {
+      ASSERT_TRUE(statuses[i].IsNotFound());
+    }
+  }
+  ASSERT_GT(TestGetTickerCount(options, BLOOM_FILTER_USEFUL), 90);
+}
+
+TEST_F(DBTest, XorFilter) {
+  Options options = CurrentOptions();
+  BlockBasedTableOptions table_options;
+  table_options.filter_policy.reset(NewBloomFilterPolicy(10, false));
+  options.table_factory.reset(NewBlockBasedTableFactory(table_options));
+  options.disable_auto_compactions = true;
+  DestroyAndReopen(options);
+
+  // One table built with the bloom filter, one with the xor filter
+  const int N = 10000;
+  for (int i = 0; i < N; i += 4) {
+    ASSERT_OK(Put(Key(i), "v" + ToString(i)));
+  }
+  Flush();
+  options.statistics = rocksdb::CreateDBStatistics();
+  table_options.filter_policy.reset(NewXorFilterPolicy());
+  options.table_factory.reset(NewBlockBasedTableFactory(table_options));
+  Reopen(options);
+  for (int i = 2; i < N; i += 4) {
+    ASSERT_OK(Put(Key(i), "v" + ToString(i)));
+  }
+  Flush();
+  ASSERT_EQ("2", FilesPerLevel());
+
+  for (int i = 0; i < N; i += 2) {
+    ASSERT_EQ("v" + ToString(i), Get(Key(i)));
+  }
+  // The keys of the older table are ruled out by the filter of the newer one
+  ASSERT_GT(TestGetTickerCount(options, BLOOM_FILTER_USEFUL), N / 4 * 97 / 100);
+
+  options.statistics = rocksdb::CreateDBStatistics();
+  Reopen(options);
+  for (int i = 1; i < N; i += 2) {
+    ASSERT_EQ("NOT_FOUND", Get(Key(i)));
+  }
+  // Both tables rule out a missing key
+  ASSERT_GT(TestGetTickerCount(options, BLOOM_FILTER_USEFUL), N * 97 / 100);
+}
+
+TEST_F(DBTest, DataBlockHashIndex) {
+  Options options = CurrentOptions();
+  BlockBasedTableOptions table_options;
+  table_options.data_block_index_type =
+      BlockBasedTableOptions::kDataBlockBinaryAndHash;
+  table_options.block_restart_interval = 4;
+  options.table_factory.reset(NewBlockBasedTableFactory(table_options));
+  options.disable_auto_compactions = true;
+  DestroyAndReopen(options);
+
+  // Old versions, overwrites, deletions and a snapshot in between, so that
+  // lookups have to skip versions of the same user key
+  const int N = 2000;
+  for (int i = 0; i < N; i += 2) {
+    ASSERT_OK(Put(Key(i), "old" + ToString(i)));
+  }
+  const Snapshot* snapshot = db_->GetSnapshot();
+  for (int i = 0; i < N; i += 2) {
+    if (i % 3 == 0) {
+      ASSERT_OK(Delete(Key(i)));
+    } else {
+      ASSERT_OK(Put(Key(i), "new" + ToString(i)));
+    }
+  }
+  Flush();
+
+  for (int round = 0; round < 2; round++) {
+    std::vector<Slice> keys;
+    std::vector<std::string> key_storage;
+    std::vector<std::string> expected;
+    for (int i = 0; i < N; i++) {
+      std::string value;
+      if (i % 2 != 0) {
+        value = "NOT_FOUND";
+      } else if (i % 3 == 0) {
+        value = "NOT_FOUND";
+      } else {
+        value = "new" + ToString(i);
+      }
+      ASSERT_EQ(value, Get(Key(i)));
+      // The second round's snapshot was taken after the compaction
+      std::string snapshot_value =
+          (round == 0 && i % 2 == 0) ? "old" + ToString(i) : value;
+      ASSERT_EQ(snapshot_value, Get(Key(i), snapshot));
+      key_storage.push_back(Key(i));
+      expected.push_back(value);
+    }
+    for (const auto& k : key_storage) {
+      keys.push_back(k);
+    }
+    std::vector<std::string> values;
+    std::vector<Status> statuses =
+        db_->MultiGet(ReadOptions(), keys, &values);
+    for (int i = 0; i < N; i++) {
+      if (expected[i] == "NOT_FOUND") {
+        ASSERT_TRUE(statuses[i].IsNotFound());
+      } else {
+        ASSERT_OK(statuses[i]);
+        ASSERT_EQ(expected[i], values[i]);
+      }
+    }
+
+    // The tables stay readable by scans
+    std::unique_ptr<Iterator> iter(db_->NewIterator(ReadOptions()));
+    int count = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      count++;
+    }
+    ASSERT_OK(iter->status());
+    ASSERT_EQ(N / 2 - (N / 2 + 2) / 3, count);
+
+    // Then check the same after a compaction dropped the deletions
+    db_->ReleaseSnapshot(snapshot);
+    snapshot = nullptr;
+    dbfull()->TEST_CompactRange(0, nullptr, nullptr);
+    snapshot = db_->GetSnapshot();
+    for (int i = 0; i < N; i += 2) {
+      if (i % 3 != 0) {
+        ASSERT_OK(Put(Key(i), "new" + ToString(i)));
+      }
+    }
+    Flush();
+  }
+  db_->ReleaseSnapshot(snapshot);
+}
+
 TEST_F(DBTest, BloomFilterRate) {
   while (ChangeFilterOptions()) {
     Options options = CurrentOptions();
@@ -4719,6 +5054,83 @@ TEST_F(DBTest, kSkipAnyCorruptedRecords) {
 }
 
 
+// Test scope:
+// - Replaying the WAL with several threads recovers the same data, and
+//   fails in the same cases, as replaying it with one
+TEST_F(DBTest, ParallelWALRecoveryModes) {
+  const int wal = RecoveryTestHelper::kWALFileOffset +
+                  RecoveryTestHelper::kWALFilesCount / 2;
+
+  for (auto mode : {WALRecoveryMode::kTolerateCorruptedTailRecords,
+                    WALRecoveryMode::kAbsoluteConsistency,
+                    WALRecoveryMode::kPointInTimeRecovery,
+                    WALRecoveryMode::kSkipAnyCorruptedRecords}) {
+    for (auto trunc : {true, false}) { /* Corruption style */
+      bool serial_ok = false;
+      size_t serial_row_count = 0;
+      for (int threads : {1, 4}) {
+        Options options = CurrentOptions();
+        RecoveryTestHelper::FillData(this, options);
+        RecoveryTestHelper::CorruptWAL(this, options, /*off=*/.3,
+                                       /*len%=*/.1, wal, trunc);
+
+        options.wal_recovery_mode = mode;
+        options.wal_recovery_threads = threads;
+        options.create_if_missing = false;
+        const bool ok = TryReopen(options).ok();
+        const size_t row_count = ok ? RecoveryTestHelper::GetData(this) : 0;
+        if (threads == 1) {
+          serial_ok = ok;
+          serial_row_count = row_count;
+        } else {
+          ASSERT_EQ(serial_ok, ok);
+          ASSERT_EQ(serial_row_count, row_count);
+        }
+      }
+    }
+  }
+}
+
+TEST_F(DBTest, ParallelWALRecoveryWithFlushes) {
+  Options options = CurrentOptions();
+  options.max_background_flushes = 2;
+  CreateAndReopenWithCF({"pikachu"}, options);
+
+  Random rnd(301);
+  std::map<std::string, std::string> expected[2];
+  for (int i = 0; i < 20000; ++i) {
+    int cf = i % 2;
+    std::string key = "key" + ToString(rnd.Uniform(5000));
+    if (rnd.OneIn(10)) {
+      ASSERT_OK(Delete(cf, key));
+      expected[cf].erase(key);
+    } else {
+      std::string value = RandomString(&rnd, 100);
+      ASSERT_OK(Put(cf, key, value));
+      expected[cf][key] = value;
+    }
+  }
+  ASSERT_EQ(NumTableFilesAtLevel(0, 0), 0);
+  ASSERT_EQ(NumTableFilesAtLevel(0, 1), 0);
+
+  // Memtables fill up several times while the logs are replayed
+  options.write_buffer_size = 100000;
+  options.wal_recovery_threads = 4;
+  options.disable_auto_compactions = true;
+  ReopenWithColumnFamilies({"default", "pikachu"}, options);
+  ASSERT_GT(NumTableFilesAtLevel(0, 0), 1);
+  ASSERT_GT(NumTableFilesAtLevel(0, 1), 1);
+
+  for (int cf = 0; cf < 2; ++cf) {
+    for (int i = 0; i < 5000; ++i) {
+      std::string key = "key" + ToString(i);
+      auto iter = expected[cf].find(key);
+      ASSERT_EQ(iter == expected[cf].end() ? "NOT_FOUND" : iter->second,
+                Get(cf, key));
+    }
+  }
+}
+
 // Multi-threaded test:
 namespace {
 
@@ -4962,6 +5374,108 @@ TEST_F(DBTest, GroupCommitTest) {
   } while (ChangeOptions(kSkipNoSeekToLast));
 }
 
+TEST_F(DBTest, ConcurrentMemtableWriteGroupCommit) {
+  Options options = CurrentOptions();
+  options.env = env_;
+  options.allow_concurrent_memtable_write = true;
+  // small memtables so that the writers of a group race to schedule flushes
+  options.write_buffer_size = 64 << 10;
+  options.statistics = rocksdb::CreateDBStatistics();
+  env_->log_write_slowdown_.store(100);
+  DestroyAndReopen(options);
+
+  GCThread thread[kGCNumThreads];
+  for (int id = 0; id < kGCNumThreads; id++) {
+    thread[id].id = id;
+    thread[id].db = db_;
+    thread[id].done = false;
+    env_->StartThread(GCThreadBody, &thread[id]);
+  }
+
+  for (int id = 0; id < kGCNumThreads; id++) {
+    while (thread[id].done == false) {
+      env_->SleepForMicroseconds(100000);
+    }
+  }
+  env_->log_write_slowdown_.store(0);
+
+  ASSERT_GT(TestGetTickerCount(options, WRITE_DONE_BY_OTHER), 0);
+
+  for (int i = 0; i < kGCNumThreads * kGCNumKeys; ++i) {
+    ASSERT_EQ(ToString(i), Get(ToString(i)));
+  }
+
+  Reopen(options);
+  for (int i = 0; i < kGCNumThreads * kGCNumKeys; ++i) {
+    ASSERT_EQ(ToString(i), Get(ToString(i)));
+  }
+}
+
+TEST_F(DBTest, PipelinedWriteGroupCommit) {
+  for (bool concurrent : {false, true}) {
+    Options options = CurrentOptions();
+    options.env = env_;
+    options.enable_pipelined_write = true;
+    options.allow_concurrent_memtable_write = concurrent;
+    // small memtables so that leaders have to drain the pipeline before
+    // switching them
+    options.write_buffer_size = 64 << 10;
+    options.statistics = rocksdb::CreateDBStatistics();
+    env_->log_write_slowdown_.store(100);
+    DestroyAndReopen(options);
+
+    GCThread thread[kGCNumThreads];
+    for (int id = 0; id < kGCNumThreads; id++) {
+      thread[id].id = id;
+      thread[id].db = db_;
+      thread[id].done = false;
+      env_->StartThread(GCThreadBody, &thread[id]);
+    }
+    // writers without a batch have to wait for the pipeline too
+    ASSERT_OK(Flush());
+
+    for (int id = 0; id < kGCNumThreads; id++) {
+      while (thread[id].done == false) {
+        env_->SleepForMicroseconds(100000);
+      }
+    }
+    env_->log_write_slowdown_.store(0);
+
+    ASSERT_GT(TestGetTickerCount(options, WRITE_DONE_BY_OTHER), 0);
+    ASSERT_EQ(static_cast<SequenceNumber>(kGCNumThreads * kGCNumKeys),
+              dbfull()->GetLatestSequenceNumber());
+
+    for (int i = 0; i < kGCNumThreads * kGCNumKeys; ++i) {
+      ASSERT_EQ(ToString(i), Get(ToString(i)));
+    }
+
+    Reopen(options);
+    for (int i = 0; i < kGCNumThreads * kGCNumKeys; ++i) {
+      ASSERT_EQ(ToString(i), Get(ToString(i)));
+    }
+  }
+}
+
+TEST_F(DBTest, ConcurrentMemtableWriteNotSupported) {
+  Options options = CurrentOptions();
+  options.allow_concurrent_memtable_write = true;
+  options.inplace_update_support = true;
+  ASSERT_TRUE(TryReopen(options).IsInvalidArgument());
+
+  options.inplace_update_support = false;
+  options.memtable_factory.reset(new VectorRepFactory());
+  ASSERT_TRUE(TryReopen(options).IsInvalidArgument());
+
+  options.memtable_factory.reset(new SkipListFactory());
+  ASSERT_OK(TryReopen(options));
+
+  ColumnFamilyOptions cf_options(options);
+  cf_options.inplace_update_support = true;
+  ColumnFamilyHandle* handle;
+  ASSERT_TRUE(db_->CreateColumnFamily(cf_options, "inplace", &handle)
+                  .IsInvalidArgument());
+}
+
 namespace {
 typedef std::map<std::string, std::string> KVMap;
 }
@@ -5450,6 +5964,81 @@ TEST_F(DBTest, MultiGetEmpty) {
   } while (ChangeCompactOptions());
 }
 
+TEST_F(DBTest, MultiGetMatchesGet) {
+  // Default tables, then small blocks with a filter, read through the block
+  // cache and without one
+  for (int table_config = 0; table_config < 3; ++table_config) {
+    do {
+      Options options = CurrentOptions();
+      options.merge_operator = MergeOperators::CreateStringAppendOperator();
+      if (table_config > 0) {
+        BlockBasedTableOptions table_options;
+        table_options.filter_policy.reset(NewBloomFilterPolicy(10, false));
+        table_options.block_size = 256;
+        table_options.no_block_cache = (table_config == 2);
+        options.table_factory.reset(NewBlockBasedTableFactory(table_options));
+      }
+      DestroyAndReopen(options);
+      CreateAndReopenWithCF({"pikachu"}, options);
+
+      // Spread puts, deletions and merge operands over the bottom level,
+      // a few level-0 files and the memtables.
+      Random rnd(301);
+      const int kNumKeys = 300;
+      for (int round = 0; round < 4; ++round) {
+        for (int i = 0; i < 400; ++i) {
+          int cf = rnd.Uniform(2);
+          std::string key = Key(rnd.Uniform(kNumKeys));
+          switch (rnd.Uniform(4)) {
+            case 0:
+              ASSERT_OK(Delete(cf, key));
+              break;
+            case 1:
+              ASSERT_OK(db_->Merge(WriteOptions(), handles_[cf], key,
+                                   RandomString(&rnd, 5)));
+              break;
+            default:
+              ASSERT_OK(Put(cf, key, RandomString(&rnd, 20)));
+              break;
+          }
+        }
+        if (round < 3) {
+          ASSERT_OK(Flush(0));
+          ASSERT_OK(Flush(1));
+        }
+        if (round == 0) {
+          ASSERT_OK(db_->CompactRange(CompactRangeOptions(), handles_[0],
+                                      nullptr, nullptr));
+          ASSERT_OK(db_->CompactRange(CompactRangeOptions(), handles_[1],
+                                      nullptr, nullptr));
+        }
+      }
+
+      // Unsorted keys, some missing, some repeated, from both column
+      // families
+      std::vector<std::string> key_data;
+      std::vector<ColumnFamilyHandle*> cfs;
+      for (int i = 0; i < 200; ++i) {
+        key_data.push_back(Key(rnd.Uniform(kNumKeys + 20)));
+        cfs.push_back(handles_[rnd.Uniform(2)]);
+      }
+      std::vector<Slice> keys(key_data.begin(), key_data.end());
+      std::vector<std::string> values;
+      std::vector<Status> s = db_->MultiGet(ReadOptions(), cfs, keys, &values);
+      ASSERT_EQ(keys.size(), s.size());
+      ASSERT_EQ(keys.size(), values.size());
+      for (size_t i = 0; i < keys.size(); ++i) {
+        std::string value;
+        Status get_status = db_->Get(ReadOptions(), cfs[i], keys[i], &value);
+        ASSERT_EQ(get_status.ToString(), s[i].ToString());
+        if (get_status.ok()) {
+          ASSERT_EQ(value, values[i]);
+        }
+      }
+    } while (ChangeCompactOptions());
+  }
+}
+
 namespace {
 void PrefixScanInit(DBTest *dbtest) {
   char buf[100];
@@ -5944,6 +6533,33 @@ TEST_F(DBTest, DBIteratorBoundTest) {
   }
 }
 
+TEST_F(DBTest, WriteThreadWaitPerfContext) {
+  // A writer queued behind a long write spins, yields and finally blocks
+  dbfull()->TEST_LockMutex();
+  auto w = dbfull()->TEST_BeginWrite();
+  dbfull()->TEST_UnlockMutex();
+
+  PerfContext writer_perf_context;
+  std::thread writer([&] {
+    SetPerfLevel(kEnableTime);
+    perf_context.Reset();
+    ASSERT_OK(Put("a", "b"));
+    writer_perf_context = perf_context;
+    SetPerfLevel(kDisable);
+  });
+  env_->SleepForMicroseconds(20000);
+
+  dbfull()->TEST_LockMutex();
+  dbfull()->TEST_EndWrite(w);
+  dbfull()->TEST_UnlockMutex();
+  writer.join();
+
+  ASSERT_GT(writer_perf_context.write_thread_spin_nanos, 0U);
+  ASSERT_GT(writer_perf_context.write_thread_yield_nanos, 0U);
+  ASSERT_GT(writer_perf_context.write_thread_block_nanos, 0U);
+  ASSERT_EQ("b", Get("a"));
+}
+
 TEST_F(DBTest, WriteSingleThreadEntry) {
   std::vector<std::thread> threads;
   dbfull()->TEST_LockMutex();
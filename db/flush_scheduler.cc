@@ -12,6 +12,7 @@
 namespace rocksdb {
 
 void FlushScheduler::ScheduleFlush(ColumnFamilyData* cfd) {
+  std::lock_guard<SpinMutex> lock(schedule_mutex_);
 #ifndef NDEBUG
   assert(column_families_set_.find(cfd) == column_families_set_.end());
   column_families_set_.insert(cfd);
@@ -21,6 +22,7 @@ void FlushScheduler::ScheduleFlush(ColumnFamilyData* cfd) {
 }
 
 ColumnFamilyData* FlushScheduler::GetNextColumnFamily() {
+  std::lock_guard<SpinMutex> lock(schedule_mutex_);
   ColumnFamilyData* cfd = nullptr;
   while (column_families_.size() > 0) {
     cfd = column_families_.front();
@@ -44,9 +46,13 @@ ColumnFamilyData* FlushScheduler::GetNextColumnFamily() {
   return cfd;
 }
 
-bool FlushScheduler::Empty() { return column_families_.empty(); }
+bool FlushScheduler::Empty() {
+  std::lock_guard<SpinMutex> lock(schedule_mutex_);
+  return column_families_.empty();
+}
 
 void FlushScheduler::Clear() {
+  std::lock_guard<SpinMutex> lock(schedule_mutex_);
   for (auto cfd : column_families_) {
 #ifndef NDEBUG
     auto itr = column_families_set_.find(cfd);
@@ -10,12 +10,17 @@
 #include <set>
 #include <vector>
 
+#include "util/mutexlock.h"
+
 namespace rocksdb {
 
 class ColumnFamilyData;
 
-// This class is thread-compatible. It's should only be accessed from single
-// write thread (between BeginWrite() and EndWrite())
+// This class is thread-safe. ScheduleFlush() is called by the writers
+// inserting into the memtables, which may run concurrently with each other
+// (allow_concurrent_memtable_write) and with the next write group's leader
+// (enable_pipelined_write). The other methods are called from the write
+// thread.
 class FlushScheduler {
  public:
   FlushScheduler() = default;
@@ -31,6 +36,7 @@ class FlushScheduler {
   void Clear();
 
  private:
+  SpinMutex schedule_mutex_;
   std::deque<ColumnFamilyData*> column_families_;
 #ifndef NDEBUG
   std::set<ColumnFamilyData*> column_families_set_;
@@ -11,6 +11,7 @@
 #pragma once
 #include "db/version_set.h"
 
+#include <atomic>
 #include <vector>
 #include <string>
 
@@ -92,8 +93,7 @@ class InternalStats {
   };
 
   InternalStats(int num_levels, Env* env, ColumnFamilyData* cfd)
-      : db_stats_(INTERNAL_DB_STATS_ENUM_MAX),
-        cf_stats_value_(INTERNAL_CF_STATS_ENUM_MAX),
+      : cf_stats_value_(INTERNAL_CF_STATS_ENUM_MAX),
         cf_stats_count_(INTERNAL_CF_STATS_ENUM_MAX),
         comp_stats_(num_levels),
         stall_leveln_slowdown_count_hard_(num_levels),
@@ -234,8 +234,9 @@ class InternalStats {
     ++cf_stats_count_[type];
   }
 
+  // Writers that do not hold the db mutex update these too
   void AddDBStats(InternalDBStatsType type, uint64_t value) {
-    db_stats_[type] += value;
+    db_stats_[type].fetch_add(value, std::memory_order_relaxed);
   }
 
   uint64_t GetBackgroundErrorCount() const { return bg_error_count_; }
@@ -256,7 +257,7 @@ class InternalStats {
   void DumpCFStats(std::string* value);
 
   // Per-DB stats
-  std::vector<uint64_t> db_stats_;
+  std::atomic<uint64_t> db_stats_[INTERNAL_DB_STATS_ENUM_MAX];
   // Per-ColumnFamily stats
   std::vector<uint64_t> cf_stats_value_;
   std::vector<uint64_t> cf_stats_count_;
@@ -11,25 +11,38 @@
 // See ../doc/log_format.txt for more detail.
 
 #pragma once
+#include <stdint.h>
+
 namespace rocksdb {
 namespace log {
 
 enum RecordType {
-  // Zero is reserved for preallocated files
+  // Zero is reserved for preallocated files; with a payload it is padding
+  // written by Writer::Sync()
   kZeroType = 0,
   kFullType = 1,
 
   // For fragments
   kFirstType = 2,
   kMiddleType = 3,
-  kLastType = 4
+  kLastType = 4,
+
+  // Start a record whose payload is compressed: the compressed bytes
+  // followed by their CompressionType, like a table block and its trailer.
+  // A fragmented one continues with kMiddleType and kLastType.
+  kCompressedFullType = 5,
+  kCompressedFirstType = 6
 };
-static const int kMaxRecordType = kLastType;
+static const int kMaxRecordType = kCompressedFirstType;
 
 static const unsigned int kBlockSize = 32768;
 
 // Header is checksum (4 bytes), type (1 byte), length (2 bytes).
 static const int kHeaderSize = 4 + 1 + 2;
 
+// Compressed records are compressed like the blocks of tables of this
+// format_version (see include/rocksdb/table.h)
+static const uint32_t kCompressionFormatVersion = 2;
+
 }  // namespace log
 }  // namespace rocksdb
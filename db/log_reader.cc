@@ -11,6 +11,7 @@
 
 #include <stdio.h>
 #include "rocksdb/env.h"
+#include "table/format.h"
 #include "util/coding.h"
 #include "util/crc32c.h"
 #include "util/file_reader_writer.h"
@@ -73,6 +74,8 @@ bool Reader::ReadRecord(Slice* record, std::string* scratch,
   scratch->clear();
   record->clear();
   bool in_fragmented_record = false;
+  // Whether the record started with a compressed type
+  bool compressed_record = false;
   // Record offset of the logical record that we're reading
   // 0 is a dummy value to make compilers happy
   uint64_t prospective_record_offset = 0;
@@ -97,7 +100,21 @@ bool Reader::ReadRecord(Slice* record, std::string* scratch,
         last_record_offset_ = prospective_record_offset;
         return true;
 
+      case kCompressedFullType:
+        if (in_fragmented_record && !scratch->empty()) {
+          ReportCorruption(scratch->size(), "partial record without end(3)");
+        }
+        in_fragmented_record = false;
+        prospective_record_offset = physical_record_offset;
+        scratch->clear();
+        if (UncompressRecord(fragment, record, scratch)) {
+          last_record_offset_ = prospective_record_offset;
+          return true;
+        }
+        break;
+
       case kFirstType:
+      case kCompressedFirstType:
         if (in_fragmented_record && !scratch->empty()) {
           // Handle bug in earlier versions of log::Writer where
           // it could emit an empty kFirstType record at the tail end
@@ -108,6 +125,7 @@ bool Reader::ReadRecord(Slice* record, std::string* scratch,
         prospective_record_offset = physical_record_offset;
         scratch->assign(fragment.data(), fragment.size());
         in_fragmented_record = true;
+        compressed_record = (record_type == kCompressedFirstType);
         break;
 
       case kMiddleType:
@@ -125,7 +143,13 @@ bool Reader::ReadRecord(Slice* record, std::string* scratch,
                            "missing start of fragmented record(2)");
         } else {
           scratch->append(fragment.data(), fragment.size());
-          *record = Slice(*scratch);
+          if (!compressed_record) {
+            *record = Slice(*scratch);
+          } else if (!UncompressRecord(Slice(*scratch), record, scratch)) {
+            in_fragmented_record = false;
+            scratch->clear();
+            break;
+          }
           last_record_offset_ = prospective_record_offset;
           return true;
         }
@@ -166,6 +190,24 @@ bool Reader::ReadRecord(Slice* record, std::string* scratch,
   return false;
 }
 
+bool Reader::UncompressRecord(const Slice& payload, Slice* record,
+                              std::string* scratch) {
+  // The payload ends with the compression type, as a block does
+  BlockContents contents;
+  Status s = Status::Corruption("missing compression type");
+  if (!payload.empty() && payload[payload.size() - 1] != kNoCompression) {
+    s = UncompressBlockContents(payload.data(), payload.size() - 1, &contents,
+                                kCompressionFormatVersion);
+  }
+  if (!s.ok()) {
+    ReportDrop(payload.size(), s);
+    return false;
+  }
+  scratch->assign(contents.data.data(), contents.data.size());
+  *record = Slice(*scratch);
+  return true;
+}
+
 uint64_t Reader::LastRecordOffset() {
   return last_record_offset_;
 }
@@ -326,6 +368,11 @@ unsigned int Reader::ReadPhysicalRecord(Slice* result,
 
     buffer_.remove_prefix(kHeaderSize + length);
 
+    if (type == kZeroType) {
+      // Padding written by Writer::Sync(); carries no data
+      continue;
+    }
+
     // Skip physical record that started before initial_offset_
     if (end_of_buffer_offset_ - buffer_.size() - kHeaderSize - length <
         initial_offset_) {
@@ -124,6 +124,12 @@ class Reader {
   unsigned int ReadPhysicalRecord(Slice* result,
                                   bool report_eof_inconsistency = false);
 
+  // Sets *record to the uncompressed contents of a compressed record's
+  // payload, kept in *scratch. Reports the payload as dropped and returns
+  // false if it does not uncompress.
+  bool UncompressRecord(const Slice& payload, Slice* record,
+                        std::string* scratch);
+
   // Reports dropped bytes to the reporter.
   // buffer_ must be updated to remove the dropped bytes prior to invocation.
   void ReportCorruption(size_t bytes, const char* reason);
@@ -11,6 +11,7 @@
 #include "db/log_writer.h"
 #include "rocksdb/env.h"
 #include "util/coding.h"
+#include "util/compression.h"
 #include "util/crc32c.h"
 #include "util/file_reader_writer.h"
 #include "util/random.h"
@@ -49,9 +50,12 @@ class LogTest : public testing::Test {
    public:
     std::string contents_;
 
+    size_t sync_alignment_;
+
     explicit StringDest(Slice& reader_contents) :
       WritableFile(),
       contents_(""),
+      sync_alignment_(0),
       reader_contents_(reader_contents),
       last_flush_(0) {
       reader_contents_ = Slice(contents_.data(), 0);
@@ -69,6 +73,7 @@ class LogTest : public testing::Test {
       return Status::OK();
     }
     virtual Status Sync() override { return Status::OK(); }
+    virtual size_t GetSyncAlignment() override { return sync_alignment_; }
     virtual Status Append(const Slice& slice) override {
       contents_.append(slice.data(), slice.size());
       return Status::OK();
@@ -195,13 +200,13 @@ class LogTest : public testing::Test {
   static uint64_t initial_offset_last_record_offsets_[];
 
  public:
-  LogTest()
+  explicit LogTest(CompressionType compression = kNoCompression)
       : reader_contents_(),
         dest_holder_(
             test::GetWritableFileWriter(new StringDest(reader_contents_))),
         source_holder_(
             test::GetSequentialFileReader(new StringSource(reader_contents_))),
-        writer_(std::move(dest_holder_)),
+        writer_(std::move(dest_holder_), compression),
         reader_(std::move(source_holder_), &report_, true /*checksum*/,
                 0 /*initial_offset*/) {}
 
@@ -213,6 +218,16 @@ class LogTest : public testing::Test {
     return dest_contents().size();
   }
 
+  void SetSyncAlignment(size_t alignment) {
+    auto dest = dynamic_cast<StringDest*>(writer_.file()->writable_file());
+    assert(dest);
+    dest->sync_alignment_ = alignment;
+  }
+
+  void Sync() {
+    ASSERT_OK(writer_.Sync(false));
+  }
+
   std::string Read(const bool report_eof_inconsistency = false) {
     std::string scratch;
     Slice record;
@@ -370,6 +385,44 @@ TEST_F(LogTest, Fragmentation) {
   ASSERT_EQ("EOF", Read());
 }
 
+TEST_F(LogTest, PaddedSync) {
+  const size_t alignment = 4096;
+  SetSyncAlignment(alignment);
+
+  Write("foo");
+  Sync();
+  ASSERT_EQ(alignment, WrittenBytes());
+  Sync();
+  ASSERT_EQ(alignment, WrittenBytes());
+
+  // Leaves exactly a header's worth of room in the unit: the padding
+  // spills over to the next one
+  Write(std::string(alignment - 2 * kHeaderSize, 'x'));
+  Sync();
+  ASSERT_EQ(3 * alignment, WrittenBytes());
+
+  Write(BigString("large", 3 * kBlockSize));
+  Sync();
+  ASSERT_EQ(0U, WrittenBytes() % alignment);
+
+  // Fill up to a header short of the block end: the trailer is the padding
+  const size_t left = kBlockSize - WrittenBytes() % kBlockSize;
+  Write(std::string(left - 2 * kHeaderSize, 'y'));
+  Sync();
+  ASSERT_EQ(0U, WrittenBytes() % kBlockSize);
+
+  Write("bar");
+
+  ASSERT_EQ("foo", Read());
+  ASSERT_EQ(std::string(alignment - 2 * kHeaderSize, 'x'), Read());
+  ASSERT_EQ(BigString("large", 3 * kBlockSize), Read());
+  ASSERT_EQ(std::string(left - 2 * kHeaderSize, 'y'), Read());
+  ASSERT_EQ("bar", Read());
+  ASSERT_EQ("EOF", Read());
+  ASSERT_EQ(0U, DroppedBytes());
+  ASSERT_EQ("", ReportMessage());
+}
+
 TEST_F(LogTest, MarginalTrailer) {
   // Make a trailer that is exactly the same length as an empty record.
   const int n = kBlockSize - 2*kHeaderSize;
@@ -703,6 +756,52 @@ TEST_F(LogTest, ClearEofError2) {
   ASSERT_EQ("OK", MatchError("read error"));
 }
 
+class CompressedLogTest : public LogTest {
+ public:
+  CompressedLogTest() : LogTest(kZlibCompression) {}
+};
+
+TEST_F(CompressedLogTest, ReadWrite) {
+  if (!Zlib_Supported()) {
+    return;
+  }
+  Random rnd(301);
+  std::string printable;
+  test::RandomString(&rnd, 3 * kBlockSize, &printable);
+  // Compresses well, does not compress, spans blocks even once compressed
+  std::vector<std::string> records = {BigString("abc", 10000), "foo", "",
+                                      printable, BigString("xyz", 100)};
+  size_t total = 0;
+  for (const auto& record : records) {
+    Write(record);
+    total += record.size();
+  }
+  ASSERT_LT(WrittenBytes(), total * 7 / 8);
+  for (const auto& record : records) {
+    ASSERT_EQ(record, Read());
+  }
+  ASSERT_EQ("EOF", Read());
+  ASSERT_EQ(0U, DroppedBytes());
+}
+
+TEST_F(CompressedLogTest, CorruptedPayload) {
+  if (!Zlib_Supported()) {
+    return;
+  }
+  std::string record = BigString("abc", 10000);
+  Write(record);
+  size_t len = WrittenBytes() - kHeaderSize;
+  ASSERT_LT(len, record.size());
+  Write("bar");
+  // Damage the compressed bytes past the size prefix, keep the checksum good
+  IncrementByte(kHeaderSize + 8, 1);
+  FixChecksum(0, static_cast<int>(len));
+  ASSERT_EQ("bar", Read());
+  ASSERT_EQ("EOF", Read());
+  ASSERT_EQ(len, DroppedBytes());
+  ASSERT_EQ("OK", MatchError("Zlib"));
+}
+
 }  // namespace log
 }  // namespace rocksdb
 
@@ -11,6 +11,7 @@
 
 #include <stdint.h>
 #include "rocksdb/env.h"
+#include "table/format.h"
 #include "util/coding.h"
 #include "util/crc32c.h"
 #include "util/file_reader_writer.h"
@@ -18,8 +19,9 @@
 namespace rocksdb {
 namespace log {
 
-Writer::Writer(unique_ptr<WritableFileWriter>&& dest)
-    : dest_(std::move(dest)), block_offset_(0) {
+Writer::Writer(unique_ptr<WritableFileWriter>&& dest,
+               CompressionType compression)
+    : dest_(std::move(dest)), block_offset_(0), compression_(compression) {
   for (int i = 0; i <= kMaxRecordType; i++) {
     char t = static_cast<char>(i);
     type_crc_[i] = crc32c::Value(&t, 1);
@@ -33,6 +35,20 @@ Status Writer::AddRecord(const Slice& slice) {
   const char* ptr = slice.data();
   size_t left = slice.size();
 
+  bool compressed = false;
+  if (compression_ != kNoCompression) {
+    CompressionType type = compression_;
+    compressed_.clear();
+    CompressBlock(slice, CompressionOptions(), &type,
+                  kCompressionFormatVersion, &compressed_);
+    if (type != kNoCompression) {
+      compressed_.push_back(static_cast<char>(type));
+      ptr = compressed_.data();
+      left = compressed_.size();
+      compressed = true;
+    }
+  }
+
   // Fragment the record if necessary and emit it.  Note that if slice
   // is empty, we still want to iterate once to emit a single
   // zero-length record
@@ -60,9 +76,9 @@ Status Writer::AddRecord(const Slice& slice) {
     RecordType type;
     const bool end = (left == fragment_length);
     if (begin && end) {
-      type = kFullType;
+      type = compressed ? kCompressedFullType : kFullType;
     } else if (begin) {
-      type = kFirstType;
+      type = compressed ? kCompressedFirstType : kFirstType;
     } else if (end) {
       type = kLastType;
     } else {
@@ -77,6 +93,45 @@ Status Writer::AddRecord(const Slice& slice) {
   return s;
 }
 
+Status Writer::Sync(bool use_fsync) {
+  Status s = PadToAlignment(dest_->GetSyncAlignment());
+  if (s.ok()) {
+    s = dest_->Sync(use_fsync);
+  }
+  return s;
+}
+
+Status Writer::PadToAlignment(size_t alignment) {
+  // Blocks have to start on an aligned offset too.
+  if (alignment == 0 || kBlockSize % alignment != 0) {
+    return Status::OK();
+  }
+
+  size_t pad = (alignment - block_offset_ % alignment) % alignment;
+  if (pad == 0) {
+    return Status::OK();
+  }
+
+  // A padding record needs a non-empty payload: readers drop the rest of
+  // the block on an empty kZeroType record
+  if (pad <= static_cast<size_t>(kHeaderSize)) {
+    if (block_offset_ + pad == kBlockSize) {
+      // Not worth a record at the end of the block; the reader skips it
+      block_offset_ = 0;
+      Status s = dest_->Append(Slice("\x00\x00\x00\x00\x00\x00", pad));
+      if (s.ok()) {
+        s = dest_->Flush();
+      }
+      return s;
+    }
+    // Too short for a padding record; pad the next unit as well
+    pad += alignment;
+  }
+
+  std::string zeros(pad - kHeaderSize, '\0');
+  return EmitPhysicalRecord(kZeroType, zeros.data(), zeros.size());
+}
+
 Status Writer::EmitPhysicalRecord(RecordType t, const char* ptr, size_t n) {
   assert(n <= 0xffff);  // Must fit in two bytes
   assert(block_offset_ + kHeaderSize + n <= kBlockSize);
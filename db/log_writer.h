@@ -10,7 +10,9 @@
 #pragma once
 #include <memory>
 #include <stdint.h>
+#include <string>
 #include "db/log_format.h"
+#include "rocksdb/options.h"
 #include "rocksdb/slice.h"
 #include "rocksdb/status.h"
 
@@ -41,6 +43,11 @@ namespace log {
  * Data is written out in kBlockSize chunks. If next record does not fit
  * into the space left, the leftover space will be padded with \0.
  *
+ * Sync() on a file with a sync alignment (see
+ * WritableFile::GetSyncAlignment()) first pads the file up to the next
+ * aligned offset with a kZeroType record whose payload is all \0; readers
+ * skip such records.
+ *
  * Record format:
  *
  * +---------+-----------+-----------+--- ... ---+
@@ -50,28 +57,40 @@ namespace log {
  * CRC = 32bit hash computed over the payload using CRC
  * Size = Length of the payload data
  * Type = Type of record
- *        (kZeroType, kFullType, kFirstType, kLastType, kMiddleType )
+ *        (kZeroType, kFullType, kFirstType, kLastType, kMiddleType,
+ *         kCompressedFullType, kCompressedFirstType)
  *        The type is used to group a bunch of records together to represent
  *        blocks that are larger than kBlockSize
  * Payload = Byte stream as long as specified by the payload size
  *
+ * A writer with a compression type compresses each logical record on its
+ * own and starts it with kCompressedFullType or kCompressedFirstType; a
+ * record that does not compress well is written as is.
+ *
  */
 class Writer {
  public:
   // Create a writer that will append data to "*dest".
   // "*dest" must be initially empty.
   // "*dest" must remain live while this Writer is in use.
-  explicit Writer(unique_ptr<WritableFileWriter>&& dest);
+  // Records are compressed with "compression" where it pays off.
+  explicit Writer(unique_ptr<WritableFileWriter>&& dest,
+                  CompressionType compression = kNoCompression);
   ~Writer();
 
   Status AddRecord(const Slice& slice);
 
+  // Pads the file to its sync alignment, if it has one, and syncs it.
+  Status Sync(bool use_fsync);
+
   WritableFileWriter* file() { return dest_.get(); }
   const WritableFileWriter* file() const { return dest_.get(); }
 
  private:
   unique_ptr<WritableFileWriter> dest_;
   int block_offset_;       // Current offset in block
+  const CompressionType compression_;
+  std::string compressed_;  // Payload of the last compressed record
 
   // crc32c values for all supported record types.  These are
   // pre-computed to reduce the overhead of computing the crc of the
@@ -79,6 +98,7 @@ class Writer {
   uint32_t type_crc_[kMaxRecordType + 1];
 
   Status EmitPhysicalRecord(RecordType type, const char* ptr, size_t length);
+  Status PadToAlignment(size_t alignment);
 
   // No copying allowed
   Writer(const Writer&);
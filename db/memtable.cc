@@ -42,6 +42,8 @@ MemTableOptions::MemTableOptions(
         mutable_cf_options.memtable_prefix_bloom_probes),
     memtable_prefix_bloom_huge_page_tlb_size(
         mutable_cf_options.memtable_prefix_bloom_huge_page_tlb_size),
+    memtable_whole_key_filtering(
+        mutable_cf_options.memtable_whole_key_filtering),
     inplace_update_support(ioptions.inplace_update_support),
     inplace_update_num_locks(mutable_cf_options.inplace_update_num_locks),
     inplace_callback(ioptions.inplace_callback),
@@ -59,7 +61,8 @@ MemTable::MemTable(const InternalKeyComparator& cmp,
       moptions_(ioptions, mutable_cf_options),
       refs_(0),
       kArenaBlockSize(OptimizeBlockSize(moptions_.arena_block_size)),
-      arena_(moptions_.arena_block_size),
+      arena_(moptions_.arena_block_size, 0 /* huge_page_size */,
+             write_buffer != nullptr ? write_buffer->block_pool() : nullptr),
       allocator_(&arena_, write_buffer),
       table_(ioptions.memtable_factory->CreateMemTableRep(
           comparator_, &allocator_, ioptions.prefix_extractor,
@@ -83,8 +86,9 @@ MemTable::MemTable(const InternalKeyComparator& cmp,
   // if should_flush_ == true without an entry inserted, something must have
   // gone wrong already.
   assert(!should_flush_);
-  if (prefix_extractor_ && moptions_.memtable_prefix_bloom_bits > 0) {
-    prefix_bloom_.reset(new DynamicBloom(
+  if ((prefix_extractor_ || moptions_.memtable_whole_key_filtering) &&
+      moptions_.memtable_prefix_bloom_bits > 0) {
+    bloom_filter_.reset(new DynamicBloom(
         &allocator_,
         moptions_.memtable_prefix_bloom_bits, ioptions.bloom_locality,
         moptions_.memtable_prefix_bloom_probes, nullptr,
@@ -96,7 +100,7 @@ MemTable::MemTable(const InternalKeyComparator& cmp,
 MemTable::~MemTable() { assert(refs_ == 0); }
 
 size_t MemTable::ApproximateMemoryUsage() {
-  size_t arena_usage = arena_.ApproximateMemoryUsage();
+  size_t arena_usage = allocator_.ApproximateMemoryUsage();
   size_t table_usage = table_->ApproximateMemoryUsage();
   // let MAX_USAGE =  std::numeric_limits<size_t>::max()
   // then if arena_usage + total_usage >= MAX_USAGE, return MAX_USAGE.
@@ -120,7 +124,7 @@ bool MemTable::ShouldFlushNow() const {
   // If arena still have room for new block allocation, we can safely say it
   // shouldn't flush.
   auto allocated_memory =
-      table_->ApproximateMemoryUsage() + arena_.MemoryAllocatedBytes();
+      table_->ApproximateMemoryUsage() + allocator_.MemoryAllocatedBytes();
 
   // if we can still allocate one more block without exceeding the
   // over-allocation ratio, then we should not flush.
@@ -163,7 +167,24 @@ bool MemTable::ShouldFlushNow() const {
   // NOTE: the average percentage of waste space of this approach can be counted
   // as: "arena block size * 0.25 / write buffer size". User who specify a small
   // write buffer size and/or big arena block size may suffer.
-  return arena_.AllocatedAndUnused() < kArenaBlockSize / 4;
+  return allocator_.AllocatedAndUnused() < kArenaBlockSize / 4;
+}
+
+void MemTable::UpdateFlushState() {
+  // should_flush_ only ever goes from false to true, so concurrent writers
+  // racing here all store the same value.
+  if (!should_flush_.load(std::memory_order_relaxed) && ShouldFlushNow()) {
+    should_flush_.store(true, std::memory_order_relaxed);
+  }
+}
+
+MemTable::KeyComparator::KeyComparator(const InternalKeyComparator& c)
+    : comparator(c), prefix_order_(kNoPrefix) {
+  if (c.user_comparator() == BytewiseComparator()) {
+    prefix_order_ = kBytewisePrefix;
+  } else if (c.user_comparator() == ReverseBytewiseComparator()) {
+    prefix_order_ = kReverseBytewisePrefix;
+  }
 }
 
 int MemTable::KeyComparator::operator()(const char* prefix_len_key1,
@@ -182,6 +203,22 @@ int MemTable::KeyComparator::operator()(const char* prefix_len_key,
   return comparator.Compare(a, key);
 }
 
+uint64_t MemTable::KeyComparator::KeyPrefix(const char* prefix_len_key) const {
+  if (prefix_order_ == kNoPrefix) {
+    return 0;
+  }
+  Slice user_key = ExtractUserKey(GetLengthPrefixedSlice(prefix_len_key));
+  // The first 8 bytes, big-endian and zero-padded, so that the numbers sort
+  // like the bytes; keys differing only past them get equal numbers.
+  uint64_t prefix = 0;
+  size_t n = std::min(user_key.size(), sizeof(prefix));
+  for (size_t i = 0; i < n; i++) {
+    prefix |= static_cast<uint64_t>(static_cast<unsigned char>(user_key[i]))
+              << (56 - 8 * i);
+  }
+  return prefix_order_ == kBytewisePrefix ? prefix : ~prefix;
+}
+
 Slice MemTableRep::UserKey(const char* key) const {
   Slice slice = GetLengthPrefixedSlice(key);
   return Slice(slice.data(), slice.size() - 8);
@@ -211,7 +248,7 @@ class MemTableIterator: public Iterator {
         valid_(false),
         arena_mode_(arena != nullptr) {
     if (prefix_extractor_ != nullptr && !read_options.total_order_seek) {
-      bloom_ = mem.prefix_bloom_.get();
+      bloom_ = mem.bloom_filter_.get();
       iter_ = mem.table_->GetDynamicPrefixIterator(arena);
     } else {
       iter_ = mem.table_->GetIterator(arena);
@@ -313,7 +350,7 @@ uint64_t MemTable::ApproximateSize(const Slice& start_ikey,
 
 void MemTable::Add(SequenceNumber s, ValueType type,
                    const Slice& key, /* user key */
-                   const Slice& value) {
+                   const Slice& value, bool allow_concurrent) {
   // Format of an entry is concatenation of:
   //  key_size     : varint32 of internal_key.size()
   //  key bytes    : char[internal_key.size()]
@@ -337,32 +374,69 @@ void MemTable::Add(SequenceNumber s, ValueType type,
   p = EncodeVarint32(p, val_size);
   memcpy(p, value.data(), val_size);
   assert((unsigned)(p + val_size - buf) == (unsigned)encoded_len);
-  table_->Insert(handle);
-  num_entries_.store(num_entries_.load(std::memory_order_relaxed) + 1,
+  if (!allow_concurrent) {
+    table_->Insert(handle);
+    num_entries_.store(num_entries_.load(std::memory_order_relaxed) + 1,
+                       std::memory_order_relaxed);
+    data_size_.store(data_size_.load(std::memory_order_relaxed) + encoded_len,
                      std::memory_order_relaxed);
-  data_size_.store(data_size_.load(std::memory_order_relaxed) + encoded_len,
-                   std::memory_order_relaxed);
-  if (type == kTypeDeletion) {
-    num_deletes_++;
-  }
+    if (type == kTypeDeletion) {
+      num_deletes_.store(num_deletes_.load(std::memory_order_relaxed) + 1,
+                         std::memory_order_relaxed);
+    }
 
-  if (prefix_bloom_) {
-    assert(prefix_extractor_);
-    prefix_bloom_->Add(prefix_extractor_->Transform(key));
-  }
+    if (bloom_filter_) {
+      if (prefix_extractor_) {
+        bloom_filter_->Add(prefix_extractor_->Transform(key));
+      }
+      if (moptions_.memtable_whole_key_filtering) {
+        bloom_filter_->Add(key);
+      }
+    }
+
+    // The first sequence number inserted into the memtable
+    assert(first_seqno_ == 0 || s > first_seqno_);
+    if (first_seqno_ == 0) {
+      first_seqno_.store(s, std::memory_order_relaxed);
 
-  // The first sequence number inserted into the memtable
-  assert(first_seqno_ == 0 || s > first_seqno_);
-  if (first_seqno_ == 0) {
-    first_seqno_ = s;
+      if (earliest_seqno_ == kMaxSequenceNumber) {
+        earliest_seqno_.store(GetFirstSequenceNumber(),
+                              std::memory_order_relaxed);
+      }
+      assert(first_seqno_.load() >= earliest_seqno_.load());
+    }
+  } else {
+    table_->InsertConcurrently(handle);
 
-    if (earliest_seqno_ == kMaxSequenceNumber) {
-      earliest_seqno_ = first_seqno_;
+    num_entries_.fetch_add(1, std::memory_order_relaxed);
+    data_size_.fetch_add(encoded_len, std::memory_order_relaxed);
+    if (type == kTypeDeletion) {
+      num_deletes_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (bloom_filter_) {
+      if (prefix_extractor_) {
+        bloom_filter_->AddConcurrently(prefix_extractor_->Transform(key));
+      }
+      if (moptions_.memtable_whole_key_filtering) {
+        bloom_filter_->AddConcurrently(key);
+      }
+    }
+
+    // atomically update first_seqno_ and earliest_seqno_.
+    uint64_t cur_seq_num = first_seqno_.load(std::memory_order_relaxed);
+    while ((cur_seq_num == 0 || s < cur_seq_num) &&
+           !first_seqno_.compare_exchange_weak(cur_seq_num, s)) {
+    }
+    uint64_t cur_earliest_seqno =
+        earliest_seqno_.load(std::memory_order_relaxed);
+    while (
+        (cur_earliest_seqno == kMaxSequenceNumber || s < cur_earliest_seqno) &&
+        !earliest_seqno_.compare_exchange_weak(cur_earliest_seqno, s)) {
     }
-    assert(first_seqno_ >= earliest_seqno_);
   }
 
-  should_flush_ = ShouldFlushNow();
+  UpdateFlushState();
 }
 
 // Callback from MemTable::Get()
@@ -495,6 +569,24 @@ static bool SaveValue(void* arg, const char* entry) {
   return false;
 }
 
+bool MemTable::KeyMayMatch(const Slice& user_key) const {
+  if (!bloom_filter_) {
+    return true;
+  }
+  bool may_match;
+  if (moptions_.memtable_whole_key_filtering) {
+    may_match = bloom_filter_->MayContain(user_key);
+  } else {
+    may_match = bloom_filter_->MayContain(prefix_extractor_->Transform(user_key));
+  }
+  if (may_match) {
+    PERF_COUNTER_ADD(bloom_memtable_hit_count, 1);
+  } else {
+    PERF_COUNTER_ADD(bloom_memtable_miss_count, 1);
+  }
+  return may_match;
+}
+
 bool MemTable::Get(const LookupKey& key, std::string* value, Status* s,
                    MergeContext* merge_context, SequenceNumber* seq) {
   // The sequence number is updated synchronously in version_set.h
@@ -508,9 +600,8 @@ bool MemTable::Get(const LookupKey& key, std::string* value, Status* s,
   bool found_final_value = false;
   bool merge_in_progress = s->IsMergeInProgress();
 
-  if (prefix_bloom_ &&
-      !prefix_bloom_->MayContain(prefix_extractor_->Transform(user_key))) {
-    // iter is null if prefix bloom says the key does not exist
+  if (!KeyMayMatch(user_key)) {
+    // iter is null if the bloom says the key does not exist
     *seq = kMaxSequenceNumber;
   } else {
     Saver saver;
@@ -540,6 +631,75 @@ bool MemTable::Get(const LookupKey& key, std::string* value, Status* s,
   return found_final_value;
 }
 
+void MemTable::MultiGet(const MultiGetKeys& keys) {
+  if (IsEmpty()) {
+    return;
+  }
+  PERF_TIMER_GUARD(get_from_memtable_time);
+
+  struct KeySaver {
+    MultiGetKeyContext* key;
+    Saver saver;
+    bool found_final_value;
+    bool merge_in_progress;
+  };
+  // reserved up front, the savers point into their own element
+  std::vector<KeySaver> key_savers;
+  key_savers.reserve(keys.size());
+  size_t num_lookups = 0;
+  for (auto key : keys) {
+    if (key->done) {
+      continue;
+    }
+    ++num_lookups;
+    if (!KeyMayMatch(key->lkey.user_key())) {
+      continue;
+    }
+    key_savers.emplace_back();
+    KeySaver& ks = key_savers.back();
+    ks.key = key;
+    ks.found_final_value = false;
+    ks.merge_in_progress = key->status->IsMergeInProgress();
+    Saver& saver = ks.saver;
+    saver.status = key->status;
+    saver.found_final_value = &ks.found_final_value;
+    saver.merge_in_progress = &ks.merge_in_progress;
+    saver.key = &key->lkey;
+    saver.value = key->value;
+    saver.seq = kMaxSequenceNumber;
+    saver.mem = this;
+    saver.merge_context = &key->merge_context;
+    saver.merge_operator = moptions_.merge_operator;
+    saver.logger = moptions_.info_log;
+    saver.inplace_update_support = moptions_.inplace_update_support;
+    saver.statistics = moptions_.statistics;
+    saver.env_ = env_;
+  }
+
+  if (!key_savers.empty()) {
+    std::vector<const LookupKey*> lkeys;
+    std::vector<void*> savers;
+    lkeys.reserve(key_savers.size());
+    savers.reserve(key_savers.size());
+    for (auto& ks : key_savers) {
+      lkeys.push_back(&ks.key->lkey);
+      savers.push_back(&ks.saver);
+    }
+    table_->MultiGet(key_savers.size(), lkeys.data(), savers.data(),
+                     SaveValue);
+  }
+
+  for (auto& ks : key_savers) {
+    if (ks.found_final_value) {
+      ks.key->done = true;
+    } else if (ks.merge_in_progress) {
+      // No change to value, since we have not yet found a Put/Delete
+      *ks.key->status = Status::MergeInProgress("");
+    }
+  }
+  PERF_COUNTER_ADD(get_from_memtable_count, num_lookups);
+}
+
 void MemTable::Update(SequenceNumber seq,
                       const Slice& key,
                       const Slice& value) {
@@ -656,16 +816,16 @@ bool MemTable::UpdateCallback(SequenceNumber seq,
               }
             }
             RecordTick(moptions_.statistics, NUMBER_KEYS_UPDATED);
-            should_flush_ = ShouldFlushNow();
+            UpdateFlushState();
             return true;
           } else if (status == UpdateStatus::UPDATED) {
             Add(seq, kTypeValue, key, Slice(str_value));
             RecordTick(moptions_.statistics, NUMBER_KEYS_WRITTEN);
-            should_flush_ = ShouldFlushNow();
+            UpdateFlushState();
             return true;
           } else if (status == UpdateStatus::UPDATE_FAILED) {
             // No action required. Return.
-            should_flush_ = ShouldFlushNow();
+            UpdateFlushState();
             return true;
           }
         }
@@ -723,4 +883,13 @@ void MemTableRep::Get(const LookupKey& k, void* callback_args,
   }
 }
 
+void MemTableRep::MultiGet(size_t num_keys, const LookupKey* const* keys,
+                           void* const* callback_args,
+                           bool (*callback_func)(void* arg,
+                                                 const char* entry)) {
+  for (size_t i = 0; i < num_keys; ++i) {
+    Get(*keys[i], callback_args[i], callback_func);
+  }
+}
+
 }  // namespace rocksdb
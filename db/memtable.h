@@ -14,6 +14,7 @@
 #include <deque>
 #include <vector>
 #include "db/dbformat.h"
+#include "db/multiget_context.h"
 #include "db/skiplist.h"
 #include "db/version_edit.h"
 #include "rocksdb/db.h"
@@ -41,6 +42,7 @@ struct MemTableOptions {
   uint32_t memtable_prefix_bloom_bits;
   uint32_t memtable_prefix_bloom_probes;
   size_t memtable_prefix_bloom_huge_page_tlb_size;
+  bool memtable_whole_key_filtering;
   bool inplace_update_support;
   size_t inplace_update_num_locks;
   UpdateStatus (*inplace_callback)(char* existing_value,
@@ -71,11 +73,22 @@ class MemTable {
  public:
   struct KeyComparator : public MemTableRep::KeyComparator {
     const InternalKeyComparator comparator;
-    explicit KeyComparator(const InternalKeyComparator& c) : comparator(c) { }
+    explicit KeyComparator(const InternalKeyComparator& c);
     virtual int operator()(const char* prefix_len_key1,
                            const char* prefix_len_key2) const override;
     virtual int operator()(const char* prefix_len_key,
                            const Slice& key) const override;
+    virtual uint64_t KeyPrefix(const char* prefix_len_key) const override;
+
+   private:
+    // How KeyPrefix() maps the leading bytes of the user key to a number;
+    // only the built-in bytewise orders have such a mapping.
+    enum PrefixOrder {
+      kNoPrefix,
+      kBytewisePrefix,
+      kReverseBytewisePrefix,
+    };
+    PrefixOrder prefix_order_;
   };
 
   // MemTables are reference counted.  The initial reference count
@@ -123,10 +136,18 @@ class MemTable {
   // This method heuristically determines if the memtable should continue to
   // host more data.
   bool ShouldScheduleFlush() const {
-    return flush_scheduled_ == false && should_flush_;
+    return flush_scheduled_.load(std::memory_order_relaxed) == false &&
+           should_flush_.load(std::memory_order_relaxed);
   }
 
-  void MarkFlushScheduled() { flush_scheduled_ = true; }
+  // Returns true if this call is the one that scheduled the flush. Writers
+  // inserting concurrently may all observe ShouldScheduleFlush().
+  bool MarkFlushScheduled() {
+    bool expected = false;
+    return flush_scheduled_.compare_exchange_strong(expected, true,
+                                                    std::memory_order_relaxed,
+                                                    std::memory_order_relaxed);
+  }
 
   // Return an iterator that yields the contents of the memtable.
   //
@@ -146,11 +167,12 @@ class MemTable {
   // specified sequence number and with the specified type.
   // Typically value will be empty if type==kTypeDeletion.
   //
-  // REQUIRES: external synchronization to prevent simultaneous
-  // operations on the same MemTable.
+  // REQUIRES: if allow_concurrent = false, external synchronization to
+  // prevent simultaneous operations on the same MemTable.
   void Add(SequenceNumber seq, ValueType type,
            const Slice& key,
-           const Slice& value);
+           const Slice& value,
+           bool allow_concurrent = false);
 
   // If memtable contains a value for key, store it in *value and return true.
   // If memtable contains a deletion for key, store a NotFound() error
@@ -174,6 +196,12 @@ class MemTable {
     return Get(key, value, s, merge_context, &seq);
   }
 
+  // Looks up every key of keys that is not done yet, as Get() does, in a
+  // single walk over the memtable. Keys whose value or deletion was found
+  // are marked done; the others are left in MergeInProgress if operands
+  // were found.
+  void MultiGet(const MultiGetKeys& keys);
+
   // Attempts to update the new_value inplace, else does normal Add
   // Pseudocode
   //   if key exists in current memtable && prev_value is of type kTypeValue
@@ -219,7 +247,9 @@ class MemTable {
   // Get total number of deletes in the mem table.
   // REQUIRES: external synchronization to prevent simultaneous
   // operations on the same MemTable (unless this Memtable is immutable).
-  uint64_t num_deletes() const { return num_deletes_; }
+  uint64_t num_deletes() const {
+    return num_deletes_.load(std::memory_order_relaxed);
+  }
 
   // Returns the edits area that is needed for flushing the memtable
   VersionEdit* GetEdits() { return &edit_; }
@@ -227,13 +257,13 @@ class MemTable {
   // Returns if there is no entry inserted to the mem table.
   // REQUIRES: external synchronization to prevent simultaneous
   // operations on the same MemTable (unless this Memtable is immutable).
-  bool IsEmpty() const { return first_seqno_ == 0; }
+  bool IsEmpty() const { return first_seqno_.load() == 0; }
 
   // Returns the sequence number of the first element that was inserted
   // into the memtable.
   // REQUIRES: external synchronization to prevent simultaneous
   // operations on the same MemTable (unless this Memtable is immutable).
-  SequenceNumber GetFirstSequenceNumber() { return first_seqno_; }
+  SequenceNumber GetFirstSequenceNumber() { return first_seqno_.load(); }
 
   // Returns the sequence number that is guaranteed to be smaller than or equal
   // to the sequence number of any key that could be inserted into this
@@ -242,7 +272,9 @@ class MemTable {
   //
   // If the earliest sequence number could not be determined,
   // kMaxSequenceNumber will be returned.
-  SequenceNumber GetEarliestSequenceNumber() { return earliest_seqno_; }
+  SequenceNumber GetEarliestSequenceNumber() {
+    return earliest_seqno_.load();
+  }
 
   // Returns the next active logfile number when this memtable is about to
   // be flushed to storage
@@ -292,6 +324,9 @@ class MemTable {
   // Dynamically check if we can add more incoming entries
   bool ShouldFlushNow() const;
 
+  // Updates should_flush_; safe to call from concurrent inserts.
+  void UpdateFlushState();
+
   friend class MemTableIterator;
   friend class MemTableBackwardIterator;
   friend class MemTableList;
@@ -307,7 +342,7 @@ class MemTable {
   // Total data size of all data inserted
   std::atomic<uint64_t> data_size_;
   std::atomic<uint64_t> num_entries_;
-  uint64_t num_deletes_;
+  std::atomic<uint64_t> num_deletes_;
 
   // These are used to manage memtable flushes to storage
   bool flush_in_progress_; // started the flush
@@ -319,11 +354,11 @@ class MemTable {
   VersionEdit edit_;
 
   // The sequence number of the kv that was inserted first
-  SequenceNumber first_seqno_;
+  std::atomic<SequenceNumber> first_seqno_;
 
   // The db sequence number at the time of creation or kMaxSequenceNumber
   // if not set.
-  SequenceNumber earliest_seqno_;
+  std::atomic<SequenceNumber> earliest_seqno_;
 
   // The log files earlier than this number can be deleted.
   uint64_t mem_next_logfile_number_;
@@ -335,14 +370,20 @@ class MemTable {
   MemTable(const MemTable&);
   void operator=(const MemTable&);
 
+  // Returns false if the bloom filter says that user_key is not in the
+  // memtable
+  bool KeyMayMatch(const Slice& user_key) const;
+
   const SliceTransform* const prefix_extractor_;
-  std::unique_ptr<DynamicBloom> prefix_bloom_;
+  // holds the prefixes of the keys if there is a prefix_extractor_, and the
+  // whole user keys if memtable_whole_key_filtering is set
+  std::unique_ptr<DynamicBloom> bloom_filter_;
 
   // a flag indicating if a memtable has met the criteria to flush
-  bool should_flush_;
+  std::atomic<bool> should_flush_;
 
   // a flag indicating if flush has been scheduled
-  bool flush_scheduled_;
+  std::atomic<bool> flush_scheduled_;
   Env* env_;
 };
 
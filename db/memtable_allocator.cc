@@ -17,6 +17,7 @@ namespace rocksdb {
 
 MemTableAllocator::MemTableAllocator(Arena* arena, WriteBuffer* write_buffer)
     : arena_(arena), write_buffer_(write_buffer), bytes_allocated_(0) {
+  UpdateArenaStats();
 }
 
 MemTableAllocator::~MemTableAllocator() {
@@ -24,21 +25,37 @@ MemTableAllocator::~MemTableAllocator() {
 }
 
 char* MemTableAllocator::Allocate(size_t bytes) {
+  std::lock_guard<SpinMutex> lock(alloc_mutex_);
   assert(write_buffer_ != nullptr);
   bytes_allocated_ += bytes;
   write_buffer_->ReserveMem(bytes);
-  return arena_->Allocate(bytes);
+  char* result = arena_->Allocate(bytes);
+  UpdateArenaStats();
+  return result;
 }
 
 char* MemTableAllocator::AllocateAligned(size_t bytes, size_t huge_page_size,
                                          Logger* logger) {
+  std::lock_guard<SpinMutex> lock(alloc_mutex_);
   assert(write_buffer_ != nullptr);
   bytes_allocated_ += bytes;
   write_buffer_->ReserveMem(bytes);
-  return arena_->AllocateAligned(bytes, huge_page_size, logger);
+  char* result = arena_->AllocateAligned(bytes, huge_page_size, logger);
+  UpdateArenaStats();
+  return result;
+}
+
+void MemTableAllocator::UpdateArenaStats() {
+  approximate_memory_usage_.store(arena_->ApproximateMemoryUsage(),
+                                  std::memory_order_relaxed);
+  memory_allocated_bytes_.store(arena_->MemoryAllocatedBytes(),
+                                std::memory_order_relaxed);
+  allocated_and_unused_.store(arena_->AllocatedAndUnused(),
+                              std::memory_order_relaxed);
 }
 
 void MemTableAllocator::DoneAllocating() {
+  std::lock_guard<SpinMutex> lock(alloc_mutex_);
   if (write_buffer_ != nullptr) {
     write_buffer_->FreeMem(bytes_allocated_);
     write_buffer_ = nullptr;
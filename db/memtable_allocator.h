@@ -9,9 +9,13 @@
 //
 // This is used by the MemTable to allocate write buffer memory. It connects
 // to WriteBuffer so we can track and enforce overall write buffer limits.
+// Allocations are serialized so that all the writers of a write group can
+// insert into the same memtable concurrently.
 
 #pragma once
+#include <atomic>
 #include "util/allocator.h"
+#include "util/mutexlock.h"
 
 namespace rocksdb {
 
@@ -34,10 +38,28 @@ class MemTableAllocator : public Allocator {
   // the write buffer's limit.
   void DoneAllocating();
 
+  // Snapshots of the arena counters, taken after every allocation. They can
+  // be read without synchronizing with concurrent allocations.
+  size_t ApproximateMemoryUsage() const {
+    return approximate_memory_usage_.load(std::memory_order_relaxed);
+  }
+  size_t MemoryAllocatedBytes() const {
+    return memory_allocated_bytes_.load(std::memory_order_relaxed);
+  }
+  size_t AllocatedAndUnused() const {
+    return allocated_and_unused_.load(std::memory_order_relaxed);
+  }
+
  private:
+  void UpdateArenaStats();
+
   Arena* arena_;
   WriteBuffer* write_buffer_;
   size_t bytes_allocated_;
+  SpinMutex alloc_mutex_;
+  std::atomic<size_t> approximate_memory_usage_;
+  std::atomic<size_t> memory_allocated_bytes_;
+  std::atomic<size_t> allocated_and_unused_;
 
   // No copying allowed
   MemTableAllocator(const MemTableAllocator&);
@@ -92,6 +92,12 @@ bool MemTableListVersion::Get(const LookupKey& key, std::string* value,
   return GetFromList(&memlist_, key, value, s, merge_context, seq);
 }
 
+void MemTableListVersion::MultiGet(const MultiGetKeys& keys) {
+  for (auto& memtable : memlist_) {
+    memtable->MultiGet(keys);
+  }
+}
+
 bool MemTableListVersion::GetFromHistory(const LookupKey& key,
                                          std::string* value, Status* s,
                                          MergeContext* merge_context,
@@ -62,6 +62,10 @@ class MemTableListVersion {
     return Get(key, value, s, merge_context, &seq);
   }
 
+  // Looks up the keys not done yet in all the memtables, starting from the
+  // most recent one, see MemTable::MultiGet().
+  void MultiGet(const MultiGetKeys& keys);
+
   // Similar to Get(), but searches the Memtable history of memtables that
   // have already been flushed.  Should only be used from in-memory only
   // queries (such as Transaction validation) as the history may contain
@@ -0,0 +1,37 @@
+//  Copyright (c) 2013, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+//
+#pragma once
+#include <string>
+#include "db/dbformat.h"
+#include "db/merge_context.h"
+#include "rocksdb/status.h"
+#include "util/autovector.h"
+
+namespace rocksdb {
+
+// The state of one key of a batched MultiGet as it goes through the
+// memtables and then the levels of a column family.
+struct MultiGetKeyContext {
+  MultiGetKeyContext(const Slice& user_key, SequenceNumber snapshot,
+                     std::string* _value, Status* _status)
+      : lkey(user_key, snapshot),
+        value(_value),
+        status(_status),
+        done(false) {}
+
+  LookupKey lkey;
+  std::string* value;
+  // OK or MergeInProgress until the lookup is done
+  Status* status;
+  MergeContext merge_context;
+  // Set once a value, a deletion or an error was found
+  bool done;
+};
+
+// The keys of a column family, in ascending order of lkey.
+typedef autovector<MultiGetKeyContext*> MultiGetKeys;
+
+}  // namespace rocksdb
@@ -56,6 +56,11 @@ class SkipList {
   // REQUIRES: nothing that compares equal to key is currently in the list.
   void Insert(const Key& key);
 
+  // Like Insert, but external synchronization is not required.  May be
+  // called concurrently with other calls to InsertConcurrently, but not
+  // with calls to Insert.  The allocator must be thread-safe.
+  void InsertConcurrently(const Key& key);
+
   // Returns true iff an entry that compares equal to key is in the list.
   bool Contains(const Key& key) const;
 
@@ -107,6 +112,10 @@ class SkipList {
   };
 
  private:
+  // Upper bound on max_height for lists that allow InsertConcurrently,
+  // which keeps its splice on the stack.
+  static const int kMaxPossibleHeight = 32;
+
   const int32_t kMaxHeight_;
   const int32_t kBranching_;
 
@@ -116,14 +125,18 @@ class SkipList {
 
   Node* const head_;
 
-  // Modified only by Insert().  Read racily by readers, but stale
-  // values are ok.
+  // Modified only by Insert() and InsertConcurrently().  Read racily by
+  // readers, but stale values are ok.
   std::atomic<int> max_height_;  // Height of the entire list
 
   // Used for optimizing sequential insert patterns
   Node** prev_;
   int32_t prev_height_;
 
+  // Set by InsertConcurrently(), which does not maintain prev_; the next
+  // Insert() drops the hint.
+  std::atomic<bool> prev_stale_;
+
   inline int GetMaxHeight() const {
     return max_height_.load(std::memory_order_relaxed);
   }
@@ -133,6 +146,7 @@ class SkipList {
 
   Node* NewNode(const Key& key, int height);
   int RandomHeight();
+  int RandomHeightConcurrently();
   bool Equal(const Key& a, const Key& b) const { return (compare_(a, b) == 0); }
 
   // Return true if key is greater than the data stored in "n"
@@ -153,6 +167,12 @@ class SkipList {
   // Return head_ if list is empty.
   Node* FindLast() const;
 
+  // Traverses a single level of the list, starting at before, to find
+  // the pair of nodes key lies between.  after bounds the search: if it
+  // is reached, it is returned as *out_next.
+  void FindSpliceForLevel(const Key& key, Node* before, Node* after,
+                          int level, Node** out_prev, Node** out_next) const;
+
   // No copying allowed
   SkipList(const SkipList&);
   void operator=(const SkipList&);
@@ -190,6 +210,12 @@ struct SkipList<Key, Comparator>::Node {
     next_[n].store(x, std::memory_order_relaxed);
   }
 
+  // Links x in place of expected, for InsertConcurrently().
+  bool CASNext(int n, Node* expected, Node* x) {
+    assert(n >= 0);
+    return next_[n].compare_exchange_strong(expected, x);
+  }
+
  private:
   // Array of length equal to the node height.  next_[0] is lowest level link.
   std::atomic<Node*> next_[1];
@@ -272,6 +298,19 @@ int SkipList<Key, Comparator>::RandomHeight() {
   return height;
 }
 
+template<typename Key, class Comparator>
+int SkipList<Key, Comparator>::RandomHeightConcurrently() {
+  // Same distribution as RandomHeight(), but rnd_ belongs to Insert()
+  Random* rnd = Random::GetTLSInstance();
+  int height = 1;
+  while (height < kMaxHeight_ && ((rnd->Next() % kBranching_) == 0)) {
+    height++;
+  }
+  assert(height > 0);
+  assert(height <= kMaxHeight_);
+  return height;
+}
+
 template<typename Key, class Comparator>
 bool SkipList<Key, Comparator>::KeyIsAfterNode(const Key& key, Node* n) const {
   // nullptr n is considered infinite
@@ -298,6 +337,11 @@ typename SkipList<Key, Comparator>::Node* SkipList<Key, Comparator>::
   int level = GetMaxHeight() - 1;
   while (true) {
     Node* next = x->Next(level);
+    if (next != nullptr) {
+      // Comparing with next is a cache miss already; start the one for the
+      // node after it, which the search visits unless it drops a level.
+      PREFETCH(next->Next(level), 0, 1);
+    }
     // Make sure the lists are sorted.
     // If x points to head_ or next points nullptr, it is trivially satisfied.
     assert((x == head_) || (next == nullptr) || KeyIsAfterNode(next->key, x));
@@ -389,9 +433,10 @@ SkipList<Key, Comparator>::SkipList(const Comparator cmp, Allocator* allocator,
       kBranching_(branching_factor),
       compare_(cmp),
       allocator_(allocator),
-      head_(NewNode(0 /* any key will do */, max_height)),
+      head_(NewNode(Key() /* any key will do */, max_height)),
       max_height_(1),
       prev_height_(1),
+      prev_stale_(false),
       rnd_(0xdeadbeef) {
   assert(kMaxHeight_ > 0);
   assert(kBranching_ > 0);
@@ -408,6 +453,16 @@ SkipList<Key, Comparator>::SkipList(const Comparator cmp, Allocator* allocator,
 
 template<typename Key, class Comparator>
 void SkipList<Key, Comparator>::Insert(const Key& key) {
+  if (prev_stale_.load(std::memory_order_relaxed)) {
+    // Nodes linked by InsertConcurrently() may sit between the hint and
+    // key on any level.
+    for (int i = 0; i < kMaxHeight_; i++) {
+      prev_[i] = head_;
+    }
+    prev_height_ = 1;
+    prev_stale_.store(false, std::memory_order_relaxed);
+  }
+
   // TODO(opt): We can use a barrier-free variant of FindGreaterOrEqual()
   // here since Insert() is externally synchronized.
   Node* x = FindGreaterOrEqual(key, prev_);
@@ -443,6 +498,80 @@ void SkipList<Key, Comparator>::Insert(const Key& key) {
   prev_height_ = height;
 }
 
+template<typename Key, class Comparator>
+void SkipList<Key, Comparator>::FindSpliceForLevel(const Key& key,
+                                                   Node* before, Node* after,
+                                                   int level, Node** out_prev,
+                                                   Node** out_next) const {
+  while (true) {
+    Node* next = before->Next(level);
+    assert(before == head_ || next == nullptr ||
+           KeyIsAfterNode(next->key, before));
+    assert(before == head_ || KeyIsAfterNode(key, before));
+    if (next == after || !KeyIsAfterNode(key, next)) {
+      // found it
+      *out_prev = before;
+      *out_next = next;
+      return;
+    }
+    before = next;
+  }
+}
+
+template<typename Key, class Comparator>
+void SkipList<Key, Comparator>::InsertConcurrently(const Key& key) {
+  assert(kMaxHeight_ <= kMaxPossibleHeight);
+  Node* prev[kMaxPossibleHeight + 1];
+  Node* next[kMaxPossibleHeight + 1];
+
+  int height = RandomHeightConcurrently();
+
+  // Readers and other writers that observe the raised max_height_ before
+  // the new levels are linked see nullptr from head_ and drop a level, as
+  // in Insert().
+  int max_height = max_height_.load(std::memory_order_relaxed);
+  while (height > max_height) {
+    if (max_height_.compare_exchange_weak(max_height, height)) {
+      // successfully updated it
+      max_height = height;
+      break;
+    }
+    // else retry, possibly exiting the loop because somebody else
+    // increased it
+  }
+  assert(max_height <= kMaxPossibleHeight);
+
+  // Find the splice top-down; each level starts from the splice above it.
+  prev[max_height] = head_;
+  next[max_height] = nullptr;
+  for (int i = max_height - 1; i >= 0; --i) {
+    FindSpliceForLevel(key, prev[i + 1], next[i + 1], i, &prev[i], &next[i]);
+  }
+
+  // Our data structure does not allow duplicate insertion
+  assert(next[0] == nullptr || !Equal(key, next[0]->key));
+
+  // Link bottom-up so that a node reachable on level i is already linked
+  // on every level below it.
+  Node* x = NewNode(key, height);
+  for (int i = 0; i < height; ++i) {
+    while (true) {
+      x->NoBarrier_SetNext(i, next[i]);
+      if (prev[i]->CASNext(i, next[i], x)) {
+        // success
+        break;
+      }
+      // CAS failed, some other writer linked a node after prev[i].  The
+      // splice can only have moved forward, so search again from prev[i].
+      FindSpliceForLevel(key, prev[i], nullptr, i, &prev[i], &next[i]);
+    }
+  }
+
+  if (!prev_stale_.load(std::memory_order_relaxed)) {
+    prev_stale_.store(true, std::memory_order_relaxed);
+  }
+}
+
 template<typename Key, class Comparator>
 bool SkipList<Key, Comparator>::Contains(const Key& key) const {
   Node* x = FindGreaterOrEqual(key, nullptr);
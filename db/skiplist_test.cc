@@ -9,6 +9,10 @@
 
 #include "db/skiplist.h"
 #include <set>
+#include <thread>
+#include <vector>
+#include "db/memtable_allocator.h"
+#include "db/writebuffer.h"
 #include "rocksdb/env.h"
 #include "util/arena.h"
 #include "util/hash.h"
@@ -370,6 +374,50 @@ TEST_F(SkipTest, Concurrent3) { RunConcurrent(3); }
 TEST_F(SkipTest, Concurrent4) { RunConcurrent(4); }
 TEST_F(SkipTest, Concurrent5) { RunConcurrent(5); }
 
+TEST_F(SkipTest, InsertConcurrently) {
+  const int kThreads = 4;
+  const int kPerThread = 5000;
+  Arena arena;
+  WriteBuffer write_buffer(0);
+  MemTableAllocator allocator(&arena, &write_buffer);
+  TestComparator cmp;
+  SkipList<Key, TestComparator> list(cmp, &allocator);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([&list, t]() {
+      // interleave the threads' keys so that they race for the same splices
+      for (int i = 0; i < kPerThread; i++) {
+        list.InsertConcurrently(static_cast<Key>(i * kThreads + t) * 2);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // a serial insert afterwards must not trust the stale prev_ hint
+  list.Insert(1);
+
+  SkipList<Key, TestComparator>::Iterator iter(&list);
+  iter.SeekToFirst();
+  ASSERT_TRUE(iter.Valid());
+  ASSERT_EQ(0U, iter.key());
+  iter.Next();
+  ASSERT_EQ(1U, iter.key());
+  iter.Next();
+  for (Key k = 2; k < static_cast<Key>(kThreads * kPerThread) * 2; k += 2) {
+    ASSERT_TRUE(iter.Valid());
+    ASSERT_EQ(k, iter.key());
+    iter.Next();
+  }
+  ASSERT_TRUE(!iter.Valid());
+  for (Key k = 0; k < static_cast<Key>(kThreads * kPerThread) * 2; k += 2) {
+    ASSERT_TRUE(list.Contains(k));
+    ASSERT_TRUE(!list.Contains(k + 3));
+  }
+}
+
 }  // namespace rocksdb
 
 int main(int argc, char** argv) {
@@ -240,6 +240,51 @@ Status TableCache::Get(const ReadOptions& options,
   return s;
 }
 
+void TableCache::MultiGet(const ReadOptions& options,
+                          const InternalKeyComparator& internal_comparator,
+                          const FileDescriptor& fd, size_t num_keys,
+                          const Slice* keys, GetContext* const* get_contexts,
+                          Status* statuses) {
+#ifndef ROCKSDB_LITE
+  if (ioptions_.row_cache) {
+    // rows are cached one key at a time
+    for (size_t i = 0; i < num_keys; ++i) {
+      statuses[i] =
+          Get(options, internal_comparator, fd, keys[i], get_contexts[i]);
+    }
+    return;
+  }
+#endif  // ROCKSDB_LITE
+
+  TableReader* t = fd.table_reader;
+  Status s;
+  Cache::Handle* handle = nullptr;
+  if (!t) {
+    s = FindTable(env_options_, internal_comparator, fd, &handle,
+                  options.read_tier == kBlockCacheTier);
+    if (s.ok()) {
+      t = GetTableReaderFromHandle(handle);
+    }
+  }
+  if (s.ok()) {
+    t->MultiGet(options, num_keys, keys, get_contexts, statuses);
+    if (handle != nullptr) {
+      ReleaseHandle(handle);
+    }
+    return;
+  }
+
+  for (size_t i = 0; i < num_keys; ++i) {
+    if (options.read_tier && s.IsIncomplete()) {
+      // Couldn't find Table in cache but treat as kFound if no_io set
+      get_contexts[i]->MarkKeyMayExist();
+      statuses[i] = Status::OK();
+    } else {
+      statuses[i] = s;
+    }
+  }
+}
+
 Status TableCache::GetTableProperties(
     const EnvOptions& env_options,
     const InternalKeyComparator& internal_comparator, const FileDescriptor& fd,
@@ -56,6 +56,15 @@ class TableCache {
              const FileDescriptor& file_fd, const Slice& k,
              GetContext* get_context);
 
+  // Looks up num_keys sorted internal keys in the specified file with one
+  // table lookup, see TableReader::MultiGet(). statuses[i] receives what
+  // Get() would have returned for keys[i].
+  void MultiGet(const ReadOptions& options,
+                const InternalKeyComparator& internal_comparator,
+                const FileDescriptor& file_fd, size_t num_keys,
+                const Slice* keys, GetContext* const* get_contexts,
+                Status* statuses);
+
   // Evict any entry for the specified file number
   static void Evict(Cache* cache, uint64_t file_number);
 
@@ -19,6 +19,7 @@
 #include <map>
 #include <set>
 #include <climits>
+#include <functional>
 #include <unordered_map>
 #include <vector>
 #include <string>
@@ -865,6 +866,156 @@ void Version::Get(const ReadOptions& read_options,
   }
 }
 
+void Version::MultiGet(const ReadOptions& read_options,
+                       const MultiGetKeys& keys) {
+  struct KeyLookup {
+    MultiGetKeyContext* key;
+    // position of the key in keys, to keep the keys of a file sorted
+    size_t index;
+    GetContext get_context;
+    FilePicker fp;
+    FdWithKeyRange* file;
+  };
+  std::vector<KeyLookup> lookups;
+  lookups.reserve(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    MultiGetKeyContext* key = keys[i];
+    if (key->done) {
+      continue;
+    }
+    assert(key->status->ok() || key->status->IsMergeInProgress());
+    Slice user_key = key->lkey.user_key();
+    lookups.push_back(KeyLookup{
+        key, i,
+        GetContext(user_comparator(), merge_operator_, info_log_,
+                   db_statistics_,
+                   key->status->ok() ? GetContext::kNotFound
+                                     : GetContext::kMerge,
+                   user_key, key->value, nullptr, &key->merge_context,
+                   this->env_),
+        FilePicker(storage_info_.files_, user_key, key->lkey.internal_key(),
+                   &storage_info_.level_files_brief_,
+                   storage_info_.num_non_empty_levels_,
+                   &storage_info_.file_indexer_, user_comparator(),
+                   internal_comparator()),
+        nullptr});
+  }
+
+  // Ends the search of a key that ran out of files
+  auto finish = [this](KeyLookup* l) {
+    Status* status = l->key->status;
+    l->key->done = true;
+    if (GetContext::kMerge == l->get_context.State()) {
+      if (!merge_operator_) {
+        *status = Status::InvalidArgument(
+            "merge_operator is not properly initialized.");
+        return;
+      }
+      // merge_operands are in saver and we hit the beginning of the key
+      // history do a final merge of nullptr and operands;
+      if (merge_operator_->FullMerge(l->key->lkey.user_key(), nullptr,
+                                     l->key->merge_context.GetOperands(),
+                                     l->key->value, info_log_)) {
+        *status = Status::OK();
+      } else {
+        RecordTick(db_statistics_, NUMBER_MERGE_FAILURES);
+        *status = Status::Corruption("could not perform end-of-key merge for ",
+                                     l->key->lkey.user_key());
+      }
+    } else {
+      *status = Status::NotFound();  // Use an empty error message for speed
+    }
+  };
+
+  std::vector<KeyLookup*> pending;
+  for (auto& l : lookups) {
+    l.file = l.fp.GetNextFile();
+    if (l.file != nullptr) {
+      pending.push_back(&l);
+    } else {
+      finish(&l);
+    }
+  }
+
+  std::vector<KeyLookup*> next_pending;
+  std::vector<Slice> ikeys;
+  std::vector<GetContext*> get_contexts;
+  std::vector<Status> statuses;
+  while (!pending.empty()) {
+    std::sort(pending.begin(), pending.end(),
+              [](const KeyLookup* a, const KeyLookup* b) {
+                if (a->file != b->file) {
+                  return std::less<FdWithKeyRange*>()(a->file, b->file);
+                }
+                return a->index < b->index;
+              });
+    next_pending.clear();
+    for (size_t begin = 0, end; begin < pending.size(); begin = end) {
+      FdWithKeyRange* f = pending[begin]->file;
+      ikeys.clear();
+      get_contexts.clear();
+      for (end = begin; end < pending.size() && pending[end]->file == f;
+           ++end) {
+        ikeys.push_back(pending[end]->key->lkey.internal_key());
+        get_contexts.push_back(&pending[end]->get_context);
+      }
+      statuses.resize(end - begin);
+      table_cache_->MultiGet(read_options, *internal_comparator(), f->fd,
+                             end - begin, ikeys.data(), get_contexts.data(),
+                             statuses.data());
+
+      for (size_t i = begin; i < end; ++i) {
+        KeyLookup* l = pending[i];
+        Status* status = l->key->status;
+        *status = statuses[i - begin];
+        // TODO: examine the behavior for corrupted key
+        if (!status->ok()) {
+          l->key->done = true;
+          continue;
+        }
+
+        bool found = true;
+        switch (l->get_context.State()) {
+          case GetContext::kNotFound:
+          case GetContext::kMerge:
+            // Keep searching in other files
+            found = false;
+            break;
+          case GetContext::kFound:
+            if (l->fp.GetHitFileLevel() == 0) {
+              RecordTick(db_statistics_, GET_HIT_L0);
+            } else if (l->fp.GetHitFileLevel() == 1) {
+              RecordTick(db_statistics_, GET_HIT_L1);
+            } else if (l->fp.GetHitFileLevel() >= 2) {
+              RecordTick(db_statistics_, GET_HIT_L2_AND_UP);
+            }
+            break;
+          case GetContext::kDeleted:
+            // Use empty error message for speed
+            *status = Status::NotFound();
+            break;
+          case GetContext::kCorrupt:
+            *status = Status::Corruption("corrupted key for ",
+                                         l->key->lkey.user_key());
+            break;
+        }
+        if (found) {
+          l->key->done = true;
+          continue;
+        }
+
+        l->file = l->fp.GetNextFile();
+        if (l->file != nullptr) {
+          next_pending.push_back(l);
+        } else {
+          finish(l);
+        }
+      }
+    }
+    pending.swap(next_pending);
+  }
+}
+
 void VersionStorageInfo::GenerateLevelFilesBrief() {
   level_files_brief_.resize(num_non_empty_levels_);
   for (int level = 0; level < num_non_empty_levels_; level++) {
@@ -37,6 +37,7 @@
 #include "db/column_family.h"
 #include "db/log_reader.h"
 #include "db/file_indexer.h"
+#include "db/multiget_context.h"
 #include "db/write_controller.h"
 #include "rocksdb/env.h"
 #include "util/instrumented_mutex.h"
@@ -415,6 +416,13 @@ class Version {
            Status* status, MergeContext* merge_context,
            bool* value_found = nullptr);
 
+  // Looks up every key of keys that is not done yet, as Get() does. The
+  // keys move down the levels together: in each round, the keys whose next
+  // file is the same are looked up in it with one TableCache::MultiGet().
+  // Marks all the keys done.
+  // REQUIRES: lock is not held
+  void MultiGet(const ReadOptions&, const MultiGetKeys& keys);
+
   // Loads some stats information from files. Call without mutex held. It needs
   // to be called before applying the version to the version set.
   void PrepareApply(const MutableCFOptions& mutable_cf_options);
@@ -0,0 +1,257 @@
+//  Copyright (c) 2013, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#include "db/wal_replay.h"
+
+#include <algorithm>
+
+#include "db/column_family.h"
+#include "db/flush_scheduler.h"
+#include "db/write_batch_internal.h"
+#include "rocksdb/write_batch.h"
+
+namespace rocksdb {
+
+namespace {
+// Records are handed over in chunks of about this many bytes, so that the
+// threads synchronize once per chunk rather than once per record
+const size_t kChunkBytes = 1 << 20;
+// How many chunks the reading thread may run ahead
+const size_t kMaxChunksAhead = 4;
+}  // namespace
+
+WalReadAhead::WalReadAhead(log::Reader* reader,
+                           log::Reader::Reporter* reporter,
+                           const Status* read_status,
+                           bool report_eof_inconsistency)
+    : reader_(reader),
+      reporter_(reporter),
+      read_status_(read_status),
+      report_eof_inconsistency_(report_eof_inconsistency),
+      done_(false),
+      stop_(false) {
+  thread_ = std::thread(&WalReadAhead::Run, this);
+}
+
+WalReadAhead::~WalReadAhead() {
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  thread_.join();
+}
+
+void WalReadAhead::Run() {
+  std::string scratch;
+  Slice record;
+  std::vector<std::string> chunk;
+  size_t chunk_bytes = 0;
+  while (reader_->ReadRecord(&record, &scratch, report_eof_inconsistency_) &&
+         (read_status_ == nullptr || read_status_->ok())) {
+    if (record.size() < 12) {
+      reporter_->Corruption(record.size(),
+                            Status::Corruption("log record too small"));
+      continue;
+    }
+    chunk.emplace_back(record.data(), record.size());
+    chunk_bytes += record.size();
+    if (chunk_bytes >= kChunkBytes) {
+      if (!Push(&chunk)) {
+        return;
+      }
+      chunk_bytes = 0;
+    }
+  }
+  if (!chunk.empty()) {
+    Push(&chunk);
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    done_ = true;
+  }
+  cv_.notify_all();
+}
+
+bool WalReadAhead::Push(std::vector<std::string>* chunk) {
+  {
+    std::unique_lock<std::mutex> guard(mu_);
+    cv_.wait(guard,
+             [this] { return stop_ || chunks_.size() < kMaxChunksAhead; });
+    if (stop_) {
+      return false;
+    }
+    chunks_.push_back(std::move(*chunk));
+  }
+  chunk->clear();
+  cv_.notify_all();
+  return true;
+}
+
+bool WalReadAhead::Next(std::vector<std::string>* records) {
+  {
+    std::unique_lock<std::mutex> guard(mu_);
+    cv_.wait(guard, [this] { return done_ || !chunks_.empty(); });
+    if (chunks_.empty()) {
+      return false;
+    }
+    *records = std::move(chunks_.front());
+    chunks_.pop_front();
+  }
+  cv_.notify_all();
+  return true;
+}
+
+WalBatchApplier::WalBatchApplier(
+    ColumnFamilySet* column_family_set, FlushScheduler* flush_scheduler,
+    int num_threads, bool concurrent_memtable_writes,
+    bool stop_when_memtable_full,
+    const std::function<void(Status*)>& maybe_ignore_error)
+    : column_family_set_(column_family_set),
+      flush_scheduler_(flush_scheduler),
+      concurrent_memtable_writes_(concurrent_memtable_writes),
+      stop_when_memtable_full_(stop_when_memtable_full),
+      maybe_ignore_error_(maybe_ignore_error),
+      records_(nullptr),
+      log_number_(0),
+      next_record_(0),
+      failed_(false),
+      generation_(0),
+      running_(0),
+      stop_(false),
+      first_error_index_(0),
+      max_sequence_(0) {
+  if (concurrent_memtable_writes_) {
+    // the calling thread applies records too
+    for (int i = 1; i < num_threads; ++i) {
+      workers_.emplace_back(&WalBatchApplier::WorkerLoop, this);
+    }
+  }
+}
+
+WalBatchApplier::~WalBatchApplier() {
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    stop_ = true;
+  }
+  work_cv_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+Status WalBatchApplier::Apply(const std::vector<std::string>& records,
+                              size_t* next, uint64_t log_number,
+                              SequenceNumber* max_sequence) {
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    records_ = &records;
+    log_number_ = log_number;
+    next_record_.store(*next, std::memory_order_relaxed);
+    failed_.store(false, std::memory_order_relaxed);
+    first_error_index_ = records.size();
+    first_error_ = Status::OK();
+    max_sequence_ = *max_sequence;
+    running_ = static_cast<int>(workers_.size());
+    ++generation_;
+  }
+  work_cv_.notify_all();
+
+  Work();
+
+  std::unique_lock<std::mutex> guard(mu_);
+  done_cv_.wait(guard, [this] { return running_ == 0; });
+  records_ = nullptr;
+  // every record claimed was applied
+  *next = std::min(next_record_.load(std::memory_order_relaxed),
+                   records.size());
+  *max_sequence = max_sequence_;
+  return first_error_;
+}
+
+void WalBatchApplier::WorkerLoop() {
+  uint64_t seen_generation = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> guard(mu_);
+      work_cv_.wait(guard, [&] {
+        return stop_ || generation_ != seen_generation;
+      });
+      if (stop_) {
+        return;
+      }
+      seen_generation = generation_;
+    }
+
+    Work();
+
+    bool last;
+    {
+      std::lock_guard<std::mutex> guard(mu_);
+      last = (--running_ == 0);
+    }
+    if (last) {
+      done_cv_.notify_one();
+    }
+  }
+}
+
+void WalBatchApplier::Work() {
+  // ColumnFamilyMemTablesImpl remembers the column family it last sought,
+  // so every thread has its own
+  ColumnFamilyMemTablesImpl column_family_memtables(column_family_set_,
+                                                    flush_scheduler_);
+  WriteBatch batch;
+  SequenceNumber max_sequence = kMaxSequenceNumber;
+  size_t error_index = records_->size();
+  Status error;
+
+  while (!failed_.load(std::memory_order_relaxed)) {
+    // the memtable is flushed before the next record, as far as the
+    // records already taken by other threads allow
+    if (stop_when_memtable_full_ && !flush_scheduler_->Empty()) {
+      break;
+    }
+    size_t i = next_record_.fetch_add(1, std::memory_order_relaxed);
+    if (i >= records_->size()) {
+      break;
+    }
+    WriteBatchInternal::SetContents(&batch, (*records_)[i]);
+
+    // If column family was not found, it might mean that the WAL write
+    // batch references to the column family that was dropped after the
+    // insert. We don't want to fail the whole write batch in that case --
+    // we just ignore the update.
+    // That's why we set ignore missing column families to true
+    Status s = WriteBatchInternal::InsertInto(
+        &batch, &column_family_memtables, true, log_number_, nullptr, true,
+        concurrent_memtable_writes_);
+    maybe_ignore_error_(&s);
+    if (!s.ok()) {
+      error_index = i;
+      error = s;
+      failed_.store(true, std::memory_order_relaxed);
+      break;
+    }
+    const SequenceNumber last_seq = WriteBatchInternal::Sequence(&batch) +
+                                    WriteBatchInternal::Count(&batch) - 1;
+    if (max_sequence == kMaxSequenceNumber || last_seq > max_sequence) {
+      max_sequence = last_seq;
+    }
+  }
+
+  std::lock_guard<std::mutex> guard(mu_);
+  if (error_index < first_error_index_) {
+    first_error_index_ = error_index;
+    first_error_ = error;
+  }
+  if (max_sequence != kMaxSequenceNumber &&
+      (max_sequence_ == kMaxSequenceNumber || max_sequence > max_sequence_)) {
+    max_sequence_ = max_sequence;
+  }
+}
+
+}  // namespace rocksdb
@@ -0,0 +1,124 @@
+//  Copyright (c) 2013, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+//
+// Helpers for replaying write-ahead logs with more than one thread during
+// recovery, see DBOptions::wal_recovery_threads.
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "db/log_reader.h"
+#include "rocksdb/status.h"
+
+namespace rocksdb {
+
+class ColumnFamilySet;
+class FlushScheduler;
+
+// Reads and checksums the records of one log on a thread of its own,
+// running ahead of the caller by a few chunks of records.
+class WalReadAhead {
+ public:
+  // Records shorter than a write batch header are reported to reporter as
+  // corruption and skipped. Reading stops at the end of the log, or as
+  // soon as read_status (the status reporter updates, if any) is not ok.
+  WalReadAhead(log::Reader* reader, log::Reader::Reporter* reporter,
+               const Status* read_status, bool report_eof_inconsistency);
+
+  // Stops reading and waits for the reading thread
+  ~WalReadAhead();
+
+  // Moves the next chunk of records, in log order, into records. Returns
+  // false once all the records of the log were returned.
+  bool Next(std::vector<std::string>* records);
+
+ private:
+  void Run();
+  // Queues chunk unless the reader was stopped, and returns false if so
+  bool Push(std::vector<std::string>* chunk);
+
+  log::Reader* const reader_;
+  log::Reader::Reporter* const reporter_;
+  const Status* const read_status_;
+  const bool report_eof_inconsistency_;
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::deque<std::vector<std::string>> chunks_;
+  bool done_;
+  bool stop_;
+  std::thread thread_;
+};
+
+// Inserts the write batches of a chunk of log records into the memtables
+// from several threads. With concurrent_memtable_writes the batches of a
+// chunk are spread over all the threads, which requires memtables that
+// support concurrent inserts; otherwise the calling thread applies them
+// alone. Memtables filling up are reported to flush_scheduler, which the
+// caller drains between calls to Apply while no insert is running.
+class WalBatchApplier {
+ public:
+  // maybe_ignore_error may clear the status of a failed batch, in which
+  // case applying goes on. With stop_when_memtable_full, Apply returns
+  // early once flush_scheduler has a memtable to flush.
+  WalBatchApplier(ColumnFamilySet* column_family_set,
+                  FlushScheduler* flush_scheduler, int num_threads,
+                  bool concurrent_memtable_writes,
+                  bool stop_when_memtable_full,
+                  const std::function<void(Status*)>& maybe_ignore_error);
+
+  ~WalBatchApplier();
+
+  // Applies records, read from log log_number, from *next on, and raises
+  // max_sequence to the last sequence number they contain. Stops early if
+  // a memtable fills up (see above); *next is then the first record not
+  // applied yet. Returns the error of the first failing record; records
+  // after it may have been applied already.
+  Status Apply(const std::vector<std::string>& records, size_t* next,
+               uint64_t log_number, SequenceNumber* max_sequence);
+
+ private:
+  void WorkerLoop();
+  // Applies records of the current chunk until none is left, one fails,
+  // or a memtable fills up
+  void Work();
+
+  ColumnFamilySet* const column_family_set_;
+  FlushScheduler* const flush_scheduler_;
+  const bool concurrent_memtable_writes_;
+  const bool stop_when_memtable_full_;
+  const std::function<void(Status*)> maybe_ignore_error_;
+
+  // The current chunk, read-only while workers apply it
+  const std::vector<std::string>* records_;
+  uint64_t log_number_;
+  std::atomic<size_t> next_record_;
+  std::atomic<bool> failed_;
+
+  std::mutex mu_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  // Protected by mu_
+  uint64_t generation_;
+  int running_;
+  bool stop_;
+  size_t first_error_index_;
+  Status first_error_;
+  SequenceNumber max_sequence_;
+
+  std::vector<std::thread> workers_;
+};
+
+}  // namespace rocksdb
@@ -369,16 +369,19 @@ class MemTableInserter : public WriteBatch::Handler {
   uint64_t log_number_;
   DBImpl* db_;
   const bool dont_filter_deletes_;
+  const bool concurrent_memtable_writes_;
 
   MemTableInserter(SequenceNumber sequence, ColumnFamilyMemTables* cf_mems,
                    bool ignore_missing_column_families, uint64_t log_number,
-                   DB* db, const bool dont_filter_deletes)
+                   DB* db, const bool dont_filter_deletes,
+                   bool concurrent_memtable_writes = false)
       : sequence_(sequence),
         cf_mems_(cf_mems),
         ignore_missing_column_families_(ignore_missing_column_families),
         log_number_(log_number),
         db_(reinterpret_cast<DBImpl*>(db)),
-        dont_filter_deletes_(dont_filter_deletes) {
+        dont_filter_deletes_(dont_filter_deletes),
+        concurrent_memtable_writes_(concurrent_memtable_writes) {
     assert(cf_mems);
     if (!dont_filter_deletes_) {
       assert(db_);
@@ -420,7 +423,7 @@ class MemTableInserter : public WriteBatch::Handler {
     MemTable* mem = cf_mems_->GetMemTable();
     auto* moptions = mem->GetMemTableOptions();
     if (!moptions->inplace_update_support) {
-      mem->Add(sequence_, kTypeValue, key, value);
+      mem->Add(sequence_, kTypeValue, key, value, concurrent_memtable_writes_);
     } else if (moptions->inplace_callback == nullptr) {
       mem->Update(sequence_, key, value);
       RecordTick(moptions->statistics, NUMBER_KEYS_UPDATED);
@@ -532,13 +535,14 @@ class MemTableInserter : public WriteBatch::Handler {
         perform_merge = false;
       } else {
         // 3) Add value to memtable
-        mem->Add(sequence_, kTypeValue, key, new_value);
+        mem->Add(sequence_, kTypeValue, key, new_value,
+                 concurrent_memtable_writes_);
       }
     }
 
     if (!perform_merge) {
       // Add merge operator to memtable
-      mem->Add(sequence_, kTypeMerge, key, value);
+      mem->Add(sequence_, kTypeMerge, key, value, concurrent_memtable_writes_);
     }
 
     sequence_++;
@@ -570,7 +574,8 @@ class MemTableInserter : public WriteBatch::Handler {
         return Status::OK();
       }
     }
-    mem->Add(sequence_, kTypeDeletion, key, Slice());
+    mem->Add(sequence_, kTypeDeletion, key, Slice(),
+             concurrent_memtable_writes_);
     sequence_++;
     cf_mems_->CheckMemtableFull();
     return Status::OK();
@@ -581,16 +586,19 @@ class MemTableInserter : public WriteBatch::Handler {
 // This function can only be called in these conditions:
 // 1) During Recovery()
 // 2) during Write(), in a single-threaded write thread
+// 3) during Write(), by every writer of a write group, each with its own
+//    memtables instance and concurrent_memtable_writes set
 // The reason is that it calles ColumnFamilyMemTablesImpl::Seek(), which needs
 // to be called from a single-threaded write thread (or while holding DB mutex)
 Status WriteBatchInternal::InsertInto(const WriteBatch* b,
                                       ColumnFamilyMemTables* memtables,
                                       bool ignore_missing_column_families,
                                       uint64_t log_number, DB* db,
-                                      const bool dont_filter_deletes) {
+                                      const bool dont_filter_deletes,
+                                      bool concurrent_memtable_writes) {
   MemTableInserter inserter(WriteBatchInternal::Sequence(b), memtables,
                             ignore_missing_column_families, log_number, db,
-                            dont_filter_deletes);
+                            dont_filter_deletes, concurrent_memtable_writes);
   return b->Iterate(&inserter);
 }
 
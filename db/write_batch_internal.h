@@ -117,11 +117,15 @@ class WriteBatchInternal {
   //
   // If log_number is non-zero, the memtable will be updated only if
   // memtables->GetLogNumber() >= log_number
+  //
+  // If concurrent_memtable_writes is true, the batch may be inserted while
+  // other writers insert into the same memtables.
   static Status InsertInto(const WriteBatch* batch,
                            ColumnFamilyMemTables* memtables,
                            bool ignore_missing_column_families = false,
                            uint64_t log_number = 0, DB* db = nullptr,
-                           const bool dont_filter_deletes = true);
+                           const bool dont_filter_deletes = true,
+                           bool concurrent_memtable_writes = false);
 
   static void Append(WriteBatch* dst, const WriteBatch* src);
 };
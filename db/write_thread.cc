@@ -5,57 +5,180 @@
 
 #include "db/write_thread.h"
 
+#include <chrono>
+#include <thread>
+#include "util/perf_context_imp.h"
+
 namespace rocksdb {
 
-void WriteThread::EnterWriteThread(WriteThread::Writer* w) {
-  // the following code block pushes the current writer "w" into the writer
-  // queue "writers_" and wait until one of the following conditions met:
-  // 1. the job of "w" has been done by some other writers.
-  // 2. "w" becomes the first writer in "writers_"
-  // 3. "w" timed-out.
-  writers_.push_back(w);
+namespace {
+// A pause takes a few tens of nanoseconds, so the spin covers the common
+// case of a leader that is about to hand over without a context switch.
+const int kMaxSpinTries = 200;
+// Past this, a waiter stops yielding and blocks on its condition variable.
+const std::chrono::microseconds kMaxYieldTime(100);
+}  // namespace
+
+WriteThread::WriteThread()
+    : newest_writer_(nullptr), newest_memtable_writer_(nullptr) {}
+
+uint8_t WriteThread::AwaitState(Writer* w, uint8_t goal_mask) {
+  uint8_t state;
+  {
+    PERF_TIMER_GUARD(write_thread_spin_nanos);
+    for (int tries = 0; tries < kMaxSpinTries; ++tries) {
+      state = w->state.load(std::memory_order_acquire);
+      if ((state & goal_mask) != 0) {
+        return state;
+      }
+      port::AsmVolatilePause();
+    }
+  }
 
-  while (!w->done && w != writers_.front()) {
-    w->cv.Wait();
+  {
+    PERF_TIMER_GUARD(write_thread_yield_nanos);
+    auto yield_begin = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - yield_begin < kMaxYieldTime) {
+      std::this_thread::yield();
+      state = w->state.load(std::memory_order_acquire);
+      if ((state & goal_mask) != 0) {
+        return state;
+      }
+    }
   }
+
+  PERF_TIMER_GUARD(write_thread_block_nanos);
+  return BlockingAwaitState(w, goal_mask);
 }
 
-void WriteThread::ExitWriteThread(WriteThread::Writer* w,
-                                  WriteThread::Writer* last_writer,
-                                  Status status) {
-  // Pop out the current writer and all writers being pushed before the
-  // current writer from the writer queue.
-  while (!writers_.empty()) {
-    Writer* ready = writers_.front();
-    writers_.pop_front();
-    if (ready != w) {
-      ready->status = status;
-      ready->done = true;
-      ready->cv.Signal();
+uint8_t WriteThread::BlockingAwaitState(Writer* w, uint8_t goal_mask) {
+  uint8_t state = w->state.load(std::memory_order_acquire);
+  assert(state != STATE_LOCKED_WAITING);
+  if ((state & goal_mask) == 0 &&
+      w->state.compare_exchange_strong(state, STATE_LOCKED_WAITING)) {
+    // from now on whoever changes the state has to go through state_mutex
+    std::unique_lock<std::mutex> guard(w->state_mutex);
+    w->state_cv.wait(guard, [w] {
+      return w->state.load(std::memory_order_relaxed) != STATE_LOCKED_WAITING;
+    });
+    state = w->state.load(std::memory_order_relaxed);
+  }
+  // Either the goal was met, or the CAS failed because the state changed
+  // under us, which also meets the goal, and state holds the new value.
+  assert((state & goal_mask) != 0);
+  return state;
+}
+
+void WriteThread::SetState(Writer* w, uint8_t new_state) {
+  uint8_t state = w->state.load(std::memory_order_acquire);
+  if (state == STATE_LOCKED_WAITING ||
+      !w->state.compare_exchange_strong(state, new_state)) {
+    assert(state == STATE_LOCKED_WAITING);
+    std::lock_guard<std::mutex> guard(w->state_mutex);
+    w->state.store(new_state, std::memory_order_relaxed);
+    w->state_cv.notify_one();
+  }
+}
+
+bool WriteThread::LinkOne(Writer* w, std::atomic<Writer*>* newest_writer) {
+  Writer* writers = newest_writer->load(std::memory_order_relaxed);
+  w->link_newer = nullptr;
+  while (true) {
+    w->link_older = writers;
+    if (newest_writer->compare_exchange_weak(writers, w)) {
+      return writers == nullptr;
+    }
+  }
+}
+
+void WriteThread::CreateMissingNewerLinks(Writer* head) {
+  while (true) {
+    Writer* next = head->link_older;
+    if (next == nullptr || next->link_newer != nullptr) {
+      assert(next == nullptr || next->link_newer == head);
+      break;
+    }
+    next->link_newer = head;
+    head = next;
+  }
+}
+
+void WriteThread::HandOff(Writer* last, std::atomic<Writer*>* newest_writer,
+                          uint8_t leader_state) {
+  Writer* head = last;
+  if (!newest_writer->compare_exchange_strong(head, nullptr)) {
+    // Somebody joined after last, and the failed CAS loaded the newest
+    // writer into head. Only a leader removes writers, so there is no need
+    // to retry: walk back to the writer that joined right after last.
+    Writer* next = head;
+    while (next->link_older != last) {
+      next = next->link_older;
+      assert(next != nullptr);
     }
-    if (ready == last_writer) break;
+    next->link_older = nullptr;
+    SetState(next, leader_state);
+  }
+}
+
+void WriteThread::JoinBatchGroup(Writer* w) {
+  assert(w->batch != nullptr);
+  bool linked_as_leader = LinkOne(w, &newest_writer_);
+  if (linked_as_leader) {
+    w->state.store(STATE_GROUP_LEADER, std::memory_order_relaxed);
+  } else {
+    // Wait until one of the following conditions is met:
+    // 1. the job of "w" has been done by its leader.
+    // 2. "w" became the oldest writer of the queue.
+    // 3. the leader of "w"'s write group asked it to insert its own batch.
+    AwaitState(w, STATE_GROUP_LEADER | STATE_PARALLEL_FOLLOWER |
+                      STATE_COMPLETED);
   }
+}
+
+void WriteThread::ExitWriteThread(Writer* leader, Writer* last_writer,
+                                  Status status) {
+  assert(leader->link_older == nullptr);
+
+  HandOff(last_writer, &newest_writer_, STATE_GROUP_LEADER);
 
-  // Notify new head of write queue
-  if (!writers_.empty()) {
-    writers_.front()->cv.Signal();
+  // The followers still hold their links among themselves. Once completed
+  // a writer may return and free itself, so read the link first.
+  while (last_writer != leader) {
+    last_writer->status = status;
+    Writer* next = last_writer->link_older;
+    SetState(last_writer, STATE_COMPLETED);
+    last_writer = next;
   }
 }
 
+void WriteThread::EnterUnbatched(Writer* w, InstrumentedMutex* mu) {
+  assert(w->batch == nullptr);
+  bool linked_as_leader = LinkOne(w, &newest_writer_);
+  if (!linked_as_leader) {
+    mu->Unlock();
+    AwaitState(w, STATE_GROUP_LEADER);
+    mu->Lock();
+  }
+  // not a write; it may switch or flush memtables
+  WaitForMemTableWriters(mu);
+}
+
+void WriteThread::ExitUnbatched(Writer* w) {
+  ExitWriteThread(w, w, Status::OK());
+}
+
 // This function will be called only when the first writer succeeds.
 // All writers in the to-be-built batch group will be processed.
-//
-// REQUIRES: Writer list must be non-empty
-// REQUIRES: First writer must have a non-nullptr batch
 size_t WriteThread::BuildBatchGroup(
-    WriteThread::Writer** last_writer,
-    autovector<WriteBatch*>* write_batch_group) {
-  assert(!writers_.empty());
-  Writer* first = writers_.front();
-  assert(first->batch != nullptr);
+    Writer* leader, Writer** last_writer,
+    autovector<WriteBatch*>* write_batch_group,
+    autovector<Writer*>* write_group) {
+  assert(leader->link_older == nullptr);
+  assert(leader->batch != nullptr);
 
-  size_t size = WriteBatchInternal::ByteSize(first->batch);
-  write_batch_group->push_back(first->batch);
+  size_t size = WriteBatchInternal::ByteSize(leader->batch);
+  write_batch_group->push_back(leader->batch);
+  write_group->push_back(leader);
 
   // Allow the group to grow up to a maximum size, but if the
   // original write is small, limit the growth so we do not slow
@@ -65,24 +188,28 @@ size_t WriteThread::BuildBatchGroup(
     max_size = size + (128<<10);
   }
 
-  *last_writer = first;
+  *last_writer = leader;
 
-  if (first->has_callback) {
+  if (leader->has_callback) {
     // TODO(agiardullo:) Batching not currently supported as this write may
     // fail if the callback function decides to abort this write.
     return size;
   }
 
-  std::deque<Writer*>::iterator iter = writers_.begin();
-  ++iter;  // Advance past "first"
-  for (; iter != writers_.end(); ++iter) {
-    Writer* w = *iter;
-    if (w->sync && !first->sync) {
+  // The group is taken from the writers that have joined so far
+  Writer* newest_writer = newest_writer_.load(std::memory_order_acquire);
+  CreateMissingNewerLinks(newest_writer);
+
+  Writer* w = leader;
+  while (w != newest_writer) {
+    w = w->link_newer;
+
+    if (w->sync && !leader->sync) {
       // Do not include a sync write into a batch handled by a non-sync write.
       break;
     }
 
-    if (!w->disableWAL && first->disableWAL) {
+    if (!w->disableWAL && leader->disableWAL) {
       // Do not include a write that needs WAL into a batch that has
       // WAL disabled.
       break;
@@ -107,10 +234,101 @@ size_t WriteThread::BuildBatchGroup(
     }
 
     write_batch_group->push_back(w->batch);
+    write_group->push_back(w);
     w->in_batch_group = true;
     *last_writer = w;
   }
   return size;
 }
 
+void WriteThread::LaunchParallelFollowers(
+    ParallelGroup* pg, const autovector<Writer*>& write_group) {
+  assert(!write_group.empty());
+  Writer* leader = write_group[0];
+  pg->leader = leader;
+  pg->write_group = &write_group;
+  pg->running.store(static_cast<int>(write_group.size()),
+                    std::memory_order_relaxed);
+  pg->status = Status::OK();
+  leader->parallel_group = pg;
+
+  for (size_t i = 1; i < write_group.size(); ++i) {
+    Writer* w = write_group[i];
+    assert(w->in_batch_group);
+    w->parallel_group = pg;
+    SetState(w, STATE_PARALLEL_FOLLOWER);
+  }
+}
+
+void WriteThread::CompleteParallelWorker(Writer* w, Status s) {
+  ParallelGroup* pg = w->parallel_group;
+  assert(pg != nullptr);
+
+  if (w != pg->leader) {
+    w->status = s;
+    // pg lives on the leader's stack, which may return as soon as the
+    // last follower is counted down
+    Writer* leader = pg->leader;
+    if (pg->running.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      SetState(leader, STATE_PARALLEL_DONE);
+    }
+    AwaitState(w, STATE_COMPLETED);
+    return;
+  }
+
+  if (pg->running.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+    AwaitState(w, STATE_PARALLEL_DONE);
+  }
+  // every follower stored its status before counting itself down
+  pg->status = s;
+  for (auto* writer : *pg->write_group) {
+    if (!pg->status.ok()) {
+      break;
+    }
+    if (writer != w) {
+      pg->status = writer->status;
+    }
+  }
+}
+
+void WriteThread::EnterMemTableWriter(Writer* leader, Writer* last_writer) {
+  assert(leader->link_older == nullptr);
+  // Queue the group for the memtables before the next leader can write the
+  // WAL, so that groups apply in WAL order. This relinks leader only;
+  // HandOff does not read the links of last_writer.
+  bool linked_as_leader = LinkOne(leader, &newest_memtable_writer_);
+  HandOff(last_writer, &newest_writer_, STATE_GROUP_LEADER);
+  if (!linked_as_leader) {
+    AwaitState(leader, STATE_MEMTABLE_WRITER_LEADER);
+  }
+}
+
+void WriteThread::ExitMemTableWriter(const autovector<Writer*>& write_group,
+                                     Status status) {
+  HandOff(write_group[0], &newest_memtable_writer_,
+          STATE_MEMTABLE_WRITER_LEADER);
+
+  for (size_t i = 1; i < write_group.size(); ++i) {
+    Writer* w = write_group[i];
+    w->status = status;
+    SetState(w, STATE_COMPLETED);
+  }
+}
+
+void WriteThread::WaitForMemTableWriters(InstrumentedMutex* mu) {
+  mu->AssertHeld();
+  if (newest_memtable_writer_.load(std::memory_order_acquire) == nullptr) {
+    return;
+  }
+  // Queue behind the pipelined groups. The caller leads the writer queue,
+  // so no group can queue behind this one.
+  Writer w;
+  if (!LinkOne(&w, &newest_memtable_writer_)) {
+    mu->Unlock();
+    AwaitState(&w, STATE_MEMTABLE_WRITER_LEADER);
+    mu->Lock();
+  }
+  HandOff(&w, &newest_memtable_writer_, STATE_MEMTABLE_WRITER_LEADER);
+}
+
 }  // namespace rocksdb
@@ -6,8 +6,9 @@
 #pragma once
 
 #include <stdint.h>
-#include <deque>
-#include <limits>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include "rocksdb/status.h"
 #include "db/write_batch_internal.h"
 #include "util/autovector.h"
@@ -16,8 +17,60 @@
 
 namespace rocksdb {
 
+// The writer queue is an intrusive lock-free list of Writer objects,
+// newest first, that writers join with a CAS on newest_writer_. The
+// oldest writer is the group leader: it alone walks and unlinks the list,
+// so no mutex is needed to join, build or leave a write group. A writer
+// waits for its state to change by busy-spinning, then yielding, then
+// blocking on a condition variable.
 class WriteThread {
  public:
+  enum State : uint8_t {
+    // The initial state of a writer. This is a Writer that is
+    // waiting in JoinBatchGroup.
+    STATE_INIT = 1,
+
+    // The state used to inform a waiting Writer that it has become the
+    // leader of the writer queue. It may build a write group and must
+    // call ExitWriteThread (or EnterMemTableWriter) when done.
+    STATE_GROUP_LEADER = 2,
+
+    // The state used to inform a waiting Writer that its batch was written
+    // to the WAL by the leader, and that it has to insert the batch into
+    // the memtables itself, then call CompleteParallelWorker.
+    STATE_PARALLEL_FOLLOWER = 4,
+
+    // A follower whose writer has been done by its leader; w->status
+    // holds the result. Terminal.
+    STATE_COMPLETED = 8,
+
+    // A temporary state set by a waiter before it blocks on its condition
+    // variable. Whoever changes the state of a writer found in this state
+    // must do so under the writer's mutex and notify it.
+    STATE_LOCKED_WAITING = 16,
+
+    // The state used to inform a pipelined group leader that the groups
+    // written to the WAL before its own are applied to the memtables.
+    STATE_MEMTABLE_WRITER_LEADER = 32,
+
+    // The state used to inform a parallel group leader that all of its
+    // followers are done inserting.
+    STATE_PARALLEL_DONE = 64,
+  };
+
+  struct Writer;
+
+  // A write group whose writers insert their own batches into the
+  // memtables concurrently, once the leader has written the WAL.
+  struct ParallelGroup {
+    Writer* leader;
+    const autovector<Writer*>* write_group;
+    // writers of the group, the leader included, still inserting
+    std::atomic<int> running;
+    // first failure among the memtable inserts of the group
+    Status status;
+  };
+
   // Information kept for every waiting writer
   struct Writer {
     Status status;
@@ -25,56 +78,143 @@ class WriteThread {
     bool sync;
     bool disableWAL;
     bool in_batch_group;
-    bool done;
     bool has_callback;
-    InstrumentedCondVar cv;
+    ParallelGroup* parallel_group;
+    std::atomic<uint8_t> state;
+    Writer* link_older;  // read/write only before linking, or as leader
+    Writer* link_newer;  // lazy, read/write only before linking, or as leader
+    // used only while the writer is blocked in STATE_LOCKED_WAITING
+    std::mutex state_mutex;
+    std::condition_variable state_cv;
 
-    explicit Writer(InstrumentedMutex* mu)
+    Writer()
         : batch(nullptr),
           sync(false),
           disableWAL(false),
           in_batch_group(false),
-          done(false),
           has_callback(false),
-          cv(mu) {}
+          parallel_group(nullptr),
+          state(STATE_INIT),
+          link_older(nullptr),
+          link_newer(nullptr) {}
   };
 
-  WriteThread() = default;
+  WriteThread();
   ~WriteThread() = default;
 
-  // Before applying write operation (such as DBImpl::Write, DBImpl::Flush)
-  // thread should grab the mutex_ and be the first on writers queue.
-  // EnterWriteThread is used for it.
-  // Be aware! Writer's job can be done by other thread (see DBImpl::Write
-  // for examples), so check it via w.done before applying changes.
+  // Links w into the writer queue and waits until one of the following
+  // holds, which is then w->state:
+  // STATE_GROUP_LEADER: w is the oldest writer; it does the write of its
+  //   group and must call ExitWriteThread or EnterMemTableWriter.
+  // STATE_PARALLEL_FOLLOWER: the leader wrote w's batch to the WAL, w has
+  //   to insert it into the memtables itself, then call
+  //   CompleteParallelWorker.
+  // STATE_COMPLETED: the job of w was done by its leader, see w->status.
   //
-  // Writer* w:                writer to be placed in the queue
+  // Writer* w:        writer to be placed in the queue, with a batch
   // See also: ExitWriteThread
-  // REQUIRES: db mutex held
-  void EnterWriteThread(Writer* w);
+  // REQUIRES: db mutex not held
+  void JoinBatchGroup(Writer* w);
 
-  // After doing write job, we need to remove already used writers from
-  // writers_ queue and notify head of the queue about it.
-  // ExitWriteThread is used for this.
+  // After doing write job, the group leader unlinks its group from the
+  // writer queue, wakes the next leader and completes the followers of
+  // the group with status.
   //
-  // Writer* w:           Writer, that was added by EnterWriteThread function
-  // Writer* last_writer: Since we can join a few Writers (as DBImpl::Write
-  //                      does)
-  //                      we should pass last_writer as a parameter to
-  //                      ExitWriteThread
-  //                      (if you don't touch other writers, just pass w)
+  // Writer* leader:      Writer that became STATE_GROUP_LEADER
+  // Writer* last_writer: the newest writer of the group, as set by
+  //                      BuildBatchGroup (just pass leader if you don't
+  //                      touch other writers)
   // Status status:       Status of write operation
-  // See also: EnterWriteThread
+  // See also: JoinBatchGroup
+  void ExitWriteThread(Writer* leader, Writer* last_writer, Status status);
+
+  // Waits to be the only thread of the writer queue, for jobs such as
+  // switching memtables or changing column families. The groups still
+  // applying to the memtables are waited for too, see
+  // WaitForMemTableWriters. mu is released while waiting.
   // REQUIRES: db mutex held
-  void ExitWriteThread(Writer* w, Writer* last_writer, Status status);
+  void EnterUnbatched(Writer* w, InstrumentedMutex* mu);
 
-  // return total batch group size
-  size_t BuildBatchGroup(Writer** last_writer,
-                         autovector<WriteBatch*>* write_batch_group);
+  // Completes a Writer begun with EnterUnbatched
+  void ExitUnbatched(Writer* w);
+
+  // return total batch group size. write_group receives the writers of
+  // the group, the leader first.
+  // REQUIRES: leader is STATE_GROUP_LEADER, with a batch
+  size_t BuildBatchGroup(Writer* leader, Writer** last_writer,
+                         autovector<WriteBatch*>* write_batch_group,
+                         autovector<Writer*>* write_group);
+
+  // Wakes the writers of write_group after its leader with
+  // STATE_PARALLEL_FOLLOWER so that each inserts its own batch. The leader
+  // inserts its batch too and then calls CompleteParallelWorker.
+  void LaunchParallelFollowers(ParallelGroup* pg,
+                               const autovector<Writer*>& write_group);
+
+  // Reports that w finished inserting into the memtables with status s.
+  // The leader returns once every writer of the group has done so, with
+  // the merged status in pg->status. Followers return once the leader has
+  // exited the group, in STATE_COMPLETED.
+  void CompleteParallelWorker(Writer* w, Status s);
+
+  // Pipelined writes (DBOptions::enable_pipelined_write): once the leader
+  // has written the WAL record of its group, it hands the writer queue to
+  // the next leader and applies the group to the memtables from a second
+  // queue, in the order the groups were written to the WAL.
+
+  // Queues the group leader..last_writer for the memtables, unlinks it
+  // from the writer queue, wakes the next leader and waits until leader is
+  // the oldest group still to be applied to the memtables. The followers
+  // keep waiting in JoinBatchGroup.
+  // REQUIRES: leader is STATE_GROUP_LEADER
+  void EnterMemTableWriter(Writer* leader, Writer* last_writer);
+
+  // Ends the memtable stage of write_group: its followers are completed
+  // with status, and the next group may apply.
+  // REQUIRES: write_group[0] called EnterMemTableWriter
+  void ExitMemTableWriter(const autovector<Writer*>& write_group,
+                          Status status);
+
+  // Waits until no group is applying to the memtables. The leader of the
+  // writer queue must call it before it switches memtables. mu is released
+  // while waiting, since the memtable writers need it to finish.
+  // REQUIRES: db mutex held, caller leads the writer queue
+  void WaitForMemTableWriters(InstrumentedMutex* mu);
 
  private:
-  // Queue of writers.
-  std::deque<Writer*> writers_;
+  // Points to the newest writer. Only the leader can remove elements,
+  // adding can be done lock-free by anybody.
+  std::atomic<Writer*> newest_writer_;
+
+  // Newest leader of the pipelined groups waiting for, or applying to,
+  // the memtables.
+  std::atomic<Writer*> newest_memtable_writer_;
+
+  // Waits for w->state & goal_mask, spinning, then yielding, then blocking,
+  // and returns the new state.
+  uint8_t AwaitState(Writer* w, uint8_t goal_mask);
+
+  // Blocks on w->state_cv until w->state changes. Writers never wait for
+  // a transition across intermediate states, so any change meets the goal.
+  uint8_t BlockingAwaitState(Writer* w, uint8_t goal_mask);
+
+  // Sets w->state, waking w if it is blocked.
+  void SetState(Writer* w, uint8_t new_state);
+
+  // Links w into the list headed by newest_writer. Returns true if the
+  // list was empty, which makes w its leader.
+  bool LinkOne(Writer* w, std::atomic<Writer*>* newest_writer);
+
+  // Computes any missing link_newer links from head back to the oldest
+  // writer. Should not be called concurrently with itself.
+  void CreateMissingNewerLinks(Writer* head);
+
+  // Unlinks every writer up to and including last from the list headed by
+  // newest_writer and makes the next writer, if any, its leader with
+  // leader_state. Uses link_older only, so last may already be linked
+  // elsewhere.
+  void HandOff(Writer* last, std::atomic<Writer*>* newest_writer,
+               uint8_t leader_state);
 };
 
 }  // namespace rocksdb
@@ -10,17 +10,32 @@
 // WriteBuffer is for managing memory allocation for one or more MemTables.
 
 #pragma once
+#include <atomic>
+#include <memory>
+#include "util/arena_block_pool.h"
 
 namespace rocksdb {
 
 class WriteBuffer {
  public:
-  explicit WriteBuffer(size_t _buffer_size)
-    : buffer_size_(_buffer_size), memory_used_(0) {}
+  // block_pool_size: if > 0, the memtables' arena blocks are kept for reuse
+  // in a pool of this many bytes, mapped from huge pages of
+  // block_pool_huge_page_size if that is > 0. See ArenaBlockPool.
+  explicit WriteBuffer(size_t _buffer_size, size_t block_pool_size = 0,
+                       size_t block_pool_huge_page_size = 0,
+                       Statistics* statistics = nullptr)
+    : buffer_size_(_buffer_size), memory_used_(0),
+      block_pool_(block_pool_size > 0
+                      ? new ArenaBlockPool(block_pool_size,
+                                           block_pool_huge_page_size, this,
+                                           statistics)
+                      : nullptr) {}
 
   ~WriteBuffer() {}
 
-  size_t memory_usage() const { return memory_used_; }
+  size_t memory_usage() const {
+    return memory_used_.load(std::memory_order_relaxed);
+  }
   size_t buffer_size() const { return buffer_size_; }
 
   // Should only be called from write thread
@@ -28,13 +43,24 @@ class WriteBuffer {
     return buffer_size() > 0 && memory_usage() >= buffer_size();
   }
 
-  // Should only be called from write thread
-  void ReserveMem(size_t mem) { memory_used_ += mem; }
-  void FreeMem(size_t mem) { memory_used_ -= mem; }
+  // Can be called by the writers of a write group inserting into their
+  // memtables concurrently
+  void ReserveMem(size_t mem) {
+    memory_used_.fetch_add(mem, std::memory_order_relaxed);
+  }
+  void FreeMem(size_t mem) {
+    memory_used_.fetch_sub(mem, std::memory_order_relaxed);
+  }
+
+  // The pool for the memtables' arenas, or nullptr if there is none
+  ArenaBlockPool* block_pool() const { return block_pool_.get(); }
 
  private:
   const size_t buffer_size_;
-  size_t memory_used_;
+  std::atomic<size_t> memory_used_;
+  // The memtables' arenas give their blocks back to it when they are
+  // destroyed, so the WriteBuffer has to outlive its memtables
+  const std::unique_ptr<ArenaBlockPool> block_pool_;
 
   // No copying allowed
   WriteBuffer(const WriteBuffer&);
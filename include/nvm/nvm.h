@@ -12,10 +12,13 @@ typedef enum
 #include <iostream>
 #include <atomic>
 #include <deque>
+#include <map>
 #include <set>
+#include <unordered_map>
 #include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -23,6 +26,7 @@ typedef enum
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 
 #ifdef OS_LINUX
 
@@ -45,21 +49,29 @@ typedef enum
 #include <signal.h>
 #include <algorithm>
 #include "rocksdb/env.h"
+#include "rocksdb/statistics.h"
 #include "nvm_debug.h"
 #include "nvm_mem.h"
 #include "nvm_ioctl.h"
+#include "nvm_device.h"
+#include "nvm_io_scheduler.h"
 #include "nvm_typedefs.h"
+#include "nvm_page_vector.h"
 #include "nvm_directory.h"
 #include "nvm_files.h"
+#include "nvm_checkpoint.h"
 #include "nvm_threading.h"
 #include "rocksdb/slice.h"
 #include "port/port.h"
+#include "util/autovector.h"
 #include "util/coding.h"
+#include "util/crc32c.h"
 #include "util/logging.h"
 #include "util/logger.h"
 #include "util/random.h"
 #include "util/iostats_context_imp.h"
 #include "util/rate_limiter.h"
+#include "util/statistics.h"
 #include "util/sync_point.h"
 #include "util/thread_status_updater.h"
 #include "util/thread_status_util.h"
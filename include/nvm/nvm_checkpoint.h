@@ -0,0 +1,127 @@
+#ifndef _NVM_CHECKPOINT_H_
+#define _NVM_CHECKPOINT_H_
+
+namespace rocksdb
+{
+
+#define NVM_CHECKPOINT_MAGIC 0x4c54464d564e5452ULL
+#define NVM_JOURNAL_MAGIC 0x4c4e524a4d564e52ULL
+
+//version 1 had no block records
+#define NVM_CHECKPOINT_VERSION 2
+
+//magic, version, generation, body length, body crc, header crc
+#define NVM_CHECKPOINT_HEADER_SIZE 36
+
+//magic, generation
+#define NVM_JOURNAL_HEADER_SIZE 16
+
+//crc, payload length
+#define NVM_JOURNAL_RECORD_HEADER_SIZE 8
+
+struct nvm_page_address
+{
+    unsigned long lun_id;
+    unsigned long block_id;
+    unsigned long page_id;
+};
+
+//what the checkpoint knows about a file
+struct nvm_file_desc
+{
+    unsigned long id;
+
+    std::string dir_path;
+
+    std::vector<std::string> names;
+
+    unsigned long size;
+
+    time_t last_modified;
+
+    std::vector<nvm_page_address> pages;
+};
+
+//what the checkpoint knows about a block
+struct nvm_block_desc
+{
+    unsigned long erase_count;
+
+    nvm_pool_id pool;
+};
+
+//block descriptors by lun and block id
+typedef std::map<std::pair<unsigned long, unsigned long>, nvm_block_desc> nvm_block_map;
+
+//binary FTL metadata: a checkpoint of the whole tree and a journal of the
+//files changed since
+//
+//checkpoint: header | next file id | directory paths | file records | block records
+//file record: id | directory | names | mtime | size | page extents
+//block record: lun | block | erase count | pool
+//
+//an extent covers count pages stored back to back in one block and
+//placed stride pages apart in the file, so a file striped over N luns
+//takes N extents per stripe of blocks
+//
+//journal: header | records; each record is written by one Save() and holds
+//the ids of the deleted files, the records of the changed files and of the
+//blocks erased or moved to another pool since. The journal only applies to
+//the checkpoint with the same generation and the replay stops at the first
+//torn record
+class nvm_checkpoint
+{
+    private:
+	std::string checkpoint_path;
+	std::string journal_path;
+
+	int journal_fd;
+
+	unsigned long generation;
+
+	unsigned long checkpoint_size;
+	unsigned long journal_size;
+
+	nvm *nvm_api;
+
+	pthread_mutex_t save_mtx;
+
+	//block records as of the last save; a journal record only holds the
+	//blocks that differ from these
+	nvm_block_map saved_blocks;
+
+	void EncodeFile(nvm_file *fd, const std::string &dir_path, std::string *dst);
+	bool DecodeFile(Slice *input, nvm_file_desc *desc);
+
+	void EncodeTree(nvm_directory *dir, const std::string &dir_path, const bool only_dirty,
+			std::string *dirs, unsigned long *nr_dirs, std::string *files, unsigned long *nr_files);
+
+	unsigned long EncodeBlocks(const bool only_changed, std::string *dst, nvm_block_map *blocks);
+	bool DecodeBlocks(Slice *input, nvm_block_map *blocks);
+	void RestoreBlocks(const nvm_block_map &blocks);
+
+	Status WriteCheckpoint(nvm_directory *root);
+	Status AppendJournal(nvm_directory *root, const std::vector<unsigned long> &deleted_files);
+	Status CreateJournal();
+
+	Status ReplayJournal(std::map<unsigned long, nvm_file_desc> *files, nvm_block_map *blocks, unsigned long *next_file_id);
+	Status Restore(nvm_directory *root, const std::vector<std::string> &dirs, std::map<unsigned long, nvm_file_desc> &files);
+	Status LoadLegacy(nvm_directory *root, Slice input);
+
+    public:
+	nvm_checkpoint(const char *_checkpoint_path, const char *_journal_path, nvm *_nvm_api);
+	~nvm_checkpoint();
+
+	//appends the changes since the last call to the journal or writes a
+	//new checkpoint if the journal is too large
+	Status Save(nvm_directory *root);
+
+	//rebuilds the tree under an empty root; NotFound if there is no
+	//checkpoint yet. A text layout from before the binary format is
+	//converted to a checkpoint
+	Status Load(nvm_directory *root);
+};
+
+}
+
+#endif
@@ -4,4 +4,35 @@
 #define NVM_ALLOCATE_BLOCKS
 //#define NVM_ALLOCATE_PAGES
 
+//number of luns a file stripes its blocks over
+#define NVM_STRIPE_WIDTH 4
+
+//pages a writable file buffers and flushes as one parallel batch
+#define NVM_WRITE_BUFFER_PAGES 8
+
+//share of the luns kept for write-ahead logs and metadata (at least one,
+//unless that leaves the ssts less than two); the sst pools split or share
+//the rest
+#define NVM_LOG_LUNS_PERCENT 25
+
+//worker threads serving page requests on each lun
+#define NVM_IO_THREADS_PER_LUN 2
+
+//the FTL journal is folded into a new checkpoint once it grows past this
+//size or past the size of the checkpoint itself, whichever is larger
+#define NVM_FTL_JOURNAL_MIN_SIZE (64 << 10)
+
+//directory paths a nvm_directory remembers before starting over
+#define NVM_PATH_CACHE_SIZE 1024
+
+//background gc is scheduled once fewer than this percent of the blocks are free
+#define NVM_GC_TRIGGER_FREE_PERCENT 10
+
+//victim blocks relocated by one gc pass
+#define NVM_GC_BLOCKS_PER_PASS 8
+
+//the data of the least erased block is moved to a worn one once their erase
+//counts are this far apart
+#define NVM_WEAR_LEVELING_THRESHOLD 64
+
 #endif
@@ -0,0 +1,132 @@
+#ifndef _NVM_DEVICE_H_
+#define _NVM_DEVICE_H_
+
+//when set, nvm() runs on top of the userspace emulator instead of /dev/rocksdb
+//format: path=<file>,luns=<n>,blocks=<n>,pages=<n>,page_size=<bytes>,channels=<n>,
+//	  read_us=<n>,write_us=<n>,erase_us=<n>
+//an empty path (or no path) backs the device with anonymous memory
+#define NVM_EMULATOR_ENV "ROCKSDB_NVM_EMULATOR"
+
+//the device is accessed through the same ioctl numbers as the lightnvm target
+//so the FTL code does not care which backend is behind it
+class nvm_device
+{
+    public:
+	virtual ~nvm_device() {}
+
+	virtual int Open() = 0;
+	virtual void Close() = 0;
+
+	virtual int Ioctl(const unsigned long request, void *arg) = 0;
+
+	virtual ssize_t Pread(void *data, const size_t len, const off_t offset) = 0;
+	virtual ssize_t Preadv(const struct iovec *iov, const int iovcnt, const off_t offset) = 0;
+	virtual ssize_t Pwrite(const void *data, const size_t len, const off_t offset) = 0;
+
+	virtual const char *GetLocation() = 0;
+};
+
+//open-channel device exposed by the lightnvm kernel target
+class nvm_lightnvm_device : public nvm_device
+{
+    private:
+	int fd;
+
+	std::string name;
+	std::string location;
+
+    public:
+	nvm_lightnvm_device(const char *_name);
+	~nvm_lightnvm_device();
+
+	virtual int Open() override;
+	virtual void Close() override;
+
+	virtual int Ioctl(const unsigned long request, void *arg) override;
+
+	virtual ssize_t Pread(void *data, const size_t len, const off_t offset) override;
+	virtual ssize_t Preadv(const struct iovec *iov, const int iovcnt, const off_t offset) override;
+	virtual ssize_t Pwrite(const void *data, const size_t len, const off_t offset) override;
+
+	virtual const char *GetLocation() override;
+};
+
+struct nvm_emulator_options
+{
+    //empty path -> anonymous memory, nothing survives Close()
+    std::string path;
+
+    unsigned long nr_luns;
+    unsigned long nr_blocks;
+    unsigned long nr_pages_per_blk;
+    unsigned long nr_channels;
+
+    unsigned int page_size;
+
+    //injected per page for reads/writes and per block for erases
+    unsigned long read_latency_us;
+    unsigned long write_latency_us;
+    unsigned long erase_latency_us;
+
+    nvm_emulator_options();
+
+    //parses the NVM_EMULATOR_ENV format; returns false on unknown keys
+    bool Parse(const char *config);
+};
+
+//suffix of the file next to the image that keeps which pages are programmed
+#define NVM_EMULATOR_PROGRAMMED_SUFFIX ".programmed"
+
+//userspace emulation of an open-channel device backed by a sparse file (or
+//anonymous memory) mapped in the address space
+//
+//a page can be programmed once; programming it again before its block is
+//erased fails with EIO just like on real flash. An erased block reads as
+//0xff; pages of a new image that were never programmed read as zeroes
+class nvm_emulated_device : public nvm_device
+{
+    private:
+	nvm_emulator_options options;
+
+	int fd;
+
+	unsigned char *mem;
+
+	unsigned long block_size;
+	unsigned long lun_size;
+	unsigned long device_size;
+
+	unsigned long nr_pages;
+
+	//one byte per page, set while the page is programmed; mapped from the
+	//file next to the image so a reopened image keeps its state
+	int programmed_fd;
+
+	unsigned char *programmed;
+
+	int OpenProgrammed(const bool new_image);
+
+	pthread_mutex_t state_mtx;
+
+	//a lun serves one operation at a time; held while its latency elapses
+	pthread_mutex_t *lun_mtx;
+
+	void InjectLatency(const unsigned long lun_id, const unsigned long us);
+
+    public:
+	nvm_emulated_device(const nvm_emulator_options &_options);
+	~nvm_emulated_device();
+
+	virtual int Open() override;
+	virtual void Close() override;
+
+	virtual int Ioctl(const unsigned long request, void *arg) override;
+
+	virtual ssize_t Pread(void *data, const size_t len, const off_t offset) override;
+	virtual ssize_t Preadv(const struct iovec *iov, const int iovcnt, const off_t offset) override;
+	virtual ssize_t Pwrite(const void *data, const size_t len, const off_t offset) override;
+
+	virtual const char *GetLocation() override;
+};
+
+#endif
@@ -5,9 +5,12 @@ namespace rocksdb
 {
 
 class nvm_file;
+class nvm_checkpoint;
 
 class nvm_directory
 {
+    friend class nvm_checkpoint;
+
     private:
 	char *name;
 
@@ -23,6 +26,26 @@ class nvm_directory
 
 	nvm_directory *parent;
 
+	//every name of every entry -> its node in the list above
+	std::unordered_map<std::string, list_node *> name_index;
+
+	//directory part of recently looked up paths -> directory node
+	std::unordered_map<std::string, list_node *> path_cache;
+	unsigned long path_cache_generation;
+
+	//guards name_index and path_cache; writers also hold list_update_mtx
+	pthread_rwlock_t index_lock;
+
+	list_node *IndexFind(const char *_name, const int n);
+	void IndexAdd(const char *_name, list_node *node);
+	void IndexRemove(const char *_name, list_node *node);
+	void IndexRemoveNode(list_node *node);
+	void IndexRename(const char *crt_name, const char *new_name, list_node *node);
+
+	list_node *walk_path(list_node *prev, const char *look_up_name);
+
+	void UnlinkFile(list_node *file_node, const char *filename);
+
     public:
 	nvm_directory(const char *_name, const int n, nvm *_nvm_api, nvm_directory *_parent);
 	~nvm_directory();
@@ -64,9 +87,6 @@ class nvm_directory
 	void Add(nvm_file *fd);
 
 	void nvm_fclose(nvm_file *file, const char *mode);
-
-	Status Save(const int fd);
-	Status Load(const int fd);
 };
 
 class NVMDirectory : public Directory
@@ -8,24 +8,49 @@ namespace rocksdb
 
 class NVMWritableFile;
 
+//an append handed to the io scheduler and not waited for yet
+struct nvm_pending_append
+{
+    unsigned long first_page_idx;
+    unsigned long count;
+    unsigned long channel;
+    unsigned long data_len;
+
+    struct nvm_page **write_pages;
+    nvm_io_request *requests;
+
+    nvm_io_batch batch;
+};
+class nvm_checkpoint;
+
 class nvm_file
 {
+    friend class nvm_checkpoint;
+
     private:
 	list_node *names;
 
+	//persistent identity used by the checkpoint journal
+	unsigned long id;
+
+	//set whenever state that goes in the checkpoint changes
+	std::atomic<bool> dirty;
+
 	pthread_mutexattr_t page_update_mtx_attr;
 	pthread_mutex_t page_update_mtx;
 
 	unsigned long size;
 
-	int fd_;
-
-	std::vector<struct nvm_page *> pages;
+	//indexed without page_update_mtx by readers
+	nvm_page_vector pages;
 
 #ifdef NVM_ALLOCATE_BLOCKS
 	std::vector<struct nvm_page *> block_pages;
 #endif
 
+	//where new blocks of the file come from
+	nvm_pool_id pool;
+
 	time_t last_modified;
 
 	pthread_mutex_t meta_mtx;
@@ -39,8 +64,15 @@ class nvm_file
 
 	bool ClaimNewPage(nvm *nvm_api, const unsigned long lun_id, const unsigned long block_id, const unsigned long page_id);
 
+#ifdef NVM_ALLOCATE_BLOCKS
+	bool RequestStripe(nvm *nvm_api);
+#endif
+
+	//page idx with its block pinned against the gc
+	struct nvm_page *PinPage(const unsigned long idx, struct nvm *nvm_api);
+
     public:
-	nvm_file(const char *_name, const int fd, nvm_directory *_parent);
+	nvm_file(const char *_name, nvm_directory *_parent);
 	~nvm_file();
 
 	bool CanOpen(const char *mode);
@@ -55,16 +87,32 @@ class nvm_file
 
 	time_t GetLastModified();
 	void UpdateFileModificationTime();
-	void Close(const char *mode);
-
-	int GetFD();
+	void Close(const char *mode, struct nvm *nvm_api);
 
 	size_t ReadPage(const nvm_page *page, const unsigned long channel, struct nvm *nvm_api, void *data);
 	size_t WritePage(struct nvm_page *&page, const unsigned long channel, struct nvm *nvm_api, void *data, const unsigned long data_len, const unsigned long new_data_offset, const unsigned long new_data_len);
 
+	ssize_t ReadRange(const unsigned long offset, const unsigned long len, const unsigned long channel, struct nvm *nvm_api, char *data);
+	bool ReadRanges(const unsigned long *offsets, const unsigned long *lens, char * const *data, const unsigned long count, const unsigned long channel, struct nvm *nvm_api, ssize_t *read);
+	bool AppendPages(const unsigned long first_page_idx, const unsigned long count, const unsigned long channel, struct nvm *nvm_api, void *data, const unsigned long data_len);
+
+	//AppendPages() in two halves: data must stay untouched until
+	//CompleteAppend() has waited for the pages (and retried failed ones)
+	nvm_pending_append *SubmitAppend(const unsigned long first_page_idx, const unsigned long count, const unsigned long channel, struct nvm *nvm_api, void *data, const unsigned long data_len, const bool async);
+	bool CompleteAppend(nvm_pending_append *append, struct nvm *nvm_api);
+
 	struct nvm_page *GetNVMPage(const unsigned long idx);
 	struct nvm_page *GetLastPage(unsigned long *page_idx);
-	bool SetPage(const unsigned long page_idx, nvm_page *page);
+	bool SetPage(nvm *nvm_api, const unsigned long page_idx, nvm_page *page);
+
+#ifdef NVM_ALLOCATE_BLOCKS
+
+	//used by the gc to move the pages of a file out of a victim block
+	bool TryLockPages();
+	void UnlockPages();
+	void RelocatePages(const unsigned long lun_id, const unsigned long block_id, struct nvm_page **dst_pages);
+
+#endif
 
 	struct nvm_page *RequestPage(nvm *nvm_api);
 	struct nvm_page *RequestPage(nvm *nvm_api, const unsigned long lun_id, const unsigned long block_id, const unsigned long page_id);
@@ -84,8 +132,11 @@ class nvm_file
 
 	void AddName(const char *name);
 
-	Status Save(const int fd);
-	Status Load(const int fd);
+	unsigned long GetId();
+
+	//set from the write lifetime hint; defaults to a guess from the name
+	void SetPool(const nvm_pool_id _pool);
+	nvm_pool_id GetPool();
 };
 
 class NVMFileLock : public FileLock
@@ -136,13 +187,12 @@ class NVMRandomAccessFile: public RandomAccessFile
 
 	nvm_directory *dir;
 
-	struct nvm_page *SeekPage(const unsigned long offset, unsigned long *page_pointer, unsigned long *page_idx) const;
-
     public:
 	NVMRandomAccessFile(const std::string& fname, nvm_file *f, nvm_directory *_dir);
 	virtual ~NVMRandomAccessFile();
 
 	virtual Status Read(uint64_t offset, size_t n, Slice* result, char* scratch) const override;
+	virtual Status MultiRead(ReadRequest* reqs, size_t num_reqs) const override;
 
 #ifdef OS_LINUX
 	virtual size_t GetUniqueId(char* id, size_t max_size) const override;
@@ -166,7 +216,17 @@ class NVMWritableFile : public WritableFile
 
 	char *buf_;           // a buffer to cache writes
 
-	uint64_t bytes_per_sync_;
+	//write-ahead logs keep appending in spare_buf_ while buf_ is written
+	//in the background; syncs are padded to whole pages by log::Writer
+	//so a page is never programmed twice
+	bool wal_mode;
+
+	char *spare_buf_;
+
+	nvm_pending_append *in_flight;
+
+	uint64_t bytes_per_sync_;   // capacity of buf_ (NVM_WRITE_BUFFER_PAGES pages)
+	uint64_t page_size_;
 
 	unsigned long channel;
 
@@ -177,6 +237,7 @@ class NVMWritableFile : public WritableFile
 
 	bool Flush(const bool closing);
 	bool UpdateLastPage();
+	bool WaitInFlight();
 
     public:
 	NVMWritableFile(const std::string& fname, nvm_file *fd, nvm_directory *dir);
@@ -191,6 +252,8 @@ class NVMWritableFile : public WritableFile
 
 	virtual uint64_t GetFileSize() override;
 
+	virtual size_t GetSyncAlignment() override;
+
 	virtual Status InvalidateCache(size_t offset, size_t length) override;
 
 #ifdef ROCKSDB_FALLOCATE_PRESENT
@@ -0,0 +1,120 @@
+#ifndef _NVM_IO_SCHEDULER_H_
+#define _NVM_IO_SCHEDULER_H_
+
+//completion tracking for a group of page requests submitted together
+class nvm_io_batch
+{
+    private:
+	pthread_mutex_t mtx;
+	pthread_cond_t done_cond;
+
+	unsigned long pending;
+
+	bool failed;
+
+    public:
+	nvm_io_batch();
+	~nvm_io_batch();
+
+	void Add();
+	void Complete(const bool ok);
+
+	//returns false if any request in the batch failed
+	bool Wait();
+};
+
+struct nvm_io_request
+{
+    bool write;
+
+    void *data;
+
+    //when set, a read scatters into these buffers instead of data
+    const struct iovec *iov;
+    int iovcnt;
+
+    unsigned long len;
+    unsigned long offset;
+    unsigned long lun_id;
+
+    ssize_t ret;
+
+    nvm_io_batch *batch;
+
+    nvm_io_request() : iov(nullptr), iovcnt(0)
+    {}
+};
+
+struct nvm_io_queue_stats
+{
+    //requests submitted to the lun and the sum of the depths they saw
+    unsigned long submitted;
+    unsigned long depth_sum;
+
+    unsigned long max_depth;
+};
+
+//keeps up to threads_per_lun page requests in flight on every lun
+//
+//requests are queued on the lun they address so a busy lun never delays
+//I/O headed to the other ones
+class nvm_io_scheduler
+{
+    private:
+	struct nvm_io_queue
+	{
+	    pthread_mutex_t mtx;
+	    pthread_cond_t cond;
+
+	    std::deque<nvm_io_request *> requests;
+
+	    unsigned long in_flight;
+
+	    nvm_io_queue_stats stats;
+	};
+
+	nvm_device *dev;
+
+	unsigned long nr_luns;
+
+	nvm_io_queue *queues;
+
+	std::vector<pthread_t> workers;
+
+	bool exit_all_threads;
+
+	std::atomic<rocksdb::Statistics *> statistics;
+
+	static void *WorkerWrapper(void *arg);
+
+	void Worker(const unsigned long lun_id);
+
+    public:
+	nvm_io_scheduler(nvm_device *_dev, const unsigned long _nr_luns, const unsigned long threads_per_lun);
+	~nvm_io_scheduler();
+
+	void Submit(nvm_io_request *request);
+
+	//runs the request on the calling thread
+	static void Execute(nvm_device *dev, nvm_io_request *request);
+
+	//requests queued or being served on the lun
+	unsigned long GetQueueDepth(const unsigned long lun_id);
+
+	void GetQueueStats(const unsigned long lun_id, nvm_io_queue_stats *stats);
+
+	//the depth every submitted request sees is sampled here; may be null
+	void SetStatistics(rocksdb::Statistics *_statistics);
+};
+
+struct nvm_io_worker_metadata
+{
+    nvm_io_scheduler *scheduler;
+
+    unsigned long lun_id;
+
+    nvm_io_worker_metadata(nvm_io_scheduler *_scheduler, const unsigned long _lun_id) : scheduler(_scheduler), lun_id(_lun_id)
+    {}
+};
+
+#endif
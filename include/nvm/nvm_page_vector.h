@@ -0,0 +1,49 @@
+#ifndef _NVM_PAGE_VECTOR_H_
+#define _NVM_PAGE_VECTOR_H_
+
+//number of page pointers held by one chunk of a nvm_page_vector
+#define NVM_PAGE_VECTOR_CHUNK 512
+
+//vector of page pointers that readers can index without taking a lock
+//
+//writers are serialized by the owner (nvm_file::page_update_mtx); entries
+//live in fixed-size chunks that never move and the chunk directory is
+//replaced (not reallocated in place) when it runs out of room, so a reader
+//holding a stale directory still sees valid memory. Old directories are
+//freed together with the vector
+class nvm_page_vector
+{
+    private:
+	struct nvm_page_chunk_dir
+	{
+	    unsigned long nr_chunks;
+
+	    std::atomic<struct nvm_page *> **chunks;
+	};
+
+	std::atomic<nvm_page_chunk_dir *> dir;
+	std::atomic<unsigned long> count;
+
+	//chunks allocated so far; kept across clear()
+	unsigned long nr_chunks;
+
+	std::vector<nvm_page_chunk_dir *> retired_dirs;
+
+	void Grow();
+
+    public:
+	nvm_page_vector();
+	~nvm_page_vector();
+
+	unsigned long size() const;
+
+	//idx must be smaller than a previously observed size()
+	struct nvm_page *operator[](const unsigned long idx) const;
+
+	void Set(const unsigned long idx, struct nvm_page *page);
+
+	void push_back(struct nvm_page *page);
+	void clear();
+};
+
+#endif
@@ -3,6 +3,14 @@
 
 typedef unsigned long long sector_t;
 
+namespace rocksdb
+{
+
+class nvm_file;
+class Statistics;
+
+}
+
 struct nba_channel
 {
     unsigned long int lun_idx;
@@ -24,6 +32,18 @@ struct nba_block
     void *internals;
 };
 
+//files that die together get their blocks from the same pool; blocks are
+//never shared between pools so they empty out (and get erased) as a whole
+typedef enum
+{
+    NVM_POOL_WAL,	//write-ahead logs
+    NVM_POOL_META,	//manifest, info logs and the other small files
+    NVM_POOL_HOT,	//flush and L0/L1 compaction output
+    NVM_POOL_WARM,	//middle levels
+    NVM_POOL_COLD,	//bottom level
+    NVM_NR_POOLS
+} nvm_pool_id;
+
 struct nvm_channel
 {
     unsigned int gran_write;
@@ -37,7 +57,12 @@ struct nvm_page
     unsigned long block_id;
     unsigned long id;
 
-#ifndef NVM_ALLOCATE_BLOCKS
+#ifdef NVM_ALLOCATE_BLOCKS
+
+    //file the page is mapped in; nullptr while the page is reserved or stale
+    rocksdb::nvm_file *owner;
+
+#else
 
     bool allocated;
 
@@ -52,10 +77,40 @@ struct nvm_block
     struct nba_block *block;
     struct nvm_page *pages;
 
+    //reads in flight on pages of the block; the gc does not erase a block
+    //it moved while this is not zero
+    std::atomic<unsigned long> nr_readers;
+
 #ifdef NVM_ALLOCATE_BLOCKS
 
     bool allocated;
 
+    //pages mapped in files and pages handed out (to a file or to the gc)
+    //but not mapped yet; the rest of the block is stale
+    unsigned long nr_valid_pages;
+    unsigned long nr_reserved_pages;
+
+    unsigned long erase_count;
+
+    //write clock when a page of the block was last mapped
+    unsigned long long last_update;
+
+    //relocated by the gc and erased by a later pass (set while the gc
+    //empties the block, so pages dropped meanwhile leave the erase to it)
+    bool erase_pending;
+
+    //gc pass that relocated the block; counted from 1
+    unsigned long gc_pass;
+
+    //free but maybe not erased; erased when it is taken off the free list
+    bool needs_erase;
+
+    nvm_pool_id pool;
+
+    //links in the free list of the lun while the block is not allocated
+    struct nvm_block *prev_free;
+    struct nvm_block *next_free;
+
 #else
 
     bool has_stale_pages;
@@ -75,6 +130,21 @@ struct nvm_lun
     unsigned long nchannels;
 
     struct nvm_channel *channels;
+
+#ifdef NVM_ALLOCATE_BLOCKS
+
+    //guards the free list and the counters and page owners of the blocks
+    //of the lun; never held together with the lock of another lun
+    pthread_mutex_t alloc_mtx;
+
+    //free blocks by erase count: the head is the least worn, the tail the
+    //most worn
+    struct nvm_block *free_head;
+    struct nvm_block *free_tail;
+
+    unsigned long nr_free_blocks;
+
+#endif
 };
 
 class list_node
@@ -99,10 +169,16 @@ class list_node
 };
 #ifdef NVM_ALLOCATE_BLOCKS
 
-struct next_block_to_allocate
+struct nvm_gc_stats
 {
-    unsigned long lun_id;
-    unsigned long block_id;
+    unsigned long user_pages_written;
+    unsigned long gc_pages_relocated;
+    unsigned long blocks_erased;
+
+    unsigned long free_blocks;
+
+    unsigned long min_erase_count;
+    unsigned long max_erase_count;
 };
 
 #else
@@ -121,23 +197,67 @@ class nvm
     public:
 	unsigned long nr_luns;
 	unsigned long max_alloc_try_count;
+	unsigned long max_blocks_per_lun;
 
 	struct nvm_lun *luns;
 
-	int fd;
+	nvm_device *dev;
 
-	std::string location;
+	nvm_io_scheduler *io;
 
+	//opens the lightnvm target or the emulator if NVM_EMULATOR_ENV is set
 	nvm();
+
+	//takes ownership of an already opened device
+	nvm(nvm_device *_dev);
 	~nvm();
 
 	void GarbageCollection();
 
+	//trigger is called by the allocating thread when free blocks run low
+	//so the owner can schedule a GarbageCollection() pass
+	void SetGarbageCollectionTrigger(void (*trigger)(void *), void *arg);
+
+	//gc relocations are charged to rate_limiter at Env::IO_LOW; both may be null
+	void SetGarbageCollectionOptions(rocksdb::RateLimiter *rate_limiter, rocksdb::Statistics *statistics);
+
 #ifdef NVM_ALLOCATE_BLOCKS
 
 	void ReclaimBlock(const unsigned long lun_id, const unsigned long block_id);
-	bool RequestBlock(std::vector<struct nvm_page *> *block_pages);
-	bool RequestBlock(std::vector<struct nvm_page *> *block_pages, const unsigned long lun_id, const unsigned long block_id);
+	bool RequestBlock(std::vector<struct nvm_page *> *block_pages, const nvm_pool_id pool);
+
+	//luns the blocks of a pool are spread over
+	unsigned long GetPoolLuns(const nvm_pool_id pool);
+
+	//free blocks on the luns of a pool, from the free list counters
+	unsigned long GetFreeBlocks(const nvm_pool_id pool);
+
+	//luns are handed to threads round robin on their first allocation;
+	//a thread allocates from its lun first (and the next ones for the
+	//rest of a stripe) so concurrent writers do not contend on a lun
+	void SetLunAffinity(const unsigned long lun_id);
+
+	//maps a page at a known address in owner; used when the FTL is restored
+	struct nvm_page *ClaimPage(rocksdb::nvm_file *owner, const unsigned long lun_id, const unsigned long block_id, const unsigned long page_id);
+
+	//wear and pool of a block, saved with the FTL and put back after
+	//its files are restored
+	void GetBlockState(const unsigned long lun_id, const unsigned long block_id, unsigned long *erase_count, nvm_pool_id *pool);
+	void RestoreBlockState(const unsigned long lun_id, const unsigned long block_id, const unsigned long erase_count, const nvm_pool_id pool);
+
+	//the blocks no restored file claimed may hold pages written after the
+	//last save or blocks the gc emptied but did not erase; each one is
+	//erased before it is handed out
+	void FreeBlocksRestored();
+
+	//a page handed out by RequestBlock() was mapped in (or dropped from) owner
+	void MapPage(struct nvm_page *page, rocksdb::nvm_file *owner);
+	void DropPage(struct nvm_page *page);
+
+	//gives back the pages of block_pages that were never mapped
+	void ReleasePages(std::vector<struct nvm_page *> *block_pages);
+
+	void GetGarbageCollectionStats(struct nvm_gc_stats *stats);
 
 #else
 
@@ -149,11 +269,64 @@ class nvm
 
 	const char *GetLocation();
 
+	//bookkeeping for the FTL checkpoint journal
+	unsigned long NewFileId();
+	unsigned long GetNextFileId();
+	void SetNextFileId(const unsigned long file_id);
+
+	void FileDeleted(const unsigned long file_id);
+	void DirectoriesChanged();
+
+	//bumped by every DirectoriesChanged(); cached paths are only valid
+	//for the generation they were resolved in
+	unsigned long GetDirectoryGeneration();
+
+	//hands over the files deleted since the last call; returns true if
+	//directories were created or deleted meanwhile
+	bool TakeMetadataChanges(std::vector<unsigned long> *deleted_files);
+
+	//a checkpoint or journal record of the FTL was written in micros
+	void FtlSaved(const unsigned long micros);
+	void GetFtlSaveStats(unsigned long *saves, unsigned long *micros);
+
+	//gc passes finished so far; a save that starts after a pass has the
+	//new locations of the pages it moved
+	unsigned long GetGarbageCollectionPasses();
+
+	//a save that started after passes gc passes succeeded
+	void GarbageCollectionSaved(const unsigned long passes);
+
+	//a reader pins the block of a page for as long as it reads the page
+	void PinBlock(const struct nvm_page *page);
+	void UnpinBlock(const struct nvm_page *page);
+
     private:
 
 #ifdef NVM_ALLOCATE_BLOCKS
 
-	next_block_to_allocate next_block;
+	//per pool: the luns it owns
+	unsigned long pool_first_lun[NVM_NR_POOLS];
+	unsigned long pool_nr_luns[NVM_NR_POOLS];
+
+	//lun handed to the next thread that allocates
+	std::atomic<unsigned long> next_lun_affinity;
+
+	unsigned long nr_blocks;
+	std::atomic<unsigned long> nr_free_blocks;
+
+	std::atomic<unsigned long long> write_clock;
+
+	//destination of relocated pages, kept apart from the blocks files write
+	//to; only touched under gc_mtx
+	std::vector<struct nvm_page *> gc_pages[NVM_NR_POOLS];
+
+	//blocks the gc emptied but did not erase yet: the FTL on disk may still
+	//point into them or a reader may still be on them
+	std::vector<struct nvm_block *> relocated_blocks;
+
+	std::atomic<unsigned long> user_pages_written;
+	std::atomic<unsigned long> gc_pages_relocated;
+	std::atomic<unsigned long> blocks_erased;
 
 #else
 
@@ -168,11 +341,62 @@ class nvm
 	pthread_mutex_t allocate_page_mtx;
 	pthread_mutexattr_t allocate_page_mtx_attr;
 
-	int open_nvm_device(const char *file);
+	void (*gc_trigger)(void *);
+	void *gc_trigger_arg;
+
+	rocksdb::RateLimiter *gc_rate_limiter;
+	//read by writers and the gc without the locks taken to set it
+	std::atomic<rocksdb::Statistics *> gc_statistics;
+
+	//held for a whole gc pass
+	pthread_mutex_t gc_mtx;
+
+	std::atomic<unsigned long> gc_passes;
+	std::atomic<unsigned long> gc_passes_saved;
+
+	unsigned long next_file_id;
+
+	std::vector<unsigned long> deleted_files;
+
+	bool directories_changed;
+
+	std::atomic<unsigned long> directory_generation;
+
+	pthread_mutex_t metadata_mtx;
+
+	std::atomic<unsigned long> ftl_saves;
+	std::atomic<unsigned long> ftl_save_micros;
+
+	void Initialize();
 	int ioctl_initialize();
 
+#ifdef NVM_ALLOCATE_BLOCKS
+
+	void AssignPoolLuns();
+
+	//the *Locked helpers expect the lock of the block's lun to be held
+	void PushFreeBlockLocked(struct nvm_block *blk);
+	void UnlinkFreeBlockLocked(struct nvm_block *blk);
+	void AllocateBlockLocked(struct nvm_block *blk, const nvm_pool_id pool);
+	void EraseBlockLocked(struct nvm_block *blk);
+	void ReclaimBlockLocked(struct nvm_block *blk);
+	void MapPageLocked(struct nvm_page *page, rocksdb::nvm_file *owner);
+
+	struct nvm_block *TakeFreeBlock(const unsigned long lun_id, const nvm_pool_id pool, const bool most_worn);
+	unsigned long NextLun();
+
+	struct nvm_block *PickVictim();
+	struct nvm_page *RequestGCPage(const nvm_pool_id pool);
+	bool CopyPage(struct nvm_page *src, struct nvm_page *dst);
+	bool RelocateBlock(struct nvm_block *victim);
+	void ThrottleGarbageCollection(unsigned long bytes);
+
+#else
+
 	void SwapBlocksOnNVM(struct nvm_block *src, struct nvm_block *dest);
 	void SwapBlocksInMem(struct nvm_block *src, struct nvm_block *dest);
+
+#endif
 };
 
 #endif
@@ -44,12 +44,27 @@ class RandomRWFile;
 class Directory;
 struct DBOptions;
 class RateLimiter;
+class Statistics;
 class ThreadStatusUpdater;
 struct ThreadStatus;
 
 using std::unique_ptr;
 using std::shared_ptr;
 
+// How long the data of a file is expected to live. Envs that control data
+// placement (e.g. on open-channel SSDs) use it to keep data that dies
+// together in the same erase units.
+enum WriteLifeTimeHint {
+  kWriteLifeTimeNotSet = 0,
+  // write-ahead logs
+  kWriteLifeTimeShort,
+  // flush output and compaction output of the first levels
+  kWriteLifeTimeMedium,
+  // compaction output of the middle levels
+  kWriteLifeTimeLong,
+  // compaction output of the bottommost level
+  kWriteLifeTimeExtreme,
+};
 
 // Options while opening a file to read/write
 struct EnvOptions {
@@ -88,6 +103,10 @@ struct EnvOptions {
 
   // If not nullptr, write rate limiting is enabled for flush and compaction
   RateLimiter* rate_limiter = nullptr;
+
+  // Expected lifetime of the data of files opened for write. Ignored by
+  // Envs that do not control data placement.
+  WriteLifeTimeHint write_hint = kWriteLifeTimeNotSet;
 };
 
 class Env {
@@ -129,6 +148,18 @@ class Env {
   virtual Status GarbageCollect();
   virtual Status SaveFTL();
 
+  // Background garbage collection of an Env that manages its own flash
+  // charges the data it moves to rate_limiter and reports to statistics.
+  // Both may be nullptr. The DB opened last on the Env sets them and
+  // clears them when it is closed.
+  virtual void SetGarbageCollectionOptions(RateLimiter* rate_limiter,
+                                           Statistics* statistics);
+
+  // Describes, in human readable form, the state of the flash an Env
+  // manages itself: pages written and moved, erases and per lun queue
+  // depths. Returns NotSupported by default.
+  virtual Status GetDeviceStats(std::string* stats);
+
   // Create an object that writes to a new file with the specified
   // name.  Deletes any existing file with the same name and creates a
   // new file.  On success, stores a pointer to the new file in
@@ -386,6 +417,18 @@ class SequentialFile {
   }
 };
 
+// One of the reads of RandomAccessFile::MultiRead()
+struct ReadRequest {
+  // Read up to "len" bytes at "offset" into "scratch[0..len-1]"
+  uint64_t offset;
+  size_t len;
+  char* scratch;
+
+  // Set by MultiRead(), as Read() sets its "*result" and return value
+  Slice result;
+  Status status;
+};
+
 // A file abstraction for randomly reading the contents of a file.
 class RandomAccessFile {
  public:
@@ -404,6 +447,34 @@ class RandomAccessFile {
   virtual Status Read(uint64_t offset, size_t n, Slice* result,
                       char* scratch) const = 0;
 
+  // Does the "num_reqs" reads of "reqs", each as Read() would, and sets
+  // their "result" and "status". Implementations that can keep several
+  // reads in flight submit them all before waiting for any, so that the
+  // batch costs about one device round trip. Returns a non-OK status only
+  // if the reads could not be issued at all.
+  //
+  // Safe for concurrent use by multiple threads.
+  //
+  // Default: calls Read() for each request in turn.
+  virtual Status MultiRead(ReadRequest* reqs, size_t num_reqs) const;
+
+  // Whether the data of the file is kept in memory that ReadPinned() can
+  // hand out, such as a memory mapping of the whole file.
+  virtual bool SupportsPinnedReads() const { return false; }
+
+  // Like Read(), but without a scratch buffer: sets "*result" to point at
+  // the memory of the file holding the data, and "*pinned" to a reference
+  // that keeps this memory valid, even past the life of the file object,
+  // until the reference is dropped. Pinned memory of a file that is deleted
+  // may keep its space in use until then.
+  // REQUIRES: SupportsPinnedReads()
+  //
+  // Safe for concurrent use by multiple threads.
+  virtual Status ReadPinned(uint64_t offset, size_t n, Slice* result,
+                            std::shared_ptr<const char>* pinned) const {
+    return Status::NotSupported("ReadPinned not supported.");
+  }
+
   // Tries to get an unique ID for this file that will be the same each time
   // the file is opened (and will stay the same while the file is open).
   // Furthermore, it tries to make this ID at most "max_size" bytes. If such an
@@ -481,6 +552,16 @@ class WritableFile {
     return 0;
   }
 
+  /*
+   * If non-zero, Sync() only persists whole units of this many bytes
+   * cheaply; a partially filled unit is either left unsynced or has to be
+   * rewritten. Writers that sync often (e.g. the WAL) may pad their data
+   * to this alignment before syncing.
+   */
+  virtual size_t GetSyncAlignment() {
+    return 0;
+  }
+
   /*
    * Get and set the default pre-allocation block size for writes to
    * this file.  If non-zero, then Allocate will be used to extend the
@@ -787,6 +868,13 @@ class EnvWrapper : public Env {
   Status SaveFTL() override {
       return target_->SaveFTL();
   }
+  void SetGarbageCollectionOptions(RateLimiter* rate_limiter,
+                                   Statistics* statistics) override {
+    target_->SetGarbageCollectionOptions(rate_limiter, statistics);
+  }
+  Status GetDeviceStats(std::string* stats) override {
+    return target_->GetDeviceStats(stats);
+  }
   Status CreateDir(const std::string& d) override {
     return target_->CreateDir(d);
   }
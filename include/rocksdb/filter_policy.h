@@ -20,6 +20,7 @@
 #ifndef STORAGE_ROCKSDB_INCLUDE_FILTER_POLICY_H_
 #define STORAGE_ROCKSDB_INCLUDE_FILTER_POLICY_H_
 
+#include <stdint.h>
 #include <string>
 #include <memory>
 
@@ -41,6 +42,11 @@ class FilterBitsBuilder {
   // The return value of this function would be the filter bits,
   // The ownership of actual data is set to buf
   virtual Slice Finish(std::unique_ptr<const char[]>* buf) = 0;
+
+  // Return the number of keys whose filter fits into "space" bytes, or 0 if
+  // the builder cannot tell. It is used to size the partitions of a
+  // partitioned filter.
+  virtual int CalculateNumEntry(const uint32_t space) { return 0; }
 };
 
 // A class that checks if a key can be in filter
@@ -51,6 +57,11 @@ class FilterBitsReader {
 
   // Check if the entry match the bits in filter
   virtual bool MayMatch(const Slice& entry) = 0;
+
+  // Check keys[0, num_keys-1] at once, storing the result for keys[i] in
+  // may_match[i]. A reader can override it to overlap the memory accesses
+  // of the keys.
+  virtual void KeysMayMatch(int num_keys, const Slice* keys, bool* may_match);
 };
 
 // We add a new format of filter block called full filter block
@@ -105,6 +116,13 @@ class FilterPolicy {
   virtual FilterBitsReader* GetFilterBitsReader(const Slice& contents) const {
     return nullptr;
   }
+
+  // Whether KeyMayMatch() and GetFilterBitsReader() can also read the filters
+  // built by the policy called "name", so that the tables built with it keep
+  // their filters after switching to this policy
+  virtual bool CanReadFiltersOf(const std::string& name) const {
+    return false;
+  }
 };
 
 // Return a new filter policy that uses a bloom filter with approximately
@@ -127,6 +145,31 @@ class FilterPolicy {
 // trailing spaces in keys.
 extern const FilterPolicy* NewBloomFilterPolicy(int bits_per_key,
     bool use_block_based_builder = true);
+
+// Return a new filter policy that builds full filters only, as register
+// blocked bloom filters: every key sets 8 bits within one 256-bit block, so a
+// lookup touches a single cache line and tests all its bits with a few SIMD
+// instructions where the CPU supports AVX2. It trades a slightly higher false
+// positive rate than NewBloomFilterPolicy(bits_per_key, false) for cheaper
+// lookups. Its filters are not readable by the other bloom filter policies,
+// nor the other way around.
+//
+// The same notes on deletion and custom comparators as for
+// NewBloomFilterPolicy() apply.
+extern const FilterPolicy* NewBlockedBloomFilterPolicy(int bits_per_key);
+
+// Return a new filter policy that builds full filters as static xor filters
+// with 8-bit fingerprints: about 9.9 bits per key for a false positive rate
+// of about 0.4%, which the full bloom filter needs about 14 bits per key for,
+// and a lookup that always reads three bytes.
+//
+// It also reads the filters built by NewBloomFilterPolicy(), so that the
+// tables a column family has built with it keep their filters after the
+// column family switches to this policy.
+//
+// The same notes on deletion and custom comparators as for
+// NewBloomFilterPolicy() apply.
+extern const FilterPolicy* NewXorFilterPolicy();
 }
 
 #endif  // STORAGE_ROCKSDB_INCLUDE_FILTER_POLICY_H_
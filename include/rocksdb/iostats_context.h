@@ -41,6 +41,12 @@ struct IOStatsContext {
 
   // time spent in Logger::Logv().
   uint64_t logger_nanos;
+
+  // pages programmed and read on an open-channel (NVM) device.
+  uint64_t nvm_pages_written;
+  uint64_t nvm_pages_read;
+  // time spent saving the FTL of an open-channel (NVM) device.
+  uint64_t nvm_ftl_save_nanos;
 };
 
 #ifndef IOS_CROSS_COMPILE
@@ -37,6 +37,7 @@
 
 #include <memory>
 #include <stdint.h>
+#include <stdlib.h>
 
 namespace rocksdb {
 
@@ -63,6 +64,16 @@ class MemTableRep {
     virtual int operator()(const char* prefix_len_key,
                            const Slice& key) const = 0;
 
+    // Returns a number that orders keys the way this comparator does
+    // wherever two numbers differ: KeyPrefix(a) < KeyPrefix(b) implies
+    // a < b. Keys with equal numbers must be compared in full. A rep may
+    // keep the number next to its links so that most comparisons never
+    // touch the key itself.
+    //
+    // Default: 0 for every key, which leaves every comparison to
+    // operator().
+    virtual uint64_t KeyPrefix(const char* prefix_len_key) const { return 0; }
+
     virtual ~KeyComparator() { }
   };
 
@@ -80,6 +91,12 @@ class MemTableRep {
   // collection.
   virtual void Insert(KeyHandle handle) = 0;
 
+  // Like Insert(handle), but may be called concurrent with other calls
+  // to InsertConcurrently for other handles
+  // REQUIRES: the factory that created this rep returns true from
+  // IsInsertConcurrentlySupported().
+  virtual void InsertConcurrently(KeyHandle handle) { abort(); }
+
   // Returns true iff an entry that compares equal to key is in the collection.
   virtual bool Contains(const char* key) const = 0;
 
@@ -103,6 +120,17 @@ class MemTableRep {
   virtual void Get(const LookupKey& k, void* callback_args,
                    bool (*callback_func)(void* arg, const char* entry));
 
+  // Does what Get() does for each of the num_keys keys[i], calling
+  // callback_func() with callback_args[i]. The keys are in ascending order,
+  // so an implementation may walk from one key to the next instead of
+  // searching for each from scratch.
+  //
+  // Default:
+  // Calls Get() for each key.
+  virtual void MultiGet(size_t num_keys, const LookupKey* const* keys,
+                        void* const* callback_args,
+                        bool (*callback_func)(void* arg, const char* entry));
+
   virtual uint64_t ApproximateNumEntries(const Slice& start_ikey,
                                          const Slice& end_key) {
     return 0;
@@ -192,6 +220,10 @@ class MemTableRepFactory {
                                          const SliceTransform*,
                                          Logger* logger) = 0;
   virtual const char* Name() const = 0;
+
+  // Return true if the current MemTableRep supports concurrent inserts
+  // Default: false
+  virtual bool IsInsertConcurrentlySupported() const { return false; }
 };
 
 // This uses a skip list to store keys. It is the default.
@@ -211,6 +243,8 @@ class SkipListFactory : public MemTableRepFactory {
                                          Logger* logger) override;
   virtual const char* Name() const override { return "SkipListFactory"; }
 
+  bool IsInsertConcurrentlySupported() const override { return true; }
+
  private:
   const size_t lookahead_;
 };
@@ -305,5 +339,14 @@ extern MemTableRepFactory* NewHashLinkListRepFactory(
 extern MemTableRepFactory* NewHashCuckooRepFactory(
     size_t write_buffer_size, size_t average_data_size = 64,
     unsigned int hash_function_count = 4);
+
+// This creates MemTableReps backed by a skip list, like SkipListFactory, but
+// each node keeps MemTableRep::KeyComparator::KeyPrefix() of its key, the
+// first 8 bytes of the user key for the bytewise comparators, beside its
+// links. A search then compares the numbers in the nodes it visits and reads
+// the keys only to break ties, which saves a cache miss per visited node
+// when the keys' leading bytes differ. With other comparators it behaves
+// like SkipListFactory at the cost of 8 bytes per entry.
+extern MemTableRepFactory* NewKeyPrefixSkipListRepFactory();
 #endif  // ROCKSDB_LITE
 }  // namespace rocksdb
@@ -666,7 +666,8 @@ struct ColumnFamilyOptions {
                                    std::string* merged_value);
 
   // if prefix_extractor is set and bloom_bits is not 0, create prefix bloom
-  // for memtable
+  // for memtable. The bloom also holds whole keys if
+  // memtable_whole_key_filtering is set, even without a prefix_extractor.
   //
   // Dynamically changeable through SetOptions() API
   uint32_t memtable_prefix_bloom_bits;
@@ -685,6 +686,16 @@ struct ColumnFamilyOptions {
   // Dynamically changeable through SetOptions() API
   size_t memtable_prefix_bloom_huge_page_tlb_size;
 
+  // If true and memtable_prefix_bloom_bits is not 0, whole user keys are
+  // added to the memtable bloom, so that a point lookup skips a memtable
+  // that cannot hold its key, with or without a prefix_extractor.
+  // Iterators keep using prefixes only.
+  //
+  // Default: false
+  //
+  // Dynamically changeable through SetOptions() API
+  bool memtable_whole_key_filtering;
+
   // Control locality of bloom filter probes to improve cache miss rate.
   // This option only applies to memtable prefix bloom and plaintable
   // prefix bloom. It essentially limits every bloom checking to one cache line.
@@ -956,6 +967,11 @@ struct DBOptions {
   bool allow_os_buffer;
 
   // Allow the OS to mmap file for reading sst tables. Default: false
+  //
+  // Uncompressed blocks then point into the mapping instead of being
+  // copied. A block kept in the block cache keeps the mapping of its whole
+  // file alive, so the disk space of a deleted sst file is only freed once
+  // all of its blocks are evicted from the block cache.
   bool allow_mmap_reads;
 
   // Allow the OS to mmap file for writing. Default: false
@@ -988,6 +1004,25 @@ struct DBOptions {
   // Default: 0 (disabled)
   size_t db_write_buffer_size;
 
+  // If non-zero, the arena blocks of flushed memtables are kept in a pool
+  // of up to this many bytes and handed to new memtables, instead of going
+  // back to malloc. With db_write_buffer_size set, the pool only keeps
+  // blocks while they and the memtables fit in it. The tickers
+  // MEMTABLE_BLOCK_POOL_HIT and MEMTABLE_BLOCK_POOL_MISS count the blocks
+  // the pool could and could not supply.
+  //
+  // Default: 0 (disabled)
+  size_t memtable_block_pool_size;
+
+  // If non-zero, the blocks of the pool above are mapped from huge pages of
+  // this size, which spares the TLB on the write path. Falls back to malloc
+  // when no huge page is left. The huge pages have to be reserved, like:
+  //     sysctl -w vm.nr_hugepages=20
+  // See linux doc Documentation/vm/hugetlbpage.txt for details.
+  //
+  // Default: 0 (no huge pages)
+  size_t memtable_block_pool_huge_page_size;
+
   // Specify the file access pattern once a compaction is started.
   // It will be applied to all input files of a compaction.
   // Default: NORMAL
@@ -1041,6 +1076,23 @@ struct DBOptions {
   // Default: false
   bool enable_thread_tracking;
 
+  // If true, allow multi-writers to update mem tables in parallel.
+  // Only some memtable factories support concurrent writes; currently it
+  // is implemented only for SkipListFactory.  Concurrent memtable writes
+  // are not compatible with inplace_update_support.
+  //
+  // Default: false
+  bool allow_concurrent_memtable_write;
+
+  // If true, a write group applies its batches to the memtables after it
+  // has handed the write queue to the next group, so the WAL write of one
+  // group overlaps the memtable inserts of the previous ones. Writes still
+  // become visible in sequence number order. Helps when memtable inserts are
+  // slow, for example with merge-heavy column families.
+  //
+  // Default: false
+  bool enable_pipelined_write;
+
   // The limited write rate to DB if soft_rate_limit or
   // level0_slowdown_writes_trigger is triggered. It is calcualted using
   // size of user write requests before compression.
@@ -1053,6 +1105,28 @@ struct DBOptions {
   // Default: kTolerateCorruptedTailRecords
   WALRecoveryMode wal_recovery_mode;
 
+  // Number of threads that replay the WAL into the memtables when the DB
+  // is opened. With more than one, each log is read and checksummed ahead
+  // by a thread of its own, the write batches are inserted concurrently
+  // (if every column family's memtable supports concurrent inserts, see
+  // allow_concurrent_memtable_write; otherwise by a single thread), and
+  // full memtables are written to level-0 tables by the background flush
+  // threads while replay goes on. The recovered data and the recovery
+  // modes are the same either way.
+  //
+  // Default: 1
+  int wal_recovery_threads;
+
+  // Compression for the records of the WAL. Each write group's batch is
+  // compressed on its own, so the WAL can be read from any record on, and
+  // stored uncompressed if that saves less than 1/8 of it or the type is
+  // not supported in this build. Trades CPU on the write path for device
+  // write bandwidth. WALs written with compression cannot be read by
+  // versions that predate this option.
+  //
+  // Default: kNoCompression
+  CompressionType wal_compression;
+
   // A global cache for table-level rows.
   // Default: nullptr (disabled)
   // Not supported in ROCKSDB_LITE mode!
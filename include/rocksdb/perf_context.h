@@ -39,6 +39,10 @@ struct PerfContext {
   uint64_t get_snapshot_time;          // total time spent on getting snapshot
   uint64_t get_from_memtable_time;     // total time spent on querying memtables
   uint64_t get_from_memtable_count;    // number of mem tables queried
+  // number of point lookups the memtable bloom filters let through, and
+  // rejected without touching the memtable
+  uint64_t bloom_memtable_hit_count;
+  uint64_t bloom_memtable_miss_count;
   // total time spent after Get() finds a key
   uint64_t get_post_process_time;
   uint64_t get_from_output_files_time; // total time reading from output files
@@ -64,6 +68,12 @@ struct PerfContext {
   uint64_t write_delay_time;
   // total time spent on writing a record, excluding the above three times
   uint64_t write_pre_and_post_process_time;
+  // time spent by writers waiting in the write thread for their group
+  // leader, split by how they waited: busy-spinning, yielding the cpu, or
+  // blocked on a condition variable
+  uint64_t write_thread_spin_nanos;
+  uint64_t write_thread_yield_nanos;
+  uint64_t write_thread_block_nanos;
 
   uint64_t db_mutex_lock_nanos;      // time spent on acquiring DB mutex.
   // Time spent on waiting with a condition variable created with DB mutex.
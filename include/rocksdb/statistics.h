@@ -151,6 +151,21 @@ enum Tickers : uint32_t {
   ROW_CACHE_HIT,
   ROW_CACHE_MISS,
 
+  // Pages written by files on an open-channel (NVM) device, pages moved by
+  // its garbage collector and blocks it erased.
+  // gc write amplification = (user pages + relocated pages) / user pages
+  NVM_USER_PAGES_WRITTEN,
+  NVM_GC_PAGES_RELOCATED,
+  NVM_BLOCKS_ERASED,
+  // Checkpoints and journal records of the NVM FTL and the time they took.
+  NVM_FTL_SAVES,
+  NVM_FTL_SAVE_MICROS,
+
+  // Memtable arena blocks reused from the block pool or newly allocated
+  // because the pool had none of the size.
+  MEMTABLE_BLOCK_POOL_HIT,
+  MEMTABLE_BLOCK_POOL_MISS,
+
   TICKER_ENUM_MAX
 };
 
@@ -220,6 +235,13 @@ const std::vector<std::pair<Tickers, std::string>> TickersNameMap = {
     {FILTER_OPERATION_TOTAL_TIME, "rocksdb.filter.operation.time.nanos"},
     {ROW_CACHE_HIT, "rocksdb.row.cache.hit"},
     {ROW_CACHE_MISS, "rocksdb.row.cache.miss"},
+    {NVM_USER_PAGES_WRITTEN, "rocksdb.nvm.user.pages.written"},
+    {NVM_GC_PAGES_RELOCATED, "rocksdb.nvm.gc.pages.relocated"},
+    {NVM_BLOCKS_ERASED, "rocksdb.nvm.blocks.erased"},
+    {NVM_FTL_SAVES, "rocksdb.nvm.ftl.saves"},
+    {NVM_FTL_SAVE_MICROS, "rocksdb.nvm.ftl.save.micros"},
+    {MEMTABLE_BLOCK_POOL_HIT, "rocksdb.memtable.block.pool.hit"},
+    {MEMTABLE_BLOCK_POOL_MISS, "rocksdb.memtable.block.pool.miss"},
 };
 
 /**
@@ -251,6 +273,8 @@ enum Histograms : uint32_t {
   NUM_FILES_IN_SINGLE_COMPACTION,
   DB_SEEK,
   WRITE_STALL,
+  // Requests queued or in flight on a NVM lun when one more is submitted.
+  NVM_LUN_QUEUE_DEPTH,
   HISTOGRAM_ENUM_MAX,  // TODO(ldemailly): enforce HistogramsNameMap match
 };
 
@@ -275,6 +299,7 @@ const std::vector<std::pair<Histograms, std::string>> HistogramsNameMap = {
   { NUM_FILES_IN_SINGLE_COMPACTION, "rocksdb.numfiles.in.singlecompaction" },
   { DB_SEEK, "rocksdb.db.seek.micros" },
   { WRITE_STALL, "rocksdb.db.write.stall" },
+  { NVM_LUN_QUEUE_DEPTH, "rocksdb.nvm.lun.queue.depth" },
 };
 
 struct HistogramData {
@@ -72,10 +72,52 @@ struct BlockBasedTableOptions {
     // The hash index, if enabled, will do the hash lookup when
     // `Options.prefix_extractor` is provided.
     kHashSearch,
+
+    // A two-level index: the index is cut into partitions of about
+    // `metadata_block_size` bytes, and a small top-level index points at
+    // them. Only the top-level index is loaded when the table is opened; the
+    // partitions are read, and cached in the block cache, as lookups need
+    // them, so huge tables do not hold multi-megabyte index blocks.
+    kTwoLevelIndexSearch,
   };
 
   IndexType index_type = kBinarySearch;
 
+  // Partition the full filter along with the index, so that a lookup only
+  // reads the filter partition of the index partition it searches, the same
+  // way as kTwoLevelIndexSearch does for the index. Requires
+  // index_type == kTwoLevelIndexSearch and a full filter (a filter_policy
+  // that does not use the block-based builder); it is ignored otherwise.
+  bool partition_filters = false;
+
+  // Target size of the partitions of a kTwoLevelIndexSearch index and of a
+  // partitioned filter. A partition is cut at the first data block boundary
+  // after it reaches this size.
+  uint64_t metadata_block_size = 4096;
+
+  // The lookup structure of the data blocks.
+  enum DataBlockIndexType : char {
+    // Binary search over the restart array only; the format every version
+    // of RocksDB reads.
+    kDataBlockBinarySearch,
+
+    // Also append a hash index mapping every user key of the block to the
+    // restart interval it starts in, so that point lookups skip the binary
+    // search. Range scans keep using the binary search. The blocks are
+    // flagged in their last word; versions that do not know the flag report
+    // them as corrupt. The hash index is left out of blocks with more than
+    // 254 restart intervals. It must not be used with a comparator that
+    // finds keys of different bytes equal.
+    kDataBlockBinaryAndHash,
+  };
+
+  DataBlockIndexType data_block_index_type = kDataBlockBinarySearch;
+
+  // The number of user keys per bucket of a kDataBlockBinaryAndHash index.
+  // Lower values mean fewer collisions, so fewer lookups falling back to the
+  // binary search, for a bigger index.
+  double data_block_hash_table_util_ratio = 0.75;
+
   // Influence the behavior when kHashSearch is used.
   // if false, stores a precise prefix to block range mapping
   // if true, does not store prefix and allows prefix hash collision
@@ -26,7 +26,8 @@ public enum HistogramType {
   SOFT_RATE_LIMIT_DELAY_COUNT(16),
   NUM_FILES_IN_SINGLE_COMPACTION(17),
   DB_SEEK(18),
-  WRITE_STALL(19);
+  WRITE_STALL(19),
+  NVM_LUN_QUEUE_DEPTH(20);
 
   private final int value_;
 
@@ -150,6 +150,15 @@ extern void InitOnce(OnceType* once, void (*initializer)());
 
 #define PREFETCH(addr, rw, locality) __builtin_prefetch(addr, rw, locality)
 
+static inline void AsmVolatilePause() {
+#if defined(__i386__) || defined(__x86_64__)
+  asm volatile("pause");
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+  // it's okay for other platforms to be no-ops
+}
+
 extern void Crash(const std::string& srcfile, int srcline);
 } // namespace port
 } // namespace rocksdb
@@ -501,6 +501,13 @@ inline bool LZ4HC_Compress(const CompressionOptions& opts, const char* input,
 
 #define CACHE_LINE_SIZE 64U
 
+static inline void AsmVolatilePause() {
+#if defined(_M_IX86) || defined(_M_X64)
+  YieldProcessor();
+#endif
+  // it would be nice to get "wfe" on ARM here
+}
+
 #ifdef min
 #undef min
 #endif
@@ -40,6 +40,7 @@ LIB_SOURCES =                                                   \
   db/version_edit.cc                                            \
   db/version_set.cc                                             \
   db/wal_manager.cc                                             \
+  db/wal_replay.cc                                              \
   db/write_batch.cc                                             \
   db/write_batch_base.cc                                        \
   db/write_controller.cc                                        \
@@ -60,6 +61,7 @@ LIB_SOURCES =                                                   \
   table/cuckoo_table_builder.cc                                 \
   table/cuckoo_table_factory.cc                                 \
   table/cuckoo_table_reader.cc                                  \
+  table/data_block_hash_index.cc                                \
   table/flush_block_policy.cc                                   \
   table/format.cc                                               \
   table/full_filter_block.cc                                    \
@@ -67,6 +69,7 @@ LIB_SOURCES =                                                   \
   table/iterator.cc                                             \
   table/merger.cc                                               \
   table/meta_blocks.cc                                          \
+  table/partitioned_filter_block.cc                             \
   table/plain_table_builder.cc                                  \
   table/plain_table_factory.cc                                  \
   table/plain_table_index.cc                                    \
@@ -75,6 +78,8 @@ LIB_SOURCES =                                                   \
   table/table_properties.cc                                     \
   table/two_level_iterator.cc                                   \
   util/arena.cc                                                 \
+  util/arena_block_pool.cc                                      \
+  util/async_read.cc                                            \
   util/auto_roll_logger.cc                                      \
   util/bloom.cc                                                 \
   util/build_version.cc                                         \
@@ -90,6 +95,10 @@ LIB_SOURCES =                                                   \
   util/env_posix.cc                                             \
   util/env_nvm.cc						\
   util/nvm.cc							\
+  util/nvm_device.cc						\
+  util/nvm_io_scheduler.cc					\
+  util/nvm_page_vector.cc					\
+  util/nvm_checkpoint.cc					\
   util/nvm_files.cc						\
   util/nvm_directory.cc						\
   util/nvm_threading.cc						\
@@ -103,6 +112,7 @@ LIB_SOURCES =                                                   \
   util/histogram.cc                                             \
   util/instrumented_mutex.cc                                    \
   util/iostats_context.cc                                       \
+  util/key_prefix_skiplist_rep.cc                               \
   utilities/backupable/backupable_db.cc                         \
   utilities/checkpoint/checkpoint.cc                            \
   utilities/document/document_db.cc                             \
@@ -135,6 +145,7 @@ LIB_SOURCES =                                                   \
   util/options_helper.cc                                        \
   util/perf_context.cc                                          \
   util/perf_level.cc                                          \
+  util/random.cc                                                \
   util/rate_limiter.cc                                          \
   util/skiplistrep.cc                                           \
   util/slice.cc                                                 \
@@ -167,7 +178,6 @@ TEST_BENCH_SOURCES =                                                    \
   db/corruption_test.cc                                                 \
   db/cuckoo_table_db_test.cc                                            \
   db/db_bench.cc                                                        \
-  db/nvm_bench.cc                                                       \
   db/dbformat_test.cc                                                   \
   db/db_iter_test.cc                                                    \
   db/db_test.cc                                                         \
@@ -217,6 +227,7 @@ TEST_BENCH_SOURCES =                                                    \
   unit_tests/nvm_rw_tests.cc						\
   unit_tests/nvm_sequential_file_test.cc				\
   unit_tests/nvm_random_access_file_test.cc				\
+  unit_tests/nvm_emulator_test.cc					\
   util/arena_test.cc                                                    \
   util/auto_roll_logger_test.cc                                         \
   util/autovector_test.cc                                               \
@@ -127,6 +127,40 @@ void BlockIter::SeekToLast() {
   }
 }
 
+void BlockIter::SeekForGet(const Slice& target) {
+  if (data_block_hash_index_ == nullptr) {
+    Seek(target);
+    return;
+  }
+  PERF_TIMER_GUARD(block_seek_nanos);
+  if (data_ == nullptr) {  // Not init yet
+    return;
+  }
+  uint8_t entry = data_block_hash_index_->Lookup(ExtractUserKey(target));
+  if (entry == kDataBlockHashCollision) {
+    Seek(target);
+    return;
+  }
+  uint32_t restart_index = entry;
+  if (entry == kDataBlockHashNoEntry) {
+    // The user key is not in the block. Scanning the last restart interval
+    // still stops at a key past the target if there is one, which tells the
+    // caller that later blocks cannot have the key either.
+    restart_index = num_restarts_ - 1;
+  } else if (restart_index >= num_restarts_) {
+    CorruptionError();
+    return;
+  }
+
+  SeekToRestartPoint(restart_index);
+  // Linear search (within restart block) for first key >= target
+  while (true) {
+    if (!ParseNextKey() || Compare(key_.GetKey(), target) >= 0) {
+      return;
+    }
+  }
+}
+
 void BlockIter::CorruptionError() {
   current_ = restarts_;
   restart_index_ = num_restarts_;
@@ -296,22 +330,31 @@ bool BlockIter::PrefixSeek(const Slice& target, uint32_t* index) {
 
 uint32_t Block::NumRestarts() const {
   assert(size_ >= 2*sizeof(uint32_t));
-  return DecodeFixed32(data_ + size_ - sizeof(uint32_t));
+  return num_restarts_;
 }
 
 Block::Block(BlockContents&& contents)
     : contents_(std::move(contents)),
       data_(contents_.data.data()),
-      size_(contents_.data.size()) {
+      size_(contents_.data.size()),
+      num_restarts_(0) {
   if (size_ < sizeof(uint32_t)) {
     size_ = 0;  // Error marker
   } else {
-    restart_offset_ =
-        static_cast<uint32_t>(size_) - (1 + NumRestarts()) * sizeof(uint32_t);
-    if (restart_offset_ > size_ - sizeof(uint32_t)) {
-      // The size is too small for NumRestarts() and therefore
-      // restart_offset_ wrapped around.
+    bool has_hash_index;
+    UnpackDataBlockFooter(DecodeFixed32(data_ + size_ - sizeof(uint32_t)),
+                          &has_hash_index, &num_restarts_);
+    // The restart array ends at the hash index, if any, or at the footer
+    uint32_t restarts_end = static_cast<uint32_t>(size_ - sizeof(uint32_t));
+    if (has_hash_index &&
+        !data_block_hash_index_.Initialize(data_, restarts_end,
+                                           &restarts_end)) {
+      size_ = 0;
+    } else if (num_restarts_ > restarts_end / sizeof(uint32_t)) {
+      // The size is too small for NumRestarts()
       size_ = 0;
+    } else {
+      restart_offset_ = restarts_end - num_restarts_ * sizeof(uint32_t);
     }
   }
 }
@@ -340,12 +383,17 @@ Iterator* Block::NewIterator(
     BlockPrefixIndex* prefix_index_ptr =
         total_order_seek ? nullptr : prefix_index_.get();
 
+    const DataBlockHashIndex* data_block_hash_index_ptr =
+        data_block_hash_index_.Valid() ? &data_block_hash_index_ : nullptr;
+
     if (iter != nullptr) {
       iter->Initialize(cmp, data_, restart_offset_, num_restarts,
-                    hash_index_ptr, prefix_index_ptr);
+                    hash_index_ptr, prefix_index_ptr,
+                    data_block_hash_index_ptr);
     } else {
       iter = new BlockIter(cmp, data_, restart_offset_, num_restarts,
-                           hash_index_ptr, prefix_index_ptr);
+                           hash_index_ptr, prefix_index_ptr,
+                           data_block_hash_index_ptr);
     }
   }
 
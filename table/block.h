@@ -19,6 +19,7 @@
 #include "db/dbformat.h"
 #include "table/block_prefix_index.h"
 #include "table/block_hash_index.h"
+#include "table/data_block_hash_index.h"
 
 #include "format.h"
 
@@ -79,6 +80,8 @@ class Block {
   const char* data_;            // contents_.data.data()
   size_t size_;                 // contents_.data.size()
   uint32_t restart_offset_;     // Offset in data_ of restart array
+  uint32_t num_restarts_;
+  DataBlockHashIndex data_block_hash_index_;
   std::unique_ptr<BlockHashIndex> hash_index_;
   std::unique_ptr<BlockPrefixIndex> prefix_index_;
 
@@ -98,19 +101,22 @@ class BlockIter : public Iterator {
         restart_index_(0),
         status_(Status::OK()),
         hash_index_(nullptr),
-        prefix_index_(nullptr) {}
+        prefix_index_(nullptr),
+        data_block_hash_index_(nullptr) {}
 
   BlockIter(const Comparator* comparator, const char* data, uint32_t restarts,
        uint32_t num_restarts, BlockHashIndex* hash_index,
-       BlockPrefixIndex* prefix_index)
+       BlockPrefixIndex* prefix_index,
+       const DataBlockHashIndex* data_block_hash_index = nullptr)
       : BlockIter() {
     Initialize(comparator, data, restarts, num_restarts,
-        hash_index, prefix_index);
+        hash_index, prefix_index, data_block_hash_index);
   }
 
   void Initialize(const Comparator* comparator, const char* data,
       uint32_t restarts, uint32_t num_restarts, BlockHashIndex* hash_index,
-      BlockPrefixIndex* prefix_index) {
+      BlockPrefixIndex* prefix_index,
+      const DataBlockHashIndex* data_block_hash_index = nullptr) {
     assert(data_ == nullptr);           // Ensure it is called only once
     assert(num_restarts > 0);           // Ensure the param is valid
 
@@ -122,6 +128,7 @@ class BlockIter : public Iterator {
     restart_index_ = num_restarts_;
     hash_index_ = hash_index;
     prefix_index_ = prefix_index;
+    data_block_hash_index_ = data_block_hash_index;
   }
 
   void SetStatus(Status s) {
@@ -149,6 +156,13 @@ class BlockIter : public Iterator {
 
   virtual void SeekToLast() override;
 
+  // Position at the first entry with a key >= target, like Seek(), when the
+  // user key of target is in the block. Otherwise the iterator may be left at
+  // any later entry of the block, or past its end if the block has no key past
+  // target. Meant for point lookups; goes through the data block hash index
+  // when the block has one.
+  void SeekForGet(const Slice& target);
+
  private:
   const Comparator* comparator_;
   const char* data_;       // underlying block contents
@@ -163,6 +177,7 @@ class BlockIter : public Iterator {
   Status status_;
   BlockHashIndex* hash_index_;
   BlockPrefixIndex* prefix_index_;
+  const DataBlockHashIndex* data_block_hash_index_;
 
   inline int Compare(const Slice& a, const Slice& b) const {
     return comparator_->Compare(a, b);
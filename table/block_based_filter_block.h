@@ -42,6 +42,7 @@ class BlockBasedFilterBlockBuilder : public FilterBlockBuilder {
   virtual void StartBlock(uint64_t block_offset) override;
   virtual void Add(const Slice& key) override;
   virtual Slice Finish() override;
+  using FilterBlockBuilder::Finish;
 
  private:
   void AddKey(const Slice& key);
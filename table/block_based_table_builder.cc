@@ -13,6 +13,7 @@
 #include <inttypes.h>
 #include <stdio.h>
 
+#include <list>
 #include <map>
 #include <memory>
 #include <string>
@@ -37,6 +38,7 @@
 #include "table/full_filter_block.h"
 #include "table/format.h"
 #include "table/meta_blocks.h"
+#include "table/partitioned_filter_block.h"
 #include "table/table_builder.h"
 
 #include "util/string_util.h"
@@ -99,8 +101,13 @@ class IndexBuilder {
   // Inform the index builder that all entries has been written. Block builder
   // may therefore perform any operation required for block finalization.
   //
-  // REQUIRES: Finish() has not yet been called.
-  virtual Status Finish(IndexBlocks* index_blocks) = 0;
+  // An index made of several blocks returns Status::Incomplete() with all of
+  // them but the last, which goes into the footer; Finish() is then called
+  // again with the handle the previous block was written at.
+  //
+  // REQUIRES: Finish() has not yet returned Status::OK().
+  virtual Status Finish(IndexBlocks* index_blocks,
+                        const BlockHandle& last_partition_block_handle) = 0;
 
   // Get the estimated size for index block.
   virtual size_t EstimatedSize() const = 0;
@@ -138,7 +145,9 @@ class ShortenedIndexBuilder : public IndexBuilder {
     index_block_builder_.Add(*last_key_in_current_block, handle_encoding);
   }
 
-  virtual Status Finish(IndexBlocks* index_blocks) override {
+  virtual Status Finish(
+      IndexBlocks* index_blocks,
+      const BlockHandle& last_partition_block_handle) override {
     index_blocks->index_block_contents = index_block_builder_.Finish();
     return Status::OK();
   }
@@ -218,9 +227,11 @@ class HashIndexBuilder : public IndexBuilder {
     }
   }
 
-  virtual Status Finish(IndexBlocks* index_blocks) override {
+  virtual Status Finish(
+      IndexBlocks* index_blocks,
+      const BlockHandle& last_partition_block_handle) override {
     FlushPendingPrefix();
-    primary_index_builder_.Finish(index_blocks);
+    primary_index_builder_.Finish(index_blocks, last_partition_block_handle);
     index_blocks->meta_blocks.insert(
         {kHashIndexPrefixesBlock.c_str(), prefix_block_});
     index_blocks->meta_blocks.insert(
@@ -261,12 +272,118 @@ class HashIndexBuilder : public IndexBuilder {
   uint64_t current_restart_index_ = 0;
 };
 
+// PartitionedIndexBuilder cuts the index into partitions of about
+// metadata_block_size bytes, each built by a ShortenedIndexBuilder, and
+// indexes them with a top-level index whose key for a partition is the last
+// index key in it. A partition is only cut between two data blocks, so the
+// key of a partition is < every key of the next one. The partitions are
+// written before the top-level index, which the footer points at:
+//
+// [index partition 1] ... [index partition n] [top-level index]
+//
+// If the filter is partitioned too, its partitions are cut along with the
+// index partitions, and the filter can ask for a cut when its partition is
+// full.
+class PartitionedIndexBuilder : public IndexBuilder {
+ public:
+  explicit PartitionedIndexBuilder(const Comparator* comparator,
+                                   uint64_t metadata_block_size)
+      : IndexBuilder(comparator),
+        metadata_block_size_(metadata_block_size),
+        index_block_builder_(1 /* block_restart_interval == 1 */) {}
+
+  void SetFilterBuilder(PartitionedFilterBlockBuilder* filter_builder) {
+    filter_builder_ = filter_builder;
+  }
+
+  virtual void AddIndexEntry(std::string* last_key_in_current_block,
+                             const Slice* first_key_in_next_block,
+                             const BlockHandle& block_handle) override {
+    if (sub_index_builder_ == nullptr) {
+      sub_index_builder_.reset(new ShortenedIndexBuilder(comparator_));
+    }
+    sub_index_builder_->AddIndexEntry(last_key_in_current_block,
+                                      first_key_in_next_block, block_handle);
+    sub_index_last_key_ = *last_key_in_current_block;
+    // The last partition is cut by Finish()
+    if (first_key_in_next_block != nullptr &&
+        (sub_index_builder_->EstimatedSize() >= metadata_block_size_ ||
+         (filter_builder_ != nullptr && filter_builder_->PartitionFull()))) {
+      CutPartition();
+    }
+  }
+
+  virtual Status Finish(
+      IndexBlocks* index_blocks,
+      const BlockHandle& last_partition_block_handle) override {
+    if (finishing_) {
+      // The partition handed out last has been written at
+      // last_partition_block_handle
+      assert(!partitions_.empty());
+      std::string handle_encoding;
+      last_partition_block_handle.EncodeTo(&handle_encoding);
+      index_block_builder_.Add(partitions_.front().key, handle_encoding);
+      partitions_.pop_front();
+    } else {
+      if (sub_index_builder_ != nullptr) {
+        CutPartition();
+      }
+      finishing_ = true;
+    }
+
+    if (partitions_.empty()) {
+      index_blocks->index_block_contents = index_block_builder_.Finish();
+      return Status::OK();
+    }
+    // The contents stay valid until the next call, which drops the partition
+    BlockHandle unused;
+    partitions_.front().builder->Finish(index_blocks, unused);
+    return Status::Incomplete(Slice());
+  }
+
+  virtual size_t EstimatedSize() const override {
+    size_t size = partitions_size_ + index_block_builder_.CurrentSizeEstimate();
+    if (sub_index_builder_ != nullptr) {
+      size += sub_index_builder_->EstimatedSize();
+    }
+    return size;
+  }
+
+ private:
+  struct Partition {
+    std::string key;
+    std::unique_ptr<ShortenedIndexBuilder> builder;
+  };
+
+  void CutPartition() {
+    partitions_size_ += sub_index_builder_->EstimatedSize();
+    partitions_.push_back({sub_index_last_key_, std::move(sub_index_builder_)});
+    if (filter_builder_ != nullptr) {
+      filter_builder_->CutPartition(sub_index_last_key_);
+    }
+  }
+
+  const uint64_t metadata_block_size_;
+  PartitionedFilterBlockBuilder* filter_builder_ = nullptr;
+
+  // The partition being built and the last key added to it
+  std::unique_ptr<ShortenedIndexBuilder> sub_index_builder_;
+  std::string sub_index_last_key_;
+
+  // The partitions not yet written; Finish() hands them out in order
+  std::list<Partition> partitions_;
+  size_t partitions_size_ = 0;
+  BlockBuilder index_block_builder_;
+  bool finishing_ = false;
+};
+
 // Without anonymous namespace here, we fail the warning -Wmissing-prototypes
 namespace {
 
 // Create a index builder based on its type.
 IndexBuilder* CreateIndexBuilder(IndexType type, const Comparator* comparator,
-                                 const SliceTransform* prefix_extractor) {
+                                 const SliceTransform* prefix_extractor,
+                                 const BlockBasedTableOptions& table_opt) {
   switch (type) {
     case BlockBasedTableOptions::kBinarySearch: {
       return new ShortenedIndexBuilder(comparator);
@@ -274,6 +391,10 @@ IndexBuilder* CreateIndexBuilder(IndexType type, const Comparator* comparator,
     case BlockBasedTableOptions::kHashSearch: {
       return new HashIndexBuilder(comparator, prefix_extractor);
     }
+    case BlockBasedTableOptions::kTwoLevelIndexSearch: {
+      return new PartitionedIndexBuilder(comparator,
+                                         table_opt.metadata_block_size);
+    }
     default: {
       assert(!"Do not recognize the index type ");
       return nullptr;
@@ -285,14 +406,25 @@ IndexBuilder* CreateIndexBuilder(IndexType type, const Comparator* comparator,
 }
 
 // Create a index builder based on its type.
+// p_index_builder: the index builder if the index is partitioned, which then
+//                  partitions a full filter too if table_opt asks for it.
 FilterBlockBuilder* CreateFilterBlockBuilder(const ImmutableCFOptions& opt,
-    const BlockBasedTableOptions& table_opt) {
+    const BlockBasedTableOptions& table_opt,
+    PartitionedIndexBuilder* p_index_builder) {
   if (table_opt.filter_policy == nullptr) return nullptr;
 
   FilterBitsBuilder* filter_bits_builder =
       table_opt.filter_policy->GetFilterBitsBuilder();
   if (filter_bits_builder == nullptr) {
     return new BlockBasedFilterBlockBuilder(opt.prefix_extractor, table_opt);
+  } else if (table_opt.partition_filters && p_index_builder != nullptr) {
+    auto keys_per_partition = filter_bits_builder->CalculateNumEntry(
+        static_cast<uint32_t>(table_opt.metadata_block_size));
+    auto filter_builder = new PartitionedFilterBlockBuilder(
+        opt.prefix_extractor, table_opt.whole_key_filtering,
+        filter_bits_builder, static_cast<uint32_t>(keys_per_partition));
+    p_index_builder->SetFilterBuilder(filter_builder);
+    return filter_builder;
   } else {
     return new FullFilterBlockBuilder(opt.prefix_extractor,
                                       table_opt.whole_key_filtering,
@@ -300,75 +432,6 @@ FilterBlockBuilder* CreateFilterBlockBuilder(const ImmutableCFOptions& opt,
   }
 }
 
-bool GoodCompressionRatio(size_t compressed_size, size_t raw_size) {
-  // Check to see if compressed less than 12.5%
-  return compressed_size < raw_size - (raw_size / 8u);
-}
-
-// format_version is the block format as defined in include/rocksdb/table.h
-Slice CompressBlock(const Slice& raw,
-                    const CompressionOptions& compression_options,
-                    CompressionType* type, uint32_t format_version,
-                    std::string* compressed_output) {
-  if (*type == kNoCompression) {
-    return raw;
-  }
-
-  // Will return compressed block contents if (1) the compression method is
-  // supported in this platform and (2) the compression rate is "good enough".
-  switch (*type) {
-    case kSnappyCompression:
-      if (Snappy_Compress(compression_options, raw.data(), raw.size(),
-                          compressed_output) &&
-          GoodCompressionRatio(compressed_output->size(), raw.size())) {
-        return *compressed_output;
-      }
-      break;  // fall back to no compression.
-    case kZlibCompression:
-      if (Zlib_Compress(
-              compression_options,
-              GetCompressFormatForVersion(kZlibCompression, format_version),
-              raw.data(), raw.size(), compressed_output) &&
-          GoodCompressionRatio(compressed_output->size(), raw.size())) {
-        return *compressed_output;
-      }
-      break;  // fall back to no compression.
-    case kBZip2Compression:
-      if (BZip2_Compress(
-              compression_options,
-              GetCompressFormatForVersion(kBZip2Compression, format_version),
-              raw.data(), raw.size(), compressed_output) &&
-          GoodCompressionRatio(compressed_output->size(), raw.size())) {
-        return *compressed_output;
-      }
-      break;  // fall back to no compression.
-    case kLZ4Compression:
-      if (LZ4_Compress(
-              compression_options,
-              GetCompressFormatForVersion(kLZ4Compression, format_version),
-              raw.data(), raw.size(), compressed_output) &&
-          GoodCompressionRatio(compressed_output->size(), raw.size())) {
-        return *compressed_output;
-      }
-      break;  // fall back to no compression.
-    case kLZ4HCCompression:
-      if (LZ4HC_Compress(
-              compression_options,
-              GetCompressFormatForVersion(kLZ4HCCompression, format_version),
-              raw.data(), raw.size(), compressed_output) &&
-          GoodCompressionRatio(compressed_output->size(), raw.size())) {
-        return *compressed_output;
-      }
-      break;     // fall back to no compression.
-    default: {}  // Do not recognize this compression type
-  }
-
-  // Compression method is not supported, or not good compression ratio, so just
-  // fall back to uncompressed form.
-  *type = kNoCompression;
-  return raw;
-}
-
 }  // namespace
 
 // kBlockBasedTableMagicNumber was picked by running
@@ -473,15 +536,23 @@ struct BlockBasedTableBuilder::Rep {
         table_options(table_opt),
         internal_comparator(icomparator),
         file(f),
-        data_block(table_options.block_restart_interval),
+        data_block(table_options.block_restart_interval,
+                   table_options.data_block_index_type ==
+                       BlockBasedTableOptions::kDataBlockBinaryAndHash,
+                   table_options.data_block_hash_table_util_ratio),
         internal_prefix_transform(_ioptions.prefix_extractor),
         index_builder(CreateIndexBuilder(table_options.index_type,
                                          &internal_comparator,
-                                         &this->internal_prefix_transform)),
+                                         &this->internal_prefix_transform,
+                                         table_options)),
         compression_type(_compression_type),
         compression_opts(_compression_opts),
         filter_block(skip_filters ? nullptr : CreateFilterBlockBuilder(
-                                                  _ioptions, table_options)),
+            _ioptions, table_options,
+            table_options.index_type ==
+                    BlockBasedTableOptions::kTwoLevelIndexSearch
+                ? static_cast<PartitionedIndexBuilder*>(index_builder.get())
+                : nullptr)),
         flush_block_policy(
             table_options.flush_block_policy_factory->NewFlushBlockPolicy(
                 table_options, data_block)) {
@@ -724,13 +795,8 @@ Status BlockBasedTableBuilder::Finish() {
   r->closed = true;
 
   BlockHandle filter_block_handle, metaindex_block_handle, index_block_handle;
-  // Write filter block
-  if (ok() && r->filter_block != nullptr) {
-    auto filter_contents = r->filter_block->Finish();
-    r->props.filter_size = filter_contents.size();
-    WriteRawBlock(filter_contents, kNoCompression, &filter_block_handle);
-  }
-
+  // Add the last index entry before the filter is written, as a partitioned
+  // filter closes its last partition with the key of the last index entry.
   // To make sure properties block is able to keep the accurate size of index
   // block, we will finish writing all index entries here and flush them
   // to storage after metaindex block is written.
@@ -740,9 +806,22 @@ Status BlockBasedTableBuilder::Finish() {
   }
 
   IndexBuilder::IndexBlocks index_blocks;
-  auto s = r->index_builder->Finish(&index_blocks);
-  if (!s.ok()) {
-    return s;
+  auto index_builder_status =
+      r->index_builder->Finish(&index_blocks, index_block_handle);
+  if (!index_builder_status.ok() && !index_builder_status.IsIncomplete()) {
+    return index_builder_status;
+  }
+
+  // Write filter block. A partitioned filter comes one partition at a time,
+  // followed by the index on its partitions, which the metaindex points at.
+  if (ok() && r->filter_block != nullptr) {
+    Status s = Status::Incomplete(Slice());
+    while (ok() && s.IsIncomplete()) {
+      auto filter_contents = r->filter_block->Finish(filter_block_handle, &s);
+      assert(s.ok() || s.IsIncomplete());
+      r->props.filter_size += filter_contents.size();
+      WriteRawBlock(filter_contents, kNoCompression, &filter_block_handle);
+    }
   }
 
   // Write meta blocks and metaindex block with the following order.
@@ -765,6 +844,10 @@ Status BlockBasedTableBuilder::Finish() {
       std::string key;
       if (r->filter_block->IsBlockBased()) {
         key = BlockBasedTable::kFilterBlockPrefix;
+      } else if (r->table_options.partition_filters &&
+                 r->table_options.index_type ==
+                     BlockBasedTableOptions::kTwoLevelIndexSearch) {
+        key = BlockBasedTable::kPartitionedFilterBlockPrefix;
       } else {
         key = BlockBasedTable::kFullFilterBlockPrefix;
       }
@@ -805,6 +888,16 @@ Status BlockBasedTableBuilder::Finish() {
     WriteRawBlock(meta_index_builder.Finish(), kNoCompression,
                   &metaindex_block_handle);
     WriteBlock(index_blocks.index_block_contents, &index_block_handle);
+    // A partitioned index writes its partitions before its top-level index,
+    // which goes into the footer
+    while (ok() && index_builder_status.IsIncomplete()) {
+      index_builder_status =
+          r->index_builder->Finish(&index_blocks, index_block_handle);
+      if (!index_builder_status.ok() && !index_builder_status.IsIncomplete()) {
+        return index_builder_status;
+      }
+      WriteBlock(index_blocks.index_block_contents, &index_block_handle);
+    }
   }
 
   // Write footer
@@ -872,4 +965,6 @@ TableProperties BlockBasedTableBuilder::GetTableProperties() const {
 
 const std::string BlockBasedTable::kFilterBlockPrefix = "filter.";
 const std::string BlockBasedTable::kFullFilterBlockPrefix = "fullfilter.";
+const std::string BlockBasedTable::kPartitionedFilterBlockPrefix =
+    "partitionedfilter.";
 }  // namespace rocksdb
@@ -9,6 +9,7 @@
 
 #include "table/block_based_table_reader.h"
 
+#include <algorithm>
 #include <string>
 #include <utility>
 
@@ -33,6 +34,7 @@
 #include "table/block_prefix_index.h"
 #include "table/format.h"
 #include "table/meta_blocks.h"
+#include "table/partitioned_filter_block.h"
 #include "table/two_level_iterator.h"
 #include "table/get_context.h"
 
@@ -340,7 +342,8 @@ struct BlockBasedTable::Rep {
         filter_policy(_table_opt.filter_policy.get()),
         internal_comparator(_internal_comparator),
         whole_key_filtering(_table_opt.whole_key_filtering),
-        prefix_filtering(true) {}
+        prefix_filtering(true),
+        filter_partitioned(false) {}
 
   const ImmutableCFOptions& ioptions;
   const EnvOptions& env_options;
@@ -363,10 +366,16 @@ struct BlockBasedTable::Rep {
   unique_ptr<FilterBlockReader> filter;
 
   std::shared_ptr<const TableProperties> table_properties;
+  // The index type the table was written with
   BlockBasedTableOptions::IndexType index_type;
   bool hash_index_allow_collision;
   bool whole_key_filtering;
   bool prefix_filtering;
+  // Whether the filter is a PartitionedFilterBlockReader
+  bool filter_partitioned;
+  // The policy name the filter of the table is stored under: the name of
+  // filter_policy, or that of a policy whose filters filter_policy can read
+  std::string filter_policy_name;
   // TODO(kailiu) It is very ugly to use internal key in table, since table
   // module should not be relying on db module. However to make things easier
   // and compatible with existing code, we introduce a wrapper that allows
@@ -493,7 +502,6 @@ Status BlockBasedTable::Open(const ImmutableCFOptions& ioptions,
       ioptions, env_options, table_options, internal_comparator);
   rep->file = std::move(file);
   rep->footer = footer;
-  rep->index_type = table_options.index_type;
   rep->hash_index_allow_collision = table_options.hash_index_allow_collision;
   SetupCacheKeyPrefix(rep);
   unique_ptr<BlockBasedTable> new_table(new BlockBasedTable(rep));
@@ -546,6 +554,39 @@ Status BlockBasedTable::Open(const ImmutableCFOptions& ioptions,
         BlockBasedTablePropertyNames::kPrefixFiltering, rep->ioptions.info_log);
   }
 
+  // Some old version of block-based tables don't have index type present in
+  // table properties. If that's the case we can safely use the kBinarySearch.
+  rep->index_type = BlockBasedTableOptions::kBinarySearch;
+  if (rep->table_properties) {
+    auto& props = rep->table_properties->user_collected_properties;
+    auto pos = props.find(BlockBasedTablePropertyNames::kIndexType);
+    if (pos != props.end()) {
+      rep->index_type = static_cast<BlockBasedTableOptions::IndexType>(
+          DecodeFixed32(pos->second.c_str()));
+    }
+  }
+
+  // A table built with another filter policy keeps its filter as long as
+  // the configured policy can read it
+  if (rep->filter_policy) {
+    rep->filter_policy_name = rep->filter_policy->Name();
+    if (rep->table_properties &&
+        !rep->table_properties->filter_policy_name.empty() &&
+        rep->filter_policy->CanReadFiltersOf(
+            rep->table_properties->filter_policy_name)) {
+      rep->filter_policy_name = rep->table_properties->filter_policy_name;
+    }
+  }
+
+  // A partitioned filter is looked up through the index on its partitions
+  if (rep->filter_policy) {
+    std::string filter_block_key = kPartitionedFilterBlockPrefix;
+    filter_block_key.append(rep->filter_policy_name);
+    BlockHandle handle;
+    rep->filter_partitioned =
+        FindMetaBlock(meta_iter.get(), filter_block_key, &handle).ok();
+  }
+
   if (prefetch_index_and_filter) {
     // pre-fetching of blocks is turned on
     // Will use block cache for index/filter blocks access?
@@ -782,9 +823,10 @@ FilterBlockReader* BlockBasedTable::ReadFilter(
     Rep* rep, Iterator* meta_index_iter, size_t* filter_size) {
   // TODO: We might want to unify with ReadBlockFromFile() if we start
   // requiring checksum verification in Table::Open.
-  for (auto prefix : {kFullFilterBlockPrefix, kFilterBlockPrefix}) {
+  for (auto prefix : {kFullFilterBlockPrefix, kPartitionedFilterBlockPrefix,
+                      kFilterBlockPrefix}) {
     std::string filter_block_key = prefix;
-    filter_block_key.append(rep->filter_policy->Name());
+    filter_block_key.append(rep->filter_policy_name);
     BlockHandle handle;
     if (FindMetaBlock(meta_index_iter, filter_block_key, &handle).ok()) {
       BlockContents block;
@@ -811,6 +853,9 @@ FilterBlockReader* BlockBasedTable::ReadFilter(
               rep->prefix_filtering ? rep->ioptions.prefix_extractor : nullptr,
               rep->whole_key_filtering, std::move(block), filter_bits_reader);
         }
+      } else if (kPartitionedFilterBlockPrefix == prefix) {
+        return new PartitionedFilterBlockReader(&rep->internal_comparator,
+                                                std::move(block));
       } else {
         assert(false);
         return nullptr;
@@ -876,12 +921,121 @@ BlockBasedTable::CachableEntry<FilterBlockReader> BlockBasedTable::GetFilter(
   return { filter, cache_handle };
 }
 
+BlockBasedTable::CachableEntry<FilterBlockReader>
+BlockBasedTable::GetFilterPartition(FilterBlockReader* filter,
+                                    const Slice& internal_key, bool no_io,
+                                    bool* past_end,
+                                    std::string* partition_key) const {
+  assert(rep_->filter_partitioned);
+  *past_end = false;
+  BlockHandle handle;
+  Status s = static_cast<PartitionedFilterBlockReader*>(filter)
+                 ->GetPartitionHandle(internal_key, &handle, partition_key);
+  if (s.IsNotFound()) {
+    *past_end = true;
+    return CachableEntry<FilterBlockReader>();
+  } else if (!s.ok()) {
+    return CachableEntry<FilterBlockReader>();
+  }
+
+  PERF_TIMER_GUARD(read_filter_block_nanos);
+
+  // The partitions are cached whenever there is a block cache, so that only
+  // the ones lookups need are held in memory
+  Cache* block_cache = rep_->table_options.block_cache.get();
+  Statistics* statistics = rep_->ioptions.statistics;
+  char cache_key[kMaxCacheKeyPrefixSize + kMaxVarint64Length];
+  Slice key;
+  if (block_cache != nullptr) {
+    key = GetCacheKey(rep_->cache_key_prefix, rep_->cache_key_prefix_size,
+                      handle, cache_key);
+    auto cache_handle =
+        GetEntryFromCache(block_cache, key, BLOCK_CACHE_FILTER_MISS,
+                          BLOCK_CACHE_FILTER_HIT, statistics);
+    if (cache_handle != nullptr) {
+      return {reinterpret_cast<FilterBlockReader*>(
+                  block_cache->Value(cache_handle)),
+              cache_handle};
+    }
+  }
+  if (no_io) {
+    return CachableEntry<FilterBlockReader>();
+  }
+
+  BlockContents block;
+  if (!ReadBlockContents(rep_->file.get(), rep_->footer, ReadOptions(), handle,
+                         &block, rep_->ioptions.env, false).ok()) {
+    return CachableEntry<FilterBlockReader>();
+  }
+  auto filter_bits_reader =
+      rep_->filter_policy->GetFilterBitsReader(block.data);
+  if (filter_bits_reader == nullptr) {
+    return CachableEntry<FilterBlockReader>();
+  }
+  size_t partition_size = block.data.size();
+  FilterBlockReader* partition = new FullFilterBlockReader(
+      rep_->prefix_filtering ? rep_->ioptions.prefix_extractor : nullptr,
+      rep_->whole_key_filtering, std::move(block), filter_bits_reader);
+  Cache::Handle* cache_handle = nullptr;
+  if (block_cache != nullptr) {
+    cache_handle = block_cache->Insert(key, partition, partition_size,
+                                       &DeleteCachedEntry<FilterBlockReader>);
+    RecordTick(statistics, BLOCK_CACHE_ADD);
+  }
+  return {partition, cache_handle};
+}
+
+void BlockBasedTable::ReleaseFilterPartition(
+    CachableEntry<FilterBlockReader>* partition) const {
+  if (partition->cache_handle != nullptr) {
+    partition->Release(rep_->table_options.block_cache.get());
+  } else {
+    delete partition->value;
+    partition->value = nullptr;
+  }
+}
+
+// Iterates the partitions of a kTwoLevelIndexSearch index, which are read and
+// cached like data blocks.
+class BlockBasedTable::PartitionIndexIteratorState
+    : public TwoLevelIteratorState {
+ public:
+  PartitionIndexIteratorState(Rep* rep, const ReadOptions& read_options)
+      : TwoLevelIteratorState(false /* check_prefix_may_match */),
+        rep_(rep),
+        read_options_(read_options) {}
+
+  Iterator* NewSecondaryIterator(const Slice& index_value) override {
+    return NewDataBlockIterator(rep_, read_options_, index_value);
+  }
+
+  bool PrefixMayMatch(const Slice& internal_key) override { return true; }
+
+ private:
+  // Don't own rep_
+  Rep* rep_;
+  const ReadOptions read_options_;
+};
+
 Iterator* BlockBasedTable::NewIndexIterator(const ReadOptions& read_options,
         BlockIter* input_iter) {
+  const bool partitioned =
+      rep_->index_type == BlockBasedTableOptions::kTwoLevelIndexSearch;
+  if (partitioned) {
+    // The iterator over the partitions owns the top-level index iterator, so
+    // the latter cannot live in input_iter
+    input_iter = nullptr;
+  }
+
   // index reader has already been pre-populated.
   if (rep_->index_reader) {
-    return rep_->index_reader->NewIterator(
+    auto* iter = rep_->index_reader->NewIterator(
         input_iter, read_options.total_order_seek);
+    if (partitioned) {
+      return NewTwoLevelIterator(
+          new PartitionIndexIteratorState(rep_, read_options), iter);
+    }
+    return iter;
   }
   PERF_TIMER_GUARD(read_index_block_nanos);
 
@@ -934,6 +1088,10 @@ Iterator* BlockBasedTable::NewIndexIterator(const ReadOptions& read_options,
   auto* iter = index_reader->NewIterator(
       input_iter, read_options.total_order_seek);
   iter->RegisterCleanup(&ReleaseCachedEntry, block_cache, cache_handle);
+  if (partitioned) {
+    return NewTwoLevelIterator(
+        new PartitionIndexIteratorState(rep_, read_options), iter);
+  }
   return iter;
 }
 
@@ -1027,15 +1185,21 @@ Iterator* BlockBasedTable::NewDataBlockIterator(Rep* rep,
     }
   }
 
+  return NewDataBlockIterator(rep, &block, s, input_iter);
+}
+
+Iterator* BlockBasedTable::NewDataBlockIterator(Rep* rep,
+    CachableEntry<Block>* block, const Status& s, BlockIter* input_iter) {
   Iterator* iter;
-  if (block.value != nullptr) {
-    iter = block.value->NewIterator(&rep->internal_comparator, input_iter);
-    if (block.cache_handle != nullptr) {
-      iter->RegisterCleanup(&ReleaseCachedEntry, block_cache,
-          block.cache_handle);
+  if (block->value != nullptr) {
+    iter = block->value->NewIterator(&rep->internal_comparator, input_iter);
+    if (block->cache_handle != nullptr) {
+      iter->RegisterCleanup(&ReleaseCachedEntry,
+          rep->table_options.block_cache.get(), block->cache_handle);
     } else {
-      iter->RegisterCleanup(&DeleteHeldResource<Block>, block.value, nullptr);
+      iter->RegisterCleanup(&DeleteHeldResource<Block>, block->value, nullptr);
     }
+    *block = CachableEntry<Block>();
   } else {
     if (input_iter != nullptr) {
       input_iter->SetStatus(s);
@@ -1047,6 +1211,80 @@ Iterator* BlockBasedTable::NewDataBlockIterator(Rep* rep,
   return iter;
 }
 
+void BlockBasedTable::PrefetchDataBlocks(
+    Rep* rep, const ReadOptions& ro, const std::vector<BlockHandle>& handles,
+    std::vector<CachableEntry<Block>>* blocks) {
+  Cache* block_cache = rep->table_options.block_cache.get();
+  Cache* block_cache_compressed =
+      rep->table_options.block_cache_compressed.get();
+  Statistics* statistics = rep->ioptions.statistics;
+  const bool fill_cache = (block_cache != nullptr ||
+                           block_cache_compressed != nullptr) && ro.fill_cache;
+
+  blocks->clear();
+  blocks->resize(handles.size());
+  std::vector<size_t> missing;
+  std::vector<std::string> keys, ckeys;
+  for (size_t i = 0; i < handles.size(); ++i) {
+    char cache_key[kMaxCacheKeyPrefixSize + kMaxVarint64Length];
+    char compressed_cache_key[kMaxCacheKeyPrefixSize + kMaxVarint64Length];
+    Slice key, ckey;
+    if (block_cache != nullptr) {
+      key = GetCacheKey(rep->cache_key_prefix, rep->cache_key_prefix_size,
+                        handles[i], cache_key);
+    }
+    if (block_cache_compressed != nullptr) {
+      ckey = GetCacheKey(rep->compressed_cache_key_prefix,
+                         rep->compressed_cache_key_prefix_size, handles[i],
+                         compressed_cache_key);
+    }
+    if (block_cache != nullptr || block_cache_compressed != nullptr) {
+      GetDataBlockFromCache(key, ckey, block_cache, block_cache_compressed,
+                            statistics, ro, &(*blocks)[i],
+                            rep->table_options.format_version);
+    }
+    if ((*blocks)[i].value == nullptr) {
+      missing.push_back(i);
+      keys.push_back(key.ToString());
+      ckeys.push_back(ckey.ToString());
+    }
+  }
+  // A single block is read by its lookup as usual
+  if (missing.size() < 2) {
+    return;
+  }
+
+  std::vector<BlockHandle> read_handles;
+  for (size_t i : missing) {
+    read_handles.push_back(handles[i]);
+  }
+  std::vector<BlockContents> contents(missing.size());
+  std::vector<Status> statuses(missing.size());
+  {
+    StopWatch sw(rep->ioptions.env, statistics, READ_BLOCK_GET_MICROS);
+    MultiReadBlockContents(rep->file.get(), rep->footer, ro,
+                           read_handles.data(), read_handles.size(),
+                           contents.data(), statuses.data(),
+                           !fill_cache || block_cache_compressed == nullptr);
+  }
+
+  // A block that failed to read is left to its lookup, which reports the error
+  for (size_t j = 0; j < missing.size(); ++j) {
+    if (!statuses[j].ok()) {
+      continue;
+    }
+    CachableEntry<Block>* block = &(*blocks)[missing[j]];
+    Block* raw_block = new Block(std::move(contents[j]));
+    if (fill_cache) {
+      PutDataBlockToCache(keys[j], ckeys[j], block_cache,
+                          block_cache_compressed, ro, statistics, block,
+                          raw_block, rep->table_options.format_version);
+    } else {
+      block->value = raw_block;
+    }
+  }
+}
+
 class BlockBasedTable::BlockEntryIteratorState : public TwoLevelIteratorState {
  public:
   BlockEntryIteratorState(BlockBasedTable* table,
@@ -1108,7 +1346,25 @@ bool BlockBasedTable::PrefixMayMatch(const Slice& internal_key) {
   // First, try check with full filter
   auto filter_entry = GetFilter(true /* no io */);
   FilterBlockReader* filter = filter_entry.value;
-  if (filter != nullptr && !filter->IsBlockBased()) {
+  if (filter != nullptr && rep_->filter_partitioned) {
+    // The keys with the prefix start in the partition found for the smallest
+    // of them. They may only continue into the next partitions if the key of
+    // this one has the prefix itself.
+    InternalKey first_with_prefix(prefix, kMaxSequenceNumber,
+                                  kValueTypeForSeek);
+    bool past_end = false;
+    std::string partition_key;
+    auto partition =
+        GetFilterPartition(filter, first_with_prefix.Encode(), true /* no io */,
+                           &past_end, &partition_key);
+    if (past_end) {
+      may_match = false;
+    } else if (partition.value != nullptr &&
+               !ExtractUserKey(partition_key).starts_with(prefix)) {
+      may_match = partition.value->PrefixMayMatch(prefix);
+    }
+    ReleaseFilterPartition(&partition);
+  } else if (filter != nullptr && !filter->IsBlockBased()) {
     may_match = filter->PrefixMayMatch(prefix);
   }
 
@@ -1167,40 +1423,57 @@ Iterator* BlockBasedTable::NewIterator(const ReadOptions& read_options,
 }
 
 bool BlockBasedTable::FullFilterKeyMayMatch(FilterBlockReader* filter,
-                                            const Slice& internal_key) const {
+                                            const Slice& internal_key,
+                                            bool no_io) const {
   if (filter == nullptr || filter->IsBlockBased()) {
     return true;
   }
-  Slice user_key = ExtractUserKey(internal_key);
-  if (!filter->KeyMayMatch(user_key)) {
-    return false;
+  CachableEntry<FilterBlockReader> partition;
+  if (rep_->filter_partitioned) {
+    bool past_end = false;
+    partition = GetFilterPartition(filter, internal_key, no_io, &past_end);
+    if (past_end) {
+      return false;
+    }
+    if (partition.value == nullptr) {
+      return true;
+    }
+    filter = partition.value;
   }
-  if (rep_->ioptions.prefix_extractor &&
-      !filter->PrefixMayMatch(
-          rep_->ioptions.prefix_extractor->Transform(user_key))) {
-    return false;
+  Slice user_key = ExtractUserKey(internal_key);
+  bool may_match = filter->KeyMayMatch(user_key) &&
+                   (rep_->ioptions.prefix_extractor == nullptr ||
+                    filter->PrefixMayMatch(
+                        rep_->ioptions.prefix_extractor->Transform(user_key)));
+  if (rep_->filter_partitioned) {
+    ReleaseFilterPartition(&partition);
   }
-  return true;
+  return may_match;
 }
 
 Status BlockBasedTable::Get(
     const ReadOptions& read_options, const Slice& key,
     GetContext* get_context) {
   Status s;
-  auto filter_entry = GetFilter(read_options.read_tier == kBlockCacheTier);
+  const bool no_io = read_options.read_tier == kBlockCacheTier;
+  auto filter_entry = GetFilter(no_io);
   FilterBlockReader* filter = filter_entry.value;
 
   // First check the full filter
   // If full filter not useful, Then go into each block
-  if (!FullFilterKeyMayMatch(filter, key)) {
+  if (!FullFilterKeyMayMatch(filter, key, no_io)) {
     RecordTick(rep_->ioptions.statistics, BLOOM_FILTER_USEFUL);
   } else {
-    BlockIter iiter;
-    NewIndexIterator(read_options, &iiter);
+    BlockIter iiter_on_stack;
+    Iterator* iiter = NewIndexIterator(read_options, &iiter_on_stack);
+    std::unique_ptr<Iterator> iiter_unique_ptr;
+    if (iiter != &iiter_on_stack) {
+      iiter_unique_ptr.reset(iiter);
+    }
 
     bool done = false;
-    for (iiter.Seek(key); iiter.Valid() && !done; iiter.Next()) {
-      Slice handle_value = iiter.value();
+    for (iiter->Seek(key); iiter->Valid() && !done; iiter->Next()) {
+      Slice handle_value = iiter->value();
 
       BlockHandle handle;
       bool not_exist_in_filter =
@@ -1216,7 +1489,7 @@ Status BlockBasedTable::Get(
         break;
       } else {
         BlockIter biter;
-        NewDataBlockIterator(rep_, read_options, iiter.value(), &biter);
+        NewDataBlockIterator(rep_, read_options, iiter->value(), &biter);
 
         if (read_options.read_tier && biter.status().IsIncomplete()) {
           // couldn't get block from block_cache
@@ -1231,7 +1504,7 @@ Status BlockBasedTable::Get(
         }
 
         // Call the *saver function on each entry/block until it returns false
-        for (biter.Seek(key); biter.Valid(); biter.Next()) {
+        for (biter.SeekForGet(key); biter.Valid(); biter.Next()) {
           ParsedInternalKey parsed_key;
           if (!ParseInternalKey(biter.key(), &parsed_key)) {
             s = Status::Corruption(Slice());
@@ -1246,7 +1519,7 @@ Status BlockBasedTable::Get(
       }
     }
     if (s.ok()) {
-      s = iiter.status();
+      s = iiter->status();
     }
   }
 
@@ -1254,6 +1527,187 @@ Status BlockBasedTable::Get(
   return s;
 }
 
+void BlockBasedTable::MultiGet(const ReadOptions& read_options,
+                               size_t num_keys, const Slice* keys,
+                               GetContext* const* get_contexts,
+                               Status* statuses) {
+  const bool no_io = read_options.read_tier == kBlockCacheTier;
+  auto filter_entry = GetFilter(no_io);
+  FilterBlockReader* filter = filter_entry.value;
+
+  // First check the full filter
+  // If full filter not useful, Then go into each block
+  std::unique_ptr<bool[]> may_match(new bool[num_keys]);
+  if (filter != nullptr && !filter->IsBlockBased() &&
+      !rep_->filter_partitioned) {
+    // The whole batch goes through the full filter at once
+    std::vector<Slice> user_keys(num_keys);
+    for (size_t i = 0; i < num_keys; ++i) {
+      user_keys[i] = ExtractUserKey(keys[i]);
+    }
+    filter->KeysMayMatch(num_keys, user_keys.data(), may_match.get());
+    if (rep_->ioptions.prefix_extractor != nullptr) {
+      for (size_t i = 0; i < num_keys; ++i) {
+        may_match[i] =
+            may_match[i] &&
+            filter->PrefixMayMatch(
+                rep_->ioptions.prefix_extractor->Transform(user_keys[i]));
+      }
+    }
+  } else {
+    for (size_t i = 0; i < num_keys; ++i) {
+      may_match[i] = FullFilterKeyMayMatch(filter, keys[i], no_io);
+    }
+  }
+
+  // The index iterator is opened once, on first use
+  BlockIter iiter_on_stack;
+  Iterator* iiter = nullptr;
+  std::unique_ptr<Iterator> iiter_unique_ptr;
+  auto open_index = [&]() {
+    iiter = NewIndexIterator(read_options, &iiter_on_stack);
+    if (iiter != &iiter_on_stack) {
+      iiter_unique_ptr.reset(iiter);
+    }
+  };
+
+  // The first data block of every key, sorted by offset, read ahead of the
+  // lookups so that the blocks missing from the block cache are read
+  // together instead of one after the other
+  std::vector<BlockHandle> prefetch_handles;
+  std::vector<CachableEntry<Block>> prefetched;
+  if (!no_io && num_keys > 1) {
+    open_index();
+    for (size_t i = 0; i < num_keys; ++i) {
+      if (!may_match[i]) {
+        continue;
+      }
+      iiter->Seek(keys[i]);
+      BlockHandle handle;
+      Slice handle_value = iiter->Valid() ? iiter->value() : Slice();
+      if (!iiter->Valid() || !handle.DecodeFrom(&handle_value).ok() ||
+          (filter != nullptr && filter->IsBlockBased() &&
+           !filter->KeyMayMatch(ExtractUserKey(keys[i]), handle.offset()))) {
+        continue;
+      }
+      prefetch_handles.push_back(handle);
+    }
+    auto by_offset = [](const BlockHandle& a, const BlockHandle& b) {
+      return a.offset() < b.offset();
+    };
+    auto same_offset = [](const BlockHandle& a, const BlockHandle& b) {
+      return a.offset() == b.offset();
+    };
+    std::sort(prefetch_handles.begin(), prefetch_handles.end(), by_offset);
+    prefetch_handles.erase(std::unique(prefetch_handles.begin(),
+                                       prefetch_handles.end(), same_offset),
+                           prefetch_handles.end());
+    PrefetchDataBlocks(rep_, read_options, prefetch_handles, &prefetched);
+  }
+
+  // The data block read last, and its handle; it is reused as long as the
+  // keys, which are sorted, keep falling into it
+  std::unique_ptr<BlockIter> biter;
+  std::string biter_handle;
+
+  for (size_t i = 0; i < num_keys; ++i) {
+    const Slice& key = keys[i];
+    GetContext* get_context = get_contexts[i];
+    Status s;
+
+    if (!may_match[i]) {
+      RecordTick(rep_->ioptions.statistics, BLOOM_FILTER_USEFUL);
+      statuses[i] = s;
+      continue;
+    }
+    if (iiter == nullptr) {
+      open_index();
+    }
+
+    bool done = false;
+    for (iiter->Seek(key); iiter->Valid() && !done; iiter->Next()) {
+      Slice handle_value = iiter->value();
+
+      BlockHandle handle;
+      bool not_exist_in_filter =
+          filter != nullptr && filter->IsBlockBased() == true &&
+          handle.DecodeFrom(&handle_value).ok() &&
+          !filter->KeyMayMatch(ExtractUserKey(key), handle.offset());
+
+      if (not_exist_in_filter) {
+        // Not found
+        RecordTick(rep_->ioptions.statistics, BLOOM_FILTER_USEFUL);
+        break;
+      }
+
+      if (biter == nullptr || iiter->value() != Slice(biter_handle)) {
+        Slice input = iiter->value();
+        CachableEntry<Block>* block = nullptr;
+        if (!prefetch_handles.empty() && handle.DecodeFrom(&input).ok()) {
+          auto it = std::lower_bound(
+              prefetch_handles.begin(), prefetch_handles.end(), handle,
+              [](const BlockHandle& a, const BlockHandle& b) {
+                return a.offset() < b.offset();
+              });
+          if (it != prefetch_handles.end() &&
+              it->offset() == handle.offset()) {
+            block = &prefetched[it - prefetch_handles.begin()];
+          }
+        }
+        biter.reset(new BlockIter);
+        if (block != nullptr && block->value != nullptr) {
+          NewDataBlockIterator(rep_, block, Status::OK(), biter.get());
+        } else {
+          NewDataBlockIterator(rep_, read_options, iiter->value(), biter.get());
+        }
+        biter_handle.assign(iiter->value().data(), iiter->value().size());
+      }
+
+      if (read_options.read_tier && biter->status().IsIncomplete()) {
+        // couldn't get block from block_cache
+        // Update Saver.state to Found because we are only looking for whether
+        // we can guarantee the key is not there when "no_io" is set
+        get_context->MarkKeyMayExist();
+        biter.reset();
+        break;
+      }
+      if (!biter->status().ok()) {
+        s = biter->status();
+        biter.reset();
+        break;
+      }
+
+      // Call the *saver function on each entry/block until it returns false
+      for (biter->SeekForGet(key); biter->Valid(); biter->Next()) {
+        ParsedInternalKey parsed_key;
+        if (!ParseInternalKey(biter->key(), &parsed_key)) {
+          s = Status::Corruption(Slice());
+        }
+
+        if (!get_context->SaveValue(parsed_key, biter->value())) {
+          done = true;
+          break;
+        }
+      }
+      s = biter->status();
+    }
+    if (s.ok()) {
+      s = iiter->status();
+    }
+    statuses[i] = s;
+  }
+
+  // Blocks no lookup ended up using
+  for (auto& block : prefetched) {
+    if (block.cache_handle != nullptr) {
+      block.Release(rep_->table_options.block_cache.get());
+    } else {
+      delete block.value;
+    }
+  }
+  filter_entry.Release(rep_->table_options.block_cache.get());
+}
+
 Status BlockBasedTable::Prefetch(const Slice* const begin,
                                  const Slice* const end) {
   auto& comparator = rep_->internal_comparator;
@@ -1262,22 +1716,26 @@ Status BlockBasedTable::Prefetch(const Slice* const begin,
     return Status::InvalidArgument(*begin, *end);
   }
 
-  BlockIter iiter;
-  NewIndexIterator(ReadOptions(), &iiter);
+  BlockIter iiter_on_stack;
+  Iterator* iiter = NewIndexIterator(ReadOptions(), &iiter_on_stack);
+  std::unique_ptr<Iterator> iiter_unique_ptr;
+  if (iiter != &iiter_on_stack) {
+    iiter_unique_ptr.reset(iiter);
+  }
 
-  if (!iiter.status().ok()) {
+  if (!iiter->status().ok()) {
     // error opening index iterator
-    return iiter.status();
+    return iiter->status();
   }
 
   // indicates if we are on the last page that need to be pre-fetched
   bool prefetching_boundary_page = false;
 
-  for (begin ? iiter.Seek(*begin) : iiter.SeekToFirst(); iiter.Valid();
-       iiter.Next()) {
-    Slice block_handle = iiter.value();
+  for (begin ? iiter->Seek(*begin) : iiter->SeekToFirst(); iiter->Valid();
+       iiter->Next()) {
+    Slice block_handle = iiter->value();
 
-    if (end && comparator.Compare(iiter.key(), *end) >= 0) {
+    if (end && comparator.Compare(iiter->key(), *end) >= 0) {
       if (prefetching_boundary_page) {
         break;
       }
@@ -1339,17 +1797,7 @@ bool BlockBasedTable::TEST_KeyInCache(const ReadOptions& options,
 //  5. index_type
 Status BlockBasedTable::CreateIndexReader(IndexReader** index_reader,
                                           Iterator* preloaded_meta_index_iter) {
-  // Some old version of block-based tables don't have index type present in
-  // table properties. If that's the case we can safely use the kBinarySearch.
-  auto index_type_on_file = BlockBasedTableOptions::kBinarySearch;
-  if (rep_->table_properties) {
-    auto& props = rep_->table_properties->user_collected_properties;
-    auto pos = props.find(BlockBasedTablePropertyNames::kIndexType);
-    if (pos != props.end()) {
-      index_type_on_file = static_cast<BlockBasedTableOptions::IndexType>(
-          DecodeFixed32(pos->second.c_str()));
-    }
-  }
+  auto index_type_on_file = rep_->index_type;
 
   auto file = rep_->file.get();
   auto env = rep_->ioptions.env;
@@ -1366,6 +1814,9 @@ Status BlockBasedTable::CreateIndexReader(IndexReader** index_reader,
   }
 
   switch (index_type_on_file) {
+    // The top-level index of a partitioned index is searched like a binary
+    // search index; NewIndexIterator() adds the partitions below it.
+    case BlockBasedTableOptions::kTwoLevelIndexSearch:
     case BlockBasedTableOptions::kBinarySearch: {
       return BinarySearchIndexReader::Create(
           file, footer, footer.index_handle(), env, comparator, index_reader);
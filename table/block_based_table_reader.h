@@ -13,6 +13,7 @@
 #include <memory>
 #include <utility>
 #include <string>
+#include <vector>
 
 #include "rocksdb/options.h"
 #include "rocksdb/statistics.h"
@@ -53,6 +54,7 @@ class BlockBasedTable : public TableReader {
  public:
   static const std::string kFilterBlockPrefix;
   static const std::string kFullFilterBlockPrefix;
+  static const std::string kPartitionedFilterBlockPrefix;
 
   // Attempt to open the table that is stored in bytes [0..file_size)
   // of "file", and read the metadata entries necessary to allow
@@ -84,6 +86,12 @@ class BlockBasedTable : public TableReader {
   Status Get(const ReadOptions& readOptions, const Slice& key,
              GetContext* get_context) override;
 
+  // Shares the filter and the index iterator between the keys, and reads a
+  // data block once for consecutive keys that fall into it.
+  void MultiGet(const ReadOptions& readOptions, size_t num_keys,
+                const Slice* keys, GetContext* const* get_contexts,
+                Status* statuses) override;
+
   // Pre-fetch the disk blocks that correspond to the key range specified by
   // (kbegin, kend). The call will return return error status in the event of
   // IO or iteration error.
@@ -128,16 +136,40 @@ class BlockBasedTable : public TableReader {
   bool compaction_optimized_;
 
   class BlockEntryIteratorState;
+  class PartitionIndexIteratorState;
   // input_iter: if it is not null, update this one and return it as Iterator
   static Iterator* NewDataBlockIterator(Rep* rep, const ReadOptions& ro,
                                         const Slice& index_value,
                                         BlockIter* input_iter = nullptr);
+  // Returns an iterator over block->value, which the iterator takes over, or
+  // one that reports s if there is no block.
+  static Iterator* NewDataBlockIterator(Rep* rep, CachableEntry<Block>* block,
+                                        const Status& s, BlockIter* input_iter);
+
+  // Looks the data blocks of "handles", sorted by offset, up in the block
+  // caches and reads the missing ones with one MultiRead(), filling the block
+  // cache as NewDataBlockIterator() does. (*blocks)[i] holds the block of
+  // handles[i], or nothing if it was not read.
+  static void PrefetchDataBlocks(Rep* rep, const ReadOptions& ro,
+                                 const std::vector<BlockHandle>& handles,
+                                 std::vector<CachableEntry<Block>>* blocks);
 
   // For the following two functions:
   // if `no_io == true`, we will not try to read filter/index from sst file
   // were they not present in cache yet.
   CachableEntry<FilterBlockReader> GetFilter(bool no_io = false) const;
 
+  // Get the partition of a partitioned filter that covers internal_key, from
+  // the block cache if there is one. Sets *past_end if internal_key is beyond
+  // the last partition, so in no partition at all, and *partition_key, if
+  // given, to the key of the partition. The returned entry is released with
+  // ReleaseFilterPartition().
+  CachableEntry<FilterBlockReader> GetFilterPartition(
+      FilterBlockReader* filter, const Slice& internal_key, bool no_io,
+      bool* past_end, std::string* partition_key = nullptr) const;
+  void ReleaseFilterPartition(CachableEntry<FilterBlockReader>* partition)
+      const;
+
   // Get the iterator from the index reader.
   // If input_iter is not set, return new Iterator
   // If input_iter is set, update it and return it as Iterator
@@ -190,7 +222,7 @@ class BlockBasedTable : public TableReader {
                            Iterator* preloaded_meta_index_iter = nullptr);
 
   bool FullFilterKeyMayMatch(FilterBlockReader* filter,
-                             const Slice& user_key) const;
+                             const Slice& internal_key, bool no_io) const;
 
   // Read the meta block from sst.
   static Status ReadMetaBlock(
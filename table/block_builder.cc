@@ -41,11 +41,15 @@
 
 namespace rocksdb {
 
-BlockBuilder::BlockBuilder(int block_restart_interval)
+BlockBuilder::BlockBuilder(int block_restart_interval,
+                           bool use_data_block_hash_index,
+                           double data_block_hash_table_util_ratio)
     : block_restart_interval_(block_restart_interval),
       restarts_(),
       counter_(0),
-      finished_(false) {
+      finished_(false),
+      use_data_block_hash_index_(use_data_block_hash_index),
+      data_block_hash_index_builder_(data_block_hash_table_util_ratio) {
   assert(block_restart_interval_ >= 1);
   restarts_.push_back(0);       // First restart point is at offset 0
 }
@@ -57,12 +61,17 @@ void BlockBuilder::Reset() {
   counter_ = 0;
   finished_ = false;
   last_key_.clear();
+  data_block_hash_index_builder_.Reset();
 }
 
 size_t BlockBuilder::CurrentSizeEstimate() const {
-  return (buffer_.size() +                        // Raw data buffer
-          restarts_.size() * sizeof(uint32_t) +   // Restart array
-          sizeof(uint32_t));                      // Restart array length
+  size_t estimate = (buffer_.size() +                        // Raw data buffer
+                     restarts_.size() * sizeof(uint32_t) +   // Restart array
+                     sizeof(uint32_t));                      // Restart array length
+  if (HasHashIndex()) {
+    estimate += data_block_hash_index_builder_.EstimateSize();
+  }
+  return estimate;
 }
 
 size_t BlockBuilder::EstimateSizeAfterKV(const Slice& key, const Slice& value)
@@ -85,11 +94,25 @@ Slice BlockBuilder::Finish() {
   for (size_t i = 0; i < restarts_.size(); i++) {
     PutFixed32(&buffer_, restarts_[i]);
   }
-  PutFixed32(&buffer_, static_cast<uint32_t>(restarts_.size()));
+  bool has_hash_index = HasHashIndex();
+  if (has_hash_index) {
+    data_block_hash_index_builder_.Finish(&buffer_);
+  }
+  PutFixed32(&buffer_,
+             PackDataBlockFooter(has_hash_index,
+                                 static_cast<uint32_t>(restarts_.size())));
   finished_ = true;
   return Slice(buffer_);
 }
 
+bool BlockBuilder::HasHashIndex() const {
+  // The last restart intervals may hold only older versions of user keys
+  // that started before them, which the hash index builder never sees
+  return use_data_block_hash_index_ &&
+         restarts_.size() <= kDataBlockHashMaxRestarts &&
+         data_block_hash_index_builder_.Valid();
+}
+
 void BlockBuilder::Add(const Slice& key, const Slice& value) {
   Slice last_key_piece(last_key_);
   assert(!finished_);
@@ -108,6 +131,14 @@ void BlockBuilder::Add(const Slice& key, const Slice& value) {
   }
   const size_t non_shared = key.size() - shared;
 
+  // Only the first version of a user key goes into the hash index
+  if (use_data_block_hash_index_ &&
+      (buffer_.empty() ||
+       ExtractUserKey(last_key_piece) != ExtractUserKey(key))) {
+    data_block_hash_index_builder_.Add(
+        ExtractUserKey(key), static_cast<uint32_t>(restarts_.size() - 1));
+  }
+
   // Add "<shared><non_shared><value_size>" to buffer_
   PutVarint32(&buffer_, static_cast<uint32_t>(shared));
   PutVarint32(&buffer_, static_cast<uint32_t>(non_shared));
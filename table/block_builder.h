@@ -12,6 +12,7 @@
 
 #include <stdint.h>
 #include "rocksdb/slice.h"
+#include "table/data_block_hash_index.h"
 
 namespace rocksdb {
 
@@ -20,7 +21,12 @@ class BlockBuilder {
   BlockBuilder(const BlockBuilder&) = delete;
   void operator=(const BlockBuilder&) = delete;
 
-  explicit BlockBuilder(int block_restart_interval);
+  // use_data_block_hash_index: append a DataBlockHashIndex over the user
+  // keys, which requires the keys to be internal keys; util_ratio is its
+  // number of keys per bucket
+  explicit BlockBuilder(int block_restart_interval,
+                        bool use_data_block_hash_index = false,
+                        double data_block_hash_table_util_ratio = 0.75);
 
   // Reset the contents as if the BlockBuilder was just constructed.
   void Reset();
@@ -47,6 +53,9 @@ class BlockBuilder {
   }
 
  private:
+  // Whether the block gets a hash index if finished now
+  bool HasHashIndex() const;
+
   const int          block_restart_interval_;
 
   std::string           buffer_;    // Destination buffer
@@ -54,6 +63,8 @@ class BlockBuilder {
   int                   counter_;   // Number of entries emitted since restart
   bool                  finished_;  // Has Finish() been called?
   std::string           last_key_;
+  const bool            use_data_block_hash_index_;
+  DataBlockHashIndexBuilder data_block_hash_index_builder_;
 };
 
 }  // namespace rocksdb
@@ -20,6 +20,7 @@
 #include "table/format.h"
 #include "table/block_hash_index.h"
 #include "util/random.h"
+#include "util/string_util.h"
 #include "util/testharness.h"
 #include "util/testutil.h"
 
@@ -234,6 +235,132 @@ TEST_F(BlockTest, IndexHashWithSharedPrefix) {
   CheckBlockContents(std::move(contents), kMaxKey, keys, values);
 }
 
+// Builds a data block of internal keys where every other user key has two
+// versions, with or without a data block hash index
+static Slice BuildDataBlock(BlockBuilder* builder, int num_user_keys,
+                            std::vector<std::string>* keys) {
+  for (int i = 0; i < num_user_keys; i++) {
+    std::string user_key = GenerateKey(2 * i, 0, 0, nullptr);
+    int versions = (i % 2 == 0) ? 2 : 1;
+    for (int v = versions; v > 0; v--) {
+      InternalKey ikey(user_key, 100 + v, kTypeValue);
+      keys->push_back(ikey.Encode().ToString());
+      builder->Add(keys->back(), "v" + ToString(i) + "." + ToString(v));
+    }
+  }
+  return builder->Finish();
+}
+
+TEST_F(BlockTest, DataBlockHashIndex) {
+  InternalKeyComparator icmp(BytewiseComparator());
+  const int kNumUserKeys = 1000;
+
+  for (int restart_interval : {1, 4, 16}) {
+    std::vector<std::string> keys;
+    BlockBuilder builder(restart_interval, true /* hash index */);
+    BlockBuilder plain_builder(restart_interval);
+    std::vector<std::string> plain_keys;
+    Slice raw = BuildDataBlock(&builder, kNumUserKeys, &keys);
+    Slice plain_raw = BuildDataBlock(&plain_builder, kNumUserKeys, &plain_keys);
+
+    Block reader(BlockContents(raw, false, kNoCompression));
+    Block plain_reader(BlockContents(plain_raw, false, kNoCompression));
+    ASSERT_EQ(reader.NumRestarts(), plain_reader.NumRestarts());
+    if (reader.NumRestarts() <= kDataBlockHashMaxRestarts) {
+      ASSERT_GT(raw.size(), plain_raw.size());
+    } else {
+      ASSERT_EQ(raw.ToString(), plain_raw.ToString());
+    }
+
+    // Iteration is unchanged
+    std::unique_ptr<Iterator> iter(reader.NewIterator(&icmp));
+    size_t count = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      ASSERT_EQ(iter->key().ToString(), keys[count++]);
+    }
+    ASSERT_OK(iter->status());
+    ASSERT_EQ(count, keys.size());
+    for (iter->SeekToLast(); iter->Valid(); iter->Prev()) {
+      ASSERT_EQ(iter->key().ToString(), keys[--count]);
+    }
+    ASSERT_EQ(count, 0U);
+
+    BlockIter biter;
+    reader.NewIterator(&icmp, &biter);
+    BlockIter plain_biter;
+    plain_reader.NewIterator(&icmp, &plain_biter);
+    for (int i = 0; i < kNumUserKeys; i++) {
+      // Present keys are found at their newest visible version
+      std::string user_key = GenerateKey(2 * i, 0, 0, nullptr);
+      for (SequenceNumber seq : {kMaxSequenceNumber, SequenceNumber(101)}) {
+        InternalKey lookup(user_key, seq, kValueTypeForSeek);
+        biter.SeekForGet(lookup.Encode());
+        plain_biter.SeekForGet(lookup.Encode());
+        ASSERT_OK(biter.status());
+        ASSERT_TRUE(biter.Valid());
+        ASSERT_TRUE(plain_biter.Valid());
+        ASSERT_EQ(biter.key().ToString(), plain_biter.key().ToString());
+        ASSERT_EQ(biter.value().ToString(), plain_biter.value().ToString());
+      }
+
+      // Absent keys never land on another version of themselves, and only
+      // run off the block when no key of the block is past them
+      std::string missing = GenerateKey(2 * i + 1, 0, 0, nullptr);
+      InternalKey lookup(missing, kMaxSequenceNumber, kValueTypeForSeek);
+      biter.SeekForGet(lookup.Encode());
+      ASSERT_OK(biter.status());
+      if (biter.Valid()) {
+        ASSERT_GT(icmp.Compare(biter.key(), lookup.Encode()), 0);
+        ASSERT_NE(ExtractUserKey(biter.key()).ToString(), missing);
+      } else {
+        ASSERT_EQ(i, kNumUserKeys - 1);
+      }
+    }
+  }
+}
+
+TEST_F(BlockTest, DataBlockHashIndexMaxRestarts) {
+  for (uint32_t num_user_keys : {kDataBlockHashMaxRestarts - 1,
+                                 kDataBlockHashMaxRestarts}) {
+    // One user key per restart interval, and a second version of the last
+    // one in an interval of its own
+    BlockBuilder builder(1, true /* hash index */);
+    BlockBuilder plain_builder(1);
+    for (uint32_t i = 0; i < num_user_keys; i++) {
+      std::string user_key = GenerateKey(i, 0, 0, nullptr);
+      int versions = (i + 1 == num_user_keys) ? 2 : 1;
+      for (int v = versions; v > 0; v--) {
+        InternalKey ikey(user_key, 100 + v, kTypeValue);
+        builder.Add(ikey.Encode(), "v");
+        plain_builder.Add(ikey.Encode(), "v");
+      }
+    }
+    Slice raw = builder.Finish();
+    Slice plain_raw = plain_builder.Finish();
+    Block reader(BlockContents(raw, false, kNoCompression));
+    ASSERT_EQ(num_user_keys + 1, reader.NumRestarts());
+    if (reader.NumRestarts() <= kDataBlockHashMaxRestarts) {
+      ASSERT_GT(raw.size(), plain_raw.size());
+    } else {
+      ASSERT_EQ(raw.ToString(), plain_raw.ToString());
+    }
+  }
+}
+
+TEST_F(BlockTest, DataBlockHashIndexCorruption) {
+  InternalKeyComparator icmp(BytewiseComparator());
+  std::vector<std::string> keys;
+  BlockBuilder builder(16, true /* hash index */);
+  std::string raw = BuildDataBlock(&builder, 100, &keys).ToString();
+
+  // A bucket count running past the block is caught on open
+  std::string bad = raw;
+  EncodeFixed32(&bad[bad.size() - 2 * sizeof(uint32_t)], 1U << 20);
+  Block reader(BlockContents(bad, false, kNoCompression));
+  std::unique_ptr<Iterator> iter(reader.NewIterator(&icmp));
+  ASSERT_TRUE(iter->status().IsCorruption());
+}
+
 }  // namespace rocksdb
 
 int main(int argc, char **argv) {
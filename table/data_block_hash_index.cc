@@ -0,0 +1,103 @@
+//  Copyright (c) 2013, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#include "table/data_block_hash_index.h"
+
+#include <assert.h>
+#include <algorithm>
+
+#include "util/coding.h"
+#include "util/hash.h"
+
+namespace rocksdb {
+
+static const uint32_t kDataBlockHashIndexFlag = 1U << 31;
+// Buckets are counted in a uint32, but a block never needs more than this
+static const uint32_t kDataBlockHashMaxBuckets = 1U << 16;
+
+uint32_t PackDataBlockFooter(bool has_hash_index, uint32_t num_restarts) {
+  assert(num_restarts < kDataBlockHashIndexFlag);
+  return has_hash_index ? (num_restarts | kDataBlockHashIndexFlag)
+                        : num_restarts;
+}
+
+void UnpackDataBlockFooter(uint32_t footer, bool* has_hash_index,
+                           uint32_t* num_restarts) {
+  *has_hash_index = (footer & kDataBlockHashIndexFlag) != 0;
+  *num_restarts = footer & ~kDataBlockHashIndexFlag;
+}
+
+DataBlockHashIndexBuilder::DataBlockHashIndexBuilder(double util_ratio)
+    : util_ratio_(util_ratio), valid_(true) {
+  assert(util_ratio_ > 0);
+}
+
+void DataBlockHashIndexBuilder::Add(const Slice& user_key,
+                                    uint32_t restart_index) {
+  if (restart_index >= kDataBlockHashMaxRestarts) {
+    valid_ = false;
+    return;
+  }
+  hash_and_restart_.emplace_back(GetSliceHash(user_key),
+                                 static_cast<uint8_t>(restart_index));
+}
+
+static uint32_t NumBuckets(size_t num_keys, double util_ratio) {
+  uint32_t num_buckets = static_cast<uint32_t>(
+      std::min<double>(num_keys / util_ratio, kDataBlockHashMaxBuckets - 1));
+  // An odd number of buckets mixes the low bits of the hashes better
+  return num_buckets | 1;
+}
+
+size_t DataBlockHashIndexBuilder::EstimateSize() const {
+  return NumBuckets(hash_and_restart_.size(), util_ratio_) + sizeof(uint32_t);
+}
+
+void DataBlockHashIndexBuilder::Finish(std::string* buffer) {
+  assert(valid_);
+  const uint32_t num_buckets =
+      NumBuckets(hash_and_restart_.size(), util_ratio_);
+  std::string buckets(num_buckets, static_cast<char>(kDataBlockHashNoEntry));
+  for (const auto& entry : hash_and_restart_) {
+    uint8_t& bucket = reinterpret_cast<uint8_t&>(
+        buckets[entry.first % num_buckets]);
+    if (bucket == kDataBlockHashNoEntry) {
+      bucket = entry.second;
+    } else if (bucket != entry.second) {
+      // Keys of different restart intervals share the bucket
+      bucket = kDataBlockHashCollision;
+    }
+  }
+  buffer->append(buckets);
+  PutFixed32(buffer, num_buckets);
+}
+
+void DataBlockHashIndexBuilder::Reset() {
+  valid_ = true;
+  hash_and_restart_.clear();
+}
+
+bool DataBlockHashIndex::Initialize(const char* data, uint32_t size,
+                                    uint32_t* index_offset) {
+  if (size < sizeof(uint32_t)) {
+    return false;
+  }
+  uint32_t num_buckets = DecodeFixed32(data + size - sizeof(uint32_t));
+  if (num_buckets == 0 || num_buckets > size - sizeof(uint32_t)) {
+    return false;
+  }
+  *index_offset = size - sizeof(uint32_t) - num_buckets;
+  buckets_ = data + *index_offset;
+  num_buckets_ = num_buckets;
+  return true;
+}
+
+uint8_t DataBlockHashIndex::Lookup(const Slice& user_key) const {
+  assert(Valid());
+  return static_cast<uint8_t>(
+      buckets_[GetSliceHash(user_key) % num_buckets_]);
+}
+
+}  // namespace rocksdb
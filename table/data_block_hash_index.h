@@ -0,0 +1,102 @@
+//  Copyright (c) 2013, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rocksdb/slice.h"
+
+namespace rocksdb {
+
+// A data block hash index maps the user keys of a data block to the restart
+// interval they start in, so that a point lookup goes straight to that
+// restart interval instead of binary searching the restart array. It is
+// appended to the data block, after the restart array:
+// +----------------------------------------------------------------+
+// | entries ... | restarts: uint32[num_restarts]                   |
+// +----------------------------------------------------------------+
+// | buckets: uint8[num_buckets] | num_buckets: uint32              |
+// +----------------------------------------------------------------+
+// | num_restarts | (1 << 31): uint32                               |
+// +----------------------------------------------------------------+
+// A bucket holds the restart index of the user keys hashed to it,
+// kDataBlockHashNoEntry if there are none or kDataBlockHashCollision if they
+// start in different restart intervals. The top bit of the last word, which
+// holds the number of restarts in a plain block, tells the two formats
+// apart; readers that do not know it see an impossible number of restarts
+// and report the block as corrupt instead of misreading it.
+//
+// User keys are compared bytewise through their hash, so as for the bloom
+// filters, the index must not be used with a comparator that finds keys of
+// different bytes equal.
+const uint8_t kDataBlockHashNoEntry = 255;
+const uint8_t kDataBlockHashCollision = 254;
+// A block with more restarts than this has no hash index: a bucket holds
+// restart indexes below the two values above
+const uint32_t kDataBlockHashMaxRestarts = 254;
+
+// Pack the number of restarts of a block and whether it has a hash index into
+// the last word of the block
+extern uint32_t PackDataBlockFooter(bool has_hash_index,
+                                    uint32_t num_restarts);
+extern void UnpackDataBlockFooter(uint32_t footer, bool* has_hash_index,
+                                  uint32_t* num_restarts);
+
+class DataBlockHashIndexBuilder {
+ public:
+  // util_ratio: the number of user keys per bucket that is aimed at
+  explicit DataBlockHashIndexBuilder(double util_ratio);
+
+  // Record that user_key starts in restart interval restart_index. Only the
+  // first restart interval of a user key is to be added.
+  void Add(const Slice& user_key, uint32_t restart_index);
+
+  // Whether the keys added so far can be indexed; false once a key starts
+  // in a restart interval past kDataBlockHashMaxRestarts
+  bool Valid() const { return valid_; }
+
+  // The size the index would take if finished now
+  size_t EstimateSize() const;
+
+  // Append the index to buffer
+  // REQUIRES: Valid()
+  void Finish(std::string* buffer);
+
+  void Reset();
+
+ private:
+  const double util_ratio_;
+  bool valid_;
+  // (hash of the user key, restart index) of every user key
+  std::vector<std::pair<uint32_t, uint8_t>> hash_and_restart_;
+};
+
+// Looks up a data block hash index in place, in the block contents
+class DataBlockHashIndex {
+ public:
+  DataBlockHashIndex() : buckets_(nullptr), num_buckets_(0) {}
+
+  // data and size describe the block up to, and excluding, the packed
+  // footer. Returns false if the index is malformed; otherwise sets
+  // *index_offset to the offset in data of the index, which is where the
+  // restart array of the block ends.
+  bool Initialize(const char* data, uint32_t size, uint32_t* index_offset);
+
+  // The restart index user_key starts in, kDataBlockHashNoEntry if it is not
+  // in the block, or kDataBlockHashCollision if the index cannot tell.
+  uint8_t Lookup(const Slice& user_key) const;
+
+  bool Valid() const { return buckets_ != nullptr; }
+
+ private:
+  const char* buckets_;
+  uint32_t num_buckets_;
+};
+
+}  // namespace rocksdb
@@ -26,6 +26,7 @@
 #include "rocksdb/options.h"
 #include "rocksdb/slice.h"
 #include "rocksdb/slice_transform.h"
+#include "rocksdb/status.h"
 #include "rocksdb/table.h"
 #include "util/hash.h"
 #include "format.h"
@@ -42,7 +43,11 @@ class FilterPolicy;
 // The sequence of calls to FilterBlockBuilder must match the regexp:
 //      (StartBlock Add*)* Finish
 //
-// BlockBased/Full FilterBlock would be called in the same way.
+// BlockBased/Full FilterBlock would be called in the same way. A partitioned
+// filter is written one partition at a time: Finish(handle, status) returns
+// each partition with Status::Incomplete() in *status, is called again with the
+// handle the partition was written at, and returns the top-level index on the
+// partitions, with Status::OK(), last.
 class FilterBlockBuilder {
  public:
   explicit FilterBlockBuilder() {}
@@ -52,6 +57,11 @@ class FilterBlockBuilder {
   virtual void StartBlock(uint64_t block_offset) = 0;  // Start new block filter
   virtual void Add(const Slice& key) = 0;      // Add a key to current filter
   virtual Slice Finish() = 0;                     // Generate Filter
+  virtual Slice Finish(const BlockHandle& last_partition_block_handle,
+                       Status* status) {
+    *status = Status::OK();
+    return Finish();
+  }
 
  private:
   // No copying allowed
@@ -73,6 +83,14 @@ class FilterBlockReader {
                            uint64_t block_offset = kNotValid) = 0;
   virtual bool PrefixMayMatch(const Slice& prefix,
                               uint64_t block_offset = kNotValid) = 0;
+  // KeyMayMatch() of keys[0, num_keys-1], without a block offset, into
+  // may_match[0, num_keys-1]
+  virtual void KeysMayMatch(size_t num_keys, const Slice* keys,
+                            bool* may_match) {
+    for (size_t i = 0; i < num_keys; ++i) {
+      may_match[i] = KeyMayMatch(keys[i]);
+    }
+  }
   virtual size_t ApproximateMemoryUsage() const = 0;
 
   // convert this object to a human readable form
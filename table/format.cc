@@ -11,6 +11,7 @@
 
 #include <string>
 #include <inttypes.h>
+#include <vector>
 
 #include "rocksdb/env.h"
 #include "table/block.h"
@@ -247,32 +248,17 @@ Status ReadFooterFromFile(RandomAccessFileReader* file, uint64_t file_size,
 // Without anonymous namespace here, we fail the warning -Wmissing-prototypes
 namespace {
 
-// Read a block and check its CRC
-// contents is the result of reading.
-// According to the implementation of file->Read, contents may not point to buf
-Status ReadBlock(RandomAccessFileReader* file, const Footer& footer,
-                 const ReadOptions& options, const BlockHandle& handle,
-                 Slice* contents, /* result of reading */ char* buf) {
-  size_t n = static_cast<size_t>(handle.size());
-  Status s;
-
-  {
-    PERF_TIMER_GUARD(block_read_time);
-    s = file->Read(handle.offset(), n + kBlockTrailerSize, contents, buf);
-  }
-
-  PERF_COUNTER_ADD(block_read_count, 1);
-  PERF_COUNTER_ADD(block_read_byte, n + kBlockTrailerSize);
-
-  if (!s.ok()) {
-    return s;
-  }
-  if (contents->size() != n + kBlockTrailerSize) {
+// Check that "contents", read for a block of "n" bytes, is complete and,
+// if asked to, that its CRC matches
+Status CheckBlock(const Footer& footer, const ReadOptions& options, size_t n,
+                  const Slice& contents) {
+  if (contents.size() != n + kBlockTrailerSize) {
     return Status::Corruption("truncated block read");
   }
 
   // Check the crc of the type and the block contents
-  const char* data = contents->data();  // Pointer to where Read put the data
+  Status s;
+  const char* data = contents.data();  // Pointer to where Read put the data
   if (options.verify_checksums) {
     PERF_TIMER_GUARD(block_checksum_time);
     uint32_t value = DecodeFixed32(data + n + 1);
@@ -291,19 +277,87 @@ Status ReadBlock(RandomAccessFileReader* file, const Footer& footer,
     if (s.ok() && actual != value) {
       s = Status::Corruption("block checksum mismatch");
     }
-    if (!s.ok()) {
-      return s;
-    }
   }
   return s;
 }
 
+// Read a block and check its CRC
+// contents is the result of reading.
+// According to the implementation of file->Read, contents may not point to buf
+Status ReadBlock(RandomAccessFileReader* file, const Footer& footer,
+                 const ReadOptions& options, const BlockHandle& handle,
+                 Slice* contents, /* result of reading */ char* buf) {
+  size_t n = static_cast<size_t>(handle.size());
+  Status s;
+
+  {
+    PERF_TIMER_GUARD(block_read_time);
+    s = file->Read(handle.offset(), n + kBlockTrailerSize, contents, buf);
+  }
+
+  PERF_COUNTER_ADD(block_read_count, 1);
+  PERF_COUNTER_ADD(block_read_byte, n + kBlockTrailerSize);
+
+  if (!s.ok()) {
+    return s;
+  }
+  return CheckBlock(footer, options, n, *contents);
+}
+
+// Read a block of a file that supports pinned reads, pointing at the memory
+// of the file instead of copying the block, unless it has to be uncompressed.
+// The block holds the memory of the whole file, so a cached block keeps the
+// disk space of a deleted file until it is evicted (see allow_mmap_reads).
+Status ReadPinnedBlockContents(RandomAccessFileReader* file,
+                               const Footer& footer,
+                               const ReadOptions& options,
+                               const BlockHandle& handle,
+                               BlockContents* contents,
+                               bool decompression_requested) {
+  size_t n = static_cast<size_t>(handle.size());
+  Slice slice;
+  std::shared_ptr<const char> pinned;
+  Status s;
+
+  {
+    PERF_TIMER_GUARD(block_read_time);
+    s = file->ReadPinned(handle.offset(), n + kBlockTrailerSize, &slice,
+                         &pinned);
+  }
+
+  PERF_COUNTER_ADD(block_read_count, 1);
+  PERF_COUNTER_ADD(block_read_byte, n + kBlockTrailerSize);
+
+  if (s.ok()) {
+    s = CheckBlock(footer, options, n, slice);
+  }
+  if (!s.ok()) {
+    return s;
+  }
+
+  PERF_TIMER_GUARD(block_decompress_time);
+
+  rocksdb::CompressionType compression_type =
+      static_cast<rocksdb::CompressionType>(slice.data()[n]);
+  if (decompression_requested && compression_type != kNoCompression) {
+    return UncompressBlockContents(slice.data(), n, contents, footer.version());
+  }
+  *contents = BlockContents(Slice(slice.data(), n), std::move(pinned),
+                            compression_type);
+  return s;
+}
+
 }  // namespace
 
 Status ReadBlockContents(RandomAccessFileReader* file, const Footer& footer,
                          const ReadOptions& options, const BlockHandle& handle,
                          BlockContents* contents, Env* env,
                          bool decompression_requested) {
+  if (file->SupportsPinnedReads()) {
+    return ReadPinnedBlockContents(file, footer, options, handle, contents,
+                                   decompression_requested);
+  }
+
   Status status;
   Slice slice;
   size_t n = static_cast<size_t>(handle.size());
@@ -350,6 +404,137 @@ Status ReadBlockContents(RandomAccessFileReader* file, const Footer& footer,
   return status;
 }
 
+void MultiReadBlockContents(RandomAccessFileReader* file, const Footer& footer,
+                            const ReadOptions& options,
+                            const BlockHandle* handles, size_t num_blocks,
+                            BlockContents* contents, Status* statuses,
+                            bool decompression_requested) {
+  if (file->SupportsPinnedReads()) {
+    // Nothing to wait for, so nothing to batch
+    for (size_t i = 0; i < num_blocks; ++i) {
+      statuses[i] = ReadPinnedBlockContents(file, footer, options, handles[i],
+                                            &contents[i],
+                                            decompression_requested);
+    }
+    return;
+  }
+
+  std::vector<std::unique_ptr<char[]>> bufs(num_blocks);
+  std::vector<ReadRequest> reqs(num_blocks);
+  for (size_t i = 0; i < num_blocks; ++i) {
+    size_t n = static_cast<size_t>(handles[i].size());
+    bufs[i].reset(new char[n + kBlockTrailerSize]);
+    reqs[i].offset = handles[i].offset();
+    reqs[i].len = n + kBlockTrailerSize;
+    reqs[i].scratch = bufs[i].get();
+    PERF_COUNTER_ADD(block_read_byte, n + kBlockTrailerSize);
+  }
+
+  Status s;
+  {
+    PERF_TIMER_GUARD(block_read_time);
+    s = file->MultiRead(reqs.data(), num_blocks);
+  }
+  PERF_COUNTER_ADD(block_read_count, num_blocks);
+
+  for (size_t i = 0; i < num_blocks; ++i) {
+    size_t n = static_cast<size_t>(handles[i].size());
+    const Slice& slice = reqs[i].result;
+    statuses[i] = s.ok() ? reqs[i].status : s;
+    if (statuses[i].ok()) {
+      statuses[i] = CheckBlock(footer, options, n, slice);
+    }
+    if (!statuses[i].ok()) {
+      continue;
+    }
+
+    PERF_TIMER_GUARD(block_decompress_time);
+
+    rocksdb::CompressionType compression_type =
+        static_cast<rocksdb::CompressionType>(slice.data()[n]);
+    if (decompression_requested && compression_type != kNoCompression) {
+      statuses[i] = UncompressBlockContents(slice.data(), n, &contents[i],
+                                            footer.version());
+    } else if (slice.data() != bufs[i].get()) {
+      contents[i] =
+          BlockContents(Slice(slice.data(), n), false, compression_type);
+    } else {
+      contents[i] =
+          BlockContents(std::move(bufs[i]), n, true, compression_type);
+    }
+  }
+}
+
+namespace {
+bool GoodCompressionRatio(size_t compressed_size, size_t raw_size) {
+  // Check to see if compressed less than 12.5%
+  return compressed_size < raw_size - (raw_size / 8u);
+}
+}  // namespace
+
+Slice CompressBlock(const Slice& raw,
+                    const CompressionOptions& compression_options,
+                    CompressionType* type, uint32_t format_version,
+                    std::string* compressed_output) {
+  if (*type == kNoCompression) {
+    return raw;
+  }
+
+  // Will return compressed block contents if (1) the compression method is
+  // supported in this platform and (2) the compression rate is "good enough".
+  switch (*type) {
+    case kSnappyCompression:
+      if (Snappy_Compress(compression_options, raw.data(), raw.size(),
+                          compressed_output) &&
+          GoodCompressionRatio(compressed_output->size(), raw.size())) {
+        return *compressed_output;
+      }
+      break;  // fall back to no compression.
+    case kZlibCompression:
+      if (Zlib_Compress(
+              compression_options,
+              GetCompressFormatForVersion(kZlibCompression, format_version),
+              raw.data(), raw.size(), compressed_output) &&
+          GoodCompressionRatio(compressed_output->size(), raw.size())) {
+        return *compressed_output;
+      }
+      break;  // fall back to no compression.
+    case kBZip2Compression:
+      if (BZip2_Compress(
+              compression_options,
+              GetCompressFormatForVersion(kBZip2Compression, format_version),
+              raw.data(), raw.size(), compressed_output) &&
+          GoodCompressionRatio(compressed_output->size(), raw.size())) {
+        return *compressed_output;
+      }
+      break;  // fall back to no compression.
+    case kLZ4Compression:
+      if (LZ4_Compress(
+              compression_options,
+              GetCompressFormatForVersion(kLZ4Compression, format_version),
+              raw.data(), raw.size(), compressed_output) &&
+          GoodCompressionRatio(compressed_output->size(), raw.size())) {
+        return *compressed_output;
+      }
+      break;  // fall back to no compression.
+    case kLZ4HCCompression:
+      if (LZ4HC_Compress(
+              compression_options,
+              GetCompressFormatForVersion(kLZ4HCCompression, format_version),
+              raw.data(), raw.size(), compressed_output) &&
+          GoodCompressionRatio(compressed_output->size(), raw.size())) {
+        return *compressed_output;
+      }
+      break;     // fall back to no compression.
+    default: {}  // Do not recognize this compression type
+  }
+
+  // Compression method is not supported, or not good compression ratio, so just
+  // fall back to uncompressed form.
+  *type = kNoCompression;
+  return raw;
+}
+
 //
 // The 'data' points to the raw block contents that was read in from file.
 // This method allocates a new heap buffer and the raw block
@@ -178,6 +178,9 @@ struct BlockContents {
   bool cachable;        // True iff data can be cached
   CompressionType compression_type;
   std::unique_ptr<char[]> allocation;
+  // Keeps data alive when it points into memory of the file rather than into
+  // allocation, see RandomAccessFile::ReadPinned()
+  std::shared_ptr<const char> pinned;
 
   BlockContents() : cachable(false), compression_type(kNoCompression) {}
 
@@ -192,6 +195,13 @@ struct BlockContents {
         compression_type(_compression_type),
         allocation(std::move(_data)) {}
 
+  BlockContents(const Slice& _data, std::shared_ptr<const char>&& _pinned,
+                CompressionType _compression_type)
+      : data(_data),
+        cachable(true),
+        compression_type(_compression_type),
+        pinned(std::move(_pinned)) {}
+
   BlockContents(BlockContents&& other) { *this = std::move(other); }
 
   BlockContents& operator=(BlockContents&& other) {
@@ -199,6 +209,7 @@ struct BlockContents {
     cachable = other.cachable;
     compression_type = other.compression_type;
     allocation = std::move(other.allocation);
+    pinned = std::move(other.pinned);
     return *this;
   }
 };
@@ -212,6 +223,26 @@ extern Status ReadBlockContents(RandomAccessFileReader* file,
                                 BlockContents* contents, Env* env,
                                 bool do_uncompress);
 
+// Read the blocks identified by "handles[0..num_blocks-1]" from "file" with
+// one RandomAccessFile::MultiRead(), so that they are read concurrently where
+// the file supports it.  Sets contents[i] and statuses[i] as
+// ReadBlockContents() sets *contents and its return value for handles[i].
+extern void MultiReadBlockContents(RandomAccessFileReader* file,
+                                   const Footer& footer,
+                                   const ReadOptions& options,
+                                   const BlockHandle* handles,
+                                   size_t num_blocks, BlockContents* contents,
+                                   Status* statuses, bool do_uncompress);
+
+// Compresses "raw" with *type, or leaves it alone if that compression is
+// not supported here or saves less than 1/8 of the size, setting *type to
+// kNoCompression then. Returns either "raw" or *compressed_output.
+// format_version is the block format as defined in include/rocksdb/table.h
+extern Slice CompressBlock(const Slice& raw,
+                           const CompressionOptions& compression_options,
+                           CompressionType* type, uint32_t format_version,
+                           std::string* compressed_output);
+
 // The 'data' points to the raw block contents read in from file.
 // This method allocates a new heap buffer and the raw block
 // contents are uncompresed into this buffer. This buffer is
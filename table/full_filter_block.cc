@@ -14,9 +14,9 @@ namespace rocksdb {
 FullFilterBlockBuilder::FullFilterBlockBuilder(
     const SliceTransform* prefix_extractor, bool whole_key_filtering,
     FilterBitsBuilder* filter_bits_builder)
-    : prefix_extractor_(prefix_extractor),
-      whole_key_filtering_(whole_key_filtering),
-      num_added_(0) {
+    : num_added_(0),
+      prefix_extractor_(prefix_extractor),
+      whole_key_filtering_(whole_key_filtering) {
   assert(filter_bits_builder != nullptr);
   filter_bits_builder_.reset(filter_bits_builder);
 }
@@ -94,6 +94,18 @@ bool FullFilterBlockReader::MayMatch(const Slice& entry) {
   return true;  // remain the same with block_based filter
 }
 
+void FullFilterBlockReader::KeysMayMatch(size_t num_keys, const Slice* keys,
+                                         bool* may_match) {
+  if (!whole_key_filtering_ || contents_.size() == 0) {
+    for (size_t i = 0; i < num_keys; ++i) {
+      may_match[i] = true;
+    }
+    return;
+  }
+  filter_bits_reader_->KeysMayMatch(static_cast<int>(num_keys), keys,
+                                    may_match);
+}
+
 size_t FullFilterBlockReader::ApproximateMemoryUsage() const {
   return contents_.size();
 }
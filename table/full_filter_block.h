@@ -46,6 +46,11 @@ class FullFilterBlockBuilder : public FilterBlockBuilder {
   virtual void StartBlock(uint64_t block_offset) override {}
   virtual void Add(const Slice& key) override;
   virtual Slice Finish() override;
+  using FilterBlockBuilder::Finish;
+
+ protected:
+  uint32_t num_added_;
+  std::unique_ptr<FilterBitsBuilder> filter_bits_builder_;
 
  private:
   // important: all of these might point to invalid addresses
@@ -54,8 +59,6 @@ class FullFilterBlockBuilder : public FilterBlockBuilder {
   const SliceTransform* prefix_extractor_;
   bool whole_key_filtering_;
 
-  uint32_t num_added_;
-  std::unique_ptr<FilterBitsBuilder> filter_bits_builder_;
   std::unique_ptr<const char[]> filter_data_;
 
   void AddKey(const Slice& key);
@@ -90,6 +93,8 @@ class FullFilterBlockReader : public FilterBlockReader {
                            uint64_t block_offset = kNotValid) override;
   virtual bool PrefixMayMatch(const Slice& prefix,
                               uint64_t block_offset = kNotValid) override;
+  virtual void KeysMayMatch(size_t num_keys, const Slice* keys,
+                            bool* may_match) override;
   virtual size_t ApproximateMemoryUsage() const override;
 
  private:
@@ -0,0 +1,81 @@
+//  Copyright (c) 2013, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#include "table/partitioned_filter_block.h"
+
+#include "rocksdb/filter_policy.h"
+#include "port/port.h"
+
+namespace rocksdb {
+
+PartitionedFilterBlockBuilder::PartitionedFilterBlockBuilder(
+    const SliceTransform* prefix_extractor, bool whole_key_filtering,
+    FilterBitsBuilder* filter_bits_builder, uint32_t keys_per_partition)
+    : FullFilterBlockBuilder(prefix_extractor, whole_key_filtering,
+                             filter_bits_builder),
+      keys_per_partition_(keys_per_partition),
+      index_on_filter_block_builder_(1 /* block_restart_interval == 1 */) {}
+
+void PartitionedFilterBlockBuilder::CutPartition(const Slice& partition_key) {
+  assert(!finishing_);
+  // Every index partition gets a filter partition, even an empty one, so that
+  // a key is always checked against the filter of its own index partition
+  partitions_.emplace_back();
+  FilterPartition& partition = partitions_.back();
+  partition.key = partition_key.ToString();
+  partition.filter = filter_bits_builder_->Finish(&partition.filter_data);
+  num_added_ = 0;
+}
+
+Slice PartitionedFilterBlockBuilder::Finish(
+    const BlockHandle& last_partition_block_handle, Status* status) {
+  if (finishing_) {
+    // The partition handed out last has been written at
+    // last_partition_block_handle
+    assert(!partitions_.empty());
+    std::string handle_encoding;
+    last_partition_block_handle.EncodeTo(&handle_encoding);
+    index_on_filter_block_builder_.Add(partitions_.front().key,
+                                       handle_encoding);
+    partitions_.pop_front();
+  } else {
+    finishing_ = true;
+  }
+
+  if (partitions_.empty()) {
+    *status = Status::OK();
+    return index_on_filter_block_builder_.Finish();
+  }
+  *status = Status::Incomplete(Slice());
+  return partitions_.front().filter;
+}
+
+PartitionedFilterBlockReader::PartitionedFilterBlockReader(
+    const InternalKeyComparator* comparator, BlockContents&& contents)
+    : comparator_(comparator),
+      index_on_filter_block_(new Block(std::move(contents))) {}
+
+Status PartitionedFilterBlockReader::GetPartitionHandle(
+    const Slice& internal_key, BlockHandle* handle,
+    std::string* partition_key) const {
+  BlockIter iter;
+  index_on_filter_block_->NewIterator(comparator_, &iter, true);
+  iter.Seek(internal_key);
+  if (!iter.Valid()) {
+    return iter.status().ok() ? Status::NotFound() : iter.status();
+  }
+  Slice handle_value = iter.value();
+  Status s = handle->DecodeFrom(&handle_value);
+  if (s.ok() && partition_key != nullptr) {
+    partition_key->assign(iter.key().data(), iter.key().size());
+  }
+  return s;
+}
+
+size_t PartitionedFilterBlockReader::ApproximateMemoryUsage() const {
+  return index_on_filter_block_->size();
+}
+
+}  // namespace rocksdb
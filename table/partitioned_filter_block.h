@@ -0,0 +1,115 @@
+//  Copyright (c) 2013, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#pragma once
+
+#include <list>
+#include <memory>
+#include <string>
+#include "db/dbformat.h"
+#include "rocksdb/slice.h"
+#include "rocksdb/slice_transform.h"
+#include "table/block.h"
+#include "table/block_builder.h"
+#include "table/full_filter_block.h"
+
+namespace rocksdb {
+
+// A PartitionedFilterBlockBuilder splits the full filter of a table into
+// partitions that follow the partitions of its index
+// (BlockBasedTableOptions::kTwoLevelIndexSearch), so that a lookup only reads
+// the filter partition of the index partition it searches. The index builder
+// cuts the filter with CutPartition() whenever it cuts an index partition.
+// The format of a partitioned filter is:
+// +----------------------------------------------------------------+
+// |              full filter for the keys of partition 1           |
+// +----------------------------------------------------------------+
+// | ...                                                            |
+// +----------------------------------------------------------------+
+// |              full filter for the keys of partition n           |
+// +----------------------------------------------------------------+
+// |              index on the filter partitions                    |
+// +----------------------------------------------------------------+
+// The index on the filter partitions is a block that maps the key of each
+// index partition, which is >= every key of the partition, to the handle of
+// its filter partition.
+class PartitionedFilterBlockBuilder : public FullFilterBlockBuilder {
+ public:
+  // keys_per_partition: the number of keys after which the filter asks for
+  // the partition to be cut, 0 to leave it to the index alone
+  explicit PartitionedFilterBlockBuilder(
+      const SliceTransform* prefix_extractor, bool whole_key_filtering,
+      FilterBitsBuilder* filter_bits_builder, uint32_t keys_per_partition);
+
+  virtual ~PartitionedFilterBlockBuilder() {}
+
+  // Whether the current partition holds enough keys to be cut
+  bool PartitionFull() const {
+    return keys_per_partition_ != 0 && num_added_ >= keys_per_partition_;
+  }
+
+  // Close the current partition, whose keys are all <= partition_key, an
+  // internal key. The last partition is closed the same way before Finish().
+  void CutPartition(const Slice& partition_key);
+
+  using FullFilterBlockBuilder::Finish;
+  virtual Slice Finish(const BlockHandle& last_partition_block_handle,
+                       Status* status) override;
+
+ private:
+  struct FilterPartition {
+    std::string key;
+    Slice filter;
+    std::unique_ptr<const char[]> filter_data;
+  };
+
+  const uint32_t keys_per_partition_;
+  // The partitions not yet written; Finish() hands them out in order
+  std::list<FilterPartition> partitions_;
+  BlockBuilder index_on_filter_block_builder_;
+  bool finishing_ = false;
+
+  // No copying allowed
+  PartitionedFilterBlockBuilder(const PartitionedFilterBlockBuilder&);
+  void operator=(const PartitionedFilterBlockBuilder&);
+};
+
+// A PartitionedFilterBlockReader holds the index on the filter partitions. The
+// partitions themselves are full filters that BlockBasedTable reads, and
+// caches, on demand, so KeyMayMatch() and PrefixMayMatch() answer true here.
+class PartitionedFilterBlockReader : public FilterBlockReader {
+ public:
+  // REQUIRES: comparator must outlive *this.
+  explicit PartitionedFilterBlockReader(const InternalKeyComparator* comparator,
+                                        BlockContents&& contents);
+  ~PartitionedFilterBlockReader() {}
+
+  virtual bool IsBlockBased() override { return false; }
+  virtual bool KeyMayMatch(const Slice& key,
+                           uint64_t block_offset = kNotValid) override {
+    return true;
+  }
+  virtual bool PrefixMayMatch(const Slice& prefix,
+                              uint64_t block_offset = kNotValid) override {
+    return true;
+  }
+  virtual size_t ApproximateMemoryUsage() const override;
+
+  // Find the filter partition that covers internal_key. Returns NotFound if
+  // internal_key is past the last partition, so in no partition at all.
+  // partition_key, if not null, is set to the key of the partition.
+  Status GetPartitionHandle(const Slice& internal_key, BlockHandle* handle,
+                            std::string* partition_key = nullptr) const;
+
+ private:
+  const InternalKeyComparator* comparator_;
+  std::unique_ptr<Block> index_on_filter_block_;
+
+  // No copying allowed
+  PartitionedFilterBlockReader(const PartitionedFilterBlockReader&);
+  void operator=(const PartitionedFilterBlockReader&);
+};
+
+}  // namespace rocksdb
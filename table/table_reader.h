@@ -68,6 +68,18 @@ class TableReader {
   virtual Status Get(const ReadOptions& readOptions, const Slice& key,
                      GetContext* get_context) = 0;
 
+  // Does what Get() does for each of the num_keys keys[i], with
+  // get_contexts[i], and stores its result in statuses[i]. keys are
+  // internal keys in ascending order, so that an implementation can share
+  // filter, index and data block reads between them.
+  virtual void MultiGet(const ReadOptions& readOptions, size_t num_keys,
+                        const Slice* keys, GetContext* const* get_contexts,
+                        Status* statuses) {
+    for (size_t i = 0; i < num_keys; ++i) {
+      statuses[i] = Get(readOptions, keys[i], get_contexts[i]);
+    }
+  }
+
   // Prefetch data corresponding to a give range of keys
   // Typically this functionality is required for table implementations that
   // persists the data on a non volatile storage medium like disk/SSD
@@ -1718,6 +1718,91 @@ TEST_F(BlockBasedTableTest, FilterBlockInBlockCache) {
   props.AssertFilterBlockStat(0, 0);
 }
 
+TEST_F(BlockBasedTableTest, PartitionedIndexAndFilter) {
+  for (bool cache_index_and_filter_blocks : {false, true}) {
+    Options options;
+    options.statistics = CreateDBStatistics();
+    BlockBasedTableOptions table_options;
+    table_options.block_size = 64;
+    table_options.index_type = BlockBasedTableOptions::kTwoLevelIndexSearch;
+    table_options.partition_filters = true;
+    table_options.metadata_block_size = 128;
+    table_options.filter_policy.reset(NewBloomFilterPolicy(10, false));
+    table_options.block_cache = NewLRUCache(1024 * 1024);
+    table_options.cache_index_and_filter_blocks = cache_index_and_filter_blocks;
+    options.table_factory.reset(new BlockBasedTableFactory(table_options));
+
+    TableConstructor c(BytewiseComparator(), true /* convert_to_internal_key */);
+    char buf[16];
+    for (int i = 0; i < 1000; i++) {
+      snprintf(buf, sizeof(buf), "k%04d", i * 2);
+      c.Add(buf, std::string(buf) + "_value");
+    }
+    std::vector<std::string> keys;
+    KVMap kvmap;
+    const ImmutableCFOptions ioptions(options);
+    InternalKeyComparator ikc(options.comparator);
+    c.Finish(options, ioptions, table_options, ikc, &keys, &kvmap);
+    auto* reader = dynamic_cast<BlockBasedTable*>(c.GetTableReader());
+    ASSERT_GT(reader->GetTableProperties()->num_data_blocks, 100U);
+
+    // Iteration walks every index partition in order
+    std::unique_ptr<Iterator> iter(c.NewIterator());
+    auto kv = kvmap.begin();
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), kv++) {
+      ASSERT_TRUE(kv != kvmap.end());
+      ASSERT_EQ(kv->first, iter->key().ToString());
+      ASSERT_EQ(kv->second, iter->value().ToString());
+    }
+    ASSERT_TRUE(kv == kvmap.end());
+    for (iter->SeekToLast(), kv = kvmap.end(); iter->Valid(); iter->Prev()) {
+      --kv;
+      ASSERT_EQ(kv->first, iter->key().ToString());
+    }
+    ASSERT_TRUE(kv == kvmap.begin());
+    for (int i = 0; i < 2000; i += 7) {
+      snprintf(buf, sizeof(buf), "k%04d", i);
+      iter->Seek(buf);
+      kv = kvmap.lower_bound(buf);
+      if (kv == kvmap.end()) {
+        ASSERT_TRUE(!iter->Valid());
+      } else {
+        ASSERT_TRUE(iter->Valid());
+        ASSERT_EQ(kv->first, iter->key().ToString());
+      }
+    }
+    iter.reset();
+
+    // Point lookups find every key through its filter partition
+    for (int i = 0; i < 2000; i++) {
+      snprintf(buf, sizeof(buf), "k%04d", i);
+      std::string value;
+      GetContext get_context(options.comparator, nullptr, nullptr, nullptr,
+                             GetContext::kNotFound, buf, &value, nullptr,
+                             nullptr, nullptr);
+      InternalKey ikey(buf, kMaxSequenceNumber, kTypeValue);
+      ASSERT_OK(reader->Get(ReadOptions(), ikey.Encode(), &get_context));
+      if (i % 2 == 0) {
+        ASSERT_EQ(GetContext::kFound, get_context.State());
+        ASSERT_EQ(std::string(buf) + "_value", value);
+      } else {
+        ASSERT_EQ(GetContext::kNotFound, get_context.State());
+      }
+    }
+    // Most missing keys are ruled out by the filter partitions
+    ASSERT_GT(options.statistics->getTickerCount(BLOOM_FILTER_USEFUL), 800U);
+
+    // A key past the last partition is ruled out without any partition
+    std::string value;
+    GetContext get_context(options.comparator, nullptr, nullptr, nullptr,
+                           GetContext::kNotFound, "z", &value, nullptr,
+                           nullptr, nullptr);
+    InternalKey ikey("z", kMaxSequenceNumber, kTypeValue);
+    ASSERT_OK(reader->Get(ReadOptions(), ikey.Encode(), &get_context));
+    ASSERT_EQ(GetContext::kNotFound, get_context.State());
+  }
+}
+
 TEST_F(BlockBasedTableTest, BlockCacheLeak) {
   // Check that when we reopen a table we don't lose access to blocks already
   // in the cache. This test checks whether the Table actually makes use of the
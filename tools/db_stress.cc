@@ -949,6 +949,7 @@ class StressTest {
         {"memtable_prefix_bloom_probes", {"4", "5", "6"}},
         {"memtable_prefix_bloom_huge_page_tlb_size",
          {"0", ToString(2 * 1024 * 1024)}},
+        {"memtable_whole_key_filtering", {"0", "1"}},
         {"max_successive_merges", {"0", "2", "4"}},
         {"filter_deletes", {"0", "1"}},
         {"inplace_update_num_locks", {"100", "200", "300"}},
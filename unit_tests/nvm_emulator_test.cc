@@ -0,0 +1,339 @@
+#ifdef ROCKSDB_PLATFORM_NVM
+
+#include "nvm/nvm.h"
+
+using namespace rocksdb;
+
+void TestEraseBeforeWrite(nvm_emulator_options &options)
+{
+    nvm_emulated_device *dev;
+
+    ALLOC_CLASS(dev, nvm_emulated_device(options));
+
+    if(dev->Open())
+    {
+	NVM_FATAL("");
+    }
+
+    char data[4096];
+
+    memset(data, 'a', options.page_size);
+
+    if(dev->Pwrite(data, options.page_size, 0) != (ssize_t)options.page_size)
+    {
+	NVM_FATAL("first program failed");
+    }
+
+    if(dev->Pwrite(data, options.page_size, 0) >= 0 || errno != EIO)
+    {
+	NVM_FATAL("page was programmed twice");
+    }
+
+    if(dev->Pwrite(data, options.page_size, 1) >= 0)
+    {
+	NVM_FATAL("unaligned program was accepted");
+    }
+
+    struct nba_block blk;
+
+    blk.lun = 0;
+    blk.id = 0;
+
+    if(dev->Ioctl(NVMBLOCKERASE, &blk))
+    {
+	NVM_FATAL("erase failed");
+    }
+
+    if(dev->Pread(data, options.page_size, 0) != (ssize_t)options.page_size || data[0] != (char)0xff)
+    {
+	NVM_FATAL("erase did not clear the block");
+    }
+
+    if(dev->Pwrite(data, options.page_size, 0) != (ssize_t)options.page_size)
+    {
+	NVM_FATAL("program after erase failed");
+    }
+
+    delete dev;
+}
+
+#define TEST_IMAGE "nvm_emulator_test.img"
+
+//the programmed state of the pages survives a reopen of the image
+void TestReopen(nvm_emulator_options options)
+{
+    options.path = TEST_IMAGE;
+
+    unlink(TEST_IMAGE);
+    unlink(TEST_IMAGE NVM_EMULATOR_PROGRAMMED_SUFFIX);
+
+    char data[4096];
+
+    memset(data, 'a', options.page_size);
+
+    for(int i = 0; i < 2; ++i)
+    {
+	nvm_emulated_device *dev;
+
+	ALLOC_CLASS(dev, nvm_emulated_device(options));
+
+	if(dev->Open())
+	{
+	    NVM_FATAL("");
+	}
+
+	ssize_t ret = dev->Pwrite(data, options.page_size, 0);
+
+	if(i == 0 && ret != (ssize_t)options.page_size)
+	{
+	    NVM_FATAL("first program failed");
+	}
+
+	if(i == 1 && (ret >= 0 || errno != EIO))
+	{
+	    NVM_FATAL("page was programmed twice across a reopen");
+	}
+
+	delete dev;
+    }
+
+    unlink(TEST_IMAGE);
+    unlink(TEST_IMAGE NVM_EMULATOR_PROGRAMMED_SUFFIX);
+}
+
+void TestFileOnEmulator(nvm_emulator_options &options)
+{
+    nvm_emulated_device *dev;
+
+    ALLOC_CLASS(dev, nvm_emulated_device(options));
+
+    if(dev->Open())
+    {
+	NVM_FATAL("");
+    }
+
+    nvm_directory *dir;
+    nvm *nvm_api;
+
+    ALLOC_CLASS(nvm_api, nvm(dev));
+    ALLOC_CLASS(dir, nvm_directory("root", 4, nvm_api, nullptr));
+
+    if(nvm_api->nr_luns != options.nr_luns || nvm_api->luns[0].nr_blocks != options.nr_blocks)
+    {
+	NVM_FATAL("geometry mismatch");
+    }
+
+    nvm_file *fd = dir->nvm_fopen("test.c", "w");
+
+    if(fd == nullptr)
+    {
+	NVM_FATAL("");
+    }
+
+    NVMWritableFile *w_file;
+
+    ALLOC_CLASS(w_file, NVMWritableFile("test.c", fd, dir));
+
+    char data[1000];
+
+    for(int i = 0; i < 100; ++i)
+    {
+	memset(data, i, 1000);
+
+	if(!w_file->Append(Slice(data, 1000)).ok())
+	{
+	    NVM_FATAL("");
+	}
+    }
+
+    w_file->Close();
+
+    delete w_file;
+
+    if(fd->GetSize() != 100000)
+    {
+	NVM_FATAL("%lu", fd->GetSize());
+    }
+
+    NVMRandomAccessFile *ra_file;
+
+    ALLOC_CLASS(ra_file, NVMRandomAccessFile("test.c", fd, dir));
+
+    Slice s;
+
+    for(int i = 0; i < 100; ++i)
+    {
+	if(!ra_file->Read(i * 1000, 1000, &s, data).ok() || s.size() != 1000)
+	{
+	    NVM_FATAL("");
+	}
+
+	for(unsigned long j = 0; j < s.size(); ++j)
+	{
+	    if(s.data()[j] != i)
+	    {
+		NVM_FATAL("%d %lu", i, j);
+	    }
+	}
+    }
+
+    delete ra_file;
+
+    if(dir->DeleteFile("test.c"))
+    {
+	NVM_FATAL("");
+    }
+
+    delete dir;
+    delete nvm_api;
+}
+
+//reads that start and end inside pages and span a whole stripe
+void TestMultiPageRead(nvm_emulator_options &options)
+{
+    nvm_emulated_device *dev;
+
+    ALLOC_CLASS(dev, nvm_emulated_device(options));
+
+    if(dev->Open())
+    {
+	NVM_FATAL("");
+    }
+
+    nvm_directory *dir;
+    nvm *nvm_api;
+
+    ALLOC_CLASS(nvm_api, nvm(dev));
+    ALLOC_CLASS(dir, nvm_directory("root", 4, nvm_api, nullptr));
+
+    nvm_file *fd = dir->nvm_fopen("test.c", "w");
+
+    if(fd == nullptr)
+    {
+	NVM_FATAL("");
+    }
+
+    NVMWritableFile *w_file;
+
+    ALLOC_CLASS(w_file, NVMWritableFile("test.c", fd, dir));
+
+    unsigned long file_size = 40 * options.page_size + 123;
+
+    char *data;
+    SAFE_ALLOC(data, char[file_size]);
+
+    for(unsigned long i = 0; i < file_size; ++i)
+    {
+	data[i] = (char)(i % 251);
+    }
+
+    if(!w_file->Append(Slice(data, file_size)).ok())
+    {
+	NVM_FATAL("");
+    }
+
+    w_file->Close();
+
+    delete w_file;
+
+    NVMRandomAccessFile *ra_file;
+
+    ALLOC_CLASS(ra_file, NVMRandomAccessFile("test.c", fd, dir));
+
+    char *scratch;
+    SAFE_ALLOC(scratch, char[file_size]);
+
+    unsigned long offsets[] = {0, 1, options.page_size - 1, 3 * options.page_size + 17, file_size - 10};
+    unsigned long lens[] = {1, 100, options.page_size, 16 * options.page_size + 1, file_size};
+
+    for(unsigned long i = 0; i < sizeof(offsets) / sizeof(offsets[0]); ++i)
+    {
+	for(unsigned long j = 0; j < sizeof(lens) / sizeof(lens[0]); ++j)
+	{
+	    Slice s;
+
+	    if(!ra_file->Read(offsets[i], lens[j], &s, scratch).ok())
+	    {
+		NVM_FATAL("");
+	    }
+
+	    if(s.size() != std::min(lens[j], file_size - offsets[i]) || memcmp(s.data(), data + offsets[i], s.size()))
+	    {
+		NVM_FATAL("%lu %lu", offsets[i], lens[j]);
+	    }
+	}
+    }
+
+    delete ra_file;
+
+    NVMSequentialFile *seq_file;
+
+    ALLOC_CLASS(seq_file, NVMSequentialFile("test.c", fd, dir));
+
+    unsigned long read_so_far = 0;
+
+    while(read_so_far < file_size)
+    {
+	Slice s;
+
+	if(!seq_file->Read(5 * options.page_size + 7, &s, scratch).ok() || s.size() == 0)
+	{
+	    NVM_FATAL("");
+	}
+
+	if(memcmp(s.data(), data + read_so_far, s.size()))
+	{
+	    NVM_FATAL("%lu", read_so_far);
+	}
+
+	read_so_far += s.size();
+    }
+
+    delete seq_file;
+
+    delete[] scratch;
+    delete[] data;
+
+    if(dir->DeleteFile("test.c"))
+    {
+	NVM_FATAL("");
+    }
+
+    delete dir;
+    delete nvm_api;
+}
+
+int main(int argc, char **argv)
+{
+    nvm_emulator_options options;
+
+    if(options.Parse("luns=2,blocks=16,pages=32,page_size=4096,channels=1,erase_us=0") == false)
+    {
+	NVM_FATAL("");
+    }
+
+    if(options.Parse("blocks=16,bogus=1"))
+    {
+	NVM_FATAL("unknown option was accepted");
+    }
+
+    options.Parse("luns=2,blocks=16,pages=32,page_size=4096");
+
+    TestEraseBeforeWrite(options);
+    TestReopen(options);
+    TestFileOnEmulator(options);
+    TestMultiPageRead(options);
+
+    NVM_DEBUG("TEST FINISHED");
+
+    return 0;
+}
+
+#else
+
+int main(void)
+{
+    return 0;
+}
+
+#endif
@@ -669,6 +669,37 @@ void TestSubdirectories(nvm_directory *dir, nvm *nvm_api)
 	NVM_FATAL("");
     }
 
+    //a deleted and recreated directory must not be served from the path cache
+    dir->CreateDirectory("cache");
+    dir->OpenDirectory("cache")->CreateDirectory("sub");
+
+    if(dir->nvm_fopen("cache/sub/file", "w") == nullptr)
+    {
+	NVM_FATAL("");
+    }
+
+    if(dir->DeleteDirectory("cache/sub") != 0)
+    {
+	NVM_FATAL("");
+    }
+
+    if(dir->FileExists("cache/sub/file"))
+    {
+	NVM_FATAL("");
+    }
+
+    dir->OpenDirectory("cache")->CreateDirectory("sub");
+
+    if(dir->nvm_fopen("cache/sub/file", "w") == nullptr)
+    {
+	NVM_FATAL("");
+    }
+
+    if(dir->OpenDirectory("cache/sub")->FileExists("file") == false)
+    {
+	NVM_FATAL("");
+    }
+
     dir->CreateDirectory("test14");
 
     dir->Delete(nvm_api);
@@ -4,8 +4,112 @@
 
 using namespace rocksdb;
 
-void TestFtlSave(nvm *nvm_api, nvm_directory *dir)
+#define TEST_IMAGE "nvm_ftl_save_test.img"
+#define TEST_LAYOUT "root_nvm.layout"
+#define TEST_JOURNAL "root_nvm.journal"
+
+#define TEST_FILE_SIZE 50000
+
+nvm *OpenNVM()
+{
+    nvm_emulator_options options;
+
+    if(options.Parse("path=" TEST_IMAGE ",luns=4,blocks=32,pages=32") == false)
+    {
+	NVM_FATAL("");
+    }
+
+    nvm_emulated_device *dev;
+
+    ALLOC_CLASS(dev, nvm_emulated_device(options));
+
+    if(dev->Open())
+    {
+	NVM_FATAL("");
+    }
+
+    nvm *nvm_api;
+
+    ALLOC_CLASS(nvm_api, nvm(dev));
+
+    return nvm_api;
+}
+
+void WriteFile(nvm_directory *dir, const char *name, const char fill, const unsigned long len)
+{
+    nvm_file *fd = dir->nvm_fopen(name, "a");
+
+    if(fd == nullptr)
+    {
+	NVM_FATAL("");
+    }
+
+    NVMWritableFile *w_file;
+
+    ALLOC_CLASS(w_file, NVMWritableFile(name, fd, dir));
+
+    char data[1000];
+
+    memset(data, fill, 1000);
+
+    for(unsigned long written = 0; written < len; written += 1000)
+    {
+	if(!w_file->Append(Slice(data, std::min(len - written, 1000UL))).ok())
+	{
+	    NVM_FATAL("");
+	}
+    }
+
+    w_file->Close();
+
+    delete w_file;
+}
+
+void CheckFile(nvm_directory *dir, const char *name, const char fill, const unsigned long len)
 {
+    nvm_file *fd = dir->nvm_fopen(name, "r");
+
+    if(fd == nullptr || fd->GetSize() != len)
+    {
+	NVM_FATAL("%s", name);
+    }
+
+    NVMRandomAccessFile *ra_file;
+
+    ALLOC_CLASS(ra_file, NVMRandomAccessFile(name, fd, dir));
+
+    char *scratch;
+    SAFE_ALLOC(scratch, char[len]);
+
+    Slice s;
+
+    if(!ra_file->Read(0, len, &s, scratch).ok() || s.size() != len)
+    {
+	NVM_FATAL("%s", name);
+    }
+
+    for(unsigned long i = 0; i < len; ++i)
+    {
+	if(s.data()[i] != fill)
+	{
+	    NVM_FATAL("%s at %lu", name, i);
+	}
+    }
+
+    delete[] scratch;
+    delete ra_file;
+}
+
+void TestFtlSave()
+{
+    nvm *nvm_api = OpenNVM();
+
+    nvm_directory *dir;
+    nvm_checkpoint *checkpoint;
+
+    ALLOC_CLASS(dir, nvm_directory("root", 4, nvm_api, nullptr));
+    ALLOC_CLASS(checkpoint, nvm_checkpoint(TEST_LAYOUT, TEST_JOURNAL, nvm_api));
+
     dir->CreateDirectory("test");
     dir->CreateDirectory("test1");
     dir->CreateDirectory("test2");
@@ -16,74 +120,401 @@ void TestFtlSave(nvm *nvm_api, nvm_directory *dir)
     dir1->CreateDirectory("testxx");
     dir1->CreateDirectory("testxxx");
 
-    dir1->nvm_fopen("ftestx", "w");
-    dir1->nvm_fopen("ftestxx", "w");
+    dir1->nvm_fclose(dir1->nvm_fopen("ftestx", "w"), "w");
+    dir1->nvm_fclose(dir1->nvm_fopen("ftestxx", "w"), "w");
+
+    WriteFile(dir, "test/data", 'a', TEST_FILE_SIZE);
+
+    //first save is always a full checkpoint
+    if(!checkpoint->Save(dir).ok())
+    {
+	NVM_FATAL("");
+    }
+
+    struct stat st;
+
+    if(stat(TEST_JOURNAL, &st) || st.st_size != NVM_JOURNAL_HEADER_SIZE)
+    {
+	NVM_FATAL("journal was not reset");
+    }
+
+    //these only go in the journal
+    WriteFile(dir, "test/data", 'a', TEST_FILE_SIZE);
+    WriteFile(dir, "test2/data", 'b', TEST_FILE_SIZE);
+
+    if(dir->DeleteFile("test1/ftestx"))
+    {
+	NVM_FATAL("");
+    }
+
+    if(dir->OpenDirectory("test1")->LinkFile("ftestxx", "ftestxx_link"))
+    {
+	NVM_FATAL("");
+    }
+
+    if(!checkpoint->Save(dir).ok())
+    {
+	NVM_FATAL("");
+    }
+
+    if(stat(TEST_JOURNAL, &st) || st.st_size <= NVM_JOURNAL_HEADER_SIZE)
+    {
+	NVM_FATAL("changes were not journaled");
+    }
+
+    unsigned long saves;
+    unsigned long save_micros;
+
+    nvm_api->GetFtlSaveStats(&saves, &save_micros);
+
+    if(saves != 2)
+    {
+	NVM_FATAL("%lu saves counted", saves);
+    }
+
+    delete checkpoint;
+    delete dir;
+    delete nvm_api;
+}
+
+void TestFtlLoad()
+{
+    nvm *nvm_api = OpenNVM();
+
+    nvm_directory *dir;
+    nvm_checkpoint *checkpoint;
+
+    ALLOC_CLASS(dir, nvm_directory("root", 4, nvm_api, nullptr));
+    ALLOC_CLASS(checkpoint, nvm_checkpoint(TEST_LAYOUT, TEST_JOURNAL, nvm_api));
+
+    if(!checkpoint->Load(dir).ok())
+    {
+	NVM_FATAL("");
+    }
+
+    if(dir->OpenDirectory("test1/testxxx") == nullptr)
+    {
+	NVM_FATAL("directory was not restored");
+    }
+
+    if(dir->FileExists("test1/ftestx"))
+    {
+	NVM_FATAL("deleted file came back");
+    }
+
+    if(dir->FileExists("test1/ftestxx") == false || dir->FileExists("test1/ftestxx_link") == false)
+    {
+	NVM_FATAL("link was not restored");
+    }
+
+    CheckFile(dir, "test/data", 'a', 2 * TEST_FILE_SIZE);
+    CheckFile(dir, "test2/data", 'b', TEST_FILE_SIZE);
+
+    //new files must not reuse the ids of restored ones
+    nvm_file *fd = dir->nvm_fopen("test/new", "w");
+
+    if(fd->GetId() <= dir->nvm_fopen("test2/data", "r")->GetId())
+    {
+	NVM_FATAL("file id reused");
+    }
 
-    int fd = open("root_nvm.layout", O_RDWR | O_CREAT, S_IWUSR | S_IRUSR);
+    delete checkpoint;
+    delete dir;
+    delete nvm_api;
+}
+
+void TestTornJournal()
+{
+    int fd = open(TEST_JOURNAL, O_WRONLY | O_APPEND);
 
     if(fd < 0)
     {
 	NVM_FATAL("");
     }
 
-    if(!dir->Save(fd).ok())
+    char garbage[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+
+    if(write(fd, garbage, sizeof(garbage)) != sizeof(garbage))
     {
 	NVM_FATAL("");
     }
 
     close(fd);
+
+    TestFtlLoad();
 }
 
-void TestFtlLoad(nvm *nvm_api, nvm_directory *dir)
+//the layout before the binary checkpoint was a text dump of the tree
+void TestLegacyLayout()
 {
-    char temp;
+    unlink(TEST_IMAGE);
+    unlink(TEST_IMAGE NVM_EMULATOR_PROGRAMMED_SUFFIX);
+    unlink(TEST_LAYOUT);
+    unlink(TEST_JOURNAL);
+
+    nvm *nvm_api = OpenNVM();
+
+    nvm_directory *dir;
+
+    ALLOC_CLASS(dir, nvm_directory("root", 4, nvm_api, nullptr));
+
+    dir->CreateDirectory("test");
+    dir->CreateDirectory("test/empty");
+
+    WriteFile(dir, "test/data", 'c', TEST_FILE_SIZE);
+
+    nvm_file *fd = dir->nvm_fopen("test/data", "r");
 
-    int fd = open("root_nvm.layout", O_RDONLY);
+    char buf[100];
 
-    if(read(fd, &temp, 1) != 1)
+    snprintf(buf, sizeof(buf), "%lu:%lu:", fd->GetSize(), (unsigned long)fd->GetLastModified());
+
+    std::string layout = "d:root{d:test{d:empty{}f:data,alias:";
+
+    layout.append(buf);
+
+    for(unsigned long i = 0; fd->GetNVMPage(i) != nullptr; ++i)
+    {
+	nvm_page *page = fd->GetNVMPage(i);
+
+	snprintf(buf, sizeof(buf), "%s%lu-%lu-%lu", i > 0 ? "," : "", page->lun_id, page->block_id, page->id);
+
+	layout.append(buf);
+    }
+
+    layout.append("\n}}");
+
+    int layout_fd = open(TEST_LAYOUT, O_WRONLY | O_CREAT | O_TRUNC, S_IWUSR | S_IRUSR);
+
+    if(layout_fd < 0 || write(layout_fd, layout.data(), layout.size()) != (ssize_t)layout.size())
     {
 	NVM_FATAL("");
     }
 
-    if(temp != 'd')
+    close(layout_fd);
+
+    delete dir;
+    delete nvm_api;
+
+    //the second load reads the binary checkpoint written by the first
+    for(int i = 0; i < 2; ++i)
+    {
+	nvm_checkpoint *checkpoint;
+
+	nvm_api = OpenNVM();
+
+	ALLOC_CLASS(dir, nvm_directory("root", 4, nvm_api, nullptr));
+	ALLOC_CLASS(checkpoint, nvm_checkpoint(TEST_LAYOUT, TEST_JOURNAL, nvm_api));
+
+	if(!checkpoint->Load(dir).ok())
+	{
+	    NVM_FATAL("");
+	}
+
+	if(dir->OpenDirectory("test/empty") == nullptr)
+	{
+	    NVM_FATAL("directory was not restored");
+	}
+
+	if(dir->FileExists("test/alias") == false)
+	{
+	    NVM_FATAL("link was not restored");
+	}
+
+	CheckFile(dir, "test/data", 'c', TEST_FILE_SIZE);
+
+	delete checkpoint;
+	delete dir;
+	delete nvm_api;
+    }
+
+    char magic[8];
+
+    layout_fd = open(TEST_LAYOUT, O_RDONLY);
+
+    if(layout_fd < 0 || read(layout_fd, magic, 8) != 8 || DecodeFixed64(magic) != NVM_CHECKPOINT_MAGIC)
+    {
+	NVM_FATAL("text layout was not converted");
+    }
+
+    close(layout_fd);
+}
+
+#ifdef NVM_ALLOCATE_BLOCKS
+
+//erases the block RequestBlock() hands out next
+void CycleBlock(nvm *nvm_api)
+{
+    std::vector<struct nvm_page *> block_pages;
+
+    if(nvm_api->RequestBlock(&block_pages, NVM_POOL_HOT) == false)
     {
 	NVM_FATAL("");
     }
 
-    dir->Load(fd);
+    nvm_api->ReleasePages(&block_pages);
+}
 
-    close(fd);
+void SnapshotBlocks(nvm *nvm_api, std::vector<nvm_block_desc> *blocks)
+{
+    blocks->clear();
 
-    fd = open("root_nvm.layout2", O_RDWR | O_CREAT, S_IWUSR | S_IRUSR);
+    for(unsigned long i = 0; i < nvm_api->nr_luns; ++i)
+    {
+	for(unsigned long j = 0; j < nvm_api->luns[i].nr_blocks; ++j)
+	{
+	    nvm_block_desc desc;
 
-    if(fd < 0)
+	    nvm_api->GetBlockState(i, j, &desc.erase_count, &desc.pool);
+
+	    //the pool of a free block is not used
+	    if(nvm_api->luns[i].blocks[j].allocated == false)
+	    {
+		desc.pool = NVM_POOL_HOT;
+	    }
+
+	    blocks->push_back(desc);
+	}
+    }
+}
+
+//erase counts and pools come back from the checkpoint and the journal
+void TestBlockState()
+{
+    unlink(TEST_IMAGE);
+    unlink(TEST_IMAGE NVM_EMULATOR_PROGRAMMED_SUFFIX);
+    unlink(TEST_LAYOUT);
+    unlink(TEST_JOURNAL);
+
+    nvm *nvm_api = OpenNVM();
+
+    nvm_directory *dir;
+    nvm_checkpoint *checkpoint;
+
+    ALLOC_CLASS(dir, nvm_directory("root", 4, nvm_api, nullptr));
+    ALLOC_CLASS(checkpoint, nvm_checkpoint(TEST_LAYOUT, TEST_JOURNAL, nvm_api));
+
+    dir->CreateDirectory("test");
+
+    for(int i = 0; i < 10; ++i)
+    {
+	CycleBlock(nvm_api);
+    }
+
+    WriteFile(dir, "test/data", 'd', TEST_FILE_SIZE);
+
+    //a pool the file would not get from its name
+    nvm_page *page = dir->nvm_fopen("test/data", "r")->GetNVMPage(0);
+
+    nvm_api->luns[page->lun_id].blocks[page->block_id].pool = NVM_POOL_COLD;
+
+    if(!checkpoint->Save(dir).ok())
     {
 	NVM_FATAL("");
     }
 
-    if(!dir->Save(fd).ok())
+    //only in the journal
+    for(int i = 0; i < 10; ++i)
+    {
+	CycleBlock(nvm_api);
+    }
+
+    if(!checkpoint->Save(dir).ok())
     {
 	NVM_FATAL("");
     }
 
-    close(fd);
+    std::vector<nvm_block_desc> saved;
+
+    SnapshotBlocks(nvm_api, &saved);
+
+    //programmed but not saved: the blocks come back free and not erased
+    WriteFile(dir, "test/unsaved", 'e', TEST_FILE_SIZE);
+
+    delete checkpoint;
+    delete dir;
+    delete nvm_api;
+
+    nvm_api = OpenNVM();
+
+    ALLOC_CLASS(dir, nvm_directory("root", 4, nvm_api, nullptr));
+    ALLOC_CLASS(checkpoint, nvm_checkpoint(TEST_LAYOUT, TEST_JOURNAL, nvm_api));
+
+    if(!checkpoint->Load(dir).ok())
+    {
+	NVM_FATAL("");
+    }
+
+    CheckFile(dir, "test/data", 'd', TEST_FILE_SIZE);
+
+    std::vector<nvm_block_desc> loaded;
+
+    SnapshotBlocks(nvm_api, &loaded);
+
+    for(unsigned long i = 0; i < saved.size(); ++i)
+    {
+	if(loaded[i].erase_count != saved[i].erase_count || loaded[i].pool != saved[i].pool)
+	{
+	    NVM_FATAL("block %lu was not restored", i);
+	}
+    }
+
+    if(dir->FileExists("test/unsaved"))
+    {
+	NVM_FATAL("unsaved file came back");
+    }
+
+    //the blocks of the unsaved file are among the least worn, so they are
+    //handed out again and have to be erased first
+    WriteFile(dir, "test/more", 'f', 10 * TEST_FILE_SIZE);
+
+    CheckFile(dir, "test/more", 'f', 10 * TEST_FILE_SIZE);
+
+    for(unsigned long i = 0; i < nvm_api->nr_luns; ++i)
+    {
+	for(nvm_block *blk = nvm_api->luns[i].free_head; blk && blk->next_free; blk = blk->next_free)
+	{
+	    if(blk->erase_count > blk->next_free->erase_count)
+	    {
+		NVM_FATAL("free list of lun %lu is not ordered by erase count", i);
+	    }
+	}
+    }
+
+    delete checkpoint;
+    delete dir;
+    delete nvm_api;
 }
 
+#endif
+
 int main(int argc, char **argv)
 {
-    nvm_directory *save_dir;
-    nvm_directory *load_dir;
-    nvm *nvm_api;
-
-    ALLOC_CLASS(nvm_api, nvm());
-    ALLOC_CLASS(save_dir, nvm_directory("root", 4, nvm_api, nullptr));
-    ALLOC_CLASS(load_dir, nvm_directory("root", 4, nvm_api, nullptr));
+    unlink(TEST_IMAGE);
+    unlink(TEST_IMAGE NVM_EMULATOR_PROGRAMMED_SUFFIX);
+    unlink(TEST_LAYOUT);
+    unlink(TEST_JOURNAL);
 
-    TestFtlSave(nvm_api, save_dir);
+    TestFtlSave();
 
     NVM_DEBUG("\nLOADING\n")
 
-    TestFtlLoad(nvm_api, load_dir);
+    TestFtlLoad();
+    TestTornJournal();
+    TestLegacyLayout();
+
+#ifdef NVM_ALLOCATE_BLOCKS
+
+    TestBlockState();
+
+#endif
+
+    unlink(TEST_IMAGE);
+    unlink(TEST_IMAGE NVM_EMULATOR_PROGRAMMED_SUFFIX);
+    unlink(TEST_LAYOUT);
+    unlink(TEST_JOURNAL);
+
+    NVM_DEBUG("TEST FINISHED");
 
     return 0;
 }
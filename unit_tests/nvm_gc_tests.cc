@@ -4,8 +4,474 @@
 
 using namespace rocksdb;
 
+#ifdef NVM_ALLOCATE_BLOCKS
+
+#define GC_TEST_PAGES 3
+
+void WriteFile(nvm_directory *dir, const char *name, const char fill, const unsigned long nr_pages, const unsigned long page_size)
+{
+    nvm_file *fd = dir->nvm_fopen(name, "a");
+
+    if(fd == nullptr)
+    {
+	NVM_FATAL("");
+    }
+
+    NVMWritableFile *w_file;
+
+    ALLOC_CLASS(w_file, NVMWritableFile(name, fd, dir));
+
+    char *data;
+    SAFE_ALLOC(data, char[page_size]);
+
+    memset(data, fill, page_size);
+
+    for(unsigned long i = 0; i < nr_pages; ++i)
+    {
+	if(!w_file->Append(Slice(data, page_size)).ok())
+	{
+	    NVM_FATAL("");
+	}
+    }
+
+    //releases the pages the file did not use
+    w_file->Close();
+
+    delete w_file;
+    delete[] data;
+}
+
+void CheckFile(nvm_directory *dir, const char *name, const char fill, const unsigned long len)
+{
+    nvm_file *fd = dir->nvm_fopen(name, "r");
+
+    NVMRandomAccessFile *ra_file;
+
+    ALLOC_CLASS(ra_file, NVMRandomAccessFile(name, fd, dir));
+
+    char *scratch;
+    SAFE_ALLOC(scratch, char[len]);
+
+    Slice s;
+
+    if(!ra_file->Read(0, len, &s, scratch).ok() || s.size() != len)
+    {
+	NVM_FATAL("%s", name);
+    }
+
+    for(unsigned long i = 0; i < len; ++i)
+    {
+	if(s.data()[i] != fill)
+	{
+	    NVM_FATAL("%s at %lu", name, i);
+	}
+    }
+
+    delete[] scratch;
+    delete ra_file;
+}
+
+void TestBlockGC()
+{
+    nvm_emulator_options options;
+
+    if(options.Parse("luns=2,blocks=8,pages=8") == false)
+    {
+	NVM_FATAL("");
+    }
+
+    nvm_emulated_device *dev;
+
+    ALLOC_CLASS(dev, nvm_emulated_device(options));
+
+    if(dev->Open())
+    {
+	NVM_FATAL("");
+    }
+
+    nvm *nvm_api;
+    nvm_directory *dir;
+
+    ALLOC_CLASS(nvm_api, nvm(dev));
+    ALLOC_CLASS(dir, nvm_directory("root", 4, nvm_api, nullptr));
+
+    std::shared_ptr<Statistics> stats = CreateDBStatistics();
+
+    nvm_api->SetGarbageCollectionOptions(nullptr, stats.get());
+
+    unsigned long page_size = options.page_size;
+
+    //one stripe of two blocks, mostly stale once the file is closed
+    WriteFile(dir, "cold", 'c', GC_TEST_PAGES, page_size);
+
+    //the writer keeps a page claimed past the data
+    nvm_file *fd = dir->nvm_fopen("cold", "r");
+
+    unsigned long nr_pages = 0;
+
+    while(fd->GetNVMPage(nr_pages))
+    {
+	++nr_pages;
+    }
+
+    struct nvm_page *old_pg = fd->GetNVMPage(0);
+
+    struct nvm_gc_stats gc_stats;
+
+    nvm_api->GetGarbageCollectionStats(&gc_stats);
+
+    if(gc_stats.free_blocks != 14 || gc_stats.user_pages_written != nr_pages)
+    {
+	NVM_FATAL("%lu free blocks, %lu pages written", gc_stats.free_blocks, gc_stats.user_pages_written);
+    }
+
+    nvm_api->GarbageCollection();
+
+    nvm_api->GetGarbageCollectionStats(&gc_stats);
+
+    if(gc_stats.gc_pages_relocated != nr_pages || gc_stats.blocks_erased != 0)
+    {
+	NVM_FATAL("%lu pages relocated, %lu blocks erased", gc_stats.gc_pages_relocated, gc_stats.blocks_erased);
+    }
+
+    CheckFile(dir, "cold", 'c', GC_TEST_PAGES * page_size);
+
+    //the FTL on disk still points into the relocated blocks
+    nvm_api->GarbageCollection();
+
+    nvm_api->GetGarbageCollectionStats(&gc_stats);
+
+    if(gc_stats.blocks_erased != 0)
+    {
+	NVM_FATAL("%lu blocks erased before a save", gc_stats.blocks_erased);
+    }
+
+    nvm_api->GarbageCollectionSaved(nvm_api->GetGarbageCollectionPasses());
+
+    //a reader that looked up a page before it moved keeps its block
+    nvm_api->PinBlock(old_pg);
+
+    nvm_api->GarbageCollection();
+
+    nvm_api->GetGarbageCollectionStats(&gc_stats);
+
+    if(gc_stats.blocks_erased != 1)
+    {
+	NVM_FATAL("%lu blocks erased with a reader pinned", gc_stats.blocks_erased);
+    }
+
+    nvm_api->UnpinBlock(old_pg);
+
+    nvm_api->GarbageCollection();
+
+    nvm_api->GetGarbageCollectionStats(&gc_stats);
+
+    if(gc_stats.blocks_erased != 2 || gc_stats.free_blocks != 15)
+    {
+	NVM_FATAL("%lu blocks erased, %lu free blocks", gc_stats.blocks_erased, gc_stats.free_blocks);
+    }
+
+    CheckFile(dir, "cold", 'c', GC_TEST_PAGES * page_size);
+
+    if(stats->getTickerCount(NVM_GC_PAGES_RELOCATED) != nr_pages ||
+       stats->getTickerCount(NVM_BLOCKS_ERASED) != 2 ||
+       stats->getTickerCount(NVM_USER_PAGES_WRITTEN) != nr_pages)
+    {
+	NVM_FATAL("statistics were not reported");
+    }
+
+    //erased blocks are the most worn now; new writes go elsewhere
+    WriteFile(dir, "hot", 'h', 1, page_size);
+
+    struct nvm_page *pg = dir->nvm_fopen("hot", "r")->GetNVMPage(0);
+
+    if(nvm_api->luns[pg->lun_id].blocks[pg->block_id].erase_count != 0)
+    {
+	NVM_FATAL("allocation is not wear aware");
+    }
+
+    //deleting a file erases its blocks right away
+    if(dir->DeleteFile("hot"))
+    {
+	NVM_FATAL("");
+    }
+
+    nvm_api->GetGarbageCollectionStats(&gc_stats);
+
+    if(gc_stats.blocks_erased != 4)
+    {
+	NVM_FATAL("%lu blocks erased", gc_stats.blocks_erased);
+    }
+
+    nvm_api->SetGarbageCollectionOptions(nullptr, nullptr);
+
+    delete dir;
+    delete nvm_api;
+}
+
+//erases the block RequestBlock() hands out next and returns it
+struct nvm_block *CycleBlock(nvm *nvm_api)
+{
+    std::vector<struct nvm_page *> block_pages;
+
+    if(nvm_api->RequestBlock(&block_pages, NVM_POOL_HOT) == false)
+    {
+	NVM_FATAL("");
+    }
+
+    struct nvm_block *blk = &nvm_api->luns[0].blocks[block_pages[0]->block_id];
+
+    nvm_api->ReleasePages(&block_pages);
+
+    return blk;
+}
+
+void TestFreeListOrder()
+{
+    nvm_emulator_options options;
+
+    if(options.Parse("luns=1,blocks=2,pages=8") == false)
+    {
+	NVM_FATAL("");
+    }
+
+    nvm_emulated_device *dev;
+
+    ALLOC_CLASS(dev, nvm_emulated_device(options));
+
+    if(dev->Open())
+    {
+	NVM_FATAL("");
+    }
+
+    nvm *nvm_api;
+
+    ALLOC_CLASS(nvm_api, nvm(dev));
+
+    //the first block ends up erased twice, the second once
+    struct nvm_block *worn = CycleBlock(nvm_api);
+
+    CycleBlock(nvm_api);
+
+    if(CycleBlock(nvm_api) != worn)
+    {
+	NVM_FATAL("the least worn block was not taken first");
+    }
+
+    std::vector<struct nvm_page *> block_pages;
+
+    if(nvm_api->RequestBlock(&block_pages, NVM_POOL_HOT) == false)
+    {
+	NVM_FATAL("");
+    }
+
+    //erased last but less worn than the other free block
+    if(CycleBlock(nvm_api) != worn)
+    {
+	NVM_FATAL("");
+    }
+
+    nvm_api->ReleasePages(&block_pages);
+
+    struct nvm_lun *lun = &nvm_api->luns[0];
+
+    if(lun->free_tail != worn || lun->free_head->erase_count != 2 || worn->erase_count != 3)
+    {
+	NVM_FATAL("free list is not ordered by erase count");
+    }
+
+    delete nvm_api;
+}
+
+void TestPools()
+{
+    nvm_emulator_options options;
+
+    if(options.Parse("luns=4,blocks=8,pages=8") == false)
+    {
+	NVM_FATAL("");
+    }
+
+    nvm_emulated_device *dev;
+
+    ALLOC_CLASS(dev, nvm_emulated_device(options));
+
+    if(dev->Open())
+    {
+	NVM_FATAL("");
+    }
+
+    nvm *nvm_api;
+    nvm_directory *dir;
+
+    ALLOC_CLASS(nvm_api, nvm(dev));
+    ALLOC_CLASS(dir, nvm_directory("root", 4, nvm_api, nullptr));
+
+    unsigned long page_size = options.page_size;
+
+    //one lun is kept for logs, the three others are shared by the ssts
+    WriteFile(dir, "000001.log", 'l', 4, page_size);
+    WriteFile(dir, "000002.sst", 's', 4, page_size);
+
+    nvm_file *fd = dir->nvm_fopen("000003.sst", "w");
+
+    fd->SetPool(NVM_POOL_COLD);
+
+    dir->nvm_fclose(fd, "w");
+
+    WriteFile(dir, "000003.sst", 'c', 4, page_size);
+
+    nvm_file *log_fd = dir->nvm_fopen("000001.log", "r");
+    nvm_file *hot_fd = dir->nvm_fopen("000002.sst", "r");
+    nvm_file *cold_fd = dir->nvm_fopen("000003.sst", "r");
+
+    if(log_fd->GetPool() != NVM_POOL_WAL || hot_fd->GetPool() != NVM_POOL_HOT)
+    {
+	NVM_FATAL("pool was not inferred from the name");
+    }
+
+    unsigned long sst_luns = 0;
+
+    for(unsigned long i = 0; i < 4; ++i)
+    {
+	struct nvm_page *log_pg = log_fd->GetNVMPage(i);
+	struct nvm_page *hot_pg = hot_fd->GetNVMPage(i);
+	struct nvm_page *cold_pg = cold_fd->GetNVMPage(i);
+
+	if(log_pg->lun_id != 0 || hot_pg->lun_id == 0 || cold_pg->lun_id == 0)
+	{
+	    NVM_FATAL("logs and ssts share a lun");
+	}
+
+	if(nvm_api->luns[hot_pg->lun_id].blocks[hot_pg->block_id].pool != NVM_POOL_HOT ||
+	   nvm_api->luns[cold_pg->lun_id].blocks[cold_pg->block_id].pool != NVM_POOL_COLD)
+	{
+	    NVM_FATAL("ssts of different lifetimes share a block");
+	}
+
+	sst_luns |= 1UL << hot_pg->lun_id;
+    }
+
+    if(sst_luns != 14)
+    {
+	NVM_FATAL("ssts are not striped over their luns %lx", sst_luns);
+    }
+
+    CheckFile(dir, "000001.log", 'l', 4 * page_size);
+    CheckFile(dir, "000002.sst", 's', 4 * page_size);
+    CheckFile(dir, "000003.sst", 'c', 4 * page_size);
+
+    delete dir;
+    delete nvm_api;
+}
+
+#define ALLOC_TEST_THREADS 8
+#define ALLOC_TEST_ROUNDS 500
+
+void *AllocateBlocks(void *arg)
+{
+    nvm *nvm_api = (nvm *)arg;
+
+    std::vector<struct nvm_page *> block_pages;
+
+    for(unsigned long i = 0; i < ALLOC_TEST_ROUNDS; ++i)
+    {
+	if(nvm_api->RequestBlock(&block_pages, NVM_POOL_HOT) == false)
+	{
+	    NVM_FATAL("out of blocks");
+	}
+
+	nvm_api->ReleasePages(&block_pages);
+    }
+
+    return nullptr;
+}
+
+void TestConcurrentAllocation()
+{
+    nvm_emulator_options options;
+
+    if(options.Parse("luns=4,blocks=16,pages=4") == false)
+    {
+	NVM_FATAL("");
+    }
+
+    nvm_emulated_device *dev;
+
+    ALLOC_CLASS(dev, nvm_emulated_device(options));
+
+    if(dev->Open())
+    {
+	NVM_FATAL("");
+    }
+
+    nvm *nvm_api;
+
+    ALLOC_CLASS(nvm_api, nvm(dev));
+
+    pthread_t threads[ALLOC_TEST_THREADS];
+
+    for(unsigned long i = 0; i < ALLOC_TEST_THREADS; ++i)
+    {
+	if(pthread_create(&threads[i], nullptr, AllocateBlocks, nvm_api))
+	{
+	    NVM_FATAL("");
+	}
+    }
+
+    for(unsigned long i = 0; i < ALLOC_TEST_THREADS; ++i)
+    {
+	pthread_join(threads[i], nullptr);
+    }
+
+    struct nvm_gc_stats gc_stats;
+
+    nvm_api->GetGarbageCollectionStats(&gc_stats);
+
+    //every block went back to its free list once erased
+    if(gc_stats.free_blocks != 64 || gc_stats.blocks_erased != ALLOC_TEST_THREADS * ALLOC_TEST_ROUNDS)
+    {
+	NVM_FATAL("%lu free blocks, %lu blocks erased", gc_stats.free_blocks, gc_stats.blocks_erased);
+    }
+
+    if(nvm_api->GetFreeBlocks(NVM_POOL_WAL) != 16 || nvm_api->GetFreeBlocks(NVM_POOL_HOT) != 48)
+    {
+	NVM_FATAL("free blocks are not counted per lun");
+    }
+
+    //a thread sticks to its lun
+    std::vector<struct nvm_page *> block_pages;
+
+    nvm_api->SetLunAffinity(2);
+
+    if(nvm_api->RequestBlock(&block_pages, NVM_POOL_HOT) == false || block_pages[0]->lun_id != 2)
+    {
+	NVM_FATAL("lun affinity was not followed");
+    }
+
+    if(nvm_api->GetFreeBlocks(NVM_POOL_HOT) != 47)
+    {
+	NVM_FATAL("");
+    }
+
+    nvm_api->ReleasePages(&block_pages);
+
+    delete nvm_api;
+}
+
+#endif
+
 int main(int argc, char **argv)
 {
+#ifdef NVM_ALLOCATE_BLOCKS
+
+    TestBlockGC();
+    TestFreeListOrder();
+    TestPools();
+    TestConcurrentAllocation();
+
+#endif
+
     nvm_directory *dir;
     nvm *nvm_api;
 
@@ -43,6 +43,32 @@ int main(int argc, char **argv)
     }
 
     NVM_DEBUG("read 2 ok");
+
+    ReadRequest reqs[3];
+
+    char *multi_scratch = new char[3 * (size / 4 + 1)];
+
+    for(int i = 0; i < 3; ++i)
+    {
+	reqs[i].offset = i * size / 2;
+	reqs[i].len = size / 4 + 1;
+	reqs[i].scratch = multi_scratch + i * (size / 4 + 1);
+    }
+
+    if(!test_file->MultiRead(reqs, 3).ok())
+    {
+	NVM_FATAL("multi read test failed");
+    }
+
+    for(int i = 0; i < 3; ++i)
+    {
+	if(!reqs[i].status.ok() || !test_file->Read(reqs[i].offset, reqs[i].len, &r, scratch).ok() || r != reqs[i].result)
+	{
+	    NVM_FATAL("multi read %d does not match read", i);
+	}
+    }
+
+    NVM_DEBUG("multi read ok");
 }
 
 #else
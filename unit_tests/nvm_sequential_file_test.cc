@@ -1,11 +1,152 @@
 #ifdef ROCKSDB_PLATFORM_NVM
 
 #include "nvm/nvm.h"
+#include "db/log_reader.h"
+#include "db/log_writer.h"
+#include "util/file_reader_writer.h"
 
 using namespace rocksdb;
 
+#ifdef NVM_ALLOCATE_BLOCKS
+
+#define WAL_TEST_RECORDS 300
+
+class WalReporter : public log::Reader::Reporter
+{
+    public:
+	size_t dropped_bytes;
+
+	WalReporter()
+	{
+	    dropped_bytes = 0;
+	}
+
+	virtual void Corruption(size_t bytes, const Status& status) override
+	{
+	    dropped_bytes += bytes;
+	}
+};
+
+std::string WalRecord(const unsigned long i)
+{
+    return std::string(1 + (i * 7919) % 3000, (char)('a' + i % 26));
+}
+
+//synced write-ahead logs are padded to whole pages: no page is written twice
+void TestWalSync()
+{
+    nvm_emulator_options options;
+
+    if(options.Parse("luns=4,blocks=32,pages=16") == false)
+    {
+	NVM_FATAL("");
+    }
+
+    nvm_emulated_device *dev;
+
+    ALLOC_CLASS(dev, nvm_emulated_device(options));
+
+    if(dev->Open())
+    {
+	NVM_FATAL("");
+    }
+
+    nvm *nvm_api;
+    nvm_directory *dir;
+
+    ALLOC_CLASS(nvm_api, nvm(dev));
+    ALLOC_CLASS(dir, nvm_directory("root", 4, nvm_api, nullptr));
+
+    nvm_file *fd = dir->nvm_fopen("000001.log", "a");
+
+    unique_ptr<WritableFile> file(new NVMWritableFile("000001.log", fd, dir));
+
+    if(file->GetSyncAlignment() != options.page_size)
+    {
+	NVM_FATAL("log is not page aligned");
+    }
+
+    iostats_context.Reset();
+
+    log::Writer *writer = new log::Writer(unique_ptr<WritableFileWriter>(new WritableFileWriter(std::move(file), EnvOptions())));
+
+    for(unsigned long i = 0; i < WAL_TEST_RECORDS; ++i)
+    {
+	if(!writer->AddRecord(WalRecord(i)).ok())
+	{
+	    NVM_FATAL("");
+	}
+
+	if(i % 3 == 0)
+	{
+	    if(!writer->Sync(false).ok())
+	    {
+		NVM_FATAL("");
+	    }
+
+	    if(fd->GetSize() != writer->file()->GetFileSize() || fd->GetSize() % options.page_size)
+	    {
+		NVM_FATAL("sync left %lu bytes of %lu", fd->GetSize(), writer->file()->GetFileSize());
+	    }
+	}
+    }
+
+    delete writer;
+
+    struct nvm_gc_stats gc_stats;
+
+    nvm_api->GetGarbageCollectionStats(&gc_stats);
+
+    unsigned long nr_pages = (fd->GetSize() + options.page_size - 1) / options.page_size;
+
+    //the writer keeps a page claimed past the data
+    if(gc_stats.user_pages_written > nr_pages + 1)
+    {
+	NVM_FATAL("%lu pages written for %lu pages of log", gc_stats.user_pages_written, nr_pages);
+    }
+
+    //every page of the log was programmed by this thread
+    if(iostats_context.nvm_pages_written < nr_pages)
+    {
+	NVM_FATAL("%lu pages written by this thread", (unsigned long)iostats_context.nvm_pages_written);
+    }
+
+    WalReporter reporter;
+
+    unique_ptr<SequentialFileReader> file_reader(new SequentialFileReader(unique_ptr<SequentialFile>(new NVMSequentialFile("000001.log", dir->nvm_fopen("000001.log", "r"), dir))));
+
+    log::Reader reader(std::move(file_reader), &reporter, true, 0);
+
+    Slice record;
+    std::string scratch;
+
+    for(unsigned long i = 0; i < WAL_TEST_RECORDS; ++i)
+    {
+	if(reader.ReadRecord(&record, &scratch) == false || record.ToString() != WalRecord(i))
+	{
+	    NVM_FATAL("record %lu was lost", i);
+	}
+    }
+
+    if(reader.ReadRecord(&record, &scratch) || reporter.dropped_bytes > 0)
+    {
+	NVM_FATAL("padding was not skipped");
+    }
+
+    delete dir;
+    delete nvm_api;
+}
+
+#endif
+
 int main(int argc, char **argv)
 {
+#ifdef NVM_ALLOCATE_BLOCKS
+
+    TestWalSync();
+
+#endif
+
     nvm_directory *dir;
     nvm *nvm_api;
 
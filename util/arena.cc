@@ -39,8 +39,9 @@ size_t OptimizeBlockSize(size_t block_size) {
   return block_size;
 }
 
-Arena::Arena(size_t block_size, size_t huge_page_size)
-    : kBlockSize(OptimizeBlockSize(block_size)) {
+Arena::Arena(size_t block_size, size_t huge_page_size,
+             ArenaBlockPool* block_pool)
+    : kBlockSize(OptimizeBlockSize(block_size)), block_pool_(block_pool) {
   assert(kBlockSize >= kMinBlockSize && kBlockSize <= kMaxBlockSize &&
          kBlockSize % kAlignUnit == 0);
   alloc_bytes_remaining_ = sizeof(inline_block_);
@@ -59,6 +60,9 @@ Arena::~Arena() {
   for (const auto& block : blocks_) {
     delete[] block;
   }
+  for (const auto& block : pool_blocks_) {
+    block_pool_->Release(block);
+  }
 
 #ifdef MAP_HUGETLB
   for (const auto& mmap_info : huge_blocks_) {
@@ -81,7 +85,12 @@ char* Arena::AllocateFallback(size_t bytes, bool aligned) {
   // We waste the remaining space in the current block.
   size_t size;
   char* block_head = nullptr;
-  if (hugetlb_size_) {
+  if (block_pool_ != nullptr) {
+    pool_blocks_.push_back(block_pool_->Allocate(kBlockSize));
+    size = pool_blocks_.back().size;
+    block_head = pool_blocks_.back().data;
+    blocks_memory_ += size;
+  } else if (hugetlb_size_) {
     size = hugetlb_size_;
     block_head = AllocateFromHugePage(size);
   }
@@ -18,6 +18,7 @@
 #include <assert.h>
 #include <stdint.h>
 #include "util/allocator.h"
+#include "util/arena_block_pool.h"
 
 namespace rocksdb {
 
@@ -34,7 +35,11 @@ class Arena : public Allocator {
   // huge_page_size: if 0, don't use huge page TLB. If > 0 (should set to the
   // supported hugepage size of the system), block allocation will try huge
   // page TLB first. If allocation fails, will fall back to normal case.
-  explicit Arena(size_t block_size = kMinBlockSize, size_t huge_page_size = 0);
+  // block_pool: if not nullptr, blocks of block_size come from it, in place
+  // of huge_page_size, and go back to it when the arena is destroyed. It
+  // must outlive the arena.
+  explicit Arena(size_t block_size = kMinBlockSize, size_t huge_page_size = 0,
+                 ArenaBlockPool* block_pool = nullptr);
   ~Arena();
 
   char* Allocate(size_t bytes) override;
@@ -89,6 +94,9 @@ class Arena : public Allocator {
   std::vector<MmapInfo> huge_blocks_;
   size_t irregular_block_num = 0;
 
+  ArenaBlockPool* const block_pool_;
+  std::vector<ArenaBlockPool::Block> pool_blocks_;
+
   // Stats for current active block.
   // For each block, we allocate aligned memory chucks from one end and
   // allocate unaligned memory chucks from the other end. Otherwise the
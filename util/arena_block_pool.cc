@@ -0,0 +1,103 @@
+//  Copyright (c) 2013, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#include "util/arena_block_pool.h"
+#ifndef OS_WIN
+#include <sys/mman.h>
+#endif
+#include "db/writebuffer.h"
+#include "rocksdb/statistics.h"
+#include "util/statistics.h"
+
+namespace rocksdb {
+
+ArenaBlockPool::ArenaBlockPool(size_t capacity, size_t huge_page_size,
+                               const WriteBuffer* write_buffer,
+                               Statistics* statistics)
+    : capacity_(capacity),
+      huge_page_size_(huge_page_size),
+      write_buffer_(write_buffer),
+      statistics_(statistics),
+      idle_bytes_(0),
+      hits_(0),
+      misses_(0) {}
+
+ArenaBlockPool::~ArenaBlockPool() {
+  for (const auto& blocks : idle_) {
+    for (const auto& block : blocks.second) {
+      Free(block);
+    }
+  }
+}
+
+ArenaBlockPool::Block ArenaBlockPool::Allocate(size_t bytes) {
+  size_t size = bytes;
+#ifdef MAP_HUGETLB
+  if (huge_page_size_ > 0) {
+    size = ((bytes - 1U) / huge_page_size_ + 1U) * huge_page_size_;
+  }
+#endif
+  {
+    std::lock_guard<SpinMutex> lock(mutex_);
+    auto it = idle_.find(size);
+    if (it != idle_.end() && !it->second.empty()) {
+      Block block = it->second.back();
+      it->second.pop_back();
+      idle_bytes_.fetch_sub(block.size, std::memory_order_relaxed);
+      hits_.fetch_add(1, std::memory_order_relaxed);
+      RecordTick(statistics_, MEMTABLE_BLOCK_POOL_HIT);
+      return block;
+    }
+  }
+  misses_.fetch_add(1, std::memory_order_relaxed);
+  RecordTick(statistics_, MEMTABLE_BLOCK_POOL_MISS);
+
+  Block block;
+#ifdef MAP_HUGETLB
+  if (huge_page_size_ > 0) {
+    void* addr = mmap(nullptr, size, (PROT_READ | PROT_WRITE),
+                      (MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB), 0, 0);
+    if (addr != MAP_FAILED) {
+      block.data = reinterpret_cast<char*>(addr);
+      block.size = size;
+      block.huge_page = true;
+      return block;
+    }
+  }
+#endif
+  // Same size as a huge page block would have been, so that it can stand
+  // in for one when it is reused
+  block.data = new char[size];
+  block.size = size;
+  block.huge_page = false;
+  return block;
+}
+
+void ArenaBlockPool::Release(const Block& block) {
+  size_t budget = write_buffer_ != nullptr ? write_buffer_->buffer_size() : 0;
+  {
+    std::lock_guard<SpinMutex> lock(mutex_);
+    size_t idle = idle_bytes_.load(std::memory_order_relaxed) + block.size;
+    if (idle <= capacity_ &&
+        (budget == 0 || write_buffer_->memory_usage() + idle <= budget)) {
+      idle_[block.size].push_back(block);
+      idle_bytes_.store(idle, std::memory_order_relaxed);
+      return;
+    }
+  }
+  Free(block);
+}
+
+void ArenaBlockPool::Free(const Block& block) {
+#ifdef MAP_HUGETLB
+  if (block.huge_page) {
+    munmap(block.data, block.size);
+    return;
+  }
+#endif
+  delete[] block.data;
+}
+
+}  // namespace rocksdb
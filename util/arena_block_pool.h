@@ -0,0 +1,77 @@
+//  Copyright (c) 2013, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+//
+// ArenaBlockPool keeps the blocks of destroyed arenas for reuse by new ones,
+// so that a stream of memtables being filled and flushed does not keep
+// handing its memory back to malloc or munmap and faulting it in again.
+
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+#include "util/mutexlock.h"
+
+namespace rocksdb {
+
+class Statistics;
+class WriteBuffer;
+
+class ArenaBlockPool {
+ public:
+  struct Block {
+    char* data;
+    size_t size;
+    bool huge_page;  // mapped from huge pages rather than new[]'ed
+  };
+
+  // capacity: at most this many bytes of idle blocks are kept; blocks
+  //   released beyond it are freed.
+  // huge_page_size: if > 0, new blocks are rounded up to a multiple of it
+  //   and mapped from huge pages, falling back to new[] where that fails.
+  //   The huge pages have to be reserved, like:
+  //       sysctl -w vm.nr_hugepages=20
+  // write_buffer: if not nullptr and it has a buffer size, idle blocks are
+  //   only kept while they fit in that size along with the memory in use.
+  // statistics: if not nullptr, counts blocks reused and newly allocated in
+  //   MEMTABLE_BLOCK_POOL_HIT and MEMTABLE_BLOCK_POOL_MISS.
+  ArenaBlockPool(size_t capacity, size_t huge_page_size,
+                 const WriteBuffer* write_buffer, Statistics* statistics);
+  ~ArenaBlockPool();
+
+  // Returns an idle block of the size a request of "bytes" gets, or a new
+  // one.
+  Block Allocate(size_t bytes);
+
+  // Takes back a block returned by Allocate().
+  void Release(const Block& block);
+
+  size_t IdleBytes() const {
+    return idle_bytes_.load(std::memory_order_relaxed);
+  }
+  uint64_t hits() const { return hits_.load(std::memory_order_relaxed); }
+  uint64_t misses() const { return misses_.load(std::memory_order_relaxed); }
+
+ private:
+  static void Free(const Block& block);
+
+  const size_t capacity_;
+  const size_t huge_page_size_;
+  const WriteBuffer* const write_buffer_;
+  Statistics* const statistics_;
+
+  SpinMutex mutex_;
+  // Idle blocks by size
+  std::unordered_map<size_t, std::vector<Block>> idle_;
+  std::atomic<size_t> idle_bytes_;
+  std::atomic<uint64_t> hits_;
+  std::atomic<uint64_t> misses_;
+
+  // No copying allowed
+  ArenaBlockPool(const ArenaBlockPool&) = delete;
+  void operator=(const ArenaBlockPool&) = delete;
+};
+
+}  // namespace rocksdb
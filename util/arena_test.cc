@@ -8,6 +8,7 @@
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 
 #include "util/arena.h"
+#include "db/writebuffer.h"
 #include "util/random.h"
 #include "util/testharness.h"
 
@@ -180,6 +181,77 @@ TEST_F(ArenaTest, Simple) {
   SimpleTest(0);
   SimpleTest(kHugePageSize);
 }
+
+namespace {
+// Allocates "bytes" from "arena" in small pieces
+void FillArena(Arena* arena, size_t bytes) {
+  const size_t piece = 1024;
+  for (size_t i = 0; i < bytes / piece; i++) {
+    memset(arena->Allocate(piece), static_cast<int>(i), piece);
+  }
+}
+
+void BlockPoolTest(size_t huge_page_size) {
+  const size_t bsz = 8192;
+  const size_t pool_block = huge_page_size > 0 ? huge_page_size : bsz;
+  ArenaBlockPool pool(20 * pool_block, huge_page_size, nullptr, nullptr);
+
+  uint64_t misses;
+  {
+    Arena arena(bsz, 0, &pool);
+    FillArena(&arena, 10 * pool_block);
+    misses = pool.misses();
+    ASSERT_GE(misses, 10U);
+    ASSERT_EQ(0U, pool.hits());
+    ASSERT_EQ(0U, pool.IdleBytes());
+  }
+  ASSERT_EQ(misses * pool_block, pool.IdleBytes());
+
+  // A second arena of the same block size takes the blocks back
+  {
+    Arena arena(bsz, 0, &pool);
+    FillArena(&arena, 10 * pool_block);
+    ASSERT_EQ(misses, pool.hits());
+    ASSERT_EQ(misses, pool.misses());
+    ASSERT_EQ(0U, pool.IdleBytes());
+  }
+
+  // Blocks past the capacity are freed
+  {
+    Arena arena(bsz, 0, &pool);
+    FillArena(&arena, 30 * pool_block);
+  }
+  ASSERT_EQ(20 * pool_block, pool.IdleBytes());
+}
+}  // namespace
+
+TEST_F(ArenaTest, BlockPool) {
+  BlockPoolTest(0);
+  BlockPoolTest(kHugePageSize);
+}
+
+TEST_F(ArenaTest, BlockPoolWithinWriteBuffer) {
+  const size_t bsz = 8192;
+  WriteBuffer wb(5 * bsz, 100 * bsz);
+  ArenaBlockPool* pool = wb.block_pool();
+  ASSERT_TRUE(pool != nullptr);
+
+  // Idle blocks and the memory in use stay within the buffer size
+  wb.ReserveMem(2 * bsz);
+  {
+    Arena arena(bsz, 0, pool);
+    FillArena(&arena, 10 * bsz);
+  }
+  ASSERT_EQ(3 * bsz, pool->IdleBytes());
+  wb.FreeMem(2 * bsz);
+  {
+    Arena arena(bsz, 0, pool);
+    FillArena(&arena, 10 * bsz);
+  }
+  ASSERT_EQ(5 * bsz, pool->IdleBytes());
+
+  ASSERT_TRUE(WriteBuffer(5 * bsz).block_pool() == nullptr);
+}
 }  // namespace rocksdb
 
 int main(int argc, char** argv) {
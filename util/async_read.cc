@@ -0,0 +1,446 @@
+//  Copyright (c) 2013, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#ifdef ROCKSDB_PLATFORM_POSIX
+
+#include "util/async_read.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#ifdef ROCKSDB_IOURING_PRESENT
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#include <algorithm>
+
+namespace rocksdb {
+
+namespace {
+
+// Reads a ReadThreadPool keeps in flight across all its readers
+const int kReadThreads = 16;
+// Reads an io_uring reader keeps in flight; more wait in its backlog
+const unsigned kRingEntries = 64;
+// Idle io_uring readers kept for reuse; each holds a ring and its mappings
+const size_t kMaxIdleReaders = 16;
+
+// A submitted read, with how much of it is done
+struct PendingRead {
+  int fd;
+  const std::string* fname;
+  ReadRequest* req;
+  size_t done;
+};
+
+// Accounts res, what pread() returned for the rest of r (or -errno), to r.
+// Returns true once r is complete, false if the rest has to be read.
+bool OnReadResult(PendingRead* r, ssize_t res) {
+  ReadRequest* req = r->req;
+  if (res < 0) {
+    int err = static_cast<int>(-res);
+    if (err == EINTR || err == EAGAIN) {
+      return false;
+    }
+    req->result = Slice(req->scratch, 0);
+    req->status = Status::IOError(*r->fname, strerror(err));
+    return true;
+  }
+  r->done += static_cast<size_t>(res);
+  if (res == 0 || r->done == req->len) {
+    // a read stops short at the end of the file only
+    req->result = Slice(req->scratch, r->done);
+    req->status = Status::OK();
+    return true;
+  }
+  return false;
+}
+
+void ReadSynchronously(PendingRead* r) {
+  ssize_t res;
+  do {
+    res = pread(r->fd, r->req->scratch + r->done, r->req->len - r->done,
+                static_cast<off_t>(r->req->offset + r->done));
+    if (res < 0) {
+      res = -errno;
+    }
+  } while (!OnReadResult(r, res));
+}
+
+class ThreadPoolReader : public AsyncReader {
+ public:
+  explicit ThreadPoolReader(ReadThreadPool* pool)
+      : pool_(pool), completed_(0) {}
+
+  virtual void Submit(int fd, const std::string* fname,
+                      ReadRequest* req) override {
+    PendingRead r = {fd, fname, req, 0};
+    pool_->Schedule([this, r]() mutable {
+      ReadSynchronously(&r);
+      std::lock_guard<std::mutex> guard(mu_);
+      ++completed_;
+      cv_.notify_one();
+    });
+  }
+
+  virtual size_t Poll(size_t min_completions) override {
+    std::unique_lock<std::mutex> guard(mu_);
+    cv_.wait(guard, [&] { return completed_ >= min_completions; });
+    size_t completed = completed_;
+    completed_ = 0;
+    return completed;
+  }
+
+ private:
+  ReadThreadPool* pool_;
+  std::mutex mu_;
+  std::condition_variable cv_;
+  size_t completed_;
+};
+
+#ifdef ROCKSDB_IOURING_PRESENT
+// Talks to the kernel through the raw io_uring system calls, with one
+// IORING_OP_READV per read in flight.
+class IoUringReader : public AsyncReader {
+ public:
+  static IoUringReader* Create(unsigned entries) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    int ring_fd =
+        static_cast<int>(syscall(__NR_io_uring_setup, entries, &p));
+    if (ring_fd < 0) {
+      return nullptr;
+    }
+    IoUringReader* reader = new IoUringReader(ring_fd);
+    if (!reader->Map(p)) {
+      delete reader;
+      return nullptr;
+    }
+    return reader;
+  }
+
+  virtual ~IoUringReader() {
+    if (sqes_ != MAP_FAILED) {
+      munmap(sqes_, sqes_size_);
+    }
+    if (cq_ptr_ != MAP_FAILED && cq_ptr_ != sq_ptr_) {
+      munmap(cq_ptr_, cq_size_);
+    }
+    if (sq_ptr_ != MAP_FAILED) {
+      munmap(sq_ptr_, sq_size_);
+    }
+    close(ring_fd_);
+  }
+
+  virtual void Submit(int fd, const std::string* fname,
+                      ReadRequest* req) override {
+    PendingRead r = {fd, fname, req, 0};
+    backlog_.push_back(r);
+  }
+
+  virtual size_t Poll(size_t min_completions) override {
+    size_t completed = 0;
+    while (true) {
+      completed += Reap();
+      while (!backlog_.empty() && !free_slots_.empty()) {
+        unsigned slot = free_slots_.back();
+        free_slots_.pop_back();
+        slots_[slot] = backlog_.front();
+        backlog_.pop_front();
+        Prepare(slot);
+      }
+      if (completed >= min_completions ||
+          (free_slots_.size() == slots_.size() && backlog_.empty())) {
+        // leave the reads prepared by Reap() running
+        Enter(0);
+        break;
+      }
+      if (!Enter(1)) {
+        completed += ReadUnsubmittedSynchronously();
+      }
+    }
+    return completed;
+  }
+
+ protected:
+  // Setting up a ring takes system calls and mappings
+  virtual bool Reusable() const override { return true; }
+
+ private:
+  explicit IoUringReader(int ring_fd)
+      : ring_fd_(ring_fd),
+        sq_ptr_(MAP_FAILED),
+        cq_ptr_(MAP_FAILED),
+        sqes_(MAP_FAILED) {}
+
+  bool Map(const struct io_uring_params& p) {
+    sq_size_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cq_size_ = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+      sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+    }
+    sq_ptr_ = mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+    if (sq_ptr_ == MAP_FAILED) {
+      return false;
+    }
+    if (single_mmap) {
+      cq_ptr_ = sq_ptr_;
+    } else {
+      cq_ptr_ = mmap(nullptr, cq_size_, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+      if (cq_ptr_ == MAP_FAILED) {
+        return false;
+      }
+    }
+    sqes_size_ = p.sq_entries * sizeof(struct io_uring_sqe);
+    sqes_ = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+    if (sqes_ == MAP_FAILED) {
+      return false;
+    }
+
+    char* sq = static_cast<char*>(sq_ptr_);
+    char* cq = static_cast<char*>(cq_ptr_);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq + p.cq_off.cqes);
+
+    // a slot per submission queue entry: the queue never overflows
+    slots_.resize(p.sq_entries);
+    iovs_.resize(p.sq_entries);
+    for (unsigned i = 0; i < p.sq_entries; ++i) {
+      free_slots_.push_back(i);
+    }
+    return true;
+  }
+
+  // Queues a read of the rest of slots_[slot]
+  void Prepare(unsigned slot) {
+    PendingRead& r = slots_[slot];
+    iovs_[slot].iov_base = r.req->scratch + r.done;
+    iovs_[slot].iov_len = r.req->len - r.done;
+
+    unsigned tail = *sq_tail_;
+    unsigned index = tail & sq_mask_;
+    struct io_uring_sqe* sqe =
+        static_cast<struct io_uring_sqe*>(sqes_) + index;
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = r.fd;
+    sqe->off = r.req->offset + r.done;
+    sqe->addr = reinterpret_cast<uint64_t>(&iovs_[slot]);
+    sqe->len = 1;
+    sqe->user_data = slot;
+    sq_array_[index] = index;
+    // the kernel reads the entry once it sees the new tail
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    unsubmitted_.push_back(slot);
+  }
+
+  // Submits the prepared reads and waits for min_complete completions.
+  // Returns false if the kernel refused the reads still unsubmitted.
+  bool Enter(unsigned min_complete) {
+    while (true) {
+      unsigned to_submit = static_cast<unsigned>(unsubmitted_.size());
+      if (to_submit == 0 && min_complete == 0) {
+        return true;
+      }
+      int ret = static_cast<int>(
+          syscall(__NR_io_uring_enter, ring_fd_, to_submit, min_complete,
+                  min_complete > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0));
+      if (ret >= 0) {
+        // the kernel consumes the submission queue in order
+        unsubmitted_.erase(unsubmitted_.begin(), unsubmitted_.begin() + ret);
+        if (unsubmitted_.empty()) {
+          return true;
+        }
+        // short submission: go on with the rest, waiting no more
+        min_complete = 0;
+        continue;
+      }
+      if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+        if (to_submit > 0 && errno != EINTR) {
+          // out of resources; completions have to be reaped first
+          return false;
+        }
+        continue;
+      }
+      return false;
+    }
+  }
+
+  // Takes the prepared reads back from the submission queue and does them
+  // on the calling thread. Returns how many completed.
+  size_t ReadUnsubmittedSynchronously() {
+    __atomic_store_n(sq_tail_,
+                     *sq_tail_ - static_cast<unsigned>(unsubmitted_.size()),
+                     __ATOMIC_RELEASE);
+    size_t completed = 0;
+    for (unsigned slot : unsubmitted_) {
+      ReadSynchronously(&slots_[slot]);
+      free_slots_.push_back(slot);
+      ++completed;
+    }
+    unsubmitted_.clear();
+    return completed;
+  }
+
+  // Accounts the completion queue entries posted so far. Returns how many
+  // reads completed; the rest of short reads is prepared again.
+  size_t Reap() {
+    size_t completed = 0;
+    unsigned head = *cq_head_;
+    unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+      const struct io_uring_cqe* cqe = &cqes_[head & cq_mask_];
+      unsigned slot = static_cast<unsigned>(cqe->user_data);
+      if (OnReadResult(&slots_[slot], cqe->res)) {
+        free_slots_.push_back(slot);
+        ++completed;
+      } else {
+        Prepare(slot);
+      }
+    }
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    return completed;
+  }
+
+  const int ring_fd_;
+  void* sq_ptr_;
+  void* cq_ptr_;
+  void* sqes_;
+  size_t sq_size_;
+  size_t cq_size_;
+  size_t sqes_size_;
+  unsigned* sq_tail_;
+  unsigned sq_mask_;
+  unsigned* sq_array_;
+  unsigned* cq_head_;
+  unsigned* cq_tail_;
+  unsigned cq_mask_;
+  struct io_uring_cqe* cqes_;
+
+  std::vector<PendingRead> slots_;
+  std::vector<struct iovec> iovs_;
+  std::vector<unsigned> free_slots_;
+  // prepared in the submission queue, in order, not yet submitted
+  std::vector<unsigned> unsubmitted_;
+  std::deque<PendingRead> backlog_;
+};
+#endif  // ROCKSDB_IOURING_PRESENT
+
+struct IdleReaders {
+  std::mutex mu;
+  std::vector<AsyncReader*> readers;
+  bool io_uring_failed = false;
+};
+
+IdleReaders* GetIdleReaders() {
+  static IdleReaders* idle = new IdleReaders();
+  return idle;
+}
+
+}  // namespace
+
+ReadThreadPool::ReadThreadPool() : exit_(false) {}
+
+ReadThreadPool::~ReadThreadPool() {
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    exit_ = true;
+  }
+  cv_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void ReadThreadPool::Schedule(std::function<void()>&& read) {
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    queue_.push_back(std::move(read));
+    if (threads_.size() < static_cast<size_t>(kReadThreads) &&
+        threads_.size() < queue_.size()) {
+      threads_.emplace_back(&ReadThreadPool::Run, this);
+    }
+  }
+  cv_.notify_one();
+}
+
+void ReadThreadPool::Run() {
+  while (true) {
+    std::function<void()> read;
+    {
+      std::unique_lock<std::mutex> guard(mu_);
+      cv_.wait(guard, [this] { return exit_ || !queue_.empty(); });
+      if (queue_.empty()) {
+        return;
+      }
+      read = std::move(queue_.front());
+      queue_.pop_front();
+    }
+    read();
+  }
+}
+
+AsyncReader* NewIoUringReader() {
+#ifdef ROCKSDB_IOURING_PRESENT
+  return IoUringReader::Create(kRingEntries);
+#else
+  return nullptr;
+#endif
+}
+
+AsyncReader* NewThreadPoolReader(ReadThreadPool* pool) {
+  return new ThreadPoolReader(pool);
+}
+
+AsyncReader* AsyncReader::Acquire(ReadThreadPool* pool) {
+  IdleReaders* idle = GetIdleReaders();
+  bool try_io_uring;
+  {
+    std::lock_guard<std::mutex> guard(idle->mu);
+    if (!idle->readers.empty()) {
+      AsyncReader* reader = idle->readers.back();
+      idle->readers.pop_back();
+      return reader;
+    }
+    try_io_uring = !idle->io_uring_failed;
+  }
+
+  AsyncReader* reader = try_io_uring ? NewIoUringReader() : nullptr;
+  if (reader == nullptr) {
+    if (try_io_uring) {
+      std::lock_guard<std::mutex> guard(idle->mu);
+      idle->io_uring_failed = true;
+    }
+    reader = NewThreadPoolReader(pool);
+  }
+  return reader;
+}
+
+void AsyncReader::Release(AsyncReader* reader) {
+  if (reader->Reusable()) {
+    IdleReaders* idle = GetIdleReaders();
+    std::lock_guard<std::mutex> guard(idle->mu);
+    if (idle->readers.size() < kMaxIdleReaders) {
+      idle->readers.push_back(reader);
+      return;
+    }
+  }
+  delete reader;
+}
+
+}  // namespace rocksdb
+
+#endif  // ROCKSDB_PLATFORM_POSIX
@@ -0,0 +1,86 @@
+//  Copyright (c) 2013, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+//
+// Asynchronous reads from file descriptors, for
+// RandomAccessFile::MultiRead() of the posix Env.
+
+#pragma once
+
+#ifdef ROCKSDB_PLATFORM_POSIX
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "rocksdb/env.h"
+
+namespace rocksdb {
+
+// Threads the thread pool readers hand their reads to. The Env that opens
+// the files owns the pool; its threads start with the first read and are
+// joined when the pool is destroyed.
+class ReadThreadPool {
+ public:
+  ReadThreadPool();
+  ~ReadThreadPool();
+
+  // Runs read on one of the threads
+  void Schedule(std::function<void()>&& read);
+
+ private:
+  void Run();
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::deque<std::function<void()>> queue_;
+  std::vector<std::thread> threads_;
+  bool exit_;
+};
+
+// Keeps any number of reads in flight: reads are submitted first, then
+// polled for completion. The io_uring reader hands them all to the kernel
+// at once; the thread pool reader, used where io_uring is missing, spreads
+// them over a ReadThreadPool.
+//
+// A reader is used by one thread at a time.
+class AsyncReader {
+ public:
+  virtual ~AsyncReader() {}
+
+  // Starts reading req->len bytes at req->offset of fd into req->scratch.
+  // req and fname must stay alive until Poll() has reported req complete;
+  // fname names the file in error messages.
+  virtual void Submit(int fd, const std::string* fname, ReadRequest* req) = 0;
+
+  // Waits until at least min_completions of the submitted reads are
+  // complete, and returns how many completed since the last call, which
+  // set req->result and req->status. A read stops short at the end of the
+  // file only.
+  virtual size_t Poll(size_t min_completions) = 0;
+
+  // Returns an idle io_uring reader, creating one if there is none, or a
+  // new reader on pool where io_uring is missing
+  static AsyncReader* Acquire(ReadThreadPool* pool);
+
+  // Takes back reader, with no read in flight. A few io_uring readers are
+  // kept for Acquire(); the others are deleted.
+  static void Release(AsyncReader* reader);
+
+ protected:
+  // Whether Release() may keep the reader rather than delete it
+  virtual bool Reusable() const { return false; }
+};
+
+// Returns nullptr if the kernel does not support io_uring
+extern AsyncReader* NewIoUringReader();
+
+extern AsyncReader* NewThreadPoolReader(ReadThreadPool* pool);
+
+}  // namespace rocksdb
+
+#endif  // ROCKSDB_PLATFORM_POSIX
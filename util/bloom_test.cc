@@ -23,6 +23,7 @@ int main() {
 #include "util/testharness.h"
 #include "util/testutil.h"
 #include "util/arena.h"
+#include "util/random.h"
 
 using GFLAGS::ParseCommandLineFlags;
 
@@ -32,6 +33,14 @@ namespace rocksdb {
 
 static const int kVerbose = 1;
 
+// Defined in util/bloom.cc
+bool BlockedBloomBlockMayMatchScalar(uint32_t h, const char* block);
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    !defined(IOS_CROSS_COMPILE)
+#define ROCKSDB_BLOCKED_BLOOM_AVX2
+bool BlockedBloomBlockMayMatchAVX2(uint32_t h, const char* block);
+#endif
+
 static Slice Key(int i, char* buffer) {
   memcpy(buffer, &i, sizeof(i));
   return Slice(buffer, sizeof(i));
@@ -189,6 +198,12 @@ class FullBloomTest : public testing::Test {
     Reset();
   }
 
+  explicit FullBloomTest(const FilterPolicy* policy) :
+      policy_(policy),
+      filter_size_(0) {
+    Reset();
+  }
+
   ~FullBloomTest() {
     delete policy_;
   }
@@ -221,6 +236,13 @@ class FullBloomTest : public testing::Test {
     return bits_reader_->MayMatch(s);
   }
 
+  void MatchesBatch(int n, const Slice* keys, bool* may_match) {
+    if (bits_reader_ == nullptr) {
+      Build();
+    }
+    bits_reader_->KeysMayMatch(n, keys, may_match);
+  }
+
   double FalsePositiveRate() {
     char buffer[sizeof(int)];
     int result = 0;
@@ -231,6 +253,60 @@ class FullBloomTest : public testing::Test {
     }
     return result / 10000.0;
   }
+
+  // Switches to "policy" for the filters built from now on
+  void ResetPolicy(const FilterPolicy* policy) {
+    delete policy_;
+    policy_ = policy;
+    Reset();
+  }
+
+  // Builds filters of many lengths with "policy" and checks that they take
+  // at most "overhead" bytes more than 10 bits per key and keep the false
+  // positive rate down
+  void VaryingLengths(const FilterPolicy* policy, size_t overhead) {
+    ResetPolicy(policy);
+    char buffer[sizeof(int)];
+
+    // Count number of filters that significantly exceed the false positive
+    // rate
+    int mediocre_filters = 0;
+    int good_filters = 0;
+
+    for (int length = 1; length <= 10000; length = NextLength(length)) {
+      Reset();
+      for (int i = 0; i < length; i++) {
+        Add(Key(i, buffer));
+      }
+      Build();
+
+      ASSERT_LE(FilterSize(), (size_t)((length * 10 / 8) + overhead)) << length;
+
+      // All added keys must match
+      for (int i = 0; i < length; i++) {
+        ASSERT_TRUE(Matches(Key(i, buffer)))
+            << "Length " << length << "; key " << i;
+      }
+
+      // Check false positive rate
+      double rate = FalsePositiveRate();
+      if (kVerbose >= 1) {
+        fprintf(stderr,
+                "False positives: %5.2f%% @ length = %6d ; bytes = %6d\n",
+                rate*100.0, length, static_cast<int>(FilterSize()));
+      }
+      ASSERT_LE(rate, 0.02);   // Must not be over 2%
+      if (rate > 0.0125)
+        mediocre_filters++;  // Allowed, but not too often
+      else
+        good_filters++;
+    }
+    if (kVerbose >= 1) {
+      fprintf(stderr, "Filters: %d good, %d mediocre\n",
+              good_filters, mediocre_filters);
+    }
+    ASSERT_LE(mediocre_filters, good_filters/5);
+  }
 };
 
 TEST_F(FullBloomTest, FullEmptyFilter) {
@@ -249,20 +325,124 @@ TEST_F(FullBloomTest, FullSmall) {
 }
 
 TEST_F(FullBloomTest, FullVaryingLengths) {
+  VaryingLengths(NewBloomFilterPolicy(FLAGS_bits_per_key, false), 128 + 5);
+}
+
+class BlockedBloomTest : public FullBloomTest {
+ public:
+  BlockedBloomTest()
+      : FullBloomTest(NewBlockedBloomFilterPolicy(FLAGS_bits_per_key)) {}
+};
+
+TEST_F(BlockedBloomTest, BlockedEmptyFilter) {
+  ASSERT_TRUE(!Matches("hello"));
+  ASSERT_TRUE(!Matches("world"));
+}
+
+TEST_F(BlockedBloomTest, BlockedSmall) {
+  Add("hello");
+  Add("world");
+  ASSERT_TRUE(Matches("hello"));
+  ASSERT_TRUE(Matches("world"));
+  ASSERT_TRUE(!Matches("x"));
+  ASSERT_TRUE(!Matches("foo"));
+}
+
+TEST_F(BlockedBloomTest, BlockedVaryingLengths) {
+  VaryingLengths(NewBlockedBloomFilterPolicy(FLAGS_bits_per_key), 32 + 5);
+}
+
+TEST_F(BlockedBloomTest, BlockedBatch) {
+  const int kNumKeys = 1000;
   char buffer[sizeof(int)];
+  for (int i = 0; i < kNumKeys; i++) {
+    Add(Key(i * 2, buffer));
+  }
+  Build();
 
-  // Count number of filters that significantly exceed the false positive rate
-  int mediocre_filters = 0;
-  int good_filters = 0;
+  // A batch gives the same answers as the keys one by one
+  std::vector<std::string> storage;
+  for (int i = 0; i < kNumKeys * 2; i++) {
+    storage.push_back(Key(i, buffer).ToString());
+  }
+  std::vector<Slice> keys(storage.begin(), storage.end());
+  std::unique_ptr<bool[]> may_match(new bool[keys.size()]);
+  MatchesBatch(static_cast<int>(keys.size()), keys.data(), may_match.get());
+  for (size_t i = 0; i < keys.size(); i++) {
+    ASSERT_EQ(Matches(keys[i]), may_match[i]) << i;
+    if (i % 2 == 0) {
+      ASSERT_TRUE(may_match[i]) << i;
+    }
+  }
+}
+
+#ifdef ROCKSDB_BLOCKED_BLOOM_AVX2
+TEST_F(BlockedBloomTest, BlockedScalarMatchesAVX2) {
+  __builtin_cpu_init();
+  if (!__builtin_cpu_supports("avx2")) {
+    fprintf(stderr, "Skipped, the CPU has no AVX2\n");
+    return;
+  }
+
+  Random rnd(301);
+  char block[32];
+  int matches = 0;
+  int misses = 0;
+  for (int i = 0; i < 20000; i++) {
+    // With 7 bits in 8 set, about a third of the probes match
+    for (size_t j = 0; j < sizeof(block); j++) {
+      block[j] = static_cast<char>(rnd.Next() | rnd.Next() | rnd.Next());
+    }
+    for (int k = 0; k < 4; k++) {
+      uint32_t h = rnd.Next() ^ (rnd.Next() << 16);
+      bool may_match = BlockedBloomBlockMayMatchScalar(h, block);
+      ASSERT_EQ(may_match, BlockedBloomBlockMayMatchAVX2(h, block)) << h;
+      if (may_match) {
+        matches++;
+      } else {
+        misses++;
+      }
+    }
+  }
+  ASSERT_GT(matches, 0);
+  ASSERT_GT(misses, 0);
+}
+#endif
+
+class XorFilterTest : public FullBloomTest {
+ public:
+  XorFilterTest() : FullBloomTest(NewXorFilterPolicy()) {}
+};
+
+TEST_F(XorFilterTest, XorEmptyFilter) {
+  ASSERT_TRUE(!Matches("hello"));
+  ASSERT_TRUE(!Matches("world"));
+}
+
+TEST_F(XorFilterTest, XorSmall) {
+  Add("hello");
+  Add("world");
+  ASSERT_TRUE(Matches("hello"));
+  ASSERT_TRUE(Matches("world"));
+  ASSERT_TRUE(!Matches("x"));
+  ASSERT_TRUE(!Matches("foo"));
+}
+
+TEST_F(XorFilterTest, XorVaryingLengths) {
+  char buffer[sizeof(int)];
 
   for (int length = 1; length <= 10000; length = NextLength(length)) {
     Reset();
     for (int i = 0; i < length; i++) {
       Add(Key(i, buffer));
+      // Duplicated keys, not always adjacent, are filtered once
+      if (i % 7 == 0) {
+        Add(Key(i / 2, buffer));
+      }
     }
     Build();
 
-    ASSERT_LE(FilterSize(), (size_t)((length * 10 / 8) + 128 + 5)) << length;
+    ASSERT_LE(FilterSize(), (size_t)(length * 1.23 + 32 + 3 + 13)) << length;
 
     // All added keys must match
     for (int i = 0; i < length; i++) {
@@ -276,17 +456,77 @@ TEST_F(FullBloomTest, FullVaryingLengths) {
       fprintf(stderr, "False positives: %5.2f%% @ length = %6d ; bytes = %6d\n",
               rate*100.0, length, static_cast<int>(FilterSize()));
     }
-    ASSERT_LE(rate, 0.02);   // Must not be over 2%
-    if (rate > 0.0125)
-      mediocre_filters++;  // Allowed, but not too often
-    else
-      good_filters++;
+    ASSERT_LE(rate, 0.01);   // Must not be over 1%
   }
-  if (kVerbose >= 1) {
-    fprintf(stderr, "Filters: %d good, %d mediocre\n",
-            good_filters, mediocre_filters);
+}
+
+TEST_F(XorFilterTest, XorBatch) {
+  const int kNumKeys = 1000;
+  char buffer[sizeof(int)];
+  for (int i = 0; i < kNumKeys; i++) {
+    Add(Key(i * 2, buffer));
+  }
+  Build();
+
+  // A batch gives the same answers as the keys one by one
+  std::vector<std::string> storage;
+  for (int i = 0; i < kNumKeys * 2; i++) {
+    storage.push_back(Key(i, buffer).ToString());
+  }
+  std::vector<Slice> keys(storage.begin(), storage.end());
+  std::unique_ptr<bool[]> may_match(new bool[keys.size()]);
+  MatchesBatch(static_cast<int>(keys.size()), keys.data(), may_match.get());
+  for (size_t i = 0; i < keys.size(); i++) {
+    ASSERT_EQ(Matches(keys[i]), may_match[i]) << i;
+    if (i % 2 == 0) {
+      ASSERT_TRUE(may_match[i]) << i;
+    }
+  }
+}
+
+TEST_F(XorFilterTest, XorReadsBloomFilters) {
+  std::unique_ptr<const FilterPolicy> bloom(NewBloomFilterPolicy(10, false));
+  std::unique_ptr<const FilterPolicy> xor_filter(NewXorFilterPolicy());
+  ASSERT_TRUE(xor_filter->CanReadFiltersOf(bloom->Name()));
+  ASSERT_TRUE(!bloom->CanReadFiltersOf(xor_filter->Name()));
+
+  char buffer[sizeof(int)];
+  std::vector<std::string> storage;
+  for (int i = 0; i < 1000; i++) {
+    storage.push_back(Key(i, buffer).ToString());
+  }
+  std::vector<Slice> keys(storage.begin(), storage.end());
+
+  // Full filter
+  std::unique_ptr<FilterBitsBuilder> builder(bloom->GetFilterBitsBuilder());
+  for (const auto& key : keys) {
+    builder->AddKey(key);
+  }
+  std::unique_ptr<const char[]> buf;
+  Slice filter = builder->Finish(&buf);
+  std::unique_ptr<FilterBitsReader> bloom_reader(
+      bloom->GetFilterBitsReader(filter));
+  std::unique_ptr<FilterBitsReader> xor_reader(
+      xor_filter->GetFilterBitsReader(filter));
+  int false_positives = 0;
+  for (int i = 0; i < 10000; i++) {
+    Slice key = Key(i, buffer);
+    ASSERT_EQ(bloom_reader->MayMatch(key), xor_reader->MayMatch(key)) << i;
+    if (i >= 1000 && xor_reader->MayMatch(key)) {
+      false_positives++;
+    }
+  }
+  ASSERT_LE(false_positives, 9000 * 2 / 100);
+
+  // Block based filter
+  std::string block_filter;
+  bloom->CreateFilter(keys.data(), static_cast<int>(keys.size()),
+                      &block_filter);
+  for (int i = 0; i < 10000; i++) {
+    Slice key = Key(i, buffer);
+    ASSERT_EQ(bloom->KeyMayMatch(key, block_filter),
+              xor_filter->KeyMayMatch(key, block_filter)) << i;
   }
-  ASSERT_LE(mediocre_filters, good_filters/5);
 }
 
 }  // namespace rocksdb
@@ -0,0 +1,4 @@
+#include "build_version.h"
+const char* rocksdb_build_git_sha = "rocksdb_build_git_sha:ab4c402dec3588c8fa0ace5c5d7f259968edc604";
+const char* rocksdb_build_git_date = "rocksdb_build_git_date:2026-10-17";
+const char* rocksdb_build_compile_date = __DATE__;
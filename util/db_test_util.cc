@@ -302,6 +302,9 @@ Options DBTestBase::CurrentOptions(
       options.row_cache = NewLRUCache(1024 * 1024);
       break;
     }
+    case kKeyPrefixSkipList:
+      options.memtable_factory.reset(NewKeyPrefixSkipListRepFactory());
+      break;
 
     default:
       break;
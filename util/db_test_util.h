@@ -421,7 +421,8 @@ class DBTestBase : public testing::Test {
     kFIFOCompaction = 25,
     kOptimizeFiltersForHits = 26,
     kRowCache = 27,
-    kEnd = 28
+    kKeyPrefixSkipList = 28,
+    kEnd = 29
   };
   int option_config_;
 
@@ -54,6 +54,12 @@ class DynamicBloom {
   // Assuming single threaded access to this function.
   void AddHash(uint32_t hash);
 
+  // Multithreaded access to this function is OK
+  void AddConcurrently(const Slice& key);
+
+  // Multithreaded access to this function is OK
+  void AddHashConcurrently(uint32_t hash);
+
   // Multithreaded access to this function is OK
   bool MayContain(const Slice& key) const;
 
@@ -76,6 +82,11 @@ class DynamicBloom {
   bool IsInitialized() const { return kNumBlocks > 0 || kTotalBits > 0; }
 
  private:
+  // or_func(ptr, mask) should effect *ptr |= mask with the appropriate
+  // concurrency safety, working with bytes.
+  template <typename OrFunc>
+  void AddHash(uint32_t hash, const OrFunc& or_func);
+
   uint32_t kTotalBits;
   uint32_t kNumBlocks;
   const uint32_t kNumProbes;
@@ -87,6 +98,28 @@ class DynamicBloom {
 
 inline void DynamicBloom::Add(const Slice& key) { AddHash(hash_func_(key)); }
 
+inline void DynamicBloom::AddConcurrently(const Slice& key) {
+  AddHashConcurrently(hash_func_(key));
+}
+
+inline void DynamicBloom::AddHash(uint32_t hash) {
+  AddHash(hash, [](unsigned char* ptr, uint8_t mask) { *ptr |= mask; });
+}
+
+inline void DynamicBloom::AddHashConcurrently(uint32_t hash) {
+  AddHash(hash, [](unsigned char* ptr, uint8_t mask) {
+    // Happens-before between AddHash and MayContain is handled by
+    // access to versions_->LastSequence(), so all we have to do here is
+    // avoid races (so we don't give the compiler a license to mess up
+    // our code) and not lose bits.  std::memory_order_relaxed is enough
+    // for that.
+    auto atomic_ptr = reinterpret_cast<std::atomic<uint8_t>*>(ptr);
+    if ((mask & atomic_ptr->load(std::memory_order_relaxed)) != mask) {
+      atomic_ptr->fetch_or(mask, std::memory_order_relaxed);
+    }
+  });
+}
+
 inline bool DynamicBloom::MayContain(const Slice& key) const {
   return (MayContainHash(hash_func_(key)));
 }
@@ -127,7 +160,8 @@ inline bool DynamicBloom::MayContainHash(uint32_t h) const {
   return true;
 }
 
-inline void DynamicBloom::AddHash(uint32_t h) {
+template <typename OrFunc>
+inline void DynamicBloom::AddHash(uint32_t h, const OrFunc& or_func) {
   assert(IsInitialized());
   const uint32_t delta = (h >> 17) | (h << 15);  // Rotate right 17 bits
   if (kNumBlocks != 0) {
@@ -136,7 +170,7 @@ inline void DynamicBloom::AddHash(uint32_t h) {
       // Since CACHE_LINE_SIZE is defined as 2^n, this line will be optimized
       // to a simple and operation by compiler.
       const uint32_t bitpos = b + (h % (CACHE_LINE_SIZE * 8));
-      data_[bitpos / 8] |= (1 << (bitpos % 8));
+      or_func(&data_[bitpos / 8], static_cast<uint8_t>(1 << (bitpos % 8)));
       // Rotate h so that we don't reuse the same bytes.
       h = h / (CACHE_LINE_SIZE * 8) +
           (h % (CACHE_LINE_SIZE * 8)) * (0x20000000U / CACHE_LINE_SIZE);
@@ -145,7 +179,7 @@ inline void DynamicBloom::AddHash(uint32_t h) {
   } else {
     for (uint32_t i = 0; i < kNumProbes; ++i) {
       const uint32_t bitpos = h % kTotalBits;
-      data_[bitpos / 8] |= (1 << (bitpos % 8));
+      or_func(&data_[bitpos / 8], static_cast<uint8_t>(1 << (bitpos % 8)));
       h += delta;
     }
   }
@@ -34,6 +34,14 @@ SequentialFile::~SequentialFile() {
 RandomAccessFile::~RandomAccessFile() {
 }
 
+Status RandomAccessFile::MultiRead(ReadRequest* reqs, size_t num_reqs) const {
+  for (size_t i = 0; i < num_reqs; ++i) {
+    reqs[i].status =
+        Read(reqs[i].offset, reqs[i].len, &reqs[i].result, reqs[i].scratch);
+  }
+  return Status::OK();
+}
+
 WritableFile::~WritableFile() {
 }
 
@@ -297,6 +305,15 @@ Status Env::SaveFTL()
     return Status::NotSupported("ftl is not supported");
 }
 
+void Env::SetGarbageCollectionOptions(RateLimiter* rate_limiter, Statistics* statistics)
+{
+}
+
+Status Env::GetDeviceStats(std::string* stats)
+{
+    return Status::NotSupported("device stats are not supported");
+}
+
 EnvOptions Env::OptimizeForLogWrite(const EnvOptions& env_options,
                                     const DBOptions& db_options) const {
   EnvOptions optimized_env_options(env_options);
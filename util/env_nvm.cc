@@ -113,8 +113,13 @@ class NVMEnv : public Env
 
 	    ALLOC_CLASS(nvm_api, nvm());
 	    ALLOC_CLASS(root_dir, nvm_directory("root", 4, nvm_api, nullptr));
+	    ALLOC_CLASS(checkpoint, nvm_checkpoint(ftl_save_location, ftl_journal_location, nvm_api));
 
 	    LoadFtl();
+
+	    gc_scheduled = false;
+
+	    nvm_api->SetGarbageCollectionTrigger(&NVMEnv::ScheduleGarbageCollection, this);
 	}
 
 	virtual ~NVMEnv()
@@ -132,6 +137,7 @@ class NVMEnv : public Env
 	    }
 
 	    delete thread_status_updater_;
+	    delete checkpoint;
 	    delete root_dir;
 	    delete nvm_api;
 	}
@@ -142,28 +148,76 @@ class NVMEnv : public Env
 
 	    nvm_api->GarbageCollection();
 
-	    return Status::OK();
+	    //what this pass moved is only erased by a later pass once a save
+	    //like this one has put the new locations in the FTL
+	    return checkpoint->Save(root_dir);
+	}
+
+	virtual void SetGarbageCollectionOptions(RateLimiter* rate_limiter, Statistics* statistics) override
+	{
+	    nvm_api->SetGarbageCollectionOptions(rate_limiter, statistics);
 	}
 
 	virtual Status SaveFTL() override
 	{
 	    NVM_DEBUG("saving ftl");
 
-	    int fd = open(ftl_save_location, O_RDWR | O_CREAT, S_IWUSR | S_IRUSR);
+	    return checkpoint->Save(root_dir);
+	}
+
+	virtual Status GetDeviceStats(std::string* stats) override
+	{
+	    char buf[200];
+
+	    stats->clear();
+
+#ifdef NVM_ALLOCATE_BLOCKS
+
+	    struct nvm_gc_stats gc_stats;
 
-	    if(fd < 0)
+	    nvm_api->GetGarbageCollectionStats(&gc_stats);
+
+	    //every page the device programs against the pages files asked for
+	    double write_amp = 0.0;
+
+	    if(gc_stats.user_pages_written > 0)
 	    {
-		return Status::IOError("Unable to create save ftl file");
+		write_amp = (double)(gc_stats.user_pages_written + gc_stats.gc_pages_relocated) / gc_stats.user_pages_written;
 	    }
 
-	    if(!root_dir->Save(fd).ok())
+	    snprintf(buf, sizeof(buf), "Pages written: %lu user, %lu relocated by gc, write amplification %.2f\n",
+				       gc_stats.user_pages_written, gc_stats.gc_pages_relocated, write_amp);
+	    stats->append(buf);
+
+	    snprintf(buf, sizeof(buf), "Blocks: %lu erased, %lu free, erase count %lu - %lu\n",
+				       gc_stats.blocks_erased, gc_stats.free_blocks,
+				       gc_stats.min_erase_count, gc_stats.max_erase_count);
+	    stats->append(buf);
+
+#endif
+
+	    unsigned long saves;
+	    unsigned long save_micros;
+
+	    nvm_api->GetFtlSaveStats(&saves, &save_micros);
+
+	    snprintf(buf, sizeof(buf), "FTL saves: %lu, %lu micros, %.1f micros/save\n",
+				       saves, save_micros, saves ? (double)save_micros / saves : 0.0);
+	    stats->append(buf);
+
+	    stats->append("Lun  Submitted  AvgDepth  MaxDepth\n");
+
+	    for(unsigned long i = 0; i < nvm_api->nr_luns; ++i)
 	    {
-		close(fd);
+		nvm_io_queue_stats queue_stats;
 
-		return Status::IOError("Unable to save directory");
-	    }
+		nvm_api->io->GetQueueStats(i, &queue_stats);
 
-	    close(fd);
+		snprintf(buf, sizeof(buf), "%3lu %10lu %9.2f %9lu\n", i, queue_stats.submitted,
+				       queue_stats.submitted ? (double)queue_stats.depth_sum / queue_stats.submitted : 0.0,
+				       queue_stats.max_depth);
+		stats->append(buf);
+	    }
 
 	    return Status::OK();
 	}
@@ -225,6 +279,39 @@ class NVMEnv : public Env
 		return Status::IOError("unable to open file for write");
 	    }
 
+	    switch(options.write_hint)
+	    {
+		case kWriteLifeTimeShort:
+		{
+		    fd->SetPool(NVM_POOL_WAL);
+		}
+		break;
+
+		case kWriteLifeTimeMedium:
+		{
+		    fd->SetPool(NVM_POOL_HOT);
+		}
+		break;
+
+		case kWriteLifeTimeLong:
+		{
+		    fd->SetPool(NVM_POOL_WARM);
+		}
+		break;
+
+		case kWriteLifeTimeExtreme:
+		{
+		    fd->SetPool(NVM_POOL_COLD);
+		}
+		break;
+
+		default:
+		{
+		    //keep the guess made from the file name
+		}
+		break;
+	    }
+
 	    NVMWritableFile *writable_file;
 
 	    ALLOC_CLASS(writable_file, NVMWritableFile(fname, fd, root_dir));
@@ -642,7 +729,10 @@ class NVMEnv : public Env
 
 	nvm_directory *root_dir;
 
+	nvm_checkpoint *checkpoint;
+
 	const char *ftl_save_location = "root_nvm.layout";
+	const char *ftl_journal_location = "root_nvm.journal";
 
 	bool checkedDiskForMmap_;
 	bool forceMmapOff; // do we override Env options?
@@ -665,50 +755,50 @@ class NVMEnv : public Env
 	pthread_mutex_t mu_;
 	std::vector<pthread_t> threads_to_join_;
 
-	void LoadFtl()
-	{
-	    int fd = open(ftl_save_location, O_RDONLY);
+	//set while a gc pass is queued or running on the LOW pool
+	std::atomic<bool> gc_scheduled;
 
-	    char temp;
+	//called by the allocator when free blocks run low
+	static void ScheduleGarbageCollection(void *arg)
+	{
+	    NVMEnv *env = (NVMEnv *)arg;
 
-	    if(fd < 0)
+	    if(env->gc_scheduled.exchange(true) == false)
 	    {
-		NVM_DEBUG("FTL file not found");
-		return;
+		env->Schedule(&NVMEnv::BGGarbageCollection, env, Priority::LOW);
 	    }
+	}
 
-	    if(read(fd, &temp, 1) != 1)
-	    {
-		NVM_DEBUG("FTL file is corrupt");
+	static void BGGarbageCollection(void *arg)
+	{
+	    NVMEnv *env = (NVMEnv *)arg;
 
-		close(fd);
+	    Status s = env->GarbageCollect();
 
-		return;
+	    if(!s.ok())
+	    {
+		NVM_ERROR("gc could not save the ftl: %s", s.ToString().c_str());
 	    }
 
-	    if(temp != 'd')
-	    {
-		NVM_DEBUG("FTL file is corrupt");
+	    env->gc_scheduled = false;
+	}
 
-		close(fd);
+	void LoadFtl()
+	{
+	    Status s = checkpoint->Load(root_dir);
 
+	    if(s.IsNotFound())
+	    {
+		NVM_DEBUG("FTL file not found");
 		return;
 	    }
 
-	    NVM_DEBUG("read d. loading root directory");
-
-	    if(!root_dir->Load(fd).ok())
+	    //starting with an empty tree would lose every file and the next
+	    //save would overwrite the layout
+	    if(!s.ok())
 	    {
-		NVM_DEBUG("FTL file is corrupt");
-
-		delete root_dir;
-		delete nvm_api;
-
-		ALLOC_CLASS(nvm_api, nvm());
-		ALLOC_CLASS(root_dir, nvm_directory("root", 4, nvm_api, nullptr));
+		NVM_FATAL("FTL file is corrupt: %s", s.ToString().c_str());
 	    }
-
-	    close(fd);
 	}
 };
 
@@ -37,6 +37,7 @@
 #include "rocksdb/env.h"
 #include "rocksdb/slice.h"
 #include "port/port.h"
+#include "util/async_read.h"
 #include "util/coding.h"
 #include "util/logging.h"
 #include "util/logger.h"
@@ -201,11 +202,15 @@ class PosixRandomAccessFile: public RandomAccessFile {
   std::string filename_;
   int fd_;
   bool use_os_buffer_;
+  ReadThreadPool* read_pool_;
 
  public:
   PosixRandomAccessFile(const std::string& fname, int fd,
-                        const EnvOptions& options)
-      : filename_(fname), fd_(fd), use_os_buffer_(options.use_os_buffer) {
+                        const EnvOptions& options, ReadThreadPool* read_pool)
+      : filename_(fname),
+        fd_(fd),
+        use_os_buffer_(options.use_os_buffer),
+        read_pool_(read_pool) {
     assert(!options.use_mmap_reads || sizeof(void*) < 8);
   }
   virtual ~PosixRandomAccessFile() { close(fd_); }
@@ -243,6 +248,25 @@ class PosixRandomAccessFile: public RandomAccessFile {
     return s;
   }
 
+  virtual Status MultiRead(ReadRequest* reqs,
+                           size_t num_reqs) const override {
+    if (num_reqs <= 1) {
+      return RandomAccessFile::MultiRead(reqs, num_reqs);
+    }
+    AsyncReader* reader = AsyncReader::Acquire(read_pool_);
+    for (size_t i = 0; i < num_reqs; ++i) {
+      reader->Submit(fd_, &filename_, &reqs[i]);
+    }
+    for (size_t completed = 0; completed < num_reqs;) {
+      completed += reader->Poll(num_reqs - completed);
+    }
+    AsyncReader::Release(reader);
+    if (!use_os_buffer_) {
+      Fadvise(fd_, 0, 0, POSIX_FADV_DONTNEED); // free OS pages
+    }
+    return Status::OK();
+  }
+
 #ifdef OS_LINUX
   virtual size_t GetUniqueId(char* id, size_t max_size) const override {
     return GetUniqueIdFromFile(fd_, id, max_size);
@@ -291,7 +315,9 @@ class PosixMmapReadableFile: public RandomAccessFile {
  private:
   int fd_;
   std::string filename_;
-  void* mmapped_region_;
+  // The mapping is shared with the blocks pinned by ReadPinned(), and
+  // unmapped when the file and all of them are gone
+  std::shared_ptr<const char> mmapped_region_;
   size_t length_;
 
  public:
@@ -299,17 +325,18 @@ class PosixMmapReadableFile: public RandomAccessFile {
   PosixMmapReadableFile(const int fd, const std::string& fname,
                         void* base, size_t length,
                         const EnvOptions& options)
-      : fd_(fd), filename_(fname), mmapped_region_(base), length_(length) {
+      : fd_(fd), filename_(fname), length_(length) {
     fd_ = fd_ + 0;  // suppress the warning for used variables
     assert(options.use_mmap_reads);
     assert(options.use_os_buffer);
-  }
-  virtual ~PosixMmapReadableFile() {
-    int ret = munmap(mmapped_region_, length_);
-    if (ret != 0) {
-      fprintf(stdout, "failed to munmap %p length %" ROCKSDB_PRIszt " \n",
-              mmapped_region_, length_);
-    }
+    mmapped_region_.reset(static_cast<const char*>(base),
+                          [length](const char* region) {
+      int ret = munmap(const_cast<char*>(region), length);
+      if (ret != 0) {
+        fprintf(stdout, "failed to munmap %p length %" ROCKSDB_PRIszt " \n",
+                region, length);
+      }
+    });
   }
 
   virtual Status Read(uint64_t offset, size_t n, Slice* result,
@@ -319,7 +346,20 @@ class PosixMmapReadableFile: public RandomAccessFile {
       *result = Slice();
       s = IOError(filename_, EINVAL);
     } else {
-      *result = Slice(reinterpret_cast<char*>(mmapped_region_) + offset, n);
+      *result = Slice(mmapped_region_.get() + offset, n);
+    }
+    return s;
+  }
+
+  virtual bool SupportsPinnedReads() const override { return true; }
+
+  virtual Status ReadPinned(
+      uint64_t offset, size_t n, Slice* result,
+      std::shared_ptr<const char>* pinned) const override {
+    Status s = Read(offset, n, result, nullptr);
+    if (s.ok()) {
+      // Shares the ownership of the mapping, with no allocation
+      *pinned = std::shared_ptr<const char>(mmapped_region_, result->data());
     }
     return s;
   }
@@ -971,7 +1011,8 @@ class PosixEnv : public Env {
       }
       close(fd);
     } else {
-      result->reset(new PosixRandomAccessFile(fname, fd, options));
+      result->reset(
+          new PosixRandomAccessFile(fname, fd, options, &read_pool_));
     }
     return s;
   }
@@ -1717,6 +1758,9 @@ class PosixEnv : public Env {
 
   std::vector<ThreadPool> thread_pools_;
 
+  // Runs the MultiRead()s of the files of this Env where io_uring is missing
+  ReadThreadPool read_pool_;
+
   pthread_mutex_t mu_;
   std::vector<pthread_t> threads_to_join_;
 
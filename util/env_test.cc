@@ -16,6 +16,8 @@
 #include <unordered_set>
 #include <atomic>
 #include <list>
+#include <algorithm>
+#include <vector>
 
 #ifdef OS_LINUX
 #include <linux/fs.h>
@@ -29,13 +31,21 @@
 #include <fcntl.h>
 #endif
 
+#ifdef ROCKSDB_PLATFORM_POSIX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #include "rocksdb/env.h"
 #include "port/port.h"
+#include "util/async_read.h"
 #include "util/coding.h"
 #include "util/log_buffer.h"
 #include "util/mutexlock.h"
+#include "util/random.h"
 #include "util/string_util.h"
 #include "util/testharness.h"
+#include "util/testutil.h"
 
 namespace rocksdb {
 
@@ -852,6 +862,137 @@ TEST_F(EnvPosixTest,
   ASSERT_OK(file.get()->Close());
 }
 
+namespace {
+// Random reads of "size" bytes of a file of "file_size" bytes, some of them
+// crossing or starting past its end
+std::vector<ReadRequest> RandomReadRequests(Random* rnd, size_t num_reqs,
+                                            size_t file_size, size_t size,
+                                            std::vector<std::string>* bufs) {
+  std::vector<ReadRequest> reqs(num_reqs);
+  bufs->assign(num_reqs, std::string(size, '\0'));
+  for (size_t i = 0; i < num_reqs; ++i) {
+    reqs[i].offset = rnd->Uniform(static_cast<int>(file_size + size));
+    reqs[i].len = 1 + rnd->Uniform(static_cast<int>(size));
+    reqs[i].scratch = &(*bufs)[i][0];
+  }
+  return reqs;
+}
+}  // namespace
+
+TEST_F(EnvPosixTest, MultiReadMatchesRead) {
+  const EnvOptions soptions;
+  std::string fname = test::TmpDir() + "/" + "testfile";
+  const size_t kFileSize = 1 << 20;
+  Random rnd(301);
+
+  std::string data;
+  {
+    unique_ptr<WritableFile> wfile;
+    ASSERT_OK(env_->NewWritableFile(fname, &wfile, soptions));
+    test::RandomString(&rnd, kFileSize, &data);
+    ASSERT_OK(wfile->Append(data));
+    ASSERT_OK(wfile->Close());
+  }
+
+  unique_ptr<RandomAccessFile> file;
+  ASSERT_OK(env_->NewRandomAccessFile(fname, &file, soptions));
+  for (size_t num_reqs : {1, 2, 100, 1000}) {
+    std::vector<std::string> bufs;
+    std::vector<ReadRequest> reqs =
+        RandomReadRequests(&rnd, num_reqs, kFileSize, 8192, &bufs);
+    ASSERT_OK(file->MultiRead(reqs.data(), reqs.size()));
+    for (auto& req : reqs) {
+      ASSERT_OK(req.status);
+      ASSERT_EQ(req.result.ToString(),
+                data.substr(std::min<size_t>(req.offset, kFileSize), req.len));
+    }
+  }
+
+#ifdef ROCKSDB_PLATFORM_POSIX
+  // Both asynchronous readers, whichever MultiRead() picked above
+  int fd = open(fname.c_str(), O_RDONLY);
+  ASSERT_GE(fd, 0);
+  ReadThreadPool pool;
+  std::vector<AsyncReader*> readers = {NewThreadPoolReader(&pool),
+                                       NewIoUringReader()};
+  for (AsyncReader* reader : readers) {
+    if (reader == nullptr) {
+      continue;  // no io_uring
+    }
+    std::vector<std::string> bufs;
+    std::vector<ReadRequest> reqs =
+        RandomReadRequests(&rnd, 1000, kFileSize, 8192, &bufs);
+    for (auto& req : reqs) {
+      reader->Submit(fd, &fname, &req);
+    }
+    size_t completed = 0;
+    while (completed < reqs.size()) {
+      completed += reader->Poll(1);
+    }
+    ASSERT_EQ(reqs.size(), completed);
+    for (auto& req : reqs) {
+      ASSERT_OK(req.status);
+      ASSERT_EQ(req.result.ToString(),
+                data.substr(std::min<size_t>(req.offset, kFileSize), req.len));
+    }
+    delete reader;
+  }
+
+  close(fd);
+
+  // Reads of a bad file descriptor fail
+  AsyncReader* reader = NewThreadPoolReader(&pool);
+  ReadRequest req;
+  char scratch[16];
+  req.offset = 0;
+  req.len = sizeof(scratch);
+  req.scratch = scratch;
+  reader->Submit(-1, &fname, &req);
+  ASSERT_EQ(1U, reader->Poll(1));
+  ASSERT_TRUE(req.status.IsIOError());
+  delete reader;
+#endif  // ROCKSDB_PLATFORM_POSIX
+
+  ASSERT_OK(env_->DeleteFile(fname));
+}
+
+TEST_F(EnvPosixTest, PinnedReadsOutliveFile) {
+  EnvOptions soptions;
+  soptions.use_mmap_reads = true;
+  std::string fname = test::TmpDir() + "/" + "testfile";
+  Random rnd(301);
+
+  std::string data;
+  {
+    unique_ptr<WritableFile> wfile;
+    ASSERT_OK(env_->NewWritableFile(fname, &wfile, soptions));
+    test::RandomString(&rnd, 1 << 16, &data);
+    ASSERT_OK(wfile->Append(data));
+    ASSERT_OK(wfile->Close());
+  }
+
+  unique_ptr<RandomAccessFile> file;
+  ASSERT_OK(env_->NewRandomAccessFile(fname, &file, soptions));
+  if (!file->SupportsPinnedReads()) {
+    // This Env does not map files
+    ASSERT_OK(env_->DeleteFile(fname));
+    return;
+  }
+
+  Slice result;
+  std::shared_ptr<const char> pinned;
+  ASSERT_OK(file->ReadPinned(1000, 5000, &result, &pinned));
+  ASSERT_EQ(result.data(), pinned.get());
+  ASSERT_TRUE(file->ReadPinned(60000, 10000, &result, &pinned).IsIOError());
+  ASSERT_OK(file->ReadPinned(1000, 5000, &result, &pinned));
+
+  // The data stays readable once the file is closed and deleted
+  file.reset();
+  ASSERT_OK(env_->DeleteFile(fname));
+  ASSERT_EQ(result.ToString(), data.substr(1000, 5000));
+  pinned.reset();
+}
+
 class TestLogger : public Logger {
  public:
   using Logger::Logv;
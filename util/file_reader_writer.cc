@@ -33,6 +33,25 @@ Status RandomAccessFileReader::Read(uint64_t offset, size_t n, Slice* result,
   return s;
 }
 
+Status RandomAccessFileReader::MultiRead(ReadRequest* reqs,
+                                         size_t num_reqs) const {
+  IOSTATS_TIMER_GUARD(read_nanos);
+  Status s = file_->MultiRead(reqs, num_reqs);
+  for (size_t i = 0; i < num_reqs; ++i) {
+    IOSTATS_ADD_IF_POSITIVE(bytes_read, reqs[i].result.size());
+  }
+  return s;
+}
+
+Status RandomAccessFileReader::ReadPinned(
+    uint64_t offset, size_t n, Slice* result,
+    std::shared_ptr<const char>* pinned) const {
+  IOSTATS_TIMER_GUARD(read_nanos);
+  Status s = file_->ReadPinned(offset, n, result, pinned);
+  IOSTATS_ADD_IF_POSITIVE(bytes_read, result->size());
+  return s;
+}
+
 Status WritableFileWriter::Append(const Slice& data) {
   const char* src = data.data();
   size_t left = data.size();
@@ -34,6 +34,13 @@ class RandomAccessFileReader : public RandomAccessFile {
 
   Status Read(uint64_t offset, size_t n, Slice* result, char* scratch) const;
 
+  Status MultiRead(ReadRequest* reqs, size_t num_reqs) const;
+
+  bool SupportsPinnedReads() const { return file_->SupportsPinnedReads(); }
+
+  Status ReadPinned(uint64_t offset, size_t n, Slice* result,
+                    std::shared_ptr<const char>* pinned) const;
+
   RandomAccessFile* file() { return file_.get(); }
 };
 
@@ -76,6 +83,8 @@ class WritableFileWriter {
 
   uint64_t GetFileSize() { return filesize_; }
 
+  size_t GetSyncAlignment() { return writable_file_->GetSyncAlignment(); }
+
   Status InvalidateCache(size_t offset, size_t length) {
     return writable_file_->InvalidateCache(offset, length);
   }
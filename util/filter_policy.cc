@@ -9,8 +9,17 @@
 
 #include "rocksdb/filter_policy.h"
 
+#include "rocksdb/slice.h"
+
 namespace rocksdb {
 
+void FilterBitsReader::KeysMayMatch(int num_keys, const Slice* keys,
+                                    bool* may_match) {
+  for (int i = 0; i < num_keys; ++i) {
+    may_match[i] = MayMatch(keys[i]);
+  }
+}
+
 FilterPolicy::~FilterPolicy() { }
 
 }  // namespace rocksdb
@@ -27,6 +27,9 @@ void IOStatsContext::Reset() {
   read_nanos = 0;
   range_sync_nanos = 0;
   logger_nanos = 0;
+  nvm_pages_written = 0;
+  nvm_pages_read = 0;
+  nvm_ftl_save_nanos = 0;
 }
 
 #define OUTPUT(counter) #counter << " = " << counter << ", "
@@ -41,7 +44,10 @@ std::string IOStatsContext::ToString() const {
      << OUTPUT(write_nanos)
      << OUTPUT(read_nanos)
      << OUTPUT(range_sync_nanos)
-     << OUTPUT(logger_nanos);
+     << OUTPUT(logger_nanos)
+     << OUTPUT(nvm_pages_written)
+     << OUTPUT(nvm_pages_read)
+     << OUTPUT(nvm_ftl_save_nanos);
 
   return ss.str();
 }
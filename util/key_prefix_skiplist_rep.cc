@@ -0,0 +1,171 @@
+//  Copyright (c) 2013, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+//
+
+#ifndef ROCKSDB_LITE
+#include "util/key_prefix_skiplist_rep.h"
+
+#include "db/memtable.h"
+#include "db/skiplist.h"
+#include "util/arena.h"
+
+namespace rocksdb {
+namespace {
+
+// An entry of the list: the encoded memtable entry together with its
+// KeyComparator::KeyPrefix(). The list stores keys by value in its nodes,
+// so the number sits right before the links of the node.
+struct PrefixedKey {
+  uint64_t prefix;
+  const char* key;
+};
+
+// Orders PrefixedKeys by their numbers and, only where those are equal, by
+// the entries they point to.
+class PrefixedKeyComparator {
+ public:
+  explicit PrefixedKeyComparator(const MemTableRep::KeyComparator& compare)
+      : compare_(compare) {}
+
+  int operator()(const PrefixedKey& a, const PrefixedKey& b) const {
+    if (a.prefix != b.prefix) {
+      return a.prefix < b.prefix ? -1 : 1;
+    }
+    return compare_(a.key, b.key);
+  }
+
+  PrefixedKey Prefixed(const char* key) const {
+    PrefixedKey prefixed;
+    prefixed.prefix = compare_.KeyPrefix(key);
+    prefixed.key = key;
+    return prefixed;
+  }
+
+ private:
+  const MemTableRep::KeyComparator& compare_;
+};
+
+class KeyPrefixSkipListRep : public MemTableRep {
+  typedef SkipList<PrefixedKey, const PrefixedKeyComparator&> List;
+
+  const PrefixedKeyComparator cmp_;
+  List skip_list_;
+
+ public:
+  explicit KeyPrefixSkipListRep(const MemTableRep::KeyComparator& compare,
+                                MemTableAllocator* allocator)
+      : MemTableRep(allocator), cmp_(compare), skip_list_(cmp_, allocator) {}
+
+  // Insert key into the list.
+  // REQUIRES: nothing that compares equal to key is currently in the list.
+  virtual void Insert(KeyHandle handle) override {
+    skip_list_.Insert(cmp_.Prefixed(static_cast<char*>(handle)));
+  }
+
+  virtual void InsertConcurrently(KeyHandle handle) override {
+    skip_list_.InsertConcurrently(cmp_.Prefixed(static_cast<char*>(handle)));
+  }
+
+  // Returns true iff an entry that compares equal to key is in the list.
+  virtual bool Contains(const char* key) const override {
+    return skip_list_.Contains(cmp_.Prefixed(key));
+  }
+
+  virtual size_t ApproximateMemoryUsage() override {
+    // All memory is allocated through allocator; nothing to report here
+    return 0;
+  }
+
+  virtual void Get(const LookupKey& k, void* callback_args,
+                   bool (*callback_func)(void* arg,
+                                         const char* entry)) override {
+    List::Iterator iter(&skip_list_);
+    for (iter.Seek(cmp_.Prefixed(k.memtable_key().data()));
+         iter.Valid() && callback_func(callback_args, iter.key().key);
+         iter.Next()) {
+    }
+  }
+
+  uint64_t ApproximateNumEntries(const Slice& start_ikey,
+                                 const Slice& end_ikey) override {
+    std::string tmp;
+    uint64_t start_count =
+        skip_list_.EstimateCount(cmp_.Prefixed(EncodeKey(&tmp, start_ikey)));
+    uint64_t end_count =
+        skip_list_.EstimateCount(cmp_.Prefixed(EncodeKey(&tmp, end_ikey)));
+    return (end_count >= start_count) ? (end_count - start_count) : 0;
+  }
+
+  virtual ~KeyPrefixSkipListRep() override {}
+
+  // Iteration over the contents of the list
+  class Iterator : public MemTableRep::Iterator {
+    List::Iterator iter_;
+    const PrefixedKeyComparator& cmp_;
+    std::string tmp_;  // For passing to EncodeKey
+
+   public:
+    // Initialize an iterator over the specified list.
+    // The returned iterator is not valid.
+    Iterator(const List* list, const PrefixedKeyComparator& cmp)
+        : iter_(list), cmp_(cmp) {}
+
+    virtual ~Iterator() override {}
+
+    // Returns true iff the iterator is positioned at a valid node.
+    virtual bool Valid() const override { return iter_.Valid(); }
+
+    // Returns the key at the current position.
+    // REQUIRES: Valid()
+    virtual const char* key() const override { return iter_.key().key; }
+
+    // Advances to the next position.
+    // REQUIRES: Valid()
+    virtual void Next() override { iter_.Next(); }
+
+    // Advances to the previous position.
+    // REQUIRES: Valid()
+    virtual void Prev() override { iter_.Prev(); }
+
+    // Advance to the first entry with a key >= target
+    virtual void Seek(const Slice& user_key,
+                      const char* memtable_key) override {
+      if (memtable_key != nullptr) {
+        iter_.Seek(cmp_.Prefixed(memtable_key));
+      } else {
+        iter_.Seek(cmp_.Prefixed(EncodeKey(&tmp_, user_key)));
+      }
+    }
+
+    // Position at the first entry in list.
+    // Final state of iterator is Valid() iff list is not empty.
+    virtual void SeekToFirst() override { iter_.SeekToFirst(); }
+
+    // Position at the last entry in list.
+    // Final state of iterator is Valid() iff list is not empty.
+    virtual void SeekToLast() override { iter_.SeekToLast(); }
+  };
+
+  virtual MemTableRep::Iterator* GetIterator(Arena* arena = nullptr) override {
+    void* mem = arena ? arena->AllocateAligned(sizeof(Iterator))
+                      : operator new(sizeof(Iterator));
+    return new (mem) Iterator(&skip_list_, cmp_);
+  }
+};
+
+}  // namespace
+
+MemTableRep* KeyPrefixSkipListRepFactory::CreateMemTableRep(
+    const MemTableRep::KeyComparator& compare, MemTableAllocator* allocator,
+    const SliceTransform* transform, Logger* logger) {
+  return new KeyPrefixSkipListRep(compare, allocator);
+}
+
+MemTableRepFactory* NewKeyPrefixSkipListRepFactory() {
+  return new KeyPrefixSkipListRepFactory();
+}
+
+}  // namespace rocksdb
+#endif  // ROCKSDB_LITE
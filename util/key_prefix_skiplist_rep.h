@@ -0,0 +1,31 @@
+//  Copyright (c) 2013, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+//
+
+#ifndef ROCKSDB_LITE
+#pragma once
+#include "rocksdb/memtablerep.h"
+
+namespace rocksdb {
+
+class KeyPrefixSkipListRepFactory : public MemTableRepFactory {
+ public:
+  KeyPrefixSkipListRepFactory() {}
+
+  virtual ~KeyPrefixSkipListRepFactory() {}
+
+  virtual MemTableRep* CreateMemTableRep(
+      const MemTableRep::KeyComparator& compare, MemTableAllocator* allocator,
+      const SliceTransform* transform, Logger* logger) override;
+
+  virtual const char* Name() const override {
+    return "KeyPrefixSkipListRepFactory";
+  }
+
+  virtual bool IsInsertConcurrentlySupported() const override { return true; }
+};
+
+}  // namespace rocksdb
+#endif  // ROCKSDB_LITE
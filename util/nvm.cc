@@ -103,212 +103,1179 @@ nvm_entry_type nvm_entry::GetType()
 
 nvm::nvm()
 {
-    fd = open_nvm_device("/rocksdb");
+    const char *emulator_config = getenv(NVM_EMULATOR_ENV);
 
-    if(fd < 0)
+    if(emulator_config)
+    {
+	nvm_emulator_options options;
+
+	if(options.Parse(emulator_config) == false)
+	{
+	    NVM_FATAL("invalid %s: %s", NVM_EMULATOR_ENV, emulator_config);
+	}
+
+	ALLOC_CLASS(dev, nvm_emulated_device(options));
+    }
+    else
+    {
+	ALLOC_CLASS(dev, nvm_lightnvm_device("/rocksdb"));
+    }
+
+    if(dev->Open())
+    {
+	NVM_FATAL("");
+    }
+
+    Initialize();
+}
+
+nvm::nvm(nvm_device *_dev)
+{
+    dev = _dev;
+
+    Initialize();
+}
+
+void nvm::Initialize()
+{
+#ifdef NVM_ALLOCATE_BLOCKS
+
+    next_lun_affinity = 0;
+
+    nr_blocks = 0;
+    nr_free_blocks = 0;
+
+    write_clock = 0;
+
+    user_pages_written = 0;
+    gc_pages_relocated = 0;
+    blocks_erased = 0;
+
+#else
+
+    next_page.lun_id = 0;
+    next_page.block_id = 0;
+    next_page.page_id = 0;
+
+    gc_block = nullptr;
+
+#endif
+
+    if(ioctl_initialize())
     {
 	NVM_FATAL("");
     }
 
-#ifdef NVM_ALLOCATE_BLOCKS
+    ALLOC_CLASS(io, nvm_io_scheduler(dev, nr_luns, NVM_IO_THREADS_PER_LUN));
+
+#ifdef NVM_ALLOCATE_BLOCKS
+
+    AssignPoolLuns();
+
+#endif
+
+    pthread_mutexattr_init(&allocate_page_mtx_attr);
+    pthread_mutexattr_settype(&allocate_page_mtx_attr, PTHREAD_MUTEX_RECURSIVE);
+
+    pthread_mutex_init(&allocate_page_mtx, &allocate_page_mtx_attr);
+
+    gc_trigger = nullptr;
+    gc_trigger_arg = nullptr;
+
+    gc_rate_limiter = nullptr;
+    gc_statistics = nullptr;
+
+    pthread_mutex_init(&gc_mtx, nullptr);
+
+    gc_passes = 0;
+    gc_passes_saved = 0;
+
+    next_file_id = 1;
+
+    directories_changed = false;
+
+    directory_generation = 0;
+
+    pthread_mutex_init(&metadata_mtx, nullptr);
+
+    ftl_saves = 0;
+    ftl_save_micros = 0;
+}
+
+nvm::~nvm()
+{
+    unsigned long i;
+    unsigned long j;
+
+    delete io;
+
+    dev->Close();
+
+    delete dev;
+
+    if(nr_luns > 0)
+    {
+	for(i = 0; i < nr_luns; ++i)
+	{
+	    for(j = 0; j < luns[i].nr_blocks; ++j)
+	    {
+		free(luns[i].blocks[j].block);
+		free(luns[i].blocks[j].pages);
+	    }
+
+#ifdef NVM_ALLOCATE_BLOCKS
+
+	    pthread_mutex_destroy(&luns[i].alloc_mtx);
+
+#endif
+
+	    free(luns[i].blocks);
+	    free(luns[i].channels);
+	}
+	free(luns);
+    }
+
+#ifndef NVM_ALLOCATE_BLOCKS
+
+    for(i = 0; i < allocated_pages.size(); ++i)
+    {
+	free(allocated_pages[i]);
+    }
+
+    allocated_pages.clear();
+
+#endif
+
+    pthread_mutexattr_destroy(&allocate_page_mtx_attr);
+    pthread_mutex_destroy(&allocate_page_mtx);
+    pthread_mutex_destroy(&metadata_mtx);
+    pthread_mutex_destroy(&gc_mtx);
+
+    NVM_DEBUG("api closed");
+}
+
+unsigned long nvm::NewFileId()
+{
+    unsigned long ret;
+
+    pthread_mutex_lock(&metadata_mtx);
+
+    ret = next_file_id++;
+
+    pthread_mutex_unlock(&metadata_mtx);
+
+    return ret;
+}
+
+unsigned long nvm::GetNextFileId()
+{
+    unsigned long ret;
+
+    pthread_mutex_lock(&metadata_mtx);
+
+    ret = next_file_id;
+
+    pthread_mutex_unlock(&metadata_mtx);
+
+    return ret;
+}
+
+void nvm::SetNextFileId(const unsigned long file_id)
+{
+    pthread_mutex_lock(&metadata_mtx);
+
+    next_file_id = file_id;
+
+    pthread_mutex_unlock(&metadata_mtx);
+}
+
+void nvm::FileDeleted(const unsigned long file_id)
+{
+    pthread_mutex_lock(&metadata_mtx);
+
+    deleted_files.push_back(file_id);
+
+    pthread_mutex_unlock(&metadata_mtx);
+}
+
+void nvm::DirectoriesChanged()
+{
+    pthread_mutex_lock(&metadata_mtx);
+
+    directories_changed = true;
+
+    ++directory_generation;
+
+    pthread_mutex_unlock(&metadata_mtx);
+}
+
+unsigned long nvm::GetDirectoryGeneration()
+{
+    return directory_generation.load(std::memory_order_acquire);
+}
+
+bool nvm::TakeMetadataChanges(std::vector<unsigned long> *_deleted_files)
+{
+    bool ret;
+
+    pthread_mutex_lock(&metadata_mtx);
+
+    _deleted_files->swap(deleted_files);
+    deleted_files.clear();
+
+    ret = directories_changed;
+
+    directories_changed = false;
+
+    pthread_mutex_unlock(&metadata_mtx);
+
+    return ret;
+}
+
+void nvm::FtlSaved(const unsigned long micros)
+{
+    ++ftl_saves;
+    ftl_save_micros += micros;
+
+    rocksdb::Statistics *statistics = gc_statistics.load();
+
+    rocksdb::RecordTick(statistics, rocksdb::NVM_FTL_SAVES);
+    rocksdb::RecordTick(statistics, rocksdb::NVM_FTL_SAVE_MICROS, micros);
+}
+
+void nvm::GetFtlSaveStats(unsigned long *saves, unsigned long *micros)
+{
+    *saves = ftl_saves;
+    *micros = ftl_save_micros;
+}
+
+unsigned long nvm::GetGarbageCollectionPasses()
+{
+    return gc_passes;
+}
+
+void nvm::GarbageCollectionSaved(const unsigned long passes)
+{
+    //saves are serialized by the checkpoint, so passes only grows
+    gc_passes_saved = passes;
+}
+
+void nvm::PinBlock(const struct nvm_page *page)
+{
+    luns[page->lun_id].blocks[page->block_id].nr_readers.fetch_add(1, std::memory_order_relaxed);
+
+    //pairs with the fence in GarbageCollection(): either the gc sees this
+    //reader or the reader sees the entry the gc replaced
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void nvm::UnpinBlock(const struct nvm_page *page)
+{
+    luns[page->lun_id].blocks[page->block_id].nr_readers.fetch_sub(1, std::memory_order_release);
+}
+
+void nvm::SetGarbageCollectionTrigger(void (*trigger)(void *), void *arg)
+{
+    pthread_mutex_lock(&allocate_page_mtx);
+
+    gc_trigger = trigger;
+    gc_trigger_arg = arg;
+
+    pthread_mutex_unlock(&allocate_page_mtx);
+}
+
+void nvm::SetGarbageCollectionOptions(rocksdb::RateLimiter *rate_limiter, rocksdb::Statistics *statistics)
+{
+    //waits for a running pass to be done with the old ones
+    pthread_mutex_lock(&gc_mtx);
+    pthread_mutex_lock(&allocate_page_mtx);
+
+    gc_rate_limiter = rate_limiter;
+    gc_statistics = statistics;
+
+    io->SetStatistics(statistics);
+
+    pthread_mutex_unlock(&allocate_page_mtx);
+    pthread_mutex_unlock(&gc_mtx);
+}
+
+#ifdef NVM_ALLOCATE_BLOCKS
+
+//lun the calling thread allocates from next; ULONG_MAX until it is assigned
+static __thread unsigned long lun_affinity = ULONG_MAX;
+
+//keeps the free list sorted by erase count, blocks with the same count in
+//the order they were erased; a block that was just erased usually has the
+//highest count of the lun, so the walk from the tail is short
+void nvm::PushFreeBlockLocked(struct nvm_block *blk)
+{
+    struct nvm_lun *lun = &luns[blk->block->lun];
+
+    struct nvm_block *prev = lun->free_tail;
+
+    while(prev && prev->erase_count > blk->erase_count)
+    {
+	prev = prev->prev_free;
+    }
+
+    blk->prev_free = prev;
+    blk->next_free = prev ? prev->next_free : lun->free_head;
+
+    if(blk->next_free)
+    {
+	blk->next_free->prev_free = blk;
+    }
+    else
+    {
+	lun->free_tail = blk;
+    }
+
+    if(prev)
+    {
+	prev->next_free = blk;
+    }
+    else
+    {
+	lun->free_head = blk;
+    }
+
+    ++lun->nr_free_blocks;
+    ++nr_free_blocks;
+}
+
+void nvm::UnlinkFreeBlockLocked(struct nvm_block *blk)
+{
+    struct nvm_lun *lun = &luns[blk->block->lun];
+
+    if(blk->prev_free)
+    {
+	blk->prev_free->next_free = blk->next_free;
+    }
+    else
+    {
+	lun->free_head = blk->next_free;
+    }
+
+    if(blk->next_free)
+    {
+	blk->next_free->prev_free = blk->prev_free;
+    }
+    else
+    {
+	lun->free_tail = blk->prev_free;
+    }
+
+    blk->prev_free = nullptr;
+    blk->next_free = nullptr;
+
+    --lun->nr_free_blocks;
+    --nr_free_blocks;
+}
+
+//takes blk off the free list of its lun
+void nvm::AllocateBlockLocked(struct nvm_block *blk, const nvm_pool_id pool)
+{
+    struct nvm_lun *lun = &luns[blk->block->lun];
+
+    NVM_DEBUG("Allocating block %p to pool %d", blk, pool);
+
+    UnlinkFreeBlockLocked(blk);
+
+    blk->allocated = true;
+    blk->erase_pending = false;
+
+    blk->pool = pool;
+
+    blk->nr_valid_pages = 0;
+    blk->nr_reserved_pages = lun->nr_pages_per_blk;
+
+    blk->last_update = write_clock;
+}
+
+//blk must be off the free list: its erase count changes
+void nvm::EraseBlockLocked(struct nvm_block *blk)
+{
+    int ret = dev->Ioctl(NVMBLOCKERASE, blk->block);
+
+    if(ret)
+    {
+	NVM_FATAL("could not erase block %p", blk->block);
+    }
+
+    NVM_DEBUG("erased block %lu - %lu", blk->block->lun, blk->block->id);
+
+    ++blk->erase_count;
+
+    blk->needs_erase = false;
+
+    ++blocks_erased;
+
+    rocksdb::RecordTick(gc_statistics.load(), rocksdb::NVM_BLOCKS_ERASED);
+}
+
+void nvm::ReclaimBlockLocked(struct nvm_block *blk)
+{
+    if(blk->allocated == false)
+    {
+	return;
+    }
+
+    EraseBlockLocked(blk);
+
+    blk->allocated = false;
+    blk->erase_pending = false;
+
+    blk->nr_valid_pages = 0;
+    blk->nr_reserved_pages = 0;
+
+    PushFreeBlockLocked(blk);
+}
+
+void nvm::ReclaimBlock(const unsigned long lun_id, const unsigned long block_id)
+{
+    if(lun_id >= nr_luns)
+    {
+	return;
+    }
+
+    if(block_id >= luns[lun_id].nr_blocks)
+    {
+	return;
+    }
+
+    pthread_mutex_lock(&luns[lun_id].alloc_mtx);
+
+    ReclaimBlockLocked(&luns[lun_id].blocks[block_id]);
+
+    pthread_mutex_unlock(&luns[lun_id].alloc_mtx);
+}
+
+//write-ahead logs and metadata get luns of their own so their appends never
+//queue behind compaction output; the sst pools split the remaining luns when
+//each of them can still stripe over NVM_STRIPE_WIDTH luns and share them
+//otherwise
+void nvm::AssignPoolLuns()
+{
+    unsigned long log_luns = std::max(1UL, nr_luns * NVM_LOG_LUNS_PERCENT / 100);
+
+    //too small a device to take luns away from the sst stripes
+    if(nr_luns < log_luns + 2)
+    {
+	log_luns = 0;
+    }
+
+    unsigned long sst_first_lun = log_luns;
+    unsigned long sst_luns = nr_luns - log_luns;
+
+    unsigned long nr_sst_pools = NVM_NR_POOLS - NVM_POOL_HOT;
+
+    for(unsigned long i = 0; i < NVM_NR_POOLS; ++i)
+    {
+	if(i < NVM_POOL_HOT)
+	{
+	    pool_first_lun[i] = 0;
+	    pool_nr_luns[i] = log_luns > 0 ? log_luns : nr_luns;
+	}
+	else if(sst_luns >= nr_sst_pools * NVM_STRIPE_WIDTH)
+	{
+	    unsigned long share = sst_luns / nr_sst_pools;
+
+	    pool_first_lun[i] = sst_first_lun + (i - NVM_POOL_HOT) * share;
+	    pool_nr_luns[i] = (i == NVM_NR_POOLS - 1) ? sst_luns - (i - NVM_POOL_HOT) * share : share;
+	}
+	else
+	{
+	    pool_first_lun[i] = sst_first_lun;
+	    pool_nr_luns[i] = sst_luns;
+	}
+
+	NVM_DEBUG("pool %lu: luns %lu - %lu", i, pool_first_lun[i], pool_first_lun[i] + pool_nr_luns[i] - 1);
+    }
+}
+
+unsigned long nvm::GetPoolLuns(const nvm_pool_id pool)
+{
+    return pool_nr_luns[pool];
+}
+
+unsigned long nvm::GetFreeBlocks(const nvm_pool_id pool)
+{
+    unsigned long ret = 0;
+
+    for(unsigned long i = pool_first_lun[pool]; i < pool_first_lun[pool] + pool_nr_luns[pool]; ++i)
+    {
+	pthread_mutex_lock(&luns[i].alloc_mtx);
+
+	ret += luns[i].nr_free_blocks;
+
+	pthread_mutex_unlock(&luns[i].alloc_mtx);
+    }
+
+    return ret;
+}
+
+void nvm::SetLunAffinity(const unsigned long lun_id)
+{
+    lun_affinity = lun_id;
+}
+
+//the lun the calling thread tries next; moves on so that the blocks of a
+//stripe land on different luns
+unsigned long nvm::NextLun()
+{
+    if(lun_affinity == ULONG_MAX)
+    {
+	lun_affinity = next_lun_affinity++;
+    }
+
+    return lun_affinity++;
+}
+
+//the head of the free list (the least worn block) for user data, the tail
+//(the most worn) with most_worn for data the gc found cold
+struct nvm_block *nvm::TakeFreeBlock(const unsigned long lun_id, const nvm_pool_id pool, const bool most_worn)
+{
+    struct nvm_lun *lun = &luns[lun_id];
+
+    pthread_mutex_lock(&lun->alloc_mtx);
+
+    struct nvm_block *ret = most_worn ? lun->free_tail : lun->free_head;
+
+    if(ret)
+    {
+	AllocateBlockLocked(ret, pool);
+
+	if(ret->needs_erase)
+	{
+	    EraseBlockLocked(ret);
+	}
+    }
+
+    pthread_mutex_unlock(&lun->alloc_mtx);
+
+    return ret;
+}
+
+bool nvm::RequestBlock(std::vector<struct nvm_page *> *block_pages, const nvm_pool_id pool)
+{
+    struct nvm_block *ret = nullptr;
+
+    unsigned long lun_id = NextLun();
+
+    //a lun of the pool is used as is, any other one picks a lun of the pool
+    unsigned long offset = lun_id % pool_nr_luns[pool];
+
+    if(lun_id >= pool_first_lun[pool] && lun_id < pool_first_lun[pool] + pool_nr_luns[pool])
+    {
+	offset = lun_id - pool_first_lun[pool];
+    }
+
+    for(unsigned long i = 0; i < pool_nr_luns[pool] && ret == nullptr; ++i)
+    {
+	ret = TakeFreeBlock(pool_first_lun[pool] + (offset + i) % pool_nr_luns[pool], pool, false);
+    }
+
+    //the pool ran dry: borrow a block from the other luns rather than fail
+    for(unsigned long i = 0; i < nr_luns && ret == nullptr; ++i)
+    {
+	ret = TakeFreeBlock((lun_id + i) % nr_luns, pool, false);
+    }
+
+    if(gc_trigger && nr_free_blocks * 100 < nr_blocks * NVM_GC_TRIGGER_FREE_PERCENT)
+    {
+	gc_trigger(gc_trigger_arg);
+    }
+
+    if(ret == nullptr)
+    {
+	//out of ssd space
+	return false;
+    }
+
+    for(unsigned long i = 0; i < luns[ret->block->lun].nr_pages_per_blk; ++i)
+    {
+	block_pages->push_back(&ret->pages[i]);
+    }
+
+    return true;
+}
+
+struct nvm_page *nvm::ClaimPage(rocksdb::nvm_file *owner, const unsigned long lun_id, const unsigned long block_id, const unsigned long page_id)
+{
+    if(lun_id >= nr_luns)
+    {
+	return nullptr;
+    }
+
+    if(block_id >= luns[lun_id].nr_blocks)
+    {
+	return nullptr;
+    }
+
+    if(page_id >= luns[lun_id].nr_pages_per_blk)
+    {
+	return nullptr;
+    }
+
+    pthread_mutex_lock(&luns[lun_id].alloc_mtx);
+
+    struct nvm_block *blk = &luns[lun_id].blocks[block_id];
+    struct nvm_page *ret = &blk->pages[page_id];
+
+    if(ret->owner != nullptr)
+    {
+	NVM_DEBUG("Already allocated");
+
+	pthread_mutex_unlock(&luns[lun_id].alloc_mtx);
+
+	return nullptr;
+    }
+
+    //what the layout does not map of a restored block is stale
+    if(blk->allocated == false)
+    {
+	AllocateBlockLocked(blk, owner->GetPool());
+
+	blk->nr_reserved_pages = 0;
+    }
+
+    ++blk->nr_reserved_pages;
+
+    MapPageLocked(ret, owner);
+
+    pthread_mutex_unlock(&luns[lun_id].alloc_mtx);
+
+    return ret;
+}
+
+void nvm::GetBlockState(const unsigned long lun_id, const unsigned long block_id, unsigned long *erase_count, nvm_pool_id *pool)
+{
+    pthread_mutex_lock(&luns[lun_id].alloc_mtx);
+
+    struct nvm_block *blk = &luns[lun_id].blocks[block_id];
+
+    *erase_count = blk->erase_count;
+    *pool = blk->pool;
+
+    pthread_mutex_unlock(&luns[lun_id].alloc_mtx);
+}
+
+void nvm::RestoreBlockState(const unsigned long lun_id, const unsigned long block_id, const unsigned long erase_count, const nvm_pool_id pool)
+{
+    pthread_mutex_lock(&luns[lun_id].alloc_mtx);
+
+    struct nvm_block *blk = &luns[lun_id].blocks[block_id];
+
+    blk->erase_count = erase_count;
+
+    //ClaimPage() put the block in the pool of the file that claimed it,
+    //which may not be the one it was written for
+    blk->pool = pool;
+
+    //a free block moves to its place by the new count
+    if(blk->allocated == false)
+    {
+	UnlinkFreeBlockLocked(blk);
+	PushFreeBlockLocked(blk);
+    }
+
+    pthread_mutex_unlock(&luns[lun_id].alloc_mtx);
+}
+
+void nvm::FreeBlocksRestored()
+{
+    for(unsigned long i = 0; i < nr_luns; ++i)
+    {
+	pthread_mutex_lock(&luns[i].alloc_mtx);
+
+	for(struct nvm_block *blk = luns[i].free_head; blk != nullptr; blk = blk->next_free)
+	{
+	    blk->needs_erase = true;
+	}
+
+	pthread_mutex_unlock(&luns[i].alloc_mtx);
+    }
+}
+
+void nvm::MapPageLocked(struct nvm_page *page, rocksdb::nvm_file *owner)
+{
+    struct nvm_block *blk = &luns[page->lun_id].blocks[page->block_id];
+
+    if(page->owner == nullptr)
+    {
+	--blk->nr_reserved_pages;
+	++blk->nr_valid_pages;
+    }
+
+    page->owner = owner;
+
+    blk->last_update = ++write_clock;
+}
+
+void nvm::MapPage(struct nvm_page *page, rocksdb::nvm_file *owner)
+{
+    pthread_mutex_lock(&luns[page->lun_id].alloc_mtx);
+
+    MapPageLocked(page, owner);
+
+    pthread_mutex_unlock(&luns[page->lun_id].alloc_mtx);
+
+    ++user_pages_written;
+
+    rocksdb::RecordTick(gc_statistics.load(), rocksdb::NVM_USER_PAGES_WRITTEN);
+}
+
+void nvm::DropPage(struct nvm_page *page)
+{
+    pthread_mutex_lock(&luns[page->lun_id].alloc_mtx);
+
+    struct nvm_block *blk = &luns[page->lun_id].blocks[page->block_id];
+
+    if(page->owner)
+    {
+	page->owner = nullptr;
+
+	--blk->nr_valid_pages;
+    }
+    else if(blk->nr_reserved_pages > 0)
+    {
+	--blk->nr_reserved_pages;
+    }
+
+    if(blk->nr_valid_pages == 0 && blk->nr_reserved_pages == 0 && blk->erase_pending == false)
+    {
+	NVM_DEBUG("block %lu - %lu has no more pages allocated", page->lun_id, page->block_id);
+
+	ReclaimBlockLocked(blk);
+    }
+
+    pthread_mutex_unlock(&luns[page->lun_id].alloc_mtx);
+}
 
-    next_block.lun_id = 0;
-    next_block.block_id = 0;
+void nvm::ReleasePages(std::vector<struct nvm_page *> *block_pages)
+{
+    for(unsigned long i = 0; i < block_pages->size(); ++i)
+    {
+	DropPage((*block_pages)[i]);
+    }
 
-#else
+    block_pages->clear();
+}
 
-    next_page.lun_id = 0;
-    next_page.block_id = 0;
-    next_page.page_id = 0;
+void nvm::GetGarbageCollectionStats(struct nvm_gc_stats *stats)
+{
+    stats->user_pages_written = user_pages_written;
+    stats->gc_pages_relocated = gc_pages_relocated;
+    stats->blocks_erased = blocks_erased;
 
-    gc_block = nullptr;
+    stats->free_blocks = nr_free_blocks;
 
-#endif
+    stats->min_erase_count = ULONG_MAX;
+    stats->max_erase_count = 0;
 
-    if(ioctl_initialize())
+    for(unsigned long i = 0; i < nr_luns; ++i)
     {
-	NVM_FATAL("");
-    }
+	pthread_mutex_lock(&luns[i].alloc_mtx);
 
-    pthread_mutexattr_init(&allocate_page_mtx_attr);
-    pthread_mutexattr_settype(&allocate_page_mtx_attr, PTHREAD_MUTEX_RECURSIVE);
+	for(unsigned long j = 0; j < luns[i].nr_blocks; ++j)
+	{
+	    stats->min_erase_count = std::min(stats->min_erase_count, luns[i].blocks[j].erase_count);
+	    stats->max_erase_count = std::max(stats->max_erase_count, luns[i].blocks[j].erase_count);
+	}
 
-    pthread_mutex_init(&allocate_page_mtx, &allocate_page_mtx_attr);
+	pthread_mutex_unlock(&luns[i].alloc_mtx);
+    }
 }
 
-nvm::~nvm()
+//cost-benefit victim selection: the space a block gives back weighted by
+//how long its data has been left alone, over the cost of moving what is still
+//valid in it
+struct nvm_block *nvm::PickVictim()
 {
-    unsigned long i;
-    unsigned long j;
+    struct nvm_block *ret = nullptr;
+    struct nvm_block *coldest = nullptr;
 
-    close(fd);
+    unsigned long coldest_erase_count = 0;
+    unsigned long max_erase_count = 0;
 
-    if(nr_luns > 0)
+    unsigned long long now = write_clock;
+
+    double best_score = 0;
+
+    for(unsigned long i = 0; i < nr_luns; ++i)
     {
-	for(i = 0; i < nr_luns; ++i)
+	pthread_mutex_lock(&luns[i].alloc_mtx);
+
+	for(unsigned long j = 0; j < luns[i].nr_blocks; ++j)
 	{
-	    for(j = 0; j < luns[i].nr_blocks; ++j)
+	    struct nvm_block *blk = &luns[i].blocks[j];
+
+	    max_erase_count = std::max(max_erase_count, blk->erase_count);
+
+	    //reserved pages are still going to be written
+	    if(blk->allocated == false || blk->erase_pending || blk->nr_reserved_pages > 0)
 	    {
-		free(luns[i].blocks[j].block);
-		free(luns[i].blocks[j].pages);
+		continue;
+	    }
+
+	    if(coldest == nullptr || blk->erase_count < coldest_erase_count)
+	    {
+		coldest = blk;
+		coldest_erase_count = blk->erase_count;
+	    }
+
+	    if(blk->nr_valid_pages == luns[i].nr_pages_per_blk)
+	    {
+		continue;
+	    }
+
+	    double u = (double)blk->nr_valid_pages / luns[i].nr_pages_per_blk;
+	    double age = (double)(now - std::min(now, blk->last_update)) + 1;
+
+	    double score = (1 - u) * age / (1 + u);
+
+	    if(score > best_score)
+	    {
+		best_score = score;
+
+		ret = blk;
 	    }
-	    free(luns[i].blocks);
-	    free(luns[i].channels);
 	}
-	free(luns);
-    }
 
-#ifndef NVM_ALLOCATE_BLOCKS
+	pthread_mutex_unlock(&luns[i].alloc_mtx);
+    }
 
-    for(i = 0; i < allocated_pages.size(); ++i)
+    //static wear leveling: cold data sitting on a young block keeps it from
+    //ever being erased; move it to a worn one and let new writes have it
+    if(coldest && max_erase_count - coldest_erase_count > NVM_WEAR_LEVELING_THRESHOLD)
     {
-	free(allocated_pages[i]);
+	NVM_DEBUG("wear leveling block %lu - %lu", coldest->block->lun, coldest->block->id);
+
+	return coldest;
     }
 
-    allocated_pages.clear();
+    return ret;
+}
 
-#endif
+//relocated pages stay in the pool they came from so the gc does not mix
+//lifetimes back together
+struct nvm_page *nvm::RequestGCPage(const nvm_pool_id pool)
+{
+    std::vector<struct nvm_page *> *pages = &gc_pages[pool];
 
-    pthread_mutexattr_destroy(&allocate_page_mtx_attr);
-    pthread_mutex_destroy(&allocate_page_mtx);
+    if(pages->empty())
+    {
+	//relocated data is cold: park it on the most worn free block and leave
+	//the least worn ones to new writes
+	unsigned long lun_id = ULONG_MAX;
+	unsigned long max_erase_count = 0;
 
-    NVM_DEBUG("api closed");
-}
+	for(unsigned long i = pool_first_lun[pool]; i < pool_first_lun[pool] + pool_nr_luns[pool]; ++i)
+	{
+	    pthread_mutex_lock(&luns[i].alloc_mtx);
 
-#ifdef NVM_ALLOCATE_BLOCKS
+	    if(luns[i].free_tail && (lun_id == ULONG_MAX || luns[i].free_tail->erase_count > max_erase_count))
+	    {
+		lun_id = i;
+		max_erase_count = luns[i].free_tail->erase_count;
+	    }
 
-void nvm::ReclaimBlock(const unsigned long lun_id, const unsigned long block_id)
-{
-    if(lun_id >= nr_luns)
-    {
-	return;
+	    pthread_mutex_unlock(&luns[i].alloc_mtx);
+	}
+
+	struct nvm_block *blk = nullptr;
+
+	if(lun_id != ULONG_MAX)
+	{
+	    blk = TakeFreeBlock(lun_id, pool, true);
+	}
+
+	for(unsigned long i = 0; i < nr_luns && blk == nullptr; ++i)
+	{
+	    blk = TakeFreeBlock(i, pool, true);
+	}
+
+	if(blk == nullptr)
+	{
+	    return nullptr;
+	}
+
+	//pages are handed out from the back
+	for(unsigned long i = luns[blk->block->lun].nr_pages_per_blk; i > 0; --i)
+	{
+	    pages->push_back(&blk->pages[i - 1]);
+	}
     }
 
-    if(block_id >= luns[lun_id].nr_blocks)
+    struct nvm_page *ret = pages->back();
+
+    pages->pop_back();
+
+    return ret;
+}
+
+bool nvm::CopyPage(struct nvm_page *src, struct nvm_page *dst)
+{
+    unsigned long page_size = src->sizes[0];
+
+    unsigned long block_size = luns[src->lun_id].nr_pages_per_blk * page_size;
+    unsigned long lun_size = luns[src->lun_id].nr_blocks * block_size;
+
+    unsigned long src_offset = src->lun_id * lun_size + src->block_id * block_size + src->id * page_size;
+    unsigned long dst_offset = dst->lun_id * lun_size + dst->block_id * block_size + dst->id * page_size;
+
+    char *data;
+    SAFE_ALLOC(data, char[page_size]);
+
+    ssize_t ret;
+
+    do
     {
-	return;
+	ret = dev->Pread(data, page_size, src_offset);
     }
+    while(ret < 0 && errno == EINTR);
 
-    if(luns[lun_id].blocks[block_id].allocated == false)
+    if(ret == (ssize_t)page_size)
     {
-	return;
+	ret = dev->Pwrite(data, page_size, dst_offset);
     }
 
-    int ret = ioctl(fd, NVMBLOCKERASE, luns[lun_id].blocks[block_id].block);
+    delete[] data;
 
-    if(ret)
+    if(ret != (ssize_t)page_size)
     {
-	NVM_FATAL("could not erase block %p", luns[lun_id].blocks[block_id].block);
+	NVM_ERROR("unable to move page %lu - %lu - %lu", src->lun_id, src->block_id, src->id);
+
+	return false;
     }
 
-    luns[lun_id].blocks[block_id].allocated = false;
+    return true;
 }
 
-bool nvm::RequestBlock(std::vector<struct nvm_page *> *block_pages, const unsigned long lun_id, const unsigned long block_id)
+//moves the valid pages of victim to the gc blocks; returns false if nothing
+//could be done
+//
+//no lun lock is held while pages are copied: the owner of the pages being
+//moved is locked instead, which keeps its pages (and the file) in place
+bool nvm::RelocateBlock(struct nvm_block *victim)
 {
-    struct nvm_block *ret;
+    struct nvm_lun *lun = &luns[victim->block->lun];
 
-    if(lun_id >= nr_luns)
-    {
-	return false;
-    }
+    unsigned long nr_pages = lun->nr_pages_per_blk;
 
-    if(block_id >= luns[lun_id].nr_blocks)
+    rocksdb::Statistics *statistics = gc_statistics.load();
+
+    bool ret = false;
+
+    pthread_mutex_lock(&lun->alloc_mtx);
+
+    if(victim->allocated == false || victim->erase_pending || victim->nr_reserved_pages > 0)
     {
+	pthread_mutex_unlock(&lun->alloc_mtx);
+
 	return false;
     }
 
-    pthread_mutex_lock(&allocate_page_mtx);
+    victim->erase_pending = true;
 
-    ret = &luns[lun_id].blocks[block_id];
+    pthread_mutex_unlock(&lun->alloc_mtx);
 
-    NVM_DEBUG("Allocating block %p", ret);
+    struct nvm_page **dst_pages;
+    SAFE_ALLOC(dst_pages, struct nvm_page *[nr_pages]);
 
-    if(ret->allocated == true)
+    bool *owned;
+    SAFE_ALLOC(owned, bool[nr_pages]);
+
+    for(unsigned long i = 0; i < nr_pages; ++i)
     {
-	NVM_DEBUG("Already allocated");
+	pthread_mutex_lock(&lun->alloc_mtx);
 
-	pthread_mutex_unlock(&allocate_page_mtx);
+	rocksdb::nvm_file *owner = victim->pages[i].owner;
 
-	return false;
-    }
+	//a file open for write holds on to its pages; try again next pass
+	//(trylock: writers take the lun lock with their pages locked)
+	if(owner == nullptr || owner->TryLockPages() == false)
+	{
+	    pthread_mutex_unlock(&lun->alloc_mtx);
 
-    ret->allocated = true;
+	    continue;
+	}
 
-    pthread_mutex_unlock(&allocate_page_mtx);
+	for(unsigned long j = 0; j < nr_pages; ++j)
+	{
+	    owned[j] = victim->pages[j].owner == owner;
+	}
 
-    for(unsigned long i = 0; i < luns[lun_id].nr_pages_per_blk; ++i)
-    {
-	block_pages->push_back(&luns[lun_id].blocks[block_id].pages[i]);
-    }
+	pthread_mutex_unlock(&lun->alloc_mtx);
 
-    return true;
-}
+	bool out_of_space = false;
 
-bool nvm::RequestBlock(std::vector<struct nvm_page *> *block_pages)
-{
-    struct nvm_block *ret;
+	for(unsigned long j = 0; j < nr_pages; ++j)
+	{
+	    dst_pages[j] = nullptr;
 
-    unsigned long try_count = 0;
+	    if(out_of_space || owned[j] == false)
+	    {
+		continue;
+	    }
 
-    pthread_mutex_lock(&allocate_page_mtx);
+	    struct nvm_page *dst = RequestGCPage(victim->pool);
 
-retry:
+	    if(dst == nullptr)
+	    {
+		out_of_space = true;
 
-    ++try_count;
+		continue;
+	    }
 
-    if(try_count == max_alloc_try_count)
-    {
-	//out of ssd space
-	pthread_mutex_unlock(&allocate_page_mtx);
+	    if(CopyPage(&victim->pages[j], dst) == false)
+	    {
+		DropPage(dst);
 
-	return false;
+		continue;
+	    }
+
+	    dst_pages[j] = dst;
+	}
+
+	owner->RelocatePages(victim->block->lun, victim->block->id, dst_pages);
+
+	for(unsigned long j = 0; j < nr_pages; ++j)
+	{
+	    if(dst_pages[j] == nullptr)
+	    {
+		continue;
+	    }
+
+	    pthread_mutex_lock(&luns[dst_pages[j]->lun_id].alloc_mtx);
+
+	    MapPageLocked(dst_pages[j], owner);
+
+	    pthread_mutex_unlock(&luns[dst_pages[j]->lun_id].alloc_mtx);
+
+	    pthread_mutex_lock(&lun->alloc_mtx);
+
+	    victim->pages[j].owner = nullptr;
+
+	    --victim->nr_valid_pages;
+
+	    pthread_mutex_unlock(&lun->alloc_mtx);
+
+	    ++gc_pages_relocated;
+
+	    rocksdb::RecordTick(statistics, rocksdb::NVM_GC_PAGES_RELOCATED);
+
+	    ret = true;
+	}
+
+	owner->UnlockPages();
+
+	if(out_of_space)
+	{
+	    break;
+	}
     }
 
-    ret = &luns[next_block.lun_id].blocks[next_block.block_id];
+    delete[] owned;
+    delete[] dst_pages;
 
-    ++next_block.block_id;
+    pthread_mutex_lock(&lun->alloc_mtx);
 
-    if(next_block.block_id < luns[next_block.lun_id].nr_blocks)
+    if(victim->nr_valid_pages == 0)
     {
-	goto end;
+	victim->gc_pass = gc_passes + 1;
+
+	relocated_blocks.push_back(victim);
+
+	ret = true;
+    }
+    else
+    {
+	victim->erase_pending = false;
     }
 
-    next_block.block_id = 0;
+    pthread_mutex_unlock(&lun->alloc_mtx);
 
-    ++next_block.lun_id;
+    return ret;
+}
 
-    if(next_block.lun_id < nr_luns)
+void nvm::ThrottleGarbageCollection(unsigned long bytes)
+{
+    if(gc_rate_limiter == nullptr)
     {
-	goto end;
+	return;
     }
 
-    next_block.lun_id = 0;
+    unsigned long burst = gc_rate_limiter->GetSingleBurstBytes();
 
-end:
-    if(ret->allocated == true)
+    while(bytes > 0)
     {
-	NVM_DEBUG("Block already allocated %p", ret);
-	goto retry;
+	unsigned long request = std::min(bytes, burst);
+
+	gc_rate_limiter->Request(request, rocksdb::Env::IO_LOW);
+
+	bytes -= request;
     }
+}
+
+void nvm::GarbageCollection()
+{
+    pthread_mutex_lock(&gc_mtx);
 
-    NVM_DEBUG("Allocating block %p", ret);
+    //a moved block is erased once a save has put the new locations of its
+    //pages in the FTL and the readers that looked up the old ones are done
+    unsigned long passes_saved = gc_passes_saved;
 
-    ret->allocated = true;
+    //pairs with the fence in PinBlock()
+    std::atomic_thread_fence(std::memory_order_seq_cst);
 
-    pthread_mutex_unlock(&allocate_page_mtx);
+    unsigned long nr_kept = 0;
 
-    for(unsigned int i = 0; i < luns[ret->block->lun].nr_pages_per_blk; ++i)
+    for(unsigned long i = 0; i < relocated_blocks.size(); ++i)
     {
-	block_pages->push_back(&luns[ret->block->lun].blocks[ret->block->id].pages[i]);
+	struct nvm_block *blk = relocated_blocks[i];
+
+	if(blk->gc_pass > passes_saved || blk->nr_readers.load(std::memory_order_acquire) > 0)
+	{
+	    relocated_blocks[nr_kept++] = blk;
+
+	    continue;
+	}
+
+	ReclaimBlock(blk->block->lun, blk->block->id);
     }
 
-    return true;
-}
+    relocated_blocks.resize(nr_kept);
 
-void nvm::GarbageCollection()
-{
+    for(unsigned long i = 0; i < NVM_GC_BLOCKS_PER_PASS; ++i)
+    {
+	struct nvm_block *victim = PickVictim();
+
+	if(victim == nullptr)
+	{
+	    break;
+	}
+
+	pthread_mutex_lock(&luns[victim->block->lun].alloc_mtx);
+
+	unsigned long bytes = victim->nr_valid_pages * victim->pages[0].sizes[0];
+
+	pthread_mutex_unlock(&luns[victim->block->lun].alloc_mtx);
+
+	NVM_DEBUG("gc victim is block %lu - %lu", victim->block->lun, victim->block->id);
+
+	//charged before any lun is locked so writers do not wait on it
+	ThrottleGarbageCollection(bytes);
+
+	if(RelocateBlock(victim) == false)
+	{
+	    break;
+	}
+    }
 
+    ++gc_passes;
+
+    pthread_mutex_unlock(&gc_mtx);
 }
 
 #else
@@ -349,7 +1316,7 @@ retry_read:
 
     NVM_DEBUG("reading block %p", src);
 
-    if((unsigned)pread(fd, data, block_size, offset) != block_size)
+    if((unsigned)dev->Pread(data, block_size, offset) != block_size)
     {
 	if (errno == EINTR)
 	{
@@ -367,11 +1334,11 @@ retry_write:
 
     NVM_DEBUG("writing page %p", dest);
 
-    if((unsigned)pwrite(fd, data, block_size, offset) != block_size)
+    if((unsigned)dev->Pwrite(data, block_size, offset) != block_size)
     {
 	if (errno == EINTR)
 	{
-	    ret = ioctl(fd, NVMBLOCKERASE, dest->block);
+	    ret = dev->Ioctl(NVMBLOCKERASE, dest->block);
 
 	    if(ret)
 	    {
@@ -386,7 +1353,7 @@ retry_write:
 
     delete[] data;
 
-    ret = ioctl(fd, NVMBLOCKERASE, src->block);
+    ret = dev->Ioctl(NVMBLOCKERASE, src->block);
 
     if(ret)
     {
@@ -638,24 +1605,9 @@ void nvm::ReclaimPage(struct nvm_page *page)
 
 #endif
 
-int nvm::open_nvm_device(const char *file)
-{
-    std::string cmd = std::string("echo \"nba ") + std::string(file) +
-		      std::string(" 0:0\" > /sys/block/nvme0n1/lightnvm/configure");
-
-    if(system(cmd.c_str()))
-    {
-	return -1;
-    }
-
-    location = std::string("/dev") + std::string(file);
-
-    return open(location.c_str(), O_RDWR);
-}
-
 const char *nvm::GetLocation()
 {
-    return location.c_str();
+    return dev->GetLocation();
 }
 
 int nvm::ioctl_initialize()
@@ -670,8 +1622,9 @@ int nvm::ioctl_initialize()
     struct nba_channel chnl_desc;
 
     max_alloc_try_count = 0;
+    max_blocks_per_lun = 0;
 
-    ret = ioctl(fd, NVMLUNSNRGET, &nr_luns);
+    ret = dev->Ioctl(NVMLUNSNRGET, &nr_luns);
 
     if(ret != 0)
     {
@@ -688,7 +1641,7 @@ int nvm::ioctl_initialize()
     {
 	luns[i].nr_pages_per_blk = i;
 
-	ret = ioctl(fd, NVMPAGESNRGET, &luns[i].nr_pages_per_blk);
+	ret = dev->Ioctl(NVMPAGESNRGET, &luns[i].nr_pages_per_blk);
 
 	if(ret != 0)
 	{
@@ -701,7 +1654,7 @@ int nvm::ioctl_initialize()
 
 	luns[i].nchannels = i;
 
-	ret = ioctl(fd, NVMCHANNELSNRGET, &luns[i].nchannels);
+	ret = dev->Ioctl(NVMCHANNELSNRGET, &luns[i].nchannels);
 
 	if(ret != 0)
 	{
@@ -720,7 +1673,7 @@ int nvm::ioctl_initialize()
 	{
 	    chnl_desc.chnl_idx = j;
 
-	    ret = ioctl(fd, NVMPAGESIZEGET, &chnl_desc);
+	    ret = dev->Ioctl(NVMPAGESIZEGET, &chnl_desc);
 
 	    if(ret != 0)
 	    {
@@ -741,7 +1694,7 @@ int nvm::ioctl_initialize()
 
 	luns[i].nr_blocks = i;
 
-	ret = ioctl(fd, NVMBLOCKSNRGET, &luns[i].nr_blocks);
+	ret = dev->Ioctl(NVMBLOCKSNRGET, &luns[i].nr_blocks);
 
 	if(ret != 0)
 	{
@@ -752,6 +1705,11 @@ int nvm::ioctl_initialize()
 
 	NVM_DEBUG("Lun %lu has %lu blocks", i, luns[i].nr_blocks);
 
+	if(luns[i].nr_blocks > max_blocks_per_lun)
+	{
+	    max_blocks_per_lun = luns[i].nr_blocks;
+	}
+
 #ifdef NVM_ALLOCATE_BLOCKS
 
 	max_alloc_try_count += luns[i].nr_blocks;
@@ -764,6 +1722,17 @@ int nvm::ioctl_initialize()
 
 	ALLOC_STRUCT(luns[i].blocks, luns[i].nr_blocks, struct nvm_block);
 
+#ifdef NVM_ALLOCATE_BLOCKS
+
+	pthread_mutex_init(&luns[i].alloc_mtx, nullptr);
+
+	luns[i].free_head = nullptr;
+	luns[i].free_tail = nullptr;
+
+	luns[i].nr_free_blocks = 0;
+
+#endif
+
 	for(j = 0; j < luns[i].nr_blocks; ++j)
 	{
 	    struct nba_block *blk;
@@ -774,7 +1743,7 @@ int nvm::ioctl_initialize()
 	    blk->id = j;
 	    blk->lun = i;
 
-	    ret = ioctl(fd, NVMBLOCKGETBYID, blk);
+	    ret = dev->Ioctl(NVMBLOCKGETBYID, blk);
 
 	    if(ret)
 	    {
@@ -785,9 +1754,26 @@ int nvm::ioctl_initialize()
 
 	    process_blk->block = blk;
 
+	    process_blk->nr_readers.store(0, std::memory_order_relaxed);
+
 #ifdef NVM_ALLOCATE_BLOCKS
 
 	    process_blk->allocated = false;
+	    process_blk->erase_pending = false;
+	    process_blk->needs_erase = false;
+	    process_blk->gc_pass = 0;
+
+	    process_blk->nr_valid_pages = 0;
+	    process_blk->nr_reserved_pages = 0;
+
+	    process_blk->erase_count = 0;
+	    process_blk->last_update = 0;
+
+	    process_blk->pool = NVM_POOL_HOT;
+
+	    PushFreeBlockLocked(process_blk);
+
+	    ++nr_blocks;
 
 #else
 
@@ -811,7 +1797,11 @@ int nvm::ioctl_initialize()
 		process_blk->pages[k].block_id = j;
 		process_blk->pages[k].id = k;
 
-#ifndef NVM_ALLOCATE_BLOCKS
+#ifdef NVM_ALLOCATE_BLOCKS
+
+		process_blk->pages[k].owner = nullptr;
+
+#else
 
 		process_blk->pages[k].allocated = false;
 
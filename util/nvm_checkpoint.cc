@@ -0,0 +1,1313 @@
+#ifdef ROCKSDB_PLATFORM_NVM
+
+#include "nvm/nvm.h"
+
+namespace rocksdb
+{
+
+static Status WriteAll(const int fd, const std::string &data, const std::string &context)
+{
+    const char *src = data.data();
+
+    size_t left = data.size();
+
+    while(left > 0)
+    {
+	ssize_t ret = write(fd, src, left);
+
+	if(ret < 0)
+	{
+	    if(errno == EINTR)
+	    {
+		continue;
+	    }
+
+	    return IOError(context, errno);
+	}
+
+	src += ret;
+	left -= ret;
+    }
+
+    return Status::OK();
+}
+
+//makes a rename in the directory of path durable
+static Status SyncParentDirectory(const std::string &path)
+{
+    size_t slash = path.rfind('/');
+
+    std::string dir_path = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+
+    int fd = open(dir_path.c_str(), O_RDONLY | O_DIRECTORY);
+
+    if(fd < 0)
+    {
+	return IOError(dir_path, errno);
+    }
+
+    Status s;
+
+    if(fsync(fd))
+    {
+	s = IOError(dir_path, errno);
+    }
+
+    close(fd);
+
+    return s;
+}
+
+//writes data to a temporary file and renames it over path; the rename is
+//synced before returning so that a checkpoint replaced before its journal
+//is also on disk before it
+static Status ReplaceFile(const std::string &path, const std::string &data)
+{
+    std::string tmp_path = path + ".tmp";
+
+    int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IWUSR | S_IRUSR);
+
+    if(fd < 0)
+    {
+	return IOError(tmp_path, errno);
+    }
+
+    Status s = WriteAll(fd, data, tmp_path);
+
+    if(s.ok() && fsync(fd))
+    {
+	s = IOError(tmp_path, errno);
+    }
+
+    close(fd);
+
+    if(s.ok() && rename(tmp_path.c_str(), path.c_str()))
+    {
+	s = IOError(path, errno);
+    }
+
+    if(s.ok())
+    {
+	s = SyncParentDirectory(path);
+    }
+
+    return s;
+}
+
+nvm_checkpoint::nvm_checkpoint(const char *_checkpoint_path, const char *_journal_path, nvm *_nvm_api)
+{
+    checkpoint_path = _checkpoint_path;
+    journal_path = _journal_path;
+
+    journal_fd = -1;
+
+    generation = 0;
+
+    checkpoint_size = 0;
+    journal_size = 0;
+
+    nvm_api = _nvm_api;
+
+    pthread_mutex_init(&save_mtx, nullptr);
+}
+
+nvm_checkpoint::~nvm_checkpoint()
+{
+    if(journal_fd >= 0)
+    {
+	close(journal_fd);
+    }
+
+    pthread_mutex_destroy(&save_mtx);
+}
+
+void nvm_checkpoint::EncodeFile(nvm_file *fd, const std::string &dir_path, std::string *dst)
+{
+    std::vector<std::string> names;
+
+    fd->EnumerateNames(&names);
+
+    PutVarint64(dst, fd->id);
+    PutLengthPrefixedSlice(dst, dir_path);
+    PutVarint64(dst, names.size());
+
+    for(unsigned long i = 0; i < names.size(); ++i)
+    {
+	PutLengthPrefixedSlice(dst, names[i]);
+    }
+
+    PutVarint64(dst, fd->GetLastModified());
+
+    std::string extents;
+
+    unsigned long nr_extents = 0;
+
+    pthread_mutex_lock(&fd->page_update_mtx);
+
+    unsigned long nr_pages = fd->pages.size();
+
+    PutVarint64(dst, fd->size);
+
+    std::vector<bool> covered(nr_pages, false);
+
+    for(unsigned long i = 0; i < nr_pages; ++i)
+    {
+	if(covered[i])
+	{
+	    continue;
+	}
+
+	unsigned long best_stride = 1;
+	unsigned long best_count = 1;
+
+	//consecutive pages of a block are NVM_STRIPE_WIDTH apart in a
+	//striped file and next to each other otherwise
+	for(unsigned long stride = 1; stride <= NVM_STRIPE_WIDTH; ++stride)
+	{
+	    unsigned long count = 1;
+
+	    for(unsigned long j = i + stride; j < nr_pages && covered[j] == false; j += stride)
+	    {
+		struct nvm_page *prev = fd->pages[j - stride];
+		struct nvm_page *crt = fd->pages[j];
+
+		if(crt->lun_id != prev->lun_id || crt->block_id != prev->block_id || crt->id != prev->id + 1)
+		{
+		    break;
+		}
+
+		++count;
+	    }
+
+	    if(count > best_count)
+	    {
+		best_stride = stride;
+		best_count = count;
+	    }
+	}
+
+	struct nvm_page *first = fd->pages[i];
+
+	PutVarint64(&extents, i);
+	PutVarint64(&extents, best_stride);
+	PutVarint64(&extents, first->lun_id);
+	PutVarint64(&extents, first->block_id);
+	PutVarint64(&extents, first->id);
+	PutVarint64(&extents, best_count);
+
+	for(unsigned long k = 0; k < best_count; ++k)
+	{
+	    covered[i + k * best_stride] = true;
+	}
+
+	++nr_extents;
+    }
+
+    pthread_mutex_unlock(&fd->page_update_mtx);
+
+    PutVarint64(dst, nr_pages);
+    PutVarint64(dst, nr_extents);
+
+    dst->append(extents);
+}
+
+bool nvm_checkpoint::DecodeFile(Slice *input, nvm_file_desc *desc)
+{
+    uint64_t id;
+    uint64_t nr_names;
+    uint64_t last_modified;
+    uint64_t size;
+    uint64_t nr_pages;
+    uint64_t nr_extents;
+
+    Slice dir_path;
+
+    if(!GetVarint64(input, &id) || !GetLengthPrefixedSlice(input, &dir_path) || !GetVarint64(input, &nr_names))
+    {
+	return false;
+    }
+
+    desc->id = id;
+    desc->dir_path = dir_path.ToString();
+    desc->names.clear();
+
+    for(unsigned long i = 0; i < nr_names; ++i)
+    {
+	Slice name;
+
+	if(!GetLengthPrefixedSlice(input, &name))
+	{
+	    return false;
+	}
+
+	desc->names.push_back(name.ToString());
+    }
+
+    if(!GetVarint64(input, &last_modified) || !GetVarint64(input, &size) ||
+       !GetVarint64(input, &nr_pages) || !GetVarint64(input, &nr_extents))
+    {
+	return false;
+    }
+
+    desc->last_modified = last_modified;
+    desc->size = size;
+
+    unsigned long device_pages = 0;
+
+    for(unsigned long i = 0; i < nvm_api->nr_luns; ++i)
+    {
+	device_pages += nvm_api->luns[i].nr_blocks * nvm_api->luns[i].nr_pages_per_blk;
+    }
+
+    if(nr_pages > device_pages || nr_extents > nr_pages)
+    {
+	return false;
+    }
+
+    desc->pages.resize(nr_pages);
+
+    std::vector<bool> filled(nr_pages, false);
+
+    for(unsigned long i = 0; i < nr_extents; ++i)
+    {
+	uint64_t start;
+	uint64_t stride;
+	uint64_t lun_id;
+	uint64_t block_id;
+	uint64_t page_id;
+	uint64_t count;
+
+	if(!GetVarint64(input, &start) || !GetVarint64(input, &stride) || !GetVarint64(input, &lun_id) ||
+	   !GetVarint64(input, &block_id) || !GetVarint64(input, &page_id) || !GetVarint64(input, &count))
+	{
+	    return false;
+	}
+
+	if(stride == 0 || count == 0 || start >= nr_pages || (count - 1) * stride >= nr_pages - start)
+	{
+	    return false;
+	}
+
+	if(lun_id >= nvm_api->nr_luns || block_id >= nvm_api->luns[lun_id].nr_blocks ||
+	   page_id + count > nvm_api->luns[lun_id].nr_pages_per_blk)
+	{
+	    return false;
+	}
+
+	for(unsigned long k = 0; k < count; ++k)
+	{
+	    unsigned long idx = start + k * stride;
+
+	    if(filled[idx])
+	    {
+		return false;
+	    }
+
+	    filled[idx] = true;
+
+	    desc->pages[idx].lun_id = lun_id;
+	    desc->pages[idx].block_id = block_id;
+	    desc->pages[idx].page_id = page_id + k;
+	}
+    }
+
+    for(unsigned long i = 0; i < nr_pages; ++i)
+    {
+	if(filled[i] == false)
+	{
+	    return false;
+	}
+    }
+
+    return true;
+}
+
+//appends the records of all the blocks, or only of those that changed since
+//the last save; blocks gets the state the records were taken from
+unsigned long nvm_checkpoint::EncodeBlocks(const bool only_changed, std::string *dst, nvm_block_map *blocks)
+{
+    std::string records;
+
+    unsigned long nr_records = 0;
+
+#ifdef NVM_ALLOCATE_BLOCKS
+
+    for(unsigned long i = 0; i < nvm_api->nr_luns; ++i)
+    {
+	for(unsigned long j = 0; j < nvm_api->luns[i].nr_blocks; ++j)
+	{
+	    nvm_block_desc desc;
+
+	    nvm_api->GetBlockState(i, j, &desc.erase_count, &desc.pool);
+
+	    (*blocks)[std::make_pair(i, j)] = desc;
+
+	    if(only_changed)
+	    {
+		auto it = saved_blocks.find(std::make_pair(i, j));
+
+		if(it != saved_blocks.end() && it->second.erase_count == desc.erase_count && it->second.pool == desc.pool)
+		{
+		    continue;
+		}
+	    }
+
+	    PutVarint64(&records, i);
+	    PutVarint64(&records, j);
+	    PutVarint64(&records, desc.erase_count);
+	    PutVarint64(&records, desc.pool);
+
+	    ++nr_records;
+	}
+    }
+
+#endif
+
+    PutVarint64(dst, nr_records);
+
+    dst->append(records);
+
+    return nr_records;
+}
+
+bool nvm_checkpoint::DecodeBlocks(Slice *input, nvm_block_map *blocks)
+{
+    uint64_t nr_records;
+
+    if(!GetVarint64(input, &nr_records))
+    {
+	return false;
+    }
+
+    for(unsigned long i = 0; i < nr_records; ++i)
+    {
+	uint64_t lun_id;
+	uint64_t block_id;
+	uint64_t erase_count;
+	uint64_t pool;
+
+	if(!GetVarint64(input, &lun_id) || !GetVarint64(input, &block_id) ||
+	   !GetVarint64(input, &erase_count) || !GetVarint64(input, &pool))
+	{
+	    return false;
+	}
+
+	if(lun_id >= nvm_api->nr_luns || block_id >= nvm_api->luns[lun_id].nr_blocks || pool >= NVM_NR_POOLS)
+	{
+	    return false;
+	}
+
+	nvm_block_desc &desc = (*blocks)[std::make_pair(lun_id, block_id)];
+
+	desc.erase_count = erase_count;
+	desc.pool = (nvm_pool_id)pool;
+    }
+
+    return true;
+}
+
+//called once the files claimed their blocks; the ones left free may need
+//an erase
+void nvm_checkpoint::RestoreBlocks(const nvm_block_map &blocks)
+{
+#ifdef NVM_ALLOCATE_BLOCKS
+
+    for(auto it = blocks.begin(); it != blocks.end(); ++it)
+    {
+	nvm_api->RestoreBlockState(it->first.first, it->first.second, it->second.erase_count, it->second.pool);
+    }
+
+#endif
+
+    //blocks a version 1 checkpoint has no record of go in the next journal record
+    saved_blocks = blocks;
+
+#ifdef NVM_ALLOCATE_BLOCKS
+
+    nvm_api->FreeBlocksRestored();
+
+#endif
+}
+
+void nvm_checkpoint::EncodeTree(nvm_directory *dir, const std::string &dir_path, const bool only_dirty,
+				std::string *dirs, unsigned long *nr_dirs, std::string *files, unsigned long *nr_files)
+{
+    pthread_mutex_lock(&dir->list_update_mtx);
+
+    for(list_node *temp = dir->head; temp != nullptr; temp = temp->GetNext())
+    {
+	nvm_entry *entry = (nvm_entry *)temp->GetData();
+
+	switch(entry->GetType())
+	{
+	    case FileEntry:
+	    {
+		nvm_file *fd = (nvm_file *)entry->GetData();
+
+		//cleared before encoding so a concurrent change marks it again
+		bool was_dirty = fd->dirty.exchange(false);
+
+		if(only_dirty && was_dirty == false)
+		{
+		    break;
+		}
+
+		EncodeFile(fd, dir_path, files);
+
+		++(*nr_files);
+	    }
+	    break;
+
+	    case DirectoryEntry:
+	    {
+		nvm_directory *sub_dir = (nvm_directory *)entry->GetData();
+
+		std::string sub_path = dir_path.empty() ? sub_dir->GetName() : dir_path + "/" + sub_dir->GetName();
+
+		if(only_dirty == false)
+		{
+		    PutLengthPrefixedSlice(dirs, sub_path);
+
+		    ++(*nr_dirs);
+		}
+
+		EncodeTree(sub_dir, sub_path, only_dirty, dirs, nr_dirs, files, nr_files);
+	    }
+	    break;
+
+	    default:
+	    {
+		NVM_FATAL("unknown entry type");
+	    }
+	    break;
+	}
+    }
+
+    pthread_mutex_unlock(&dir->list_update_mtx);
+}
+
+Status nvm_checkpoint::CreateJournal()
+{
+    if(journal_fd >= 0)
+    {
+	close(journal_fd);
+
+	journal_fd = -1;
+    }
+
+    std::string header;
+
+    PutFixed64(&header, NVM_JOURNAL_MAGIC);
+    PutFixed64(&header, generation);
+
+    Status s = ReplaceFile(journal_path, header);
+
+    if(!s.ok())
+    {
+	return s;
+    }
+
+    journal_fd = open(journal_path.c_str(), O_WRONLY | O_APPEND);
+
+    if(journal_fd < 0)
+    {
+	return IOError(journal_path, errno);
+    }
+
+    journal_size = header.size();
+
+    return Status::OK();
+}
+
+Status nvm_checkpoint::WriteCheckpoint(nvm_directory *root)
+{
+    std::string dirs;
+    std::string files;
+
+    unsigned long nr_dirs = 0;
+    unsigned long nr_files = 0;
+
+    EncodeTree(root, "", false, &dirs, &nr_dirs, &files, &nr_files);
+
+    std::string block_records;
+
+    nvm_block_map blocks;
+
+    EncodeBlocks(false, &block_records, &blocks);
+
+    std::string data;
+
+    data.reserve(NVM_CHECKPOINT_HEADER_SIZE + dirs.size() + files.size() + block_records.size() + 32);
+    data.resize(NVM_CHECKPOINT_HEADER_SIZE);
+
+    PutVarint64(&data, nvm_api->GetNextFileId());
+    PutVarint64(&data, nr_dirs);
+    data.append(dirs);
+    PutVarint64(&data, nr_files);
+    data.append(files);
+    data.append(block_records);
+
+    const char *body = data.data() + NVM_CHECKPOINT_HEADER_SIZE;
+
+    unsigned long body_len = data.size() - NVM_CHECKPOINT_HEADER_SIZE;
+
+    char *header = &data[0];
+
+    EncodeFixed64(header, NVM_CHECKPOINT_MAGIC);
+    EncodeFixed32(header + 8, NVM_CHECKPOINT_VERSION);
+    EncodeFixed64(header + 12, generation + 1);
+    EncodeFixed64(header + 20, body_len);
+    EncodeFixed32(header + 28, crc32c::Mask(crc32c::Value(body, body_len)));
+    EncodeFixed32(header + 32, crc32c::Mask(crc32c::Value(header, 32)));
+
+    Status s = ReplaceFile(checkpoint_path, data);
+
+    if(!s.ok())
+    {
+	return s;
+    }
+
+    //the old journal now carries a stale generation and is ignored even if
+    //we crash before replacing it
+    ++generation;
+
+    saved_blocks.swap(blocks);
+
+    checkpoint_size = data.size();
+
+    NVM_DEBUG("wrote checkpoint %lu with %lu files in %lu bytes", generation, nr_files, checkpoint_size);
+
+    return CreateJournal();
+}
+
+Status nvm_checkpoint::AppendJournal(nvm_directory *root, const std::vector<unsigned long> &deleted_files)
+{
+    std::string dirs;
+    std::string files;
+
+    unsigned long nr_dirs = 0;
+    unsigned long nr_files = 0;
+
+    EncodeTree(root, "", true, &dirs, &nr_dirs, &files, &nr_files);
+
+    std::string block_records;
+
+    nvm_block_map blocks;
+
+    unsigned long nr_blocks = EncodeBlocks(true, &block_records, &blocks);
+
+    if(nr_files == 0 && deleted_files.empty() && nr_blocks == 0)
+    {
+	return Status::OK();
+    }
+
+    std::string record;
+
+    record.resize(NVM_JOURNAL_RECORD_HEADER_SIZE);
+
+    PutVarint64(&record, nvm_api->GetNextFileId());
+    PutVarint64(&record, deleted_files.size());
+
+    for(unsigned long i = 0; i < deleted_files.size(); ++i)
+    {
+	PutVarint64(&record, deleted_files[i]);
+    }
+
+    PutVarint64(&record, nr_files);
+    record.append(files);
+    record.append(block_records);
+
+    const char *payload = record.data() + NVM_JOURNAL_RECORD_HEADER_SIZE;
+
+    unsigned long payload_len = record.size() - NVM_JOURNAL_RECORD_HEADER_SIZE;
+
+    EncodeFixed32(&record[0], crc32c::Mask(crc32c::Value(payload, payload_len)));
+    EncodeFixed32(&record[4], payload_len);
+
+    Status s = WriteAll(journal_fd, record, journal_path);
+
+    if(s.ok() && fdatasync(journal_fd))
+    {
+	s = IOError(journal_path, errno);
+    }
+
+    if(s.ok())
+    {
+	journal_size += record.size();
+
+	saved_blocks.swap(blocks);
+
+	NVM_DEBUG("journaled %lu files, %lu deletes and %lu blocks", nr_files, deleted_files.size(), nr_blocks);
+    }
+
+    return s;
+}
+
+Status nvm_checkpoint::Save(nvm_directory *root)
+{
+    std::vector<unsigned long> deleted_files;
+
+    Status s;
+
+    pthread_mutex_lock(&save_mtx);
+
+    struct timespec start;
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    //the pages moved by these passes are already in place in the files
+    unsigned long gc_passes = nvm_api->GetGarbageCollectionPasses();
+
+    bool directories_changed = nvm_api->TakeMetadataChanges(&deleted_files);
+
+    if(journal_fd < 0 || directories_changed || journal_size > std::max(checkpoint_size, (unsigned long)NVM_FTL_JOURNAL_MIN_SIZE))
+    {
+	s = WriteCheckpoint(root);
+    }
+    else
+    {
+	s = AppendJournal(root, deleted_files);
+    }
+
+    if(!s.ok() && journal_fd >= 0)
+    {
+	//the changes taken above are lost; only a full checkpoint has them
+	close(journal_fd);
+
+	journal_fd = -1;
+    }
+
+    if(s.ok())
+    {
+	//the blocks those passes emptied can be erased now
+	nvm_api->GarbageCollectionSaved(gc_passes);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    unsigned long nanos = (end.tv_sec - start.tv_sec) * 1000000000UL + end.tv_nsec - start.tv_nsec;
+
+    nvm_api->FtlSaved(nanos / 1000);
+
+    IOSTATS_ADD(nvm_ftl_save_nanos, nanos);
+
+    pthread_mutex_unlock(&save_mtx);
+
+    return s;
+}
+
+Status nvm_checkpoint::ReplayJournal(std::map<unsigned long, nvm_file_desc> *files, nvm_block_map *blocks, unsigned long *next_file_id)
+{
+    int fd = open(journal_path.c_str(), O_RDWR);
+
+    if(fd < 0)
+    {
+	NVM_DEBUG("no journal at %s", journal_path.c_str());
+
+	return Status::OK();
+    }
+
+    struct stat st;
+
+    if(fstat(fd, &st) || (unsigned long)st.st_size < NVM_JOURNAL_HEADER_SIZE)
+    {
+	close(fd);
+
+	return Status::OK();
+    }
+
+    unsigned long file_size = st.st_size;
+
+    void *addr = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if(addr == MAP_FAILED)
+    {
+	close(fd);
+
+	return IOError(journal_path, errno);
+    }
+
+    const char *data = (const char *)addr;
+
+    if(DecodeFixed64(data) != NVM_JOURNAL_MAGIC || DecodeFixed64(data + 8) != generation)
+    {
+	NVM_DEBUG("journal does not belong to checkpoint %lu", generation);
+
+	munmap(addr, file_size);
+	close(fd);
+
+	return Status::OK();
+    }
+
+    unsigned long offset = NVM_JOURNAL_HEADER_SIZE;
+    unsigned long nr_records = 0;
+
+    while(offset + NVM_JOURNAL_RECORD_HEADER_SIZE <= file_size)
+    {
+	uint32_t crc = crc32c::Unmask(DecodeFixed32(data + offset));
+	uint32_t payload_len = DecodeFixed32(data + offset + 4);
+
+	if(offset + NVM_JOURNAL_RECORD_HEADER_SIZE + payload_len > file_size)
+	{
+	    break;
+	}
+
+	const char *payload = data + offset + NVM_JOURNAL_RECORD_HEADER_SIZE;
+
+	if(crc32c::Value(payload, payload_len) != crc)
+	{
+	    break;
+	}
+
+	Slice input(payload, payload_len);
+
+	uint64_t record_next_file_id;
+	uint64_t nr_deleted;
+	uint64_t nr_changed;
+
+	std::vector<unsigned long> deleted;
+	std::vector<nvm_file_desc> changed;
+
+	nvm_block_map changed_blocks;
+
+	bool ok = GetVarint64(&input, &record_next_file_id) && GetVarint64(&input, &nr_deleted);
+
+	for(unsigned long i = 0; ok && i < nr_deleted; ++i)
+	{
+	    uint64_t id;
+
+	    ok = GetVarint64(&input, &id);
+
+	    deleted.push_back(id);
+	}
+
+	ok = ok && GetVarint64(&input, &nr_changed);
+
+	for(unsigned long i = 0; ok && i < nr_changed; ++i)
+	{
+	    changed.push_back(nvm_file_desc());
+
+	    ok = DecodeFile(&input, &changed.back());
+	}
+
+	//records written for a version 1 checkpoint end with the files
+	if(ok && input.size() > 0)
+	{
+	    ok = DecodeBlocks(&input, &changed_blocks);
+	}
+
+	if(ok == false)
+	{
+	    NVM_ERROR("journal record at %lu is corrupt", offset);
+
+	    break;
+	}
+
+	for(unsigned long i = 0; i < deleted.size(); ++i)
+	{
+	    files->erase(deleted[i]);
+	}
+
+	for(unsigned long i = 0; i < changed.size(); ++i)
+	{
+	    (*files)[changed[i].id] = changed[i];
+	}
+
+	for(auto it = changed_blocks.begin(); it != changed_blocks.end(); ++it)
+	{
+	    (*blocks)[it->first] = it->second;
+	}
+
+	*next_file_id = std::max(*next_file_id, (unsigned long)record_next_file_id);
+
+	offset += NVM_JOURNAL_RECORD_HEADER_SIZE + payload_len;
+
+	++nr_records;
+    }
+
+    munmap(addr, file_size);
+
+    //drop a torn tail so new records follow the last good one
+    if(offset < file_size && ftruncate(fd, offset))
+    {
+	close(fd);
+
+	return IOError(journal_path, errno);
+    }
+
+    close(fd);
+
+    journal_fd = open(journal_path.c_str(), O_WRONLY | O_APPEND);
+
+    if(journal_fd < 0)
+    {
+	return IOError(journal_path, errno);
+    }
+
+    journal_size = offset;
+
+    NVM_DEBUG("replayed %lu journal records", nr_records);
+
+    return Status::OK();
+}
+
+Status nvm_checkpoint::Restore(nvm_directory *root, const std::vector<std::string> &dirs, std::map<unsigned long, nvm_file_desc> &files)
+{
+    for(unsigned long i = 0; i < dirs.size(); ++i)
+    {
+	if(root->CreateDirectory(dirs[i].c_str()))
+	{
+	    return Status::Corruption("unable to restore directory", dirs[i]);
+	}
+    }
+
+    for(auto it = files.begin(); it != files.end(); ++it)
+    {
+	nvm_file_desc &desc = it->second;
+
+	if(desc.names.empty())
+	{
+	    continue;
+	}
+
+	nvm_directory *dir = root;
+
+	if(desc.dir_path.length() > 0)
+	{
+	    root->CreateDirectory(desc.dir_path.c_str());
+
+	    dir = root->OpenDirectory(desc.dir_path.c_str());
+
+	    if(dir == nullptr)
+	    {
+		return Status::Corruption("unable to restore directory", desc.dir_path);
+	    }
+	}
+
+	nvm_file *fd = dir->create_file(desc.names[0].c_str());
+
+	if(fd == nullptr)
+	{
+	    return Status::Corruption("unable to restore file", desc.names[0]);
+	}
+
+	for(unsigned long i = 1; i < desc.names.size(); ++i)
+	{
+	    dir->LinkFile(desc.names[0].c_str(), desc.names[i].c_str());
+	}
+
+	for(unsigned long i = 0; i < desc.pages.size(); ++i)
+	{
+	    nvm_page_address &address = desc.pages[i];
+
+	    if(fd->ClaimNewPage(nvm_api, address.lun_id, address.block_id, address.page_id) == false)
+	    {
+		return Status::Corruption("unable to claim page of", desc.names[0]);
+	    }
+	}
+
+	fd->id = desc.id;
+	fd->size = desc.size;
+	fd->last_modified = desc.last_modified;
+
+	fd->dirty = false;
+    }
+
+    return Status::OK();
+}
+
+//reads a decimal number of the text layout up to the terminator
+static bool GetLegacyNumber(Slice *input, const char terminator, unsigned long *value)
+{
+    *value = 0;
+
+    while(input->size() > 0 && (*input)[0] >= '0' && (*input)[0] <= '9')
+    {
+	*value = *value * 10 + (*input)[0] - '0';
+
+	input->remove_prefix(1);
+    }
+
+    if(input->size() == 0 || (*input)[0] != terminator)
+    {
+	return false;
+    }
+
+    input->remove_prefix(1);
+
+    return true;
+}
+
+//f:name,name:size:mtime:lun-block-page,lun-block-page\n
+static bool GetLegacyFile(Slice *input, nvm_file_desc *desc)
+{
+    if(input->size() == 0 || (*input)[0] != ':')
+    {
+	return false;
+    }
+
+    input->remove_prefix(1);
+
+    std::string name;
+
+    while(true)
+    {
+	if(input->size() == 0)
+	{
+	    return false;
+	}
+
+	char c = (*input)[0];
+
+	input->remove_prefix(1);
+
+	if(c == ',' || c == ':')
+	{
+	    desc->names.push_back(name);
+
+	    name.clear();
+
+	    if(c == ':')
+	    {
+		break;
+	    }
+	}
+	else
+	{
+	    name.push_back(c);
+	}
+    }
+
+    unsigned long last_modified;
+
+    if(!GetLegacyNumber(input, ':', &desc->size) || !GetLegacyNumber(input, ':', &last_modified))
+    {
+	return false;
+    }
+
+    desc->last_modified = last_modified;
+
+    if(input->size() > 0 && (*input)[0] == '\n')
+    {
+	input->remove_prefix(1);
+
+	return true;
+    }
+
+    while(true)
+    {
+	nvm_page_address address;
+
+	if(!GetLegacyNumber(input, '-', &address.lun_id) || !GetLegacyNumber(input, '-', &address.block_id))
+	{
+	    return false;
+	}
+
+	desc->pages.push_back(address);
+
+	if(GetLegacyNumber(input, ',', &desc->pages.back().page_id))
+	{
+	    continue;
+	}
+
+	if(input->size() == 0 || (*input)[0] != '\n')
+	{
+	    return false;
+	}
+
+	input->remove_prefix(1);
+
+	return true;
+    }
+}
+
+//:name{entries} after the 'd'; the root's own name is not part of the paths
+static bool GetLegacyDirectory(Slice *input, const std::string &dir_path, std::vector<std::string> *dirs,
+				std::map<unsigned long, nvm_file_desc> *files)
+{
+    if(input->size() == 0 || (*input)[0] != ':')
+    {
+	return false;
+    }
+
+    input->remove_prefix(1);
+
+    while(input->size() > 0 && (*input)[0] != '{')
+    {
+	input->remove_prefix(1);
+    }
+
+    if(input->size() == 0)
+    {
+	return false;
+    }
+
+    input->remove_prefix(1);
+
+    while(input->size() > 0)
+    {
+	char type = (*input)[0];
+
+	input->remove_prefix(1);
+
+	switch(type)
+	{
+	    case 'd':
+	    {
+		const char *name = input->data() + 1;
+
+		const char *brace = (const char *)memchr(input->data(), '{', input->size());
+
+		if(input->size() == 0 || brace == nullptr || brace < name)
+		{
+		    return false;
+		}
+
+		std::string sub_name(name, brace - name);
+
+		std::string sub_path = dir_path.empty() ? sub_name : dir_path + "/" + sub_name;
+
+		dirs->push_back(sub_path);
+
+		if(!GetLegacyDirectory(input, sub_path, dirs, files))
+		{
+		    return false;
+		}
+	    }
+	    break;
+
+	    case 'f':
+	    {
+		nvm_file_desc desc;
+
+		if(!GetLegacyFile(input, &desc))
+		{
+		    return false;
+		}
+
+		//the text layout has no ids; number the files in order
+		desc.id = files->size() + 1;
+		desc.dir_path = dir_path;
+
+		(*files)[desc.id] = desc;
+	    }
+	    break;
+
+	    case '}':
+	    {
+	    }
+	    return true;
+
+	    default:
+	    {
+		NVM_DEBUG("legacy layout is corrupt at %c", type);
+	    }
+	    return false;
+	}
+    }
+
+    return false;
+}
+
+//the layout used to be a text dump of the tree; it is loaded once and
+//written back as a binary checkpoint so the next save does not drop it
+Status nvm_checkpoint::LoadLegacy(nvm_directory *root, Slice input)
+{
+    std::vector<std::string> dirs;
+    std::map<unsigned long, nvm_file_desc> files;
+
+    input.remove_prefix(1);
+
+    if(!GetLegacyDirectory(&input, "", &dirs, &files))
+    {
+	return Status::Corruption("bad text layout", checkpoint_path);
+    }
+
+    Status s = Restore(root, dirs, files);
+
+    if(!s.ok())
+    {
+	return s;
+    }
+
+    RestoreBlocks(nvm_block_map());
+
+    nvm_api->SetNextFileId(files.size() + 1);
+
+    pthread_mutex_lock(&save_mtx);
+
+    s = WriteCheckpoint(root);
+
+    pthread_mutex_unlock(&save_mtx);
+
+    if(!s.ok())
+    {
+	return s;
+    }
+
+    std::vector<unsigned long> ignored;
+
+    nvm_api->TakeMetadataChanges(&ignored);
+
+    NVM_DEBUG("converted text layout with %lu files", files.size());
+
+    return Status::OK();
+}
+
+Status nvm_checkpoint::Load(nvm_directory *root)
+{
+    int fd = open(checkpoint_path.c_str(), O_RDONLY);
+
+    if(fd < 0)
+    {
+	return Status::NotFound(checkpoint_path);
+    }
+
+    struct stat st;
+
+    if(fstat(fd, &st))
+    {
+	close(fd);
+
+	return IOError(checkpoint_path, errno);
+    }
+
+    unsigned long file_size = st.st_size;
+
+    if(file_size == 0)
+    {
+	close(fd);
+
+	return Status::Corruption("checkpoint too short", checkpoint_path);
+    }
+
+    void *addr = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    close(fd);
+
+    if(addr == MAP_FAILED)
+    {
+	return IOError(checkpoint_path, errno);
+    }
+
+    const char *data = (const char *)addr;
+
+    if(data[0] == 'd')
+    {
+	Status s = LoadLegacy(root, Slice(data, file_size));
+
+	munmap(addr, file_size);
+
+	return s;
+    }
+
+    if(file_size < NVM_CHECKPOINT_HEADER_SIZE)
+    {
+	munmap(addr, file_size);
+
+	return Status::Corruption("checkpoint too short", checkpoint_path);
+    }
+
+    unsigned long body_len = DecodeFixed64(data + 20);
+
+    uint32_t version = DecodeFixed32(data + 8);
+
+    if(crc32c::Unmask(DecodeFixed32(data + 32)) != crc32c::Value(data, 32) ||
+       DecodeFixed64(data) != NVM_CHECKPOINT_MAGIC ||
+       version < 1 || version > NVM_CHECKPOINT_VERSION ||
+       body_len > file_size - NVM_CHECKPOINT_HEADER_SIZE ||
+       crc32c::Unmask(DecodeFixed32(data + 28)) != crc32c::Value(data + NVM_CHECKPOINT_HEADER_SIZE, body_len))
+    {
+	munmap(addr, file_size);
+
+	return Status::Corruption("bad checkpoint header or checksum", checkpoint_path);
+    }
+
+    generation = DecodeFixed64(data + 12);
+
+    checkpoint_size = NVM_CHECKPOINT_HEADER_SIZE + body_len;
+
+    Slice input(data + NVM_CHECKPOINT_HEADER_SIZE, body_len);
+
+    uint64_t next_file_id;
+    uint64_t nr_dirs;
+    uint64_t nr_files;
+
+    std::vector<std::string> dirs;
+    std::map<unsigned long, nvm_file_desc> files;
+
+    nvm_block_map blocks;
+
+    bool ok = GetVarint64(&input, &next_file_id) && GetVarint64(&input, &nr_dirs);
+
+    for(unsigned long i = 0; ok && i < nr_dirs; ++i)
+    {
+	Slice dir_path;
+
+	ok = GetLengthPrefixedSlice(&input, &dir_path);
+
+	dirs.push_back(dir_path.ToString());
+    }
+
+    ok = ok && GetVarint64(&input, &nr_files);
+
+    for(unsigned long i = 0; ok && i < nr_files; ++i)
+    {
+	nvm_file_desc desc;
+
+	ok = DecodeFile(&input, &desc);
+
+	files[desc.id] = desc;
+    }
+
+    if(version > 1)
+    {
+	ok = ok && DecodeBlocks(&input, &blocks);
+    }
+
+    munmap(addr, file_size);
+
+    if(ok == false)
+    {
+	return Status::Corruption("bad checkpoint body", checkpoint_path);
+    }
+
+    unsigned long restored_next_file_id = next_file_id;
+
+    Status s = ReplayJournal(&files, &blocks, &restored_next_file_id);
+
+    if(!s.ok())
+    {
+	return s;
+    }
+
+    s = Restore(root, dirs, files);
+
+    if(!s.ok())
+    {
+	return s;
+    }
+
+    RestoreBlocks(blocks);
+
+    if(files.size() > 0)
+    {
+	restored_next_file_id = std::max(restored_next_file_id, files.rbegin()->first + 1);
+    }
+
+    nvm_api->SetNextFileId(restored_next_file_id);
+
+    //what Restore did is already on disk
+    std::vector<unsigned long> ignored;
+
+    nvm_api->TakeMetadataChanges(&ignored);
+
+    NVM_DEBUG("loaded checkpoint %lu with %lu files", generation, files.size());
+
+    return Status::OK();
+}
+
+}
+
+#endif
@@ -0,0 +1,585 @@
+#ifdef ROCKSDB_PLATFORM_NVM
+
+#include "nvm/nvm.h"
+
+nvm_lightnvm_device::nvm_lightnvm_device(const char *_name)
+{
+    fd = -1;
+
+    name = _name;
+}
+
+nvm_lightnvm_device::~nvm_lightnvm_device()
+{
+    Close();
+}
+
+int nvm_lightnvm_device::Open()
+{
+    std::string cmd = std::string("echo \"nba ") + name +
+		      std::string(" 0:0\" > /sys/block/nvme0n1/lightnvm/configure");
+
+    if(system(cmd.c_str()))
+    {
+	return -1;
+    }
+
+    location = std::string("/dev") + name;
+
+    fd = open(location.c_str(), O_RDWR);
+
+    if(fd < 0)
+    {
+	return -1;
+    }
+
+    return 0;
+}
+
+void nvm_lightnvm_device::Close()
+{
+    if(fd >= 0)
+    {
+	close(fd);
+    }
+
+    fd = -1;
+}
+
+int nvm_lightnvm_device::Ioctl(const unsigned long request, void *arg)
+{
+    return ioctl(fd, request, arg);
+}
+
+ssize_t nvm_lightnvm_device::Pread(void *data, const size_t len, const off_t offset)
+{
+    return pread(fd, data, len, offset);
+}
+
+ssize_t nvm_lightnvm_device::Preadv(const struct iovec *iov, const int iovcnt, const off_t offset)
+{
+    return preadv(fd, iov, iovcnt, offset);
+}
+
+ssize_t nvm_lightnvm_device::Pwrite(const void *data, const size_t len, const off_t offset)
+{
+    return pwrite(fd, data, len, offset);
+}
+
+const char *nvm_lightnvm_device::GetLocation()
+{
+    return location.c_str();
+}
+
+nvm_emulator_options::nvm_emulator_options()
+{
+    path = "";
+
+    nr_luns = 4;
+    nr_blocks = 128;
+    nr_pages_per_blk = 128;
+    nr_channels = 1;
+
+    page_size = 4096;
+
+    read_latency_us = 0;
+    write_latency_us = 0;
+    erase_latency_us = 0;
+}
+
+bool nvm_emulator_options::Parse(const char *config)
+{
+    std::string key;
+    std::string value;
+
+    bool in_value = false;
+
+    for(const char *c = config; ; ++c)
+    {
+	if(*c != ',' && *c != '\0')
+	{
+	    if(*c == '=' && in_value == false)
+	    {
+		in_value = true;
+	    }
+	    else if(in_value)
+	    {
+		value.append(c, 1);
+	    }
+	    else
+	    {
+		key.append(c, 1);
+	    }
+
+	    continue;
+	}
+
+	if(key.length() > 0)
+	{
+	    unsigned long number = strtoul(value.c_str(), nullptr, 10);
+
+	    if(key == "path")
+	    {
+		path = value;
+	    }
+	    else if(key == "luns")
+	    {
+		nr_luns = number;
+	    }
+	    else if(key == "blocks")
+	    {
+		nr_blocks = number;
+	    }
+	    else if(key == "pages")
+	    {
+		nr_pages_per_blk = number;
+	    }
+	    else if(key == "channels")
+	    {
+		nr_channels = number;
+	    }
+	    else if(key == "page_size")
+	    {
+		page_size = number;
+	    }
+	    else if(key == "read_us")
+	    {
+		read_latency_us = number;
+	    }
+	    else if(key == "write_us")
+	    {
+		write_latency_us = number;
+	    }
+	    else if(key == "erase_us")
+	    {
+		erase_latency_us = number;
+	    }
+	    else
+	    {
+		NVM_ERROR("unknown emulator option %s", key.c_str());
+
+		return false;
+	    }
+	}
+
+	key = "";
+	value = "";
+
+	in_value = false;
+
+	if(*c == '\0')
+	{
+	    break;
+	}
+    }
+
+    return nr_luns > 0 && nr_blocks > 0 && nr_pages_per_blk > 0 && nr_channels > 0 && page_size > 0;
+}
+
+nvm_emulated_device::nvm_emulated_device(const nvm_emulator_options &_options)
+{
+    options = _options;
+
+    fd = -1;
+
+    mem = nullptr;
+
+    block_size = options.nr_pages_per_blk * options.page_size;
+    lun_size = options.nr_blocks * block_size;
+    device_size = options.nr_luns * lun_size;
+
+    nr_pages = options.nr_luns * options.nr_blocks * options.nr_pages_per_blk;
+
+    programmed_fd = -1;
+
+    programmed = nullptr;
+
+    pthread_mutex_init(&state_mtx, nullptr);
+
+    ALLOC_STRUCT(lun_mtx, options.nr_luns, pthread_mutex_t);
+
+    for(unsigned long i = 0; i < options.nr_luns; ++i)
+    {
+	pthread_mutex_init(&lun_mtx[i], nullptr);
+    }
+}
+
+nvm_emulated_device::~nvm_emulated_device()
+{
+    Close();
+
+    pthread_mutex_destroy(&state_mtx);
+
+    for(unsigned long i = 0; i < options.nr_luns; ++i)
+    {
+	pthread_mutex_destroy(&lun_mtx[i]);
+    }
+
+    free(lun_mtx);
+}
+
+//maps the programmed state of the pages; a new image has none programmed
+int nvm_emulated_device::OpenProgrammed(const bool new_image)
+{
+    void *addr;
+
+    if(options.path.length() > 0)
+    {
+	std::string programmed_path = options.path + NVM_EMULATOR_PROGRAMMED_SUFFIX;
+
+	struct stat st;
+
+	programmed_fd = open(programmed_path.c_str(), O_RDWR | O_CREAT, S_IWUSR | S_IRUSR);
+
+	if(programmed_fd < 0)
+	{
+	    return -1;
+	}
+
+	if(new_image && ftruncate(programmed_fd, 0))
+	{
+	    return -1;
+	}
+
+	if(fstat(programmed_fd, &st) || ((unsigned long)st.st_size < nr_pages && ftruncate(programmed_fd, nr_pages)))
+	{
+	    return -1;
+	}
+
+	addr = mmap(nullptr, nr_pages, PROT_READ | PROT_WRITE, MAP_SHARED, programmed_fd, 0);
+    }
+    else
+    {
+	addr = mmap(nullptr, nr_pages, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+
+    if(addr == MAP_FAILED)
+    {
+	return -1;
+    }
+
+    programmed = (unsigned char *)addr;
+
+    return 0;
+}
+
+int nvm_emulated_device::Open()
+{
+    void *addr;
+
+    bool new_image = true;
+
+    if(options.path.length() > 0)
+    {
+	struct stat st;
+
+	fd = open(options.path.c_str(), O_RDWR | O_CREAT, S_IWUSR | S_IRUSR);
+
+	if(fd < 0)
+	{
+	    return -1;
+	}
+
+	if(fstat(fd, &st))
+	{
+	    Close();
+
+	    return -1;
+	}
+
+	//an image too small for the geometry is laid out anew
+	new_image = (unsigned long)st.st_size < device_size;
+
+	if(new_image && ftruncate(fd, device_size))
+	{
+	    Close();
+
+	    return -1;
+	}
+
+	addr = mmap(nullptr, device_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    else
+    {
+	addr = mmap(nullptr, device_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    }
+
+    if(addr == MAP_FAILED)
+    {
+	Close();
+
+	return -1;
+    }
+
+    mem = (unsigned char *)addr;
+
+    if(OpenProgrammed(new_image))
+    {
+	Close();
+
+	return -1;
+    }
+
+    NVM_DEBUG("emulated device %s: %lu luns, %lu blocks, %lu pages of %u bytes", GetLocation(), options.nr_luns,
+											 options.nr_blocks,
+											 options.nr_pages_per_blk,
+											 options.page_size);
+
+    return 0;
+}
+
+void nvm_emulated_device::Close()
+{
+    if(mem)
+    {
+	munmap(mem, device_size);
+    }
+
+    if(fd >= 0)
+    {
+	close(fd);
+    }
+
+    if(programmed)
+    {
+	munmap(programmed, nr_pages);
+    }
+
+    if(programmed_fd >= 0)
+    {
+	close(programmed_fd);
+    }
+
+    mem = nullptr;
+    fd = -1;
+
+    programmed = nullptr;
+    programmed_fd = -1;
+}
+
+void nvm_emulated_device::InjectLatency(const unsigned long lun_id, const unsigned long us)
+{
+    if(us == 0)
+    {
+	return;
+    }
+
+    struct timespec ts;
+
+    ts.tv_sec = us / 1000000;
+    ts.tv_nsec = (us % 1000000) * 1000;
+
+    pthread_mutex_lock(&lun_mtx[lun_id]);
+
+    while(nanosleep(&ts, &ts) && errno == EINTR);
+
+    pthread_mutex_unlock(&lun_mtx[lun_id]);
+}
+
+int nvm_emulated_device::Ioctl(const unsigned long request, void *arg)
+{
+    switch(request)
+    {
+	case NVMLUNSNRGET:
+	{
+	    *(unsigned long *)arg = options.nr_luns;
+	}
+	return 0;
+
+	case NVMPAGESNRGET:
+	{
+	    *(unsigned long *)arg = options.nr_pages_per_blk;
+	}
+	return 0;
+
+	case NVMCHANNELSNRGET:
+	{
+	    *(unsigned long *)arg = options.nr_channels;
+	}
+	return 0;
+
+	case NVMBLOCKSNRGET:
+	{
+	    *(unsigned long *)arg = options.nr_blocks;
+	}
+	return 0;
+
+	case NVMPAGESIZEGET:
+	{
+	    struct nba_channel *chnl_desc = (struct nba_channel *)arg;
+
+	    if(chnl_desc->lun_idx >= options.nr_luns || chnl_desc->chnl_idx >= options.nr_channels)
+	    {
+		errno = EINVAL;
+		return -1;
+	    }
+
+	    chnl_desc->gran_write = options.page_size;
+	    chnl_desc->gran_read = options.page_size;
+	    chnl_desc->gran_erase = block_size;
+	}
+	return 0;
+
+	case NVMBLOCKGETBYID:
+	{
+	    struct nba_block *blk = (struct nba_block *)arg;
+
+	    if(blk->lun >= options.nr_luns || blk->id >= options.nr_blocks)
+	    {
+		errno = EINVAL;
+		return -1;
+	    }
+
+	    blk->phys_addr = (blk->lun * lun_size + blk->id * block_size) >> 9;
+	    blk->internals = nullptr;
+	}
+	return 0;
+
+	case NVMBLOCKERASE:
+	{
+	    struct nba_block *blk = (struct nba_block *)arg;
+
+	    if(blk->lun >= options.nr_luns || blk->id >= options.nr_blocks)
+	    {
+		errno = EINVAL;
+		return -1;
+	    }
+
+	    unsigned long first_page = (blk->lun * options.nr_blocks + blk->id) * options.nr_pages_per_blk;
+
+	    InjectLatency(blk->lun, options.erase_latency_us);
+
+	    pthread_mutex_lock(&state_mtx);
+
+	    memset(mem + blk->lun * lun_size + blk->id * block_size, 0xff, block_size);
+
+	    memset(programmed + first_page, 0, options.nr_pages_per_blk);
+
+	    pthread_mutex_unlock(&state_mtx);
+	}
+	return 0;
+
+	default:
+	{
+	    NVM_DEBUG("emulator does not implement ioctl %lu", request);
+	}
+	break;
+    }
+
+    errno = ENOTTY;
+    return -1;
+}
+
+ssize_t nvm_emulated_device::Pread(void *data, const size_t len, const off_t offset)
+{
+    if(offset < 0 || (unsigned long)offset + len > device_size)
+    {
+	errno = EINVAL;
+	return -1;
+    }
+
+    if(len == 0)
+    {
+	return 0;
+    }
+
+    unsigned long first_page = offset / options.page_size;
+    unsigned long last_page = (offset + len - 1) / options.page_size;
+
+    InjectLatency(offset / lun_size, options.read_latency_us * (last_page - first_page + 1));
+
+    memcpy(data, mem + offset, len);
+
+    return len;
+}
+
+ssize_t nvm_emulated_device::Preadv(const struct iovec *iov, const int iovcnt, const off_t offset)
+{
+    size_t len = 0;
+
+    for(int i = 0; i < iovcnt; ++i)
+    {
+	len += iov[i].iov_len;
+    }
+
+    if(offset < 0 || (unsigned long)offset + len > device_size)
+    {
+	errno = EINVAL;
+	return -1;
+    }
+
+    if(len == 0)
+    {
+	return 0;
+    }
+
+    unsigned long first_page = offset / options.page_size;
+    unsigned long last_page = (offset + len - 1) / options.page_size;
+
+    InjectLatency(offset / lun_size, options.read_latency_us * (last_page - first_page + 1));
+
+    unsigned char *src = mem + offset;
+
+    for(int i = 0; i < iovcnt; ++i)
+    {
+	memcpy(iov[i].iov_base, src, iov[i].iov_len);
+
+	src += iov[i].iov_len;
+    }
+
+    return len;
+}
+
+ssize_t nvm_emulated_device::Pwrite(const void *data, const size_t len, const off_t offset)
+{
+    if(offset < 0 || (unsigned long)offset + len > device_size || offset % options.page_size)
+    {
+	errno = EINVAL;
+	return -1;
+    }
+
+    if(len == 0)
+    {
+	return 0;
+    }
+
+    unsigned long first_page = offset / options.page_size;
+    unsigned long last_page = (offset + len - 1) / options.page_size;
+
+    pthread_mutex_lock(&state_mtx);
+
+    for(unsigned long i = first_page; i <= last_page; ++i)
+    {
+	if(programmed[i])
+	{
+	    pthread_mutex_unlock(&state_mtx);
+
+	    NVM_ERROR("page %lu programmed twice without erase", i);
+
+	    errno = EIO;
+	    return -1;
+	}
+    }
+
+    memset(programmed + first_page, 1, last_page - first_page + 1);
+
+    pthread_mutex_unlock(&state_mtx);
+
+    InjectLatency(offset / lun_size, options.write_latency_us * (last_page - first_page + 1));
+
+    memcpy(mem + offset, data, len);
+
+    return len;
+}
+
+const char *nvm_emulated_device::GetLocation()
+{
+    if(options.path.length() > 0)
+    {
+	return options.path.c_str();
+    }
+
+    return "anonymous";
+}
+
+#endif
@@ -22,6 +22,10 @@ nvm_directory::nvm_directory(const char *_name, const int n, nvm *_nvm_api, nvm_
     pthread_mutexattr_init(&list_update_mtx_attr);
     pthread_mutexattr_settype(&list_update_mtx_attr, PTHREAD_MUTEX_RECURSIVE);
     pthread_mutex_init(&list_update_mtx, &list_update_mtx_attr);
+
+    pthread_rwlock_init(&index_lock, nullptr);
+
+    path_cache_generation = 0;
 }
 
 nvm_directory::~nvm_directory()
@@ -33,6 +37,8 @@ nvm_directory::~nvm_directory()
     pthread_mutex_destroy(&list_update_mtx);
     pthread_mutexattr_destroy(&list_update_mtx_attr);
 
+    pthread_rwlock_destroy(&index_lock);
+
     //delete all files in the directory
     list_node *temp = head;
 
@@ -71,270 +77,186 @@ bool nvm_directory::HasName(const char *_name, const int n)
     return (name[i] == '\0');
 }
 
-Status nvm_directory::Load(const int fd)
+//checks if the node exists
+list_node *nvm_directory::IndexFind(const char *_name, const int n)
 {
-    std::string _name;
+    list_node *ret = nullptr;
+
+    std::string key(_name, n);
 
-    char readIn;
+    pthread_rwlock_rdlock(&index_lock);
 
-    NVM_DEBUG("loading directory %p", this);
+    auto it = name_index.find(key);
 
-    if(read(fd, &readIn, 1) != 1)
+    if(it != name_index.end())
     {
-	return Status::IOError("Could no read d 1");
+	ret = it->second;
     }
 
-    if(readIn != ':')
-    {
-	NVM_DEBUG("ftl file is corrupt %c at %p", readIn, this);
+    pthread_rwlock_unlock(&index_lock);
 
-	return Status::IOError("Corrupt ftl file");
-    }
+    return ret;
+}
 
-    do
-    {
-	if(read(fd, &readIn, 1) != 1)
-	{
-	    return Status::IOError("Could no read d 1");
-	}
+void nvm_directory::IndexAdd(const char *_name, list_node *node)
+{
+    pthread_rwlock_wrlock(&index_lock);
 
-	if(readIn != '{')
-	{
-	    _name.append(&readIn, 1);
-	}
-    }
-    while(readIn != '{');
+    name_index[_name] = node;
 
-    if(name)
-    {
-	delete[] name;
+    pthread_rwlock_unlock(&index_lock);
+}
 
-	SAFE_ALLOC(name, char[_name.length() + 1]);
+//removes the name only if it still points to node
+void nvm_directory::IndexRemove(const char *_name, list_node *node)
+{
+    pthread_rwlock_wrlock(&index_lock);
+
+    auto it = name_index.find(_name);
+
+    if(it != name_index.end() && it->second == node)
+    {
+	name_index.erase(it);
     }
 
-    strcpy(name, _name.c_str());
+    pthread_rwlock_unlock(&index_lock);
+}
 
-    NVM_DEBUG("Loaded directory %s", name);
+void nvm_directory::IndexRemoveNode(list_node *node)
+{
+    pthread_rwlock_wrlock(&index_lock);
 
-    do
+    for(auto it = name_index.begin(); it != name_index.end(); )
     {
-	if(read(fd, &readIn, 1) != 1)
+	if(it->second == node)
 	{
-	    return Status::IOError("Could no read d 2");
+	    it = name_index.erase(it);
 	}
-
-	switch(readIn)
+	else
 	{
-	    case 'd':
-	    {
-		nvm_directory *load_dir = (nvm_directory *)create_node("d", DirectoryEntry);
-
-		if(!load_dir->Load(fd).ok())
-		{
-		    NVM_DEBUG("directory %p reported corruption", load_dir);
-
-		    return Status::IOError("Corrupt ftl file");
-		}
-	    }
-	    break;
-
-	    case 'f':
-	    {
-		nvm_file *load_file = (nvm_file *)create_node("", FileEntry);
-
-		if(!load_file->Load(fd).ok())
-		{
-		    NVM_DEBUG("File %p reported corruption", load_file);
-
-		    return Status::IOError("Corrupt ftl file");
-		}
-	    }
-	    break;
-
-	    case '}':
-	    {
-	    }
-	    break;
-
-	    default:
-	    {
-		NVM_DEBUG("ftl file is corrupt %c", readIn);
-	    }
-	    return Status::IOError("Corrupt ftl file");
+	    ++it;
 	}
     }
-    while(readIn != '}');
 
-    return Status::OK();
+    pthread_rwlock_unlock(&index_lock);
 }
 
-Status nvm_directory::Save(const int fd)
+//readers see either the old or the new name, never none
+void nvm_directory::IndexRename(const char *crt_name, const char *new_name, list_node *node)
 {
-    if(write(fd, "d:", 2) != 2)
-    {
-	return Status::IOError("Error writing 1");
-    }
+    pthread_rwlock_wrlock(&index_lock);
 
-    int name_len = strlen(name);
+    name_index[new_name] = node;
+    name_index.erase(crt_name);
 
-    if(write(fd, name, name_len) != name_len)
-    {
-	return Status::IOError("Error writing 2");
-    }
+    pthread_rwlock_unlock(&index_lock);
+}
 
-    if(write(fd, "{", 1) != 1)
-    {
-	return Status::IOError("Error writing 3");
-    }
+//resolves a path one component at a time through the directory indexes
+list_node *nvm_directory::walk_path(list_node *prev, const char *look_up_name)
+{
+    nvm_directory *dir = this;
 
-    list_node *temp;
+    list_node *node = prev;
 
-    pthread_mutex_lock(&list_update_mtx);
+    while(true)
+    {
+	int i = 0;
 
-    temp = head;
+	while(look_up_name[i] != '/' && look_up_name[i] != '\0')
+	{
+	    ++i;
+	}
 
-    pthread_mutex_unlock(&list_update_mtx);
+	if(i == 0)
+	{
+	    return node;
+	}
 
-    while(temp != nullptr)
-    {
-	nvm_entry *entry = (nvm_entry *)temp->GetData();
+	node = dir->IndexFind(look_up_name, i);
 
-	switch(entry->GetType())
+	if(node == nullptr)
 	{
-	    case FileEntry:
-	    {
-		nvm_file *process_file = (nvm_file *)entry->GetData();
-
-		if(!process_file->Save(fd).ok())
-		{
-		    return Status::IOError("Error writing 4");
-		}
-	    }
-	    break;
+	    return nullptr;
+	}
 
-	    case DirectoryEntry:
-	    {
-		nvm_directory *process_directory = (nvm_directory *)entry->GetData();
+	if(look_up_name[i] == '\0')
+	{
+	    return node;
+	}
 
-		if(!process_directory->Save(fd).ok())
-		{
-		    return Status::IOError("Error writing 5");
-		}
-	    }
-	    break;
+	nvm_entry *entry = (nvm_entry *)node->GetData();
 
-	    default:
-	    {
-		NVM_FATAL("Unknown entry type!!");
-	    }
-	    break;
+	if(entry->GetType() != DirectoryEntry)
+	{
+	    return nullptr;
 	}
 
-	temp = temp->GetNext();
-    }
+	dir = (nvm_directory *)entry->GetData();
 
-    if(write(fd, "}", 1) != 1)
-    {
-	return Status::IOError("Error writing 3");
+	look_up_name += i + 1;
     }
-
-    return Status::OK();
 }
 
 //checks if the node exists
+//
+//the directory part of a path is resolved through path_cache, which is
+//dropped whenever a directory is deleted anywhere in the tree
 list_node *nvm_directory::node_look_up(list_node *prev, const char *look_up_name)
 {
-    list_node *temp;
-
-    NVM_DEBUG("looking for %s in %s", look_up_name, name);
-
-    int i = 0;
-
-    while(look_up_name[i] != '/' && look_up_name[i] != '\0')
-    {
-	++i;
-    }
-
-    NVM_DEBUG("i is %d", i);
+    const char *last_slash = strrchr(look_up_name, '/');
 
-    if(i == 0)
+    if(last_slash == nullptr || last_slash == look_up_name)
     {
-	NVM_DEBUG("returning prev");
-
-	return prev;
+	return walk_path(prev, look_up_name);
     }
 
-    pthread_mutex_lock(&list_update_mtx);
+    std::string dir_path(look_up_name, last_slash - look_up_name);
 
-    temp = head;
+    list_node *dir_node = nullptr;
 
-    pthread_mutex_unlock(&list_update_mtx);
+    unsigned long generation = nvm_api->GetDirectoryGeneration();
 
-    NVM_DEBUG("mutex released %p", temp);
+    pthread_rwlock_rdlock(&index_lock);
 
-    while(temp != nullptr)
+    if(path_cache_generation == generation)
     {
-	nvm_entry *entry = (nvm_entry *)temp->GetData();
+	auto it = path_cache.find(dir_path);
 
-	switch(entry->GetType())
+	if(it != path_cache.end())
 	{
-	    case FileEntry:
-	    {
-		nvm_file *process_file = (nvm_file *)entry->GetData();
+	    dir_node = it->second;
+	}
+    }
 
-		if(process_file->HasName(look_up_name, i) == false)
-		{
-		    break;
-		}
+    pthread_rwlock_unlock(&index_lock);
 
-		if(look_up_name[i] == '\0')
-		{
-		    NVM_DEBUG("found file at %p", temp);
-
-		    return temp;
-		}
-		else
-		{
-		    return nullptr;
-		}
-	    }
-	    break;
-
-	    case DirectoryEntry:
-	    {
-		nvm_directory *process_directory = (nvm_directory *)entry->GetData();
+    if(dir_node == nullptr)
+    {
+	dir_node = walk_path(nullptr, dir_path.c_str());
 
-		if(process_directory->HasName(look_up_name, i) == false)
-		{
-		    break;
-		}
+	if(dir_node == nullptr || ((nvm_entry *)dir_node->GetData())->GetType() != DirectoryEntry)
+	{
+	    return nullptr;
+	}
 
-		if(look_up_name[i] == '\0')
-		{
-		    NVM_DEBUG("found directory at %p", temp);
+	pthread_rwlock_wrlock(&index_lock);
 
-		    return temp;
-		}
-		else
-		{
-		    return process_directory->node_look_up(temp, look_up_name + i + 1);
-		}
-	    }
-	    break;
+	if(path_cache_generation != generation || path_cache.size() >= NVM_PATH_CACHE_SIZE)
+	{
+	    path_cache.clear();
 
-	    default:
-	    {
-		NVM_FATAL("Unknown entry type!!");
-	    }
-	    break;
+	    path_cache_generation = generation;
 	}
 
-	temp = temp->GetNext();
+	path_cache[dir_path] = dir_node;
+
+	pthread_rwlock_unlock(&index_lock);
     }
 
-    NVM_DEBUG("returning null");
+    nvm_directory *dir = (nvm_directory *)((nvm_entry *)dir_node->GetData())->GetData();
 
-    return nullptr;
+    return dir->walk_path(dir_node, last_slash + 1);
 }
 
 //checks if the node with a specific type exists
@@ -403,9 +325,9 @@ void *nvm_directory::create_node(const char *look_up_name, const nvm_entry_type
 
     pthread_mutex_lock(&list_update_mtx);
 
-    iterator = head;
+    iterator = IndexFind(look_up_name, i);
 
-    while(iterator)
+    if(iterator)
     {
 	entry = (nvm_entry *)iterator->GetData();
 
@@ -415,11 +337,6 @@ void *nvm_directory::create_node(const char *look_up_name, const nvm_entry_type
 	    {
 		fd = (nvm_file *)entry->GetData();
 
-		if(fd->HasName(look_up_name, i) == false)
-		{
-		    break;
-		}
-
 		if(look_up_name[i] != '\0')
 		{
 		    ret = nullptr;
@@ -442,11 +359,6 @@ void *nvm_directory::create_node(const char *look_up_name, const nvm_entry_type
 	    {
 		dd = (nvm_directory *)entry->GetData();
 
-		if(dd->HasName(look_up_name, i) == false)
-		{
-		    break;
-		}
-
 		if(look_up_name[i] != '\0')
 		{
 		    ret = dd->create_node(look_up_name + i + 1, type);
@@ -471,8 +383,6 @@ void *nvm_directory::create_node(const char *look_up_name, const nvm_entry_type
 	    }
 	    break;
 	}
-
-	iterator = iterator->GetNext();
     }
 
     if(look_up_name[i] == '\0')
@@ -481,7 +391,7 @@ void *nvm_directory::create_node(const char *look_up_name, const nvm_entry_type
 	{
 	    case FileEntry:
 	    {
-		ALLOC_CLASS(fd, nvm_file(look_up_name, nvm_api->fd, this));
+		ALLOC_CLASS(fd, nvm_file(look_up_name, this));
 		ALLOC_CLASS(entry, nvm_entry(FileEntry, fd));
 
 		ret = fd;
@@ -524,6 +434,12 @@ void *nvm_directory::create_node(const char *look_up_name, const nvm_entry_type
 
     head = file_node;
 
+    {
+	std::string key(look_up_name, i);
+
+	IndexAdd(key.c_str(), file_node);
+    }
+
 out:
 
     pthread_mutex_unlock(&list_update_mtx);
@@ -542,6 +458,8 @@ int nvm_directory::CreateDirectory(const char *directory_name)
 {
     if(create_node(directory_name, DirectoryEntry) != nullptr)
     {
+	nvm_api->DirectoriesChanged();
+
 	return 0;
     }
 
@@ -619,7 +537,19 @@ void nvm_directory::nvm_fclose(nvm_file *file, const char *mode)
 {
     NVM_DEBUG("closing file at %p with %s", file, mode);
 
-    file->Close(mode);
+    file->Close(mode, nvm_api);
+}
+
+static const char *GetLastPathComponent(const char *path)
+{
+    const char *last_slash = strrchr(path, '/');
+
+    if(last_slash == nullptr)
+    {
+	return path;
+    }
+
+    return last_slash + 1;
 }
 
 int nvm_directory::LinkFile(const char *src, const char *target)
@@ -634,18 +564,33 @@ int nvm_directory::LinkFile(const char *src, const char *target)
 	return -1;
     }
 
-    fd = file_look_up(src);
+    list_node *file_node = node_look_up(src, FileEntry);
 
-    if(fd)
+    if(file_node == nullptr)
     {
-	fd->AddName(target);
+	pthread_mutex_unlock(&list_update_mtx);
+	return -1;
+    }
+
+    fd = (nvm_file *)((nvm_entry *)file_node->GetData())->GetData();
+
+    //a link lives next to the file it points to
+    nvm_directory *dir = fd->GetParent();
 
+    if(OpenParentDirectory(target) != dir)
+    {
 	pthread_mutex_unlock(&list_update_mtx);
-	return 0;
+	return -1;
     }
 
+    const char *target_name = GetLastPathComponent(target);
+
+    fd->AddName(target_name);
+
+    dir->IndexAdd(target_name, file_node);
+
     pthread_mutex_unlock(&list_update_mtx);
-    return -1;
+    return 0;
 }
 
 void nvm_directory::Remove(nvm_file *fd)
@@ -676,6 +621,8 @@ void nvm_directory::Remove(nvm_file *fd)
 
 	NVM_DEBUG("Found file to remove");
 
+	IndexRemoveNode(iterator);
+
 	struct list_node *prev = iterator->GetPrev();
 	struct list_node *next = iterator->GetNext();
 
@@ -725,6 +672,15 @@ void nvm_directory::Add(nvm_file *fd)
 
     head = node;
 
+    std::vector<std::string> names;
+
+    fd->EnumerateNames(&names);
+
+    for(unsigned long i = 0; i < names.size(); ++i)
+    {
+	IndexAdd(names[i].c_str(), node);
+    }
+
     pthread_mutex_unlock(&list_update_mtx);
 }
 
@@ -732,8 +688,6 @@ int nvm_directory::RenameFile(const char *crt_filename, const char *new_filename
 {
     pthread_mutex_lock(&list_update_mtx);
 
-    nvm_file *fd;
-
     nvm_directory *dir = OpenParentDirectory(new_filename);
 
     if(dir == nullptr)
@@ -742,131 +696,153 @@ int nvm_directory::RenameFile(const char *crt_filename, const char *new_filename
 	return 1;
     }
 
-    fd = file_look_up(crt_filename);
+    list_node *file_node = node_look_up(crt_filename, FileEntry);
 
-    if(fd == nullptr)
+    if(file_node == nullptr)
     {
 	pthread_mutex_unlock(&list_update_mtx);
 	return 1;
     }
 
-    DeleteFile(new_filename);
+    nvm_file *fd = (nvm_file *)((nvm_entry *)file_node->GetData())->GetData();
 
-    int last_slash_crt = 0;
-    int i = 0;
+    nvm_directory *crt_dir = fd->GetParent();
+
+    const char *crt_name = GetLastPathComponent(crt_filename);
+    const char *new_name = GetLastPathComponent(new_filename);
 
-    while(crt_filename[i] != '\0')
+    list_node *target_node = dir->walk_path(nullptr, new_name);
+
+    if(target_node == file_node && crt_dir == dir)
     {
-	if(crt_filename[i] == '/')
+	if(strcmp(crt_name, new_name) != 0)
 	{
-	    last_slash_crt = i + 1;
+	    //both names are links to the same file: drop the old one
+	    crt_dir->UnlinkFile(file_node, crt_name);
 	}
 
-	++i;
+	pthread_mutex_unlock(&list_update_mtx);
+	return 0;
     }
 
-    int last_slash_new = 0;
-    i = 0;
-
-    while(new_filename[i] != '\0')
+    if(target_node && ((nvm_entry *)target_node->GetData())->GetType() != FileEntry)
     {
-	if(new_filename[i] == '/')
-	{
-	    last_slash_new = i + 1;
-	}
-
-	++i;
+	pthread_mutex_unlock(&list_update_mtx);
+	return 1;
     }
 
-    fd->ChangeName(crt_filename + last_slash_crt, new_filename + last_slash_new);
+    pthread_mutex_lock(&dir->list_update_mtx);
 
-    if(fd->GetParent() != dir)
+    fd->ChangeName(crt_name, new_name);
+
+    //the new name points to the file before the old one (or the file it
+    //replaces) goes away
+    if(crt_dir == dir)
+    {
+	dir->IndexRename(crt_name, new_name, file_node);
+    }
+    else
     {
 	NVM_DEBUG("Rename is changing directories");
 
-	fd->GetParent()->Remove(fd);
 	dir->Add(fd);
+	crt_dir->Remove(fd);
 	fd->SetParent(dir);
     }
 
+    if(target_node)
+    {
+	dir->UnlinkFile(target_node, new_name);
+    }
+
+    pthread_mutex_unlock(&dir->list_update_mtx);
+
     pthread_mutex_unlock(&list_update_mtx);
     return 0;
 }
 
-int nvm_directory::DeleteFile(const char *filename)
+//drops one name of the file at file_node; the file goes away with its last name
+void nvm_directory::UnlinkFile(list_node *file_node, const char *filename)
 {
-    unsigned char last_slash = 0;
+    nvm_entry *entry = (nvm_entry *)file_node->GetData();
+
+    nvm_file *file = (nvm_file *)entry->GetData();
+
+    IndexRemove(filename, file_node);
 
-    for(unsigned int i = 0; i < strlen(filename); ++i)
+    if(file->Delete(filename, nvm_api) == false)
     {
-	if(filename[i] == '/')
-	{
-	    last_slash = i;
-	}
+	return;
     }
 
-    pthread_mutex_lock(&list_update_mtx);
+    NVM_DEBUG("NO MORE LINKS.. removing from list");
 
-    NVM_DEBUG("Deleting %s", filename);
+    nvm_api->FileDeleted(file->GetId());
 
-    list_node *file_node = node_look_up(filename, FileEntry);
+    IndexRemoveNode(file_node);
 
-    if(file_node)
+    list_node *prev = file_node->GetPrev();
+    list_node *next = file_node->GetNext();
+
+    //we have no more link files
+    if(prev)
     {
-	list_node *prev = file_node->GetPrev();
-	list_node *next = file_node->GetNext();
+	NVM_DEBUG("Prev is not null");
 
-	nvm_entry *entry = (nvm_entry *)file_node->GetData();
+	prev->SetNext(next);
+    }
 
-	nvm_file *file = (nvm_file *)entry->GetData();
+    if(next)
+    {
+	NVM_DEBUG("Next is not null");
 
-	bool ret;
+	next->SetPrev(prev);
+    }
 
-	if(last_slash > 0)
-	{
-	    ret = file->Delete(filename + last_slash + 1, nvm_api);
-	}
-	else
-	{
-	    ret = file->Delete(filename, nvm_api);
-	}
+    if(prev == nullptr && next != nullptr)
+    {
+	NVM_DEBUG("Moving head");
 
-	if(ret)
-	{
-	    NVM_DEBUG("NO MORE LINKS.. removing from list");
+	head = head->GetNext();
+    }
 
-	    //we have no more link files
-	    if(prev)
-	    {
-		NVM_DEBUG("Prev is not null");
+    if(next == nullptr && prev == nullptr)
+    {
+	NVM_DEBUG("Head becomes null");
 
-		prev->SetNext(next);
-	    }
+	head = nullptr;
+    }
 
-	    if(next)
-	    {
-		NVM_DEBUG("Next is not null");
+    delete entry;
+    delete file_node;
+}
 
-		next->SetPrev(prev);
-	    }
+int nvm_directory::DeleteFile(const char *filename)
+{
+    const char *last_slash = strrchr(filename, '/');
 
-	    if(prev == nullptr && next != nullptr)
-	    {
-		NVM_DEBUG("Moving head");
+    if(last_slash != nullptr && last_slash != filename)
+    {
+	//the list and index to update are the ones of the parent
+	nvm_directory *dir = OpenParentDirectory(filename);
 
-		head = head->GetNext();
-	    }
+	if(dir == nullptr)
+	{
+	    return 0;
+	}
 
-	    if(next == nullptr && prev == nullptr)
-	    {
-		NVM_DEBUG("Head becomes null");
+	return dir->DeleteFile(last_slash + 1);
+    }
 
-		head = nullptr;
-	    }
+    pthread_mutex_lock(&list_update_mtx);
 
-	    delete entry;
-	    delete file_node;
-	}
+    NVM_DEBUG("Deleting %s", filename);
+
+    list_node *file_node = node_look_up(filename, FileEntry);
+
+    if(file_node)
+    {
+	UnlinkFile(file_node, filename);
     }
 
     pthread_mutex_unlock(&list_update_mtx);
@@ -1009,6 +985,20 @@ int nvm_directory::GetChildren(const char *_name, std::vector<std::string>* resu
 
 int nvm_directory::DeleteDirectory(const char *_name)
 {
+    const char *last_slash = strrchr(_name, '/');
+
+    if(last_slash != nullptr && last_slash != _name && last_slash[1] != '\0')
+    {
+	nvm_directory *dir = OpenParentDirectory(_name);
+
+	if(dir == nullptr)
+	{
+	    return 0;
+	}
+
+	return dir->DeleteDirectory(last_slash + 1);
+    }
+
     pthread_mutex_lock(&list_update_mtx);
 
     list_node *dir_node = node_look_up(_name, DirectoryEntry);
@@ -1020,6 +1010,11 @@ int nvm_directory::DeleteDirectory(const char *_name)
 	return 0;
     }
 
+    //cached paths may point into the directory
+    nvm_api->DirectoriesChanged();
+
+    IndexRemoveNode(dir_node);
+
     list_node *prev = dir_node->GetPrev();
     list_node *next = dir_node->GetNext();
 
@@ -30,7 +30,29 @@ static size_t GetUniqueIdFromFile(nvm_file *fd, char* id, size_t max_size)
 
 #endif
 
-nvm_file::nvm_file(const char *_name, const int fd, nvm_directory *_parent)
+static nvm_pool_id GetPoolFromName(const char *name)
+{
+    const char *ext = strrchr(name, '.');
+
+    if(ext == nullptr)
+    {
+	return NVM_POOL_META;
+    }
+
+    if(strcmp(ext, ".log") == 0)
+    {
+	return NVM_POOL_WAL;
+    }
+
+    if(strcmp(ext, ".sst") == 0 || strcmp(ext, ".ldb") == 0)
+    {
+	return NVM_POOL_HOT;
+    }
+
+    return NVM_POOL_META;
+}
+
+nvm_file::nvm_file(const char *_name, nvm_directory *_parent)
 {
     char *name;
 
@@ -52,12 +74,16 @@ nvm_file::nvm_file(const char *_name, const int fd, nvm_directory *_parent)
 
     size = 0;
 
-    fd_ = fd;
-
     last_modified = time(nullptr);
 
     pages.clear();
 
+    pool = GetPoolFromName(_name);
+
+    id = _parent == nullptr ? 0 : _parent->GetNVMApi()->NewFileId();
+
+    dirty = true;
+
     opened_for_write = false;
 
     parent = _parent;
@@ -108,60 +134,63 @@ void nvm_file::ReclaimPage(nvm *nvm_api, struct nvm_page *pg)
 {
 #ifdef NVM_ALLOCATE_BLOCKS
 
-    bool has_more_pages_allocated = false;
+    nvm_api->DropPage(pg);
 
-    for(unsigned long i = 0; i < pages.size(); ++i)
-    {
-	if(pages[i]->lun_id != pg->lun_id)
-	{
-	    continue;
-	}
+#else
 
-	if(pages[i]->block_id != pg->block_id)
-	{
-	    continue;
-	}
+    nvm_api->ReclaimPage(pg);
 
-	has_more_pages_allocated = true;
+#endif
+}
 
-	break;
-    }
+#ifdef NVM_ALLOCATE_BLOCKS
 
-    if(has_more_pages_allocated)
-    {
-	return;
-    }
+//claims up to NVM_STRIPE_WIDTH blocks (on different luns) and interleaves
+//their pages so that consecutive file pages can be read and written in parallel
+bool nvm_file::RequestStripe(nvm *nvm_api)
+{
+    std::vector<struct nvm_page *> stripe[NVM_STRIPE_WIDTH];
 
-    for(unsigned long i = 0; i < block_pages.size(); ++i)
-    {
-	if(block_pages[i]->lun_id != pg->lun_id)
-	{
-	    continue;
-	}
+    unsigned long width = 0;
 
-	if(block_pages[i]->block_id != pg->block_id)
+    while(width < NVM_STRIPE_WIDTH && width < nvm_api->GetPoolLuns(pool))
+    {
+	if(nvm_api->RequestBlock(&stripe[width], pool) == false)
 	{
-	    continue;
+	    break;
 	}
 
-	has_more_pages_allocated = true;
-
-	break;
+	++width;
     }
 
-    if(has_more_pages_allocated == false)
+    if(width == 0)
     {
-	NVM_DEBUG("block %lu - %lu has no more pages allocated", pg->lun_id, pg->block_id);
+	return false;
+    }
 
-	nvm_api->ReclaimBlock(pg->lun_id, pg->block_id);
+    unsigned long max_pages = 0;
+
+    for(unsigned long j = 0; j < width; ++j)
+    {
+	max_pages = std::max(max_pages, (unsigned long)stripe[j].size());
     }
 
-#else
+    //pages are handed out from the back
+    for(unsigned long i = max_pages; i > 0; --i)
+    {
+	for(unsigned long j = width; j > 0; --j)
+	{
+	    if(i <= stripe[j - 1].size())
+	    {
+		block_pages.push_back(stripe[j - 1][i - 1]);
+	    }
+	}
+    }
 
-    nvm_api->ReclaimPage(pg);
+    return true;
+}
 
 #endif
-}
 
 struct nvm_page *nvm_file::RequestPage(nvm *nvm_api)
 {
@@ -171,7 +200,7 @@ struct nvm_page *nvm_file::RequestPage(nvm *nvm_api)
 
     if(block_pages.empty())
     {
-	if(nvm_api->RequestBlock(&block_pages) == false)
+	if(RequestStripe(nvm_api) == false)
 	{
 	    return nullptr;
 	}
@@ -194,43 +223,8 @@ struct nvm_page *nvm_file::RequestPage(nvm *nvm_api, const unsigned long lun_id,
 
 #ifdef NVM_ALLOCATE_BLOCKS
 
-    struct nvm_page *ret = nullptr;
-
-retry:
-
-    for(unsigned long i = 0; i < block_pages.size(); ++i)
-    {
-	if(block_pages[i]->lun_id != lun_id)
-	{
-	    continue;
-	}
-
-	if(block_pages[i]->block_id != block_id)
-	{
-	    continue;
-	}
-
-	if(block_pages[i]->id != page_id)
-	{
-	    continue;
-	}
-
-	ret = block_pages[i];
-
-	break;
-    }
-
-    if(ret)
-    {
-	return ret;
-    }
-
-    if(nvm_api->RequestBlock(&block_pages, lun_id, block_id) == false)
-    {
-	return nullptr;
-    }
-
-    goto retry;
+    //the page comes back already mapped in this file
+    return nvm_api->ClaimPage(this, lun_id, block_id, page_id);
 
 #else
 
@@ -264,269 +258,19 @@ void nvm_file::UnlockFile()
     pthread_mutex_unlock(&file_lock);
 }
 
-Status nvm_file::Load(const int fd)
+unsigned long nvm_file::GetId()
 {
-    std::string _name;
-
-    char readIn;
-
-    NVM_DEBUG("loading file %p", this);
-
-    if(read(fd, &readIn, 1) != 1)
-    {
-	return Status::IOError("Could no read f 1");
-    }
-
-    if(readIn != ':')
-    {
-	NVM_DEBUG("ftl file is corrupt %c at %p", readIn, this);
-
-	return Status::IOError("Corrupt ftl file");
-    }
-
-    //load names
-
-    _name = "";
-
-    do
-    {
-	if(read(fd, &readIn, 1) != 1)
-	{
-	    return Status::IOError("Could no read f 2");
-	}
-
-	if(readIn == ',' || readIn == ':')
-	{
-	    NVM_DEBUG("Adding name %s to %p", _name.c_str(), this);
-
-	    AddName(_name.c_str());
-
-	    _name = "";
-	}
-	else
-	{
-	    _name.append(&readIn, 1);
-	}
-    }
-    while(readIn != ':');
-
-    //load size
-
-    size = 0;
-
-    do
-    {
-	if(read(fd, &readIn, 1) != 1)
-	{
-	    return Status::IOError("Could no read f 3");
-	}
-
-	if(readIn >= '0' && readIn <= '9')
-	{
-	    size = size * 10 + readIn - '0';
-	}
-    }
-    while(readIn >= '0' && readIn <= '9');
-
-    if(readIn != ':')
-    {
-	NVM_DEBUG("ftl file is corrupt %c at %p", readIn, this);
-
-	return Status::IOError("Corrupt ftl file");
-    }
-
-    //load last modified
-
-    last_modified = 0;
-
-    do
-    {
-	if(read(fd, &readIn, 1) != 1)
-	{
-	    return Status::IOError("Could no read f 3");
-	}
-
-	if(readIn >= '0' && readIn <= '9')
-	{
-	    last_modified = last_modified * 10 + readIn - '0';
-	}
-    }
-    while(readIn >= '0' && readIn <= '9');
-
-    if(readIn != ':')
-    {
-	NVM_DEBUG("ftl file is corrupt %c at %p", readIn, this);
-
-	return Status::IOError("Corrupt ftl file");
-    }
-
-    do
-    {
-	unsigned long lun_id = 0;
-	unsigned long block_id = 0;
-	unsigned long page_id = 0;
-
-	bool page_to_claim = true;
-
-	do
-	{
-	    if(readIn == '\n')
-	    {
-		page_to_claim = false;
-
-		break;
-	    }
-
-	    if(read(fd, &readIn, 1) != 1)
-	    {
-		return Status::IOError("Could no read f 3");
-	    }
-
-	    if(readIn >= '0' && readIn <= '9')
-	    {
-		lun_id = lun_id * 10 + readIn - '0';
-	    }
-	}
-	while(readIn != '-');
-
-	do
-	{
-	    if(readIn == '\n')
-	    {
-		page_to_claim = false;
-
-		break;
-	    }
-
-	    if(read(fd, &readIn, 1) != 1)
-	    {
-		return Status::IOError("Could no read f 3");
-	    }
-
-	    if(readIn >= '0' && readIn <= '9')
-	    {
-		block_id = block_id * 10 + readIn - '0';
-	    }
-	}
-	while(readIn != '-');
-
-	do
-	{
-	    if(readIn == '\n')
-	    {
-		page_to_claim = false;
-
-		break;
-	    }
-
-	    if(read(fd, &readIn, 1) != 1)
-	    {
-		return Status::IOError("Could no read f 3");
-	    }
-
-	    if(readIn >= '0' && readIn <= '9')
-	    {
-		page_id = page_id * 10 + readIn - '0';
-	    }
-	}
-	while(readIn != ',' && readIn != '\n');
-
-	if(page_to_claim)
-	{
-	    ClaimNewPage(parent->GetNVMApi(), lun_id, block_id, page_id);
-	}
-    }
-    while(readIn != '\n');
-
-    return Status::OK();
+    return id;
 }
 
-Status nvm_file::Save(const int fd)
+void nvm_file::SetPool(const nvm_pool_id _pool)
 {
-    char temp[100];
-
-    unsigned int len;
-
-    std::vector<std::string> _names;
-
-    EnumerateNames(&_names);
-
-    if(write(fd, "f:", 2) != 2)
-    {
-	return Status::IOError("fError writing 2");
-    }
-
-    for(unsigned int i = 0; i < _names.size(); ++i)
-    {
-	if(i > 0)
-	{
-	    if(write(fd, ",", 1) != 1)
-	    {
-		return Status::IOError("fError writing 3");
-	    }
-	}
-
-	len = _names[i].length();
-
-	if(write(fd, _names[i].c_str(), len) != len)
-	{
-	    return Status::IOError("fError writing 4");
-	}
-    }
-
-    if(write(fd, ":", 1) != 1)
-    {
-	return Status::IOError("fError writing 5");
-    }
-
-    len = sprintf(temp, "%lu", GetSize());
-
-    if(write(fd, temp, len) != len)
-    {
-	return Status::IOError("fError writing 6");
-    }
-
-    if(write(fd, ":", 1) != 1)
-    {
-	return Status::IOError("fError writing 7");
-    }
-
-    len = sprintf(temp, "%ld", GetLastModified());
-
-    if(write(fd, temp, len) != len)
-    {
-	return Status::IOError("fError writing 8");
-    }
-
-    if(write(fd, ":", 1) != 1)
-    {
-	return Status::IOError("fError writing 9");
-    }
-
-    for(unsigned int i = 0; i < pages.size(); ++i)
-    {
-	if(i > 0)
-	{
-	    if(write(fd, ",", 1) != 1)
-	    {
-		return Status::IOError("fError writing 10");
-	    }
-	}
-
-	len = sprintf(temp, "%lu-%lu-%lu", pages[i]->lun_id, pages[i]->block_id, pages[i]->id);
-
-	if(write(fd, temp, len) != len)
-	{
-	    return Status::IOError("fError writing 11");
-	}
-    }
-
-    if(write(fd, "\n", 1) != 1)
-    {
-	return Status::IOError("fError writing 12");
-    }
+    pool = _pool;
+}
 
-    return Status::OK();
+nvm_pool_id nvm_file::GetPool()
+{
+    return pool;
 }
 
 bool nvm_file::ClearLastPage(nvm *nvm_api)
@@ -553,7 +297,15 @@ bool nvm_file::ClearLastPage(nvm *nvm_api)
 	return false;
     }
 
-    pages[pages.size() - 1] = pg;
+    pages.Set(pages.size() - 1, pg);
+
+#ifdef NVM_ALLOCATE_BLOCKS
+
+    nvm_api->MapPage(pg, this);
+
+#endif
+
+    dirty = true;
 
     pthread_mutex_unlock(&page_update_mtx);
 
@@ -564,17 +316,19 @@ bool nvm_file::ClaimNewPage(nvm *nvm_api, const unsigned long lun_id, const unsi
 {
     struct nvm_page *new_page = RequestPage(nvm_api, lun_id, block_id, page_id);
 
-    NVM_DEBUG("File at %p claimed page %lu-%lu-%lu", this, new_page->lun_id, new_page->block_id, new_page->id);
-
     if(new_page == nullptr)
     {
 	return false;
     }
 
+    NVM_DEBUG("File at %p claimed page %lu-%lu-%lu", this, new_page->lun_id, new_page->block_id, new_page->id);
+
     pthread_mutex_lock(&page_update_mtx);
 
     pages.push_back(new_page);
 
+    dirty = true;
+
     pthread_mutex_unlock(&page_update_mtx);
 
     return true;
@@ -584,17 +338,25 @@ bool nvm_file::ClaimNewPage(nvm *nvm_api)
 {
     struct nvm_page *new_page = RequestPage(nvm_api);
 
-    NVM_DEBUG("File at %p claimed page %lu-%lu-%lu", this, new_page->lun_id, new_page->block_id, new_page->id);
-
     if(new_page == nullptr)
     {
 	return false;
     }
 
+    NVM_DEBUG("File at %p claimed page %lu-%lu-%lu", this, new_page->lun_id, new_page->block_id, new_page->id);
+
     pthread_mutex_lock(&page_update_mtx);
 
     pages.push_back(new_page);
 
+#ifdef NVM_ALLOCATE_BLOCKS
+
+    nvm_api->MapPage(new_page, this);
+
+#endif
+
+    dirty = true;
+
     pthread_mutex_unlock(&page_update_mtx);
 
     return true;
@@ -613,16 +375,77 @@ time_t nvm_file::GetLastModified()
     return ret;
 }
 
-void nvm_file::Close(const char *mode)
+void nvm_file::Close(const char *mode, struct nvm *nvm_api)
 {
     if(mode[0] == 'r' || mode[0] == 'l')
     {
 	return;
     }
 
-    opened_for_write = false;
+#ifdef NVM_ALLOCATE_BLOCKS
+
+    //what the writer did not use of its blocks is left for the gc to reclaim
+    nvm_api->ReleasePages(&block_pages);
+
+#endif
+
+    opened_for_write = false;
+}
+
+#ifdef NVM_ALLOCATE_BLOCKS
+
+//called by the gc with the allocator locked, so it must not wait for a
+//writer that holds page_update_mtx while it allocates
+bool nvm_file::TryLockPages()
+{
+    if(pthread_mutex_trylock(&meta_mtx))
+    {
+	return false;
+    }
+
+    if(opened_for_write)
+    {
+	pthread_mutex_unlock(&meta_mtx);
+
+	return false;
+    }
+
+    if(pthread_mutex_trylock(&page_update_mtx))
+    {
+	pthread_mutex_unlock(&meta_mtx);
+
+	return false;
+    }
+
+    return true;
+}
+
+void nvm_file::UnlockPages()
+{
+    pthread_mutex_unlock(&page_update_mtx);
+    pthread_mutex_unlock(&meta_mtx);
+}
+
+//dst_pages is indexed by page id inside the block; a null entry leaves the page where it is
+void nvm_file::RelocatePages(const unsigned long lun_id, const unsigned long block_id, struct nvm_page **dst_pages)
+{
+    for(unsigned long i = 0; i < pages.size(); ++i)
+    {
+	struct nvm_page *pg = pages[i];
+
+	if(pg->lun_id != lun_id || pg->block_id != block_id || dst_pages[pg->id] == nullptr)
+	{
+	    continue;
+	}
+
+	pages.Set(i, dst_pages[pg->id]);
+
+	dirty = true;
+    }
 }
 
+#endif
+
 bool nvm_file::CanOpen(const char *mode)
 {
     bool ret = true;
@@ -725,6 +548,8 @@ void nvm_file::AddName(const char *name)
 
     names = name_node;
 
+    dirty = true;
+
     pthread_mutex_unlock(&meta_mtx);
 }
 
@@ -753,6 +578,8 @@ void nvm_file::ChangeName(const char *crt_name, const char *new_name)
 
 	    NVM_DEBUG("SET DATA %s", crt_name_node);
 
+	    dirty = true;
+
 	    pthread_mutex_unlock(&meta_mtx);
 
 	    return;
@@ -764,11 +591,6 @@ void nvm_file::ChangeName(const char *crt_name, const char *new_name)
     pthread_mutex_unlock(&meta_mtx);
 }
 
-int nvm_file::GetFD()
-{
-    return fd_;
-}
-
 unsigned long nvm_file::GetSize()
 {
     unsigned long ret;
@@ -788,6 +610,8 @@ void nvm_file::UpdateFileModificationTime()
 
     last_modified = time(nullptr);
 
+    dirty = true;
+
     pthread_mutex_unlock(&meta_mtx);
 }
 
@@ -804,6 +628,12 @@ void nvm_file::DeleteAllLinks(struct nvm *_nvm_api)
 
     pages.clear();
 
+#ifdef NVM_ALLOCATE_BLOCKS
+
+    _nvm_api->ReleasePages(&block_pages);
+
+#endif
+
     size = 0;
 
     pthread_mutex_unlock(&page_update_mtx);
@@ -868,6 +698,8 @@ bool nvm_file::Delete(const char * filename, struct nvm *nvm_api)
 	    delete[] (char *)temp1->GetData();
 	    delete temp1;
 
+	    dirty = true;
+
 	    break;
 	}
 
@@ -912,7 +744,7 @@ struct nvm_page *nvm_file::GetLastPage(unsigned long *page_idx)
     return ret;
 }
 
-bool nvm_file::SetPage(const unsigned long page_idx, nvm_page *page)
+bool nvm_file::SetPage(nvm *nvm_api, const unsigned long page_idx, nvm_page *page)
 {
     bool ret = false;
 
@@ -920,7 +752,15 @@ bool nvm_file::SetPage(const unsigned long page_idx, nvm_page *page)
 
     if(pages.size() > page_idx)
     {
-	pages[page_idx] = page;
+	pages.Set(page_idx, page);
+
+#ifdef NVM_ALLOCATE_BLOCKS
+
+	nvm_api->MapPage(page, this);
+
+#endif
+
+	dirty = true;
 
 	ret = true;
     }
@@ -932,39 +772,36 @@ bool nvm_file::SetPage(const unsigned long page_idx, nvm_page *page)
 
 struct nvm_page *nvm_file::GetNVMPage(const unsigned long idx)
 {
-    struct nvm_page *ret;
-
-    pthread_mutex_lock(&page_update_mtx);
-
     if(idx < pages.size())
     {
-	ret = pages[idx];
-    }
-    else
-    {
-	ret = nullptr;
+	return pages[idx];
     }
 
-    pthread_mutex_unlock(&page_update_mtx);
-
-    return ret;
+    return nullptr;
 }
 
-size_t nvm_file::ReadPage(const nvm_page *page, const unsigned long channel, struct nvm *nvm_api, void *data)
+static unsigned long GetPageOffset(const nvm_page *page, const unsigned long channel, struct nvm *nvm_api)
 {
-    unsigned long offset;
-
     unsigned long page_size = page->sizes[channel];
     unsigned long block_size = nvm_api->luns[page->lun_id].nr_pages_per_blk * page_size;
     unsigned long lun_size = nvm_api->luns[page->lun_id].nr_blocks * block_size;
 
-    offset = page->lun_id * lun_size + page->block_id * block_size + page->id * page_size;
+    return page->lun_id * lun_size + page->block_id * block_size + page->id * page_size;
+}
+
+//only used by the writer of the file; the gc leaves the pages of a file
+//open for write alone, so the page is not pinned
+size_t nvm_file::ReadPage(const nvm_page *page, const unsigned long channel, struct nvm *nvm_api, void *data)
+{
+    unsigned long offset = GetPageOffset(page, channel, nvm_api);
+
+    unsigned long page_size = page->sizes[channel];
 
     NVM_DEBUG("reading %lu bytes at %lu", page_size, offset);
 
 retry:
 
-    if((unsigned)pread(fd_, data, page_size, offset) != page_size)
+    if((unsigned)nvm_api->dev->Pread(data, page_size, offset) != page_size)
     {
 	if (errno == EINTR)
 	{
@@ -974,6 +811,7 @@ retry:
     }
 
     IOSTATS_ADD(bytes_read, page_size);
+    IOSTATS_ADD(nvm_pages_read, 1);
 
     return page_size;
 }
@@ -982,71 +820,440 @@ size_t nvm_file::WritePage(struct nvm_page *&page, const unsigned long channel,
 {
     unsigned long offset;
 
-    unsigned long page_size = page->sizes[channel];
+    unsigned long page_size = page->sizes[channel];
+
+    struct nvm_page *param_page = page;
+
+    if(data_len > page_size)
+    {
+	NVM_FATAL("out of page bounds");
+    }
+
+retry:
+
+    offset = GetPageOffset(page, channel, nvm_api);
+
+    NVM_DEBUG("writing page %p", page);
+
+    if((unsigned)nvm_api->dev->Pwrite(data, data_len, offset) != data_len)
+    {
+	if (errno == EINTR)
+	{
+	    //EINTR may cause a stale page -> replace page
+
+	    ReclaimPage(nvm_api, page);
+
+	    page = RequestPage(nvm_api);
+
+	    if(page == nullptr)
+	    {
+		return -1;
+	    }
+
+	    goto retry;
+	}
+
+	NVM_ERROR("unable to write data");
+	return -1;
+    }
+
+    pthread_mutex_lock(&page_update_mtx);
+
+    if(param_page == pages[pages.size() - 1])
+    {
+	NVM_DEBUG("Wrote last page");
+
+	unsigned long crt_size_offset = 0;
+
+	crt_size_offset = size % page->sizes[channel];
+
+	if(new_data_len + new_data_offset > crt_size_offset)
+	{
+	    size += (new_data_len + new_data_offset - crt_size_offset);
+
+	    NVM_DEBUG("File %p now has size %lu", this, size);
+	}
+    }
+
+    pthread_mutex_unlock(&page_update_mtx);
+
+    UpdateFileModificationTime();
+
+    IOSTATS_ADD(bytes_written, data_len);
+    IOSTATS_ADD(nvm_pages_written, 1);
+
+    return data_len;
+}
+
+//segments of a read served without allocating
+#define NVM_INLINE_READ_SEGMENTS 32
+
+struct nvm_read_segment
+{
+    unsigned long offset;
+    unsigned long len;
+    unsigned long lun_id;
+
+    //pinned until the read is done
+    struct nvm_page *page;
+
+    char *data;
+};
+
+static bool CompareReadSegments(const nvm_read_segment &a, const nvm_read_segment &b)
+{
+    return a.offset < b.offset;
+}
+
+//the gc moves a page by replacing its entry and erases the old block once
+//no reader is pinned on it, so the entry is looked up again after pinning:
+//if it is still the same, the gc has not erased the block and will not
+//until UnpinBlock()
+struct nvm_page *nvm_file::PinPage(const unsigned long idx, struct nvm *nvm_api)
+{
+    while(true)
+    {
+	struct nvm_page *pg = pages[idx];
+
+	nvm_api->PinBlock(pg);
+
+	if(pages[idx] == pg)
+	{
+	    return pg;
+	}
+
+	nvm_api->UnpinBlock(pg);
+    }
+}
+
+//reads len bytes of the file starting at offset straight into data
+//Returns the number of bytes read (short only past the last page) or -1 on
+//error
+ssize_t nvm_file::ReadRange(const unsigned long offset, const unsigned long len, const unsigned long channel, struct nvm *nvm_api, char *data)
+{
+    ssize_t read;
+
+    ReadRanges(&offset, &len, &data, 1, channel, nvm_api, &read);
+
+    return read;
+}
+
+//reads lens[i] bytes of the file starting at offsets[i] straight into
+//data[i] for each of the count ranges, setting read[i] as ReadRange() returns
+//
+//the pieces of all the ranges are sorted by their device offset and pieces
+//that are next to each other on the device are fetched with one preadv; runs
+//on different luns are served in parallel. If any run fails, every range is
+//reported as failed. Returns false on error
+bool nvm_file::ReadRanges(const unsigned long *offsets, const unsigned long *lens, char * const *data, const unsigned long count, const unsigned long channel, struct nvm *nvm_api, ssize_t *read)
+{
+    //entries below this stay readable, though the gc may move them under us
+    //(see PinPage())
+    unsigned long nr_pages = pages.size();
+
+    for(unsigned long r = 0; r < count; ++r)
+    {
+	read[r] = 0;
+    }
+
+    if(nr_pages == 0)
+    {
+	return true;
+    }
+
+    unsigned long page_size = pages[0]->sizes[channel];
+
+    autovector<nvm_read_segment, NVM_INLINE_READ_SEGMENTS> segments;
+
+    unsigned long total = 0;
+
+    for(unsigned long r = 0; r < count; ++r)
+    {
+	unsigned long done = 0;
+
+	while(done < lens[r])
+	{
+	    unsigned long page_idx = (offsets[r] + done) / page_size;
+
+	    if(page_idx >= nr_pages)
+	    {
+		break;
+	    }
+
+	    struct nvm_page *pg = PinPage(page_idx, nvm_api);
+
+	    unsigned long page_pointer = (offsets[r] + done) % page_size;
+
+	    nvm_read_segment segment;
+
+	    segment.offset = GetPageOffset(pg, channel, nvm_api) + page_pointer;
+	    segment.len = std::min(lens[r] - done, page_size - page_pointer);
+	    segment.lun_id = pg->lun_id;
+	    segment.page = pg;
+	    segment.data = data[r] + done;
+
+	    segments.push_back(segment);
+
+	    done += segment.len;
+	}
+
+	read[r] = done;
+	total += done;
+    }
+
+    if(total == 0)
+    {
+	return true;
+    }
+
+    std::sort(segments.begin(), segments.end(), CompareReadSegments);
+
+    //a run points into iov, so it has to be one contiguous array
+    struct iovec iov_buf[NVM_INLINE_READ_SEGMENTS];
+    struct iovec *iov = iov_buf;
+
+    if(segments.size() > NVM_INLINE_READ_SEGMENTS)
+    {
+	SAFE_ALLOC(iov, struct iovec[segments.size()]);
+    }
+
+    for(unsigned long i = 0; i < segments.size(); ++i)
+    {
+	iov[i].iov_base = segments[i].data;
+	iov[i].iov_len = segments[i].len;
+    }
+
+    autovector<nvm_io_request, 8> requests;
+
+    for(unsigned long i = 0; i < segments.size(); ++i)
+    {
+	if(requests.size() > 0)
+	{
+	    nvm_io_request &last = requests.back();
+
+	    if(last.lun_id == segments[i].lun_id && last.offset + last.len == segments[i].offset && last.iovcnt < IOV_MAX)
+	    {
+		last.len += segments[i].len;
+		++last.iovcnt;
+
+		continue;
+	    }
+	}
+
+	nvm_io_request request;
+
+	request.write = false;
+	request.data = segments[i].data;
+	request.iov = &iov[i];
+	request.iovcnt = 1;
+	request.len = segments[i].len;
+	request.offset = segments[i].offset;
+	request.lun_id = segments[i].lun_id;
+
+	requests.push_back(request);
+    }
+
+    nvm_io_batch batch;
+
+    //the last run is served by the calling thread
+    for(unsigned long i = 0; i + 1 < requests.size(); ++i)
+    {
+	requests[i].batch = &batch;
+
+	nvm_api->io->Submit(&requests[i]);
+    }
+
+    nvm_io_request &inline_request = requests.back();
+
+    nvm_io_scheduler::Execute(nvm_api->dev, &inline_request);
+
+    bool ok = batch.Wait();
+
+    for(unsigned long i = 0; i < segments.size(); ++i)
+    {
+	nvm_api->UnpinBlock(segments[i].page);
+    }
+
+    if(iov != iov_buf)
+    {
+	delete[] iov;
+    }
+
+    if(ok == false || inline_request.ret != (ssize_t)inline_request.len)
+    {
+	NVM_ERROR("unable to read %lu bytes in %lu ranges", total, count);
+
+	for(unsigned long r = 0; r < count; ++r)
+	{
+	    read[r] = -1;
+	}
+
+	return false;
+    }
+
+    IOSTATS_ADD(bytes_read, total);
+    IOSTATS_ADD(nvm_pages_read, segments.size());
+
+    return true;
+}
+
+//writes count pages starting with the page at first_page_idx (all already
+//claimed) in parallel; data_len bytes of data are valid
+bool nvm_file::AppendPages(const unsigned long first_page_idx, const unsigned long count, const unsigned long channel, struct nvm *nvm_api, void *data, const unsigned long data_len)
+{
+    nvm_pending_append *append = SubmitAppend(first_page_idx, count, channel, nvm_api, data, data_len, false);
+
+    if(append == nullptr)
+    {
+	return false;
+    }
+
+    return CompleteAppend(append, nvm_api);
+}
+
+//a single page is written by the caller itself unless async is set
+nvm_pending_append *nvm_file::SubmitAppend(const unsigned long first_page_idx, const unsigned long count, const unsigned long channel, struct nvm *nvm_api, void *data, const unsigned long data_len, const bool async)
+{
+    nvm_pending_append *append;
+
+    ALLOC_CLASS(append, nvm_pending_append());
+
+    append->first_page_idx = first_page_idx;
+    append->count = count;
+    append->channel = channel;
+    append->data_len = data_len;
+
+    SAFE_ALLOC(append->write_pages, struct nvm_page *[count]);
+
+    pthread_mutex_lock(&page_update_mtx);
+
+    if(first_page_idx + count > pages.size())
+    {
+	pthread_mutex_unlock(&page_update_mtx);
+
+	delete[] append->write_pages;
+	delete append;
+
+	NVM_ERROR("appending to pages that were not claimed");
+
+	return nullptr;
+    }
+
+    for(unsigned long i = 0; i < count; ++i)
+    {
+	append->write_pages[i] = pages[first_page_idx + i];
+    }
+
+    pthread_mutex_unlock(&page_update_mtx);
+
+    unsigned long page_size = append->write_pages[0]->sizes[channel];
+
+    SAFE_ALLOC(append->requests, nvm_io_request[count]);
+
+    for(unsigned long i = 0; i < count; ++i)
+    {
+	nvm_io_request *request = &append->requests[i];
+
+	request->write = true;
+	request->data = (char *)data + i * page_size;
+	request->len = page_size;
+	request->offset = GetPageOffset(append->write_pages[i], channel, nvm_api);
+	request->lun_id = append->write_pages[i]->lun_id;
+	request->batch = &append->batch;
+
+	if(count == 1 && async == false)
+	{
+	    nvm_io_scheduler::Execute(nvm_api->dev, request);
+	}
+	else
+	{
+	    nvm_api->io->Submit(request);
+	}
+    }
+
+    return append;
+}
+
+bool nvm_file::CompleteAppend(nvm_pending_append *append, struct nvm *nvm_api)
+{
+    append->batch.Wait();
+
+    unsigned long first_page_idx = append->first_page_idx;
+    unsigned long count = append->count;
+    unsigned long channel = append->channel;
+
+    struct nvm_page **write_pages = append->write_pages;
+    nvm_io_request *requests = append->requests;
 
-    struct nvm_page *param_page = page;
+    unsigned long page_size = write_pages[0]->sizes[channel];
 
-    if(data_len > page_size)
-    {
-	NVM_FATAL("out of page bounds");
-    }
+    bool ret = true;
 
-    unsigned long block_size = nvm_api->luns[page->lun_id].nr_pages_per_blk * page_size;
-    unsigned long lun_size = nvm_api->luns[page->lun_id].nr_blocks * block_size;
+    for(unsigned long i = 0; i < count; ++i)
+    {
+	if(requests[i].ret == (ssize_t)page_size)
+	{
+	    continue;
+	}
 
-    offset = page->lun_id * lun_size + page->block_id * block_size + page->id * page_size;
+	//retry on a fresh page
+	struct nvm_page *wrote_pg = write_pages[i];
 
-retry:
+	ReclaimPage(nvm_api, wrote_pg);
 
-    NVM_DEBUG("writing page %p", page);
+	wrote_pg = RequestPage(nvm_api);
 
-    if((unsigned)pwrite(fd_, data, data_len, offset) != data_len)
-    {
-	if (errno == EINTR)
+	if(wrote_pg == nullptr)
 	{
-	    //EINTR may cause a stale page -> replace page
+	    ret = false;
 
-	    ReclaimPage(nvm_api, page);
+	    break;
+	}
 
-	    page = RequestPage(nvm_api);
+	requests[i].offset = GetPageOffset(wrote_pg, channel, nvm_api);
 
-	    if(page == nullptr)
-	    {
-		return -1;
-	    }
+	nvm_io_scheduler::Execute(nvm_api->dev, &requests[i]);
 
-	    goto retry;
+	if(requests[i].ret != (ssize_t)page_size)
+	{
+	    NVM_ERROR("unable to write data");
+
+	    ret = false;
+
+	    break;
 	}
 
-	NVM_ERROR("unable to write data");
-	return -1;
+	SetPage(nvm_api, first_page_idx + i, wrote_pg);
     }
 
-    pthread_mutex_lock(&page_update_mtx);
+    unsigned long data_len = append->data_len;
 
-    if(param_page == pages[pages.size() - 1])
-    {
-	NVM_DEBUG("Wrote last page");
+    delete[] requests;
+    delete[] write_pages;
+    delete append;
 
-	unsigned long crt_size_offset = 0;
+    if(ret == false)
+    {
+	return false;
+    }
 
-	crt_size_offset = size % page->sizes[channel];
+    pthread_mutex_lock(&page_update_mtx);
 
-	if(new_data_len + new_data_offset > crt_size_offset)
-	{
-	    size += (new_data_len + new_data_offset - crt_size_offset);
+    if(first_page_idx * page_size + data_len > size)
+    {
+	size = first_page_idx * page_size + data_len;
 
-	    NVM_DEBUG("File %p now has size %lu", this, size);
-	}
+	NVM_DEBUG("File %p now has size %lu", this, size);
     }
 
     pthread_mutex_unlock(&page_update_mtx);
 
     UpdateFileModificationTime();
 
-    IOSTATS_ADD(bytes_written, data_len);
+    IOSTATS_ADD(bytes_written, count * page_size);
+    IOSTATS_ADD(nvm_pages_written, count);
 
-    return data_len;
+    return true;
 }
 
 NVMSequentialFile::NVMSequentialFile(const std::string& fname, nvm_file *f, nvm_directory *_dir) :
@@ -1086,13 +1293,15 @@ void NVMSequentialFile::SeekPage(const unsigned long offset)
 	}
     }
 
+    unsigned long page_size = crt_page->sizes[channel];
+
     page_pointer += offset;
 
-    crt_page_idx += (unsigned long)(page_pointer / crt_page->sizes[channel]);
+    crt_page_idx += (unsigned long)(page_pointer / page_size);
 
     crt_page = file_->GetNVMPage(crt_page_idx);
 
-    page_pointer %= crt_page->sizes[channel];
+    page_pointer %= page_size;
 }
 
 Status NVMSequentialFile::Read(size_t n, Slice* result, char* scratch)
@@ -1110,51 +1319,16 @@ Status NVMSequentialFile::Read(size_t n, Slice* result, char* scratch)
 	return Status::OK();
     }
 
-    SeekPage(0);
+    ssize_t l = file_->ReadRange(file_pointer, n, channel, nvm_api, scratch);
 
-    if(crt_page == nullptr)
+    if(l < 0)
     {
-	NVM_DEBUG("crt_page is null");
-
-	*result = Slice(scratch, 0);
-	return Status::OK();
+	return Status::IOError(filename_, "unable to read pages");
     }
 
-    size_t len = n;
-    size_t l;
-    size_t scratch_offset = 0;
-    size_t size_to_copy;
-
-    char *data;
-
-    SAFE_ALLOC(data, char[crt_page->sizes[channel]]);
-
-    while(len > 0)
-    {
-	l = file_->ReadPage(crt_page, channel, nvm_api, data);
-
-	if(len > l - page_pointer)
-	{
-	    size_to_copy = l - page_pointer;
-	}
-	else
-	{
-	    size_to_copy = len;
-	}
-
-	NVM_DEBUG("copy %lu to scratch from offset %lu", size_to_copy, scratch_offset);
-
-	memcpy(scratch + scratch_offset, data + page_pointer, size_to_copy);
-
-	len -= size_to_copy;
-	scratch_offset += size_to_copy;
-
-	SeekPage(size_to_copy);
+    n = l;
 
-	NVM_DEBUG("page pointer becomes %lu and page is %p", page_pointer, crt_page);
-    }
-
-    delete[] data;
+    SeekPage(n);
 
     file_pointer += n;
 
@@ -1211,25 +1385,8 @@ NVMRandomAccessFile::~NVMRandomAccessFile()
     dir->nvm_fclose(file_, "r");
 }
 
-struct nvm_page *NVMRandomAccessFile::SeekPage(const unsigned long offset, unsigned long *page_pointer, unsigned long *page_idx) const
-{
-    struct nvm_page *crt_page = file_->GetNVMPage(0);
-
-    *page_pointer = offset;
-
-    *page_idx = (unsigned long)(*page_pointer / crt_page->sizes[channel]);
-
-    *page_pointer %= crt_page->sizes[channel];
-
-    crt_page = file_->GetNVMPage(*page_idx);
-
-    return crt_page;
-}
-
 Status NVMRandomAccessFile::Read(uint64_t offset, size_t n, Slice* result, char* scratch) const
 {
-    unsigned long page_pointer;
-
     if(offset >= file_->GetSize())
     {
 	NVM_DEBUG("offset is out of bounds");
@@ -1251,58 +1408,61 @@ Status NVMRandomAccessFile::Read(uint64_t offset, size_t n, Slice* result, char*
 	return Status::OK();
     }
 
-    size_t len = n;
-    size_t l;
-    size_t scratch_offset = 0;
-    size_t size_to_copy;
+    ssize_t l = file_->ReadRange(offset, n, channel, nvm_api, scratch);
 
-    char *data;
+    if(l < 0)
+    {
+	return Status::IOError(filename_, "unable to read pages");
+    }
 
-    unsigned long page_idx;
+    NVM_DEBUG("read %ld bytes", l);
 
-    struct nvm_page *crt_page = SeekPage(offset, &page_pointer, &page_idx);
+    *result = Slice(scratch, l);
 
-    if(crt_page == nullptr)
-    {
-	*result = Slice(scratch, 0);
-	return Status::OK();
-    }
+    return Status::OK();
+}
 
-    SAFE_ALLOC(data, char[crt_page->sizes[channel]]);
+//all the requests are read with one ReadRanges(), so the pages of different
+//requests are fetched in parallel too
+Status NVMRandomAccessFile::MultiRead(ReadRequest* reqs, size_t num_reqs) const
+{
+    unsigned long file_size = file_->GetSize();
 
-    while(len > 0)
-    {
-	if(crt_page == nullptr)
-	{
-	    n -= len;
-	    break;
-	}
+    autovector<unsigned long, 8> offsets;
+    autovector<unsigned long, 8> lens;
+    autovector<char *, 8> data;
+    autovector<ssize_t, 8> read;
 
-	l = file_->ReadPage(crt_page, channel, nvm_api, data);
+    for(size_t i = 0; i < num_reqs; ++i)
+    {
+	unsigned long len = 0;
 
-	if(len > l - page_pointer)
-	{
-	    size_to_copy = l - page_pointer;
-	}
-	else
+	if(reqs[i].offset < file_size)
 	{
-	    size_to_copy = len;
+	    len = std::min((unsigned long)reqs[i].len, file_size - (unsigned long)reqs[i].offset);
 	}
 
-	memcpy(scratch + scratch_offset, data + page_pointer, size_to_copy);
-
-	len -= size_to_copy;
-	scratch_offset += size_to_copy;
-
-	crt_page = file_->GetNVMPage(++page_idx);
-	page_pointer = 0;
+	offsets.push_back(reqs[i].offset);
+	lens.push_back(len);
+	data.push_back(reqs[i].scratch);
+	read.push_back(0);
     }
 
-    delete[] data;
+    file_->ReadRanges(&offsets[0], &lens[0], &data[0], num_reqs, channel, nvm_api, &read[0]);
 
-    NVM_DEBUG("read %lu bytes", n);
+    for(size_t i = 0; i < num_reqs; ++i)
+    {
+	if(read[i] < 0)
+	{
+	    reqs[i].result = Slice(reqs[i].scratch, 0);
+	    reqs[i].status = Status::IOError(filename_, "unable to read pages");
 
-    *result = Slice(scratch, n);
+	    continue;
+	}
+
+	reqs[i].result = Slice(reqs[i].scratch, read[i]);
+	reqs[i].status = Status::OK();
+    }
 
     return Status::OK();
 }
@@ -1333,6 +1493,15 @@ NVMWritableFile::NVMWritableFile(const std::string& fname, nvm_file *fd, nvm_dir
     channel = 0;
 
     buf_ = nullptr;
+    cursize_ = 0;
+    bytes_per_sync_ = 0;
+    page_size_ = 0;
+
+    wal_mode = fd->GetPool() == NVM_POOL_WAL;
+
+    spare_buf_ = nullptr;
+    in_flight = nullptr;
+
     last_page = nullptr;
     last_page_idx = 0;
 
@@ -1354,66 +1523,86 @@ NVMWritableFile::~NVMWritableFile()
 	delete[] buf_;
     }
 
+    if(spare_buf_)
+    {
+	delete[] spare_buf_;
+    }
+
     buf_ = nullptr;
+    spare_buf_ = nullptr;
 }
 
+//positions the write buffer on the last page of the file
 bool NVMWritableFile::UpdateLastPage()
 {
-    if(last_page)
+    NVM_DEBUG("last page is null");
+
+    last_page = fd_->GetLastPage(&last_page_idx);
+
+    if(last_page != nullptr && fd_->GetSize() >= (last_page_idx + 1) * last_page->sizes[channel])
+    {
+	//last page is full; start on a fresh one
+	last_page = nullptr;
+    }
+
+    if(last_page == nullptr)
     {
+	NVM_DEBUG("need to claim page");
+
 	if(fd_->ClaimNewPage(dir_->GetNVMApi()) == false)
 	{
 	    return false;
 	}
 
-	NVM_DEBUG("last page is not null, iterating");
-
 	last_page = fd_->GetLastPage(&last_page_idx);
-
-	bytes_per_sync_ = last_page->sizes[channel];
-
-	cursize_ = 0;
     }
-    else
-    {
-	NVM_DEBUG("last page is null");
 
-	last_page = fd_->GetLastPage(&last_page_idx);
+    page_size_ = last_page->sizes[channel];
+    bytes_per_sync_ = page_size_ * NVM_WRITE_BUFFER_PAGES;
 
-	if(last_page == nullptr)
-	{
-	    NVM_DEBUG("need to claim page");
+    cursize_ = fd_->GetSize() - last_page_idx * page_size_;
 
-	    if(fd_->ClaimNewPage(dir_->GetNVMApi()) == false)
-	    {
-		return false;
-	    }
+    if(buf_ == nullptr)
+    {
+	SAFE_ALLOC(buf_, char[bytes_per_sync_]);
+    }
 
-	    last_page = fd_->GetLastPage(&last_page_idx);
-	}
+    if(wal_mode && spare_buf_ == nullptr)
+    {
+	SAFE_ALLOC(spare_buf_, char[bytes_per_sync_]);
+    }
 
-	bytes_per_sync_ = last_page->sizes[channel];
+    if(cursize_ > 0)
+    {
+	//swap last page to be ready for page write
 
-	cursize_ = fd_->GetSize() % last_page->sizes[channel];
+	fd_->ReadPage(last_page, channel, dir_->GetNVMApi(), buf_);
+	fd_->ClearLastPage(dir_->GetNVMApi());
 
-	SAFE_ALLOC(buf_, char[bytes_per_sync_]);
+	last_page = fd_->GetLastPage(&last_page_idx);
+    }
 
-	if(cursize_ > 0)
-	{
-	    //swap last page to be ready for page write
+    NVM_DEBUG("last page is at %p, buffer size is %lu, cursize_ is %lu", last_page, bytes_per_sync_, cursize_);
 
-	    fd_->ReadPage(last_page, channel, dir_->GetNVMApi(), buf_);
-	    fd_->ClearLastPage(dir_->GetNVMApi());
+    return true;
+}
 
-	    last_page = fd_->GetLastPage(&last_page_idx);
-	}
+bool NVMWritableFile::WaitInFlight()
+{
+    if(in_flight == nullptr)
+    {
+	return true;
     }
 
-    NVM_DEBUG("last page is at %p, bytes per sync is %lu, cursize_ is %lu", last_page, bytes_per_sync_, cursize_);
+    bool ret = fd_->CompleteAppend(in_flight, dir_->GetNVMApi());
 
-    return true;
+    in_flight = nullptr;
+
+    return ret;
 }
 
+//writes every complete page in the buffer (and the partial tail when
+//closing) as one parallel batch
 bool NVMWritableFile::Flush(const bool closing)
 {
     if(cursize_ == 0)
@@ -1435,35 +1624,91 @@ bool NVMWritableFile::Flush(const bool closing)
 	NVM_FATAL("last page is null, cursize is %lu, byte_per_sync is %lu", cursize_, bytes_per_sync_);
     }
 
-    if(cursize_ == bytes_per_sync_ || closing)
+    nvm *nvm_api = dir_->GetNVMApi();
+
+    unsigned long full_pages = cursize_ / page_size_;
+    unsigned long write_pages = full_pages;
+
+    if(closing && cursize_ % page_size_)
+    {
+	++write_pages;
+    }
+
+    if(write_pages == 0)
     {
-	struct nvm_page *wrote_pg = last_page;
+	return true;
+    }
 
-	if(fd_->WritePage(wrote_pg, channel, dir_->GetNVMApi(), buf_, wrote_pg->sizes[channel], 0, cursize_) != wrote_pg->sizes[channel])
+    //the first page of the buffer is already claimed
+    for(unsigned long i = 1; i < write_pages; ++i)
+    {
+	if(fd_->ClaimNewPage(nvm_api) == false)
 	{
-	    NVM_DEBUG("unable to write data");
 	    return false;
 	}
+    }
+
+    //the spare buffer is free once the write before this one is done
+    if(WaitInFlight() == false)
+    {
+	return false;
+    }
+
+    if(wal_mode && closing == false)
+    {
+	in_flight = fd_->SubmitAppend(last_page_idx, write_pages, channel, nvm_api, buf_, full_pages * page_size_, true);
 
-	if(last_page != wrote_pg)
+	if(in_flight == nullptr)
 	{
-	    last_page = wrote_pg;
+	    return false;
+	}
 
-	    if(fd_->SetPage(last_page_idx, last_page) == false)
-	    {
-		NVM_FATAL("unable to update last page after EINTR");
-	    }
+	//appends go on in the other buffer while these pages are written
+	std::swap(buf_, spare_buf_);
+
+	cursize_ -= full_pages * page_size_;
+
+	if(cursize_ > 0)
+	{
+	    memcpy(buf_, spare_buf_ + full_pages * page_size_, cursize_);
 	}
 
-	if(cursize_ == bytes_per_sync_)
+	if(fd_->ClaimNewPage(nvm_api) == false)
 	{
-	    if(UpdateLastPage() == false)
-	    {
-		return false;
-	    }
+	    return false;
 	}
+
+	last_page = fd_->GetLastPage(&last_page_idx);
+
+	return true;
     }
 
+    if(fd_->AppendPages(last_page_idx, write_pages, channel, nvm_api, buf_, cursize_) == false)
+    {
+	NVM_DEBUG("unable to write data");
+	return false;
+    }
+
+    if(write_pages != full_pages)
+    {
+	//the partial tail was programmed on close; nothing follows it
+	return true;
+    }
+
+    cursize_ -= full_pages * page_size_;
+
+    if(cursize_ > 0)
+    {
+	memmove(buf_, buf_ + full_pages * page_size_, cursize_);
+    }
+
+    if(fd_->ClaimNewPage(nvm_api) == false)
+    {
+	return false;
+    }
+
+    last_page = fd_->GetLastPage(&last_page_idx);
+
     return true;
 }
 
@@ -1491,29 +1736,20 @@ Status NVMWritableFile::Append(const Slice& data)
 
     while(left > 0)
     {
-	NVM_DEBUG("Appending slice %lu bytes", left);
-
-	if(cursize_ + left <= bytes_per_sync_)
-	{
-	    NVM_DEBUG("All in buffer from %lu to %p", cursize_, buf_);
-
-	    memcpy(buf_ + cursize_, src + offset, left);
+	size_t size_to_copy = std::min(left, (size_t)(bytes_per_sync_ - cursize_));
 
-	    cursize_ += left;
-
-	    left = 0;	    
-	}
-	else
-	{
-	    NVM_DEBUG("Buffer is at %lu out of %lu. Appending %lu", cursize_, bytes_per_sync_, bytes_per_sync_ - cursize_);
+	NVM_DEBUG("Buffer is at %lu out of %lu. Appending %lu", cursize_, bytes_per_sync_, size_to_copy);
 
-	    memcpy(buf_ + cursize_, src + offset, bytes_per_sync_ - cursize_);
+	memcpy(buf_ + cursize_, src + offset, size_to_copy);
 
-	    left -= bytes_per_sync_ - cursize_;
+	cursize_ += size_to_copy;
 
-	    offset += bytes_per_sync_ - cursize_;
+	left -= size_to_copy;
+	offset += size_to_copy;
 
-	    cursize_ = bytes_per_sync_;	    
+	if(cursize_ < bytes_per_sync_)
+	{
+	    continue;
 	}
 
 	if(Flush(false) == false)
@@ -1536,7 +1772,7 @@ Status NVMWritableFile::Close()
 
     NVM_DEBUG("closing %p", this);
 
-    if(Flush(true) == false)
+    if(Flush(true) == false || WaitInFlight() == false)
     {
 	return Status::IOError("out of ssd space");
     }
@@ -1568,7 +1804,7 @@ Status NVMWritableFile::Sync()
 	return Status::IOError("file has been closed");
     }
 
-    if(Flush(false) == false)
+    if(Flush(false) == false || WaitInFlight() == false)
     {
 	return Status::IOError("out of ssd space");
     }
@@ -1583,7 +1819,7 @@ Status NVMWritableFile::Fsync()
 	return Status::IOError("file has been closed");
     }
 
-    if(Flush(false) == false)
+    if(Flush(false) == false || WaitInFlight() == false)
     {
 	return Status::IOError("out of ssd space");
     }
@@ -1593,7 +1829,17 @@ Status NVMWritableFile::Fsync()
 
 uint64_t NVMWritableFile::GetFileSize()
 {
-    return fd_->GetSize() + cursize_;
+    if(page_size_ == 0)
+    {
+	return fd_->GetSize();
+    }
+
+    return last_page_idx * page_size_ + cursize_;
+}
+
+size_t NVMWritableFile::GetSyncAlignment()
+{
+    return wal_mode ? page_size_ : 0;
 }
 
 Status NVMWritableFile::InvalidateCache(size_t offset, size_t length)
@@ -1768,7 +2014,7 @@ Status NVMRandomRWFile::Write(uint64_t offset, const Slice& data)
 		return Status::IOError("request new page returned");
 	    }
 
-	    fd_->SetPage(page_idx, new_pg);
+	    fd_->SetPage(nvm_api, page_idx, new_pg);
 	}
 
 	struct nvm_page *wrote_pg = new_pg;
@@ -1780,7 +2026,7 @@ Status NVMRandomRWFile::Write(uint64_t offset, const Slice& data)
 
 	if(wrote_pg != new_pg)
 	{
-	    fd_->SetPage(page_idx, wrote_pg);
+	    fd_->SetPage(nvm_api, page_idx, wrote_pg);
 	}
 
 	if(page_just_claimed == false)
@@ -1799,8 +2045,6 @@ Status NVMRandomRWFile::Write(uint64_t offset, const Slice& data)
 
 Status NVMRandomRWFile::Read(uint64_t offset, size_t n, Slice* result, char* scratch) const
 {
-    unsigned long page_pointer;
-
     if(offset > fd_->GetSize())
     {
 	NVM_DEBUG("offset is out of bounds");
@@ -1822,58 +2066,16 @@ Status NVMRandomRWFile::Read(uint64_t offset, size_t n, Slice* result, char* scr
 	return Status::OK();
     }
 
-    size_t len = n;
-    size_t l;
-    size_t scratch_offset = 0;
-    size_t size_to_copy;
-
-    char *data;
-
-    unsigned long page_idx;
-
-    struct nvm_page *crt_page = SeekPage(offset, &page_pointer, &page_idx);
-
-    if(crt_page == nullptr)
-    {
-	*result = Slice(scratch, 0);
-	return Status::OK();
-    }
-
-    SAFE_ALLOC(data, char[crt_page->sizes[channel]]);
+    ssize_t l = fd_->ReadRange(offset, n, channel, nvm_api, scratch);
 
-    while(len > 0)
+    if(l < 0)
     {
-	if(crt_page == nullptr)
-	{
-	    n -= len;
-	    break;
-	}
-
-	l = fd_->ReadPage(crt_page, channel, nvm_api, data);
-
-	if(len > l - page_pointer)
-	{
-	    size_to_copy = l - page_pointer;
-	}
-	else
-	{
-	    size_to_copy = len;
-	}
-
-	memcpy(scratch + scratch_offset, data + page_pointer, size_to_copy);
-
-	len -= size_to_copy;
-	scratch_offset += size_to_copy;
-
-	crt_page = fd_->GetNVMPage(++page_idx);
-	page_pointer = 0;
+	return Status::IOError(filename_, "unable to read pages");
     }
 
-    delete[] data;
+    NVM_DEBUG("read %ld bytes", l);
 
-    NVM_DEBUG("read %lu bytes", n);
-
-    *result = Slice(scratch, n);
+    *result = Slice(scratch, l);
 
     return Status::OK();
 }
@@ -0,0 +1,278 @@
+#ifdef ROCKSDB_PLATFORM_NVM
+
+#include "nvm/nvm.h"
+
+nvm_io_batch::nvm_io_batch()
+{
+    pending = 0;
+
+    failed = false;
+
+    pthread_mutex_init(&mtx, nullptr);
+    pthread_cond_init(&done_cond, nullptr);
+}
+
+nvm_io_batch::~nvm_io_batch()
+{
+    pthread_mutex_destroy(&mtx);
+    pthread_cond_destroy(&done_cond);
+}
+
+void nvm_io_batch::Add()
+{
+    pthread_mutex_lock(&mtx);
+
+    ++pending;
+
+    pthread_mutex_unlock(&mtx);
+}
+
+void nvm_io_batch::Complete(const bool ok)
+{
+    pthread_mutex_lock(&mtx);
+
+    if(ok == false)
+    {
+	failed = true;
+    }
+
+    --pending;
+
+    if(pending == 0)
+    {
+	pthread_cond_signal(&done_cond);
+    }
+
+    pthread_mutex_unlock(&mtx);
+}
+
+bool nvm_io_batch::Wait()
+{
+    bool ret;
+
+    pthread_mutex_lock(&mtx);
+
+    while(pending > 0)
+    {
+	pthread_cond_wait(&done_cond, &mtx);
+    }
+
+    ret = !failed;
+
+    pthread_mutex_unlock(&mtx);
+
+    return ret;
+}
+
+nvm_io_scheduler::nvm_io_scheduler(nvm_device *_dev, const unsigned long _nr_luns, const unsigned long threads_per_lun)
+{
+    dev = _dev;
+
+    nr_luns = _nr_luns;
+
+    exit_all_threads = false;
+
+    statistics = nullptr;
+
+    SAFE_ALLOC(queues, nvm_io_queue[nr_luns]);
+
+    for(unsigned long i = 0; i < nr_luns; ++i)
+    {
+	pthread_mutex_init(&queues[i].mtx, nullptr);
+	pthread_cond_init(&queues[i].cond, nullptr);
+
+	queues[i].in_flight = 0;
+
+	queues[i].stats.submitted = 0;
+	queues[i].stats.depth_sum = 0;
+	queues[i].stats.max_depth = 0;
+    }
+
+    for(unsigned long i = 0; i < nr_luns; ++i)
+    {
+	for(unsigned long j = 0; j < threads_per_lun; ++j)
+	{
+	    pthread_t t;
+
+	    if(pthread_create(&t, nullptr, &nvm_io_scheduler::WorkerWrapper, new nvm_io_worker_metadata(this, i)))
+	    {
+		NVM_FATAL("unable to start io worker for lun %lu", i);
+	    }
+
+#if defined(_GNU_SOURCE) && defined(__GLIBC_PREREQ)
+#if __GLIBC_PREREQ(2, 12)
+
+	    //thread names are limited to 16 bytes
+	    char name_buf[32];
+	    snprintf(name_buf, sizeof name_buf, "rocksdb:lun%lu", i);
+	    name_buf[15] = '\0';
+	    pthread_setname_np(t, name_buf);
+
+#endif
+#endif
+
+	    workers.push_back(t);
+	}
+    }
+}
+
+nvm_io_scheduler::~nvm_io_scheduler()
+{
+    for(unsigned long i = 0; i < nr_luns; ++i)
+    {
+	pthread_mutex_lock(&queues[i].mtx);
+
+	exit_all_threads = true;
+
+	pthread_cond_broadcast(&queues[i].cond);
+	pthread_mutex_unlock(&queues[i].mtx);
+    }
+
+    for(unsigned long i = 0; i < workers.size(); ++i)
+    {
+	pthread_join(workers[i], nullptr);
+    }
+
+    for(unsigned long i = 0; i < nr_luns; ++i)
+    {
+	pthread_mutex_destroy(&queues[i].mtx);
+	pthread_cond_destroy(&queues[i].cond);
+    }
+
+    delete[] queues;
+}
+
+void *nvm_io_scheduler::WorkerWrapper(void *arg)
+{
+    nvm_io_worker_metadata *meta = (nvm_io_worker_metadata *)arg;
+
+    nvm_io_scheduler *scheduler = meta->scheduler;
+    unsigned long lun_id = meta->lun_id;
+
+    delete meta;
+
+    scheduler->Worker(lun_id);
+
+    return nullptr;
+}
+
+void nvm_io_scheduler::Execute(nvm_device *dev, nvm_io_request *request)
+{
+    if(request->write)
+    {
+	//a write interrupted half way may leave the page programmed; let
+	//the caller move the data to a fresh page instead of retrying here
+	request->ret = dev->Pwrite(request->data, request->len, request->offset);
+
+	return;
+    }
+
+    do
+    {
+	if(request->iov)
+	{
+	    request->ret = dev->Preadv(request->iov, request->iovcnt, request->offset);
+	}
+	else
+	{
+	    request->ret = dev->Pread(request->data, request->len, request->offset);
+	}
+    }
+    while(request->ret < 0 && errno == EINTR);
+}
+
+void nvm_io_scheduler::Worker(const unsigned long lun_id)
+{
+    nvm_io_queue *queue = &queues[lun_id];
+
+    while(true)
+    {
+	pthread_mutex_lock(&queue->mtx);
+
+	while(exit_all_threads == false && queue->requests.empty())
+	{
+	    pthread_cond_wait(&queue->cond, &queue->mtx);
+	}
+
+	if(queue->requests.empty())
+	{
+	    //only get here when exiting; queued requests are always served
+	    pthread_mutex_unlock(&queue->mtx);
+
+	    break;
+	}
+
+	nvm_io_request *request = queue->requests.front();
+	queue->requests.pop_front();
+
+	++queue->in_flight;
+
+	pthread_mutex_unlock(&queue->mtx);
+
+	Execute(dev, request);
+
+	pthread_mutex_lock(&queue->mtx);
+
+	--queue->in_flight;
+
+	pthread_mutex_unlock(&queue->mtx);
+
+	request->batch->Complete(request->ret == (ssize_t)request->len);
+    }
+}
+
+void nvm_io_scheduler::Submit(nvm_io_request *request)
+{
+    nvm_io_queue *queue = &queues[request->lun_id % nr_luns];
+
+    request->batch->Add();
+
+    pthread_mutex_lock(&queue->mtx);
+
+    unsigned long depth = queue->requests.size() + queue->in_flight;
+
+    queue->requests.push_back(request);
+
+    ++queue->stats.submitted;
+
+    queue->stats.depth_sum += depth;
+    queue->stats.max_depth = std::max(queue->stats.max_depth, depth);
+
+    pthread_cond_signal(&queue->cond);
+    pthread_mutex_unlock(&queue->mtx);
+
+    rocksdb::MeasureTime(statistics, rocksdb::NVM_LUN_QUEUE_DEPTH, depth);
+}
+
+unsigned long nvm_io_scheduler::GetQueueDepth(const unsigned long lun_id)
+{
+    unsigned long ret;
+
+    nvm_io_queue *queue = &queues[lun_id % nr_luns];
+
+    pthread_mutex_lock(&queue->mtx);
+
+    ret = queue->requests.size() + queue->in_flight;
+
+    pthread_mutex_unlock(&queue->mtx);
+
+    return ret;
+}
+
+void nvm_io_scheduler::GetQueueStats(const unsigned long lun_id, nvm_io_queue_stats *stats)
+{
+    nvm_io_queue *queue = &queues[lun_id % nr_luns];
+
+    pthread_mutex_lock(&queue->mtx);
+
+    *stats = queue->stats;
+
+    pthread_mutex_unlock(&queue->mtx);
+}
+
+void nvm_io_scheduler::SetStatistics(rocksdb::Statistics *_statistics)
+{
+    statistics = _statistics;
+}
+
+#endif
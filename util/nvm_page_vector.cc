@@ -0,0 +1,113 @@
+#ifdef ROCKSDB_PLATFORM_NVM
+
+#include "nvm/nvm.h"
+
+nvm_page_vector::nvm_page_vector()
+{
+    nvm_page_chunk_dir *empty_dir;
+
+    ALLOC_CLASS(empty_dir, nvm_page_chunk_dir());
+
+    empty_dir->nr_chunks = 0;
+    empty_dir->chunks = nullptr;
+
+    dir.store(empty_dir, std::memory_order_relaxed);
+    count.store(0, std::memory_order_relaxed);
+
+    nr_chunks = 0;
+}
+
+nvm_page_vector::~nvm_page_vector()
+{
+    nvm_page_chunk_dir *crt_dir = dir.load(std::memory_order_relaxed);
+
+    for(unsigned long i = 0; i < nr_chunks; ++i)
+    {
+	delete[] crt_dir->chunks[i];
+    }
+
+    retired_dirs.push_back(crt_dir);
+
+    for(unsigned long i = 0; i < retired_dirs.size(); ++i)
+    {
+	delete[] retired_dirs[i]->chunks;
+	delete retired_dirs[i];
+    }
+}
+
+void nvm_page_vector::Grow()
+{
+    nvm_page_chunk_dir *old_dir = dir.load(std::memory_order_relaxed);
+    nvm_page_chunk_dir *new_dir;
+
+    ALLOC_CLASS(new_dir, nvm_page_chunk_dir());
+
+    new_dir->nr_chunks = old_dir->nr_chunks == 0 ? 8 : old_dir->nr_chunks * 2;
+
+    SAFE_ALLOC(new_dir->chunks, std::atomic<struct nvm_page *> *[new_dir->nr_chunks]);
+
+    for(unsigned long i = 0; i < old_dir->nr_chunks; ++i)
+    {
+	new_dir->chunks[i] = old_dir->chunks[i];
+    }
+
+    for(unsigned long i = old_dir->nr_chunks; i < new_dir->nr_chunks; ++i)
+    {
+	new_dir->chunks[i] = nullptr;
+    }
+
+    dir.store(new_dir, std::memory_order_release);
+
+    retired_dirs.push_back(old_dir);
+}
+
+unsigned long nvm_page_vector::size() const
+{
+    return count.load(std::memory_order_acquire);
+}
+
+struct nvm_page *nvm_page_vector::operator[](const unsigned long idx) const
+{
+    nvm_page_chunk_dir *crt_dir = dir.load(std::memory_order_acquire);
+
+    return crt_dir->chunks[idx / NVM_PAGE_VECTOR_CHUNK][idx % NVM_PAGE_VECTOR_CHUNK].load(std::memory_order_acquire);
+}
+
+void nvm_page_vector::Set(const unsigned long idx, struct nvm_page *page)
+{
+    nvm_page_chunk_dir *crt_dir = dir.load(std::memory_order_relaxed);
+
+    crt_dir->chunks[idx / NVM_PAGE_VECTOR_CHUNK][idx % NVM_PAGE_VECTOR_CHUNK].store(page, std::memory_order_release);
+}
+
+void nvm_page_vector::push_back(struct nvm_page *page)
+{
+    unsigned long idx = count.load(std::memory_order_relaxed);
+    unsigned long chunk_id = idx / NVM_PAGE_VECTOR_CHUNK;
+
+    if(chunk_id == nr_chunks)
+    {
+	if(chunk_id == dir.load(std::memory_order_relaxed)->nr_chunks)
+	{
+	    Grow();
+	}
+
+	nvm_page_chunk_dir *crt_dir = dir.load(std::memory_order_relaxed);
+
+	SAFE_ALLOC(crt_dir->chunks[chunk_id], std::atomic<struct nvm_page *>[NVM_PAGE_VECTOR_CHUNK]);
+
+	++nr_chunks;
+    }
+
+    Set(idx, page);
+
+    //publish the entry before the new size
+    count.store(idx + 1, std::memory_order_release);
+}
+
+void nvm_page_vector::clear()
+{
+    count.store(0, std::memory_order_release);
+}
+
+#endif
@@ -116,6 +116,7 @@ ColumnFamilyOptions::ColumnFamilyOptions()
       memtable_prefix_bloom_bits(0),
       memtable_prefix_bloom_probes(6),
       memtable_prefix_bloom_huge_page_tlb_size(0),
+      memtable_whole_key_filtering(false),
       bloom_locality(0),
       max_successive_merges(0),
       min_partial_merge_operands(2),
@@ -180,6 +181,7 @@ ColumnFamilyOptions::ColumnFamilyOptions(const Options& options)
       memtable_prefix_bloom_probes(options.memtable_prefix_bloom_probes),
       memtable_prefix_bloom_huge_page_tlb_size(
           options.memtable_prefix_bloom_huge_page_tlb_size),
+      memtable_whole_key_filtering(options.memtable_whole_key_filtering),
       bloom_locality(options.bloom_locality),
       max_successive_merges(options.max_successive_merges),
       min_partial_merge_operands(options.min_partial_merge_operands),
@@ -231,14 +233,20 @@ DBOptions::DBOptions()
       stats_dump_period_sec(600),
       advise_random_on_open(true),
       db_write_buffer_size(0),
+      memtable_block_pool_size(0),
+      memtable_block_pool_huge_page_size(0),
       access_hint_on_compaction_start(NORMAL),
       use_adaptive_mutex(false),
       bytes_per_sync(0),
       wal_bytes_per_sync(0),
       listeners(),
       enable_thread_tracking(false),
+      allow_concurrent_memtable_write(false),
+      enable_pipelined_write(false),
       delayed_write_rate(1024U * 1024U),
-      wal_recovery_mode(WALRecoveryMode::kTolerateCorruptedTailRecords) {
+      wal_recovery_mode(WALRecoveryMode::kTolerateCorruptedTailRecords),
+      wal_recovery_threads(1),
+      wal_compression(kNoCompression) {
 }
 
 DBOptions::DBOptions(const Options& options)
@@ -278,14 +286,21 @@ DBOptions::DBOptions(const Options& options)
       stats_dump_period_sec(options.stats_dump_period_sec),
       advise_random_on_open(options.advise_random_on_open),
       db_write_buffer_size(options.db_write_buffer_size),
+      memtable_block_pool_size(options.memtable_block_pool_size),
+      memtable_block_pool_huge_page_size(
+          options.memtable_block_pool_huge_page_size),
       access_hint_on_compaction_start(options.access_hint_on_compaction_start),
       use_adaptive_mutex(options.use_adaptive_mutex),
       bytes_per_sync(options.bytes_per_sync),
       wal_bytes_per_sync(options.wal_bytes_per_sync),
       listeners(options.listeners),
       enable_thread_tracking(options.enable_thread_tracking),
+      allow_concurrent_memtable_write(options.allow_concurrent_memtable_write),
+      enable_pipelined_write(options.enable_pipelined_write),
       delayed_write_rate(options.delayed_write_rate),
       wal_recovery_mode(options.wal_recovery_mode),
+      wal_recovery_threads(options.wal_recovery_threads),
+      wal_compression(options.wal_compression),
       row_cache(options.row_cache) {}
 
 static const char* const access_hints[] = {
@@ -350,6 +365,14 @@ void DBOptions::Dump(Logger* log) const {
          "                    Options.db_write_buffer_size: %" ROCKSDB_PRIszt
          "d",
          db_write_buffer_size);
+    Warn(log,
+         "                Options.memtable_block_pool_size: %" ROCKSDB_PRIszt
+         "d",
+         memtable_block_pool_size);
+    Warn(log,
+         "      Options.memtable_block_pool_huge_page_size: %" ROCKSDB_PRIszt
+         "d",
+         memtable_block_pool_huge_page_size);
     Warn(log, "         Options.access_hint_on_compaction_start: %s",
         access_hints[access_hint_on_compaction_start]);
     Warn(log, "                      Options.use_adaptive_mutex: %d",
@@ -362,6 +385,14 @@ void DBOptions::Dump(Logger* log) const {
         wal_bytes_per_sync);
     Warn(log, "                  Options.enable_thread_tracking: %d",
         enable_thread_tracking);
+    Warn(log, "         Options.allow_concurrent_memtable_write: %d",
+        allow_concurrent_memtable_write);
+    Warn(log, "                  Options.enable_pipelined_write: %d",
+        enable_pipelined_write);
+    Warn(log, "                    Options.wal_recovery_threads: %d",
+        wal_recovery_threads);
+    Warn(log, "                         Options.wal_compression: %s",
+        CompressionTypeToString(wal_compression).c_str());
     if (row_cache) {
       Warn(log, "                               Options.row_cache: %" PRIu64,
            row_cache->GetCapacity());
@@ -492,6 +523,8 @@ void ColumnFamilyOptions::Dump(Logger* log) const {
     Warn(log,
          "  Options.memtable_prefix_bloom_huge_page_tlb_size: %" ROCKSDB_PRIszt,
          memtable_prefix_bloom_huge_page_tlb_size);
+    Warn(log, "            Options.memtable_whole_key_filtering: %d",
+        memtable_whole_key_filtering);
     Warn(log, "                          Options.bloom_locality: %d",
         bloom_locality);
 
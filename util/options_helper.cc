@@ -48,10 +48,22 @@ BlockBasedTableOptions::IndexType ParseBlockBasedTableIndexType(
     return BlockBasedTableOptions::kBinarySearch;
   } else if (type == "kHashSearch") {
     return BlockBasedTableOptions::kHashSearch;
+  } else if (type == "kTwoLevelIndexSearch") {
+    return BlockBasedTableOptions::kTwoLevelIndexSearch;
   }
   throw std::invalid_argument("Unknown index type: " + type);
 }
 
+BlockBasedTableOptions::DataBlockIndexType
+ParseBlockBasedTableDataBlockIndexType(const std::string& type) {
+  if (type == "kDataBlockBinarySearch") {
+    return BlockBasedTableOptions::kDataBlockBinarySearch;
+  } else if (type == "kDataBlockBinaryAndHash") {
+    return BlockBasedTableOptions::kDataBlockBinaryAndHash;
+  }
+  throw std::invalid_argument("Unknown data block index type: " + type);
+}
+
 ChecksumType ParseBlockBasedTableChecksumType(
     const std::string& type) {
   if (type == "kNoChecksum") {
@@ -170,6 +182,8 @@ bool ParseMemtableOptions(const std::string& name, const std::string& value,
   } else if (name == "memtable_prefix_bloom_huge_page_tlb_size") {
     new_options->memtable_prefix_bloom_huge_page_tlb_size =
       ParseSizeT(value);
+  } else if (name == "memtable_whole_key_filtering") {
+    new_options->memtable_whole_key_filtering = ParseBoolean(name, value);
   } else if (name == "max_successive_merges") {
     new_options->max_successive_merges = ParseSizeT(value);
   } else if (name == "filter_deletes") {
@@ -555,6 +569,19 @@ bool ParseDBOption(const std::string& name, const std::string& value,
       new_options->bytes_per_sync = ParseUint64(value);
     } else if (name == "wal_bytes_per_sync") {
       new_options->wal_bytes_per_sync = ParseUint64(value);
+    } else if (name == "allow_concurrent_memtable_write") {
+      new_options->allow_concurrent_memtable_write =
+          ParseBoolean(name, value);
+    } else if (name == "enable_pipelined_write") {
+      new_options->enable_pipelined_write = ParseBoolean(name, value);
+    } else if (name == "wal_recovery_threads") {
+      new_options->wal_recovery_threads = ParseInt(value);
+    } else if (name == "wal_compression") {
+      new_options->wal_compression = ParseCompressionType(value);
+    } else if (name == "memtable_block_pool_size") {
+      new_options->memtable_block_pool_size = ParseSizeT(value);
+    } else if (name == "memtable_block_pool_huge_page_size") {
+      new_options->memtable_block_pool_huge_page_size = ParseSizeT(value);
     } else {
       return false;
     }
@@ -578,6 +605,16 @@ Status GetBlockBasedTableOptionsFromMap(
           ParseBoolean(o.first, o.second);
       } else if (o.first == "index_type") {
         new_table_options->index_type = ParseBlockBasedTableIndexType(o.second);
+      } else if (o.first == "partition_filters") {
+        new_table_options->partition_filters = ParseBoolean(o.first, o.second);
+      } else if (o.first == "metadata_block_size") {
+        new_table_options->metadata_block_size = ParseUint64(o.second);
+      } else if (o.first == "data_block_index_type") {
+        new_table_options->data_block_index_type =
+          ParseBlockBasedTableDataBlockIndexType(o.second);
+      } else if (o.first == "data_block_hash_table_util_ratio") {
+        new_table_options->data_block_hash_table_util_ratio =
+          ParseDouble(o.second);
       } else if (o.first == "hash_index_allow_collision") {
         new_table_options->hash_index_allow_collision =
           ParseBoolean(o.first, o.second);
@@ -600,6 +637,22 @@ Status GetBlockBasedTableOptionsFromMap(
       } else if (o.first == "filter_policy") {
         // Expect the following format
         // bloomfilter:int:bool
+        // or
+        // blockedbloomfilter:int
+        // or
+        // xorfilter
+        if (o.second == "xorfilter") {
+          new_table_options->filter_policy.reset(NewXorFilterPolicy());
+          continue;
+        }
+        const std::string kBlockedName = "blockedbloomfilter:";
+        if (o.second.compare(0, kBlockedName.size(), kBlockedName) == 0) {
+          int bits_per_key =
+              ParseInt(trim(o.second.substr(kBlockedName.size())));
+          new_table_options->filter_policy.reset(
+              NewBlockedBloomFilterPolicy(bits_per_key));
+          continue;
+        }
         const std::string kName = "bloomfilter:";
         if (o.second.compare(0, kName.size(), kName) != 0) {
           return Status::InvalidArgument("Invalid filter policy name");
@@ -133,6 +133,7 @@ TEST_F(OptionsTest, GetOptionsFromMapTest) {
       {"memtable_prefix_bloom_bits", "26"},
       {"memtable_prefix_bloom_probes", "27"},
       {"memtable_prefix_bloom_huge_page_tlb_size", "28"},
+      {"memtable_whole_key_filtering", "true"},
       {"bloom_locality", "29"},
       {"max_successive_merges", "30"},
       {"min_partial_merge_operands", "31"},
@@ -172,6 +173,12 @@ TEST_F(OptionsTest, GetOptionsFromMapTest) {
     {"use_adaptive_mutex", "false"},
     {"bytes_per_sync", "47"},
     {"wal_bytes_per_sync", "48"},
+    {"allow_concurrent_memtable_write", "true"},
+    {"enable_pipelined_write", "true"},
+    {"wal_recovery_threads", "4"},
+    {"wal_compression", "kSnappyCompression"},
+    {"memtable_block_pool_size", "49"},
+    {"memtable_block_pool_huge_page_size", "50"},
   };
 
   ColumnFamilyOptions base_cf_opt;
@@ -225,6 +232,7 @@ TEST_F(OptionsTest, GetOptionsFromMapTest) {
   ASSERT_EQ(new_cf_opt.memtable_prefix_bloom_bits, 26U);
   ASSERT_EQ(new_cf_opt.memtable_prefix_bloom_probes, 27U);
   ASSERT_EQ(new_cf_opt.memtable_prefix_bloom_huge_page_tlb_size, 28U);
+  ASSERT_EQ(new_cf_opt.memtable_whole_key_filtering, true);
   ASSERT_EQ(new_cf_opt.bloom_locality, 29U);
   ASSERT_EQ(new_cf_opt.max_successive_merges, 30U);
   ASSERT_EQ(new_cf_opt.min_partial_merge_operands, 31U);
@@ -278,6 +286,13 @@ TEST_F(OptionsTest, GetOptionsFromMapTest) {
   ASSERT_EQ(new_db_opt.use_adaptive_mutex, false);
   ASSERT_EQ(new_db_opt.bytes_per_sync, static_cast<uint64_t>(47));
   ASSERT_EQ(new_db_opt.wal_bytes_per_sync, static_cast<uint64_t>(48));
+  ASSERT_EQ(new_db_opt.allow_concurrent_memtable_write, true);
+  ASSERT_EQ(new_db_opt.enable_pipelined_write, true);
+  ASSERT_EQ(new_db_opt.wal_recovery_threads, 4);
+  ASSERT_EQ(new_db_opt.wal_compression, kSnappyCompression);
+  ASSERT_EQ(new_db_opt.memtable_block_pool_size, static_cast<size_t>(49));
+  ASSERT_EQ(new_db_opt.memtable_block_pool_huge_page_size,
+            static_cast<size_t>(50));
 }
 #endif  // !ROCKSDB_LITE
 
@@ -444,6 +459,33 @@ TEST_F(OptionsTest, GetBlockBasedTableOptionsFromString) {
   ASSERT_EQ(new_opt.block_restart_interval, 4);
   ASSERT_TRUE(new_opt.filter_policy != nullptr);
 
+  ASSERT_OK(GetBlockBasedTableOptionsFromString(table_opt,
+            "index_type=kTwoLevelIndexSearch;partition_filters=1;"
+            "metadata_block_size=1024;filter_policy=bloomfilter:10:false",
+            &new_opt));
+  ASSERT_EQ(new_opt.index_type, BlockBasedTableOptions::kTwoLevelIndexSearch);
+  ASSERT_TRUE(new_opt.partition_filters);
+  ASSERT_EQ(new_opt.metadata_block_size, 1024U);
+
+  ASSERT_OK(GetBlockBasedTableOptionsFromString(table_opt,
+            "data_block_index_type=kDataBlockBinaryAndHash;"
+            "data_block_hash_table_util_ratio=0.5",
+            &new_opt));
+  ASSERT_EQ(new_opt.data_block_index_type,
+            BlockBasedTableOptions::kDataBlockBinaryAndHash);
+  ASSERT_EQ(new_opt.data_block_hash_table_util_ratio, 0.5);
+
+  ASSERT_OK(GetBlockBasedTableOptionsFromString(table_opt,
+            "filter_policy=blockedbloomfilter:10", &new_opt));
+  ASSERT_TRUE(new_opt.filter_policy != nullptr);
+  ASSERT_EQ(std::string(new_opt.filter_policy->Name()),
+            "rocksdb.BuiltinBlockedBloomFilter");
+  ASSERT_OK(GetBlockBasedTableOptionsFromString(table_opt,
+            "filter_policy=xorfilter", &new_opt));
+  ASSERT_TRUE(new_opt.filter_policy != nullptr);
+  ASSERT_EQ(std::string(new_opt.filter_policy->Name()),
+            "rocksdb.BuiltinXorFilter");
+
   // unknown option
   ASSERT_NOK(GetBlockBasedTableOptionsFromString(table_opt,
              "cache_index_and_filter_blocks=1;index_type=kBinarySearch;"
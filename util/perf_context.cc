@@ -33,6 +33,8 @@ void PerfContext::Reset() {
   get_snapshot_time = 0;
   get_from_memtable_time = 0;
   get_from_memtable_count = 0;
+  bloom_memtable_hit_count = 0;
+  bloom_memtable_miss_count = 0;
   get_post_process_time = 0;
   get_from_output_files_time = 0;
   seek_on_memtable_time = 0;
@@ -45,6 +47,9 @@ void PerfContext::Reset() {
   write_pre_and_post_process_time = 0;
   write_memtable_time = 0;
   write_delay_time = 0;
+  write_thread_spin_nanos = 0;
+  write_thread_yield_nanos = 0;
+  write_thread_block_nanos = 0;
   db_mutex_lock_nanos = 0;
   db_condition_wait_nanos = 0;
   merge_operator_time_nanos = 0;
@@ -70,7 +75,8 @@ std::string PerfContext::ToString() const {
      << OUTPUT(block_decompress_time) << OUTPUT(internal_key_skipped_count)
      << OUTPUT(internal_delete_skipped_count) << OUTPUT(write_wal_time)
      << OUTPUT(get_snapshot_time) << OUTPUT(get_from_memtable_time)
-     << OUTPUT(get_from_memtable_count) << OUTPUT(get_post_process_time)
+     << OUTPUT(get_from_memtable_count) << OUTPUT(bloom_memtable_hit_count)
+     << OUTPUT(bloom_memtable_miss_count) << OUTPUT(get_post_process_time)
      << OUTPUT(get_from_output_files_time) << OUTPUT(seek_on_memtable_time)
      << OUTPUT(seek_on_memtable_count) << OUTPUT(seek_child_seek_time)
      << OUTPUT(seek_child_seek_count) << OUTPUT(seek_min_heap_time)
@@ -78,6 +84,8 @@ std::string PerfContext::ToString() const {
      << OUTPUT(write_pre_and_post_process_time) << OUTPUT(write_memtable_time)
      << OUTPUT(db_mutex_lock_nanos) << OUTPUT(db_condition_wait_nanos)
      << OUTPUT(merge_operator_time_nanos) << OUTPUT(write_delay_time)
+     << OUTPUT(write_thread_spin_nanos) << OUTPUT(write_thread_yield_nanos)
+     << OUTPUT(write_thread_block_nanos)
      << OUTPUT(read_index_block_nanos) << OUTPUT(read_filter_block_nanos)
      << OUTPUT(new_table_block_iter_nanos) << OUTPUT(new_table_iterator_nanos)
      << OUTPUT(block_seek_nanos) << OUTPUT(find_table_nanos);
@@ -10,6 +10,10 @@
 
 namespace rocksdb {
 namespace {
+// How many nodes MultiGet() walks from one key towards the next before it
+// searches from the head of the list instead
+const size_t kMultiGetMaxSteps = 16;
+
 class SkipListRep : public MemTableRep {
   SkipList<const char*, const MemTableRep::KeyComparator&> skip_list_;
   const MemTableRep::KeyComparator& cmp_;
@@ -31,6 +35,10 @@ public:
     skip_list_.Insert(static_cast<char*>(handle));
   }
 
+  virtual void InsertConcurrently(KeyHandle handle) override {
+    skip_list_.InsertConcurrently(static_cast<char*>(handle));
+  }
+
   // Returns true iff an entry that compares equal to key is in the list.
   virtual bool Contains(const char* key) const override {
     return skip_list_.Contains(key);
@@ -52,6 +60,39 @@ public:
     }
   }
 
+  virtual void MultiGet(size_t num_keys, const LookupKey* const* keys,
+                        void* const* callback_args,
+                        bool (*callback_func)(void* arg,
+                                              const char* entry)) override {
+    // Where the search for the previous key ended; the entries of the next
+    // key are at or after it, often only a few nodes away.
+    SkipList<const char*, const MemTableRep::KeyComparator&>::Iterator start(
+        &skip_list_);
+    SkipList<const char*, const MemTableRep::KeyComparator&>::Iterator iter(
+        &skip_list_);
+    for (size_t i = 0; i < num_keys; ++i) {
+      const char* target = keys[i]->memtable_key().data();
+      bool positioned = false;
+      if (start.Valid() && cmp_(target, start.key()) >= 0) {
+        iter = start;
+        for (size_t steps = 0; steps <= kMultiGetMaxSteps; ++steps) {
+          if (!iter.Valid() || cmp_(target, iter.key()) <= 0) {
+            positioned = true;
+            break;
+          }
+          iter.Next();
+        }
+      }
+      if (!positioned) {
+        iter.Seek(target);
+      }
+      start = iter;
+      for (; iter.Valid() && callback_func(callback_args[i], iter.key());
+           iter.Next()) {
+      }
+    }
+  }
+
   uint64_t ApproximateNumEntries(const Slice& start_ikey,
                                  const Slice& end_ikey) override {
     std::string tmp;
@@ -5,12 +5,15 @@
 
 #ifndef ROCKSDB_LITE
 
+#include <atomic>
 #include <string>
+#include <thread>
 
 #include "rocksdb/db.h"
 #include "rocksdb/utilities/optimistic_transaction.h"
 #include "rocksdb/utilities/optimistic_transaction_db.h"
 #include "util/logging.h"
+#include "util/sync_point.h"
 #include "util/testharness.h"
 
 using std::string;
@@ -139,6 +142,50 @@ TEST_F(OptimisticTransactionTest, WriteConflictTest2) {
   delete txn;
 }
 
+TEST_F(OptimisticTransactionTest, PipelinedWriteConflictTest) {
+  delete txn_db;
+  options.enable_pipelined_write = true;
+  Status s = OptimisticTransactionDB::Open(options, dbname, &txn_db);
+  ASSERT_OK(s);
+  db = txn_db->GetBaseDB();
+
+  WriteOptions write_options;
+  ReadOptions read_options;
+  string value;
+
+  OptimisticTransaction* txn = txn_db->BeginTransaction(write_options);
+  ASSERT_TRUE(txn);
+  txn->Put("foo", "bar2");
+
+  // Hold a conflicting write between its WAL record and its memtable insert
+  // while the transaction commits
+  std::atomic<bool> in_memtable_stage(false);
+  rocksdb::SyncPoint::GetInstance()->SetCallBack(
+      "DBImpl::WriteImpl:BeforePipelinedMemTableWrite", [&](void* arg) {
+        if (!in_memtable_stage.exchange(true)) {
+          Env::Default()->SleepForMicroseconds(200000);
+        }
+      });
+  rocksdb::SyncPoint::GetInstance()->EnableProcessing();
+
+  std::thread writer([&] {
+    ASSERT_OK(db->Put(write_options, "foo", "bar"));
+  });
+  while (!in_memtable_stage.load()) {
+    Env::Default()->SleepForMicroseconds(1000);
+  }
+  s = txn->Commit();
+  ASSERT_TRUE(s.IsBusy());
+  writer.join();
+  rocksdb::SyncPoint::GetInstance()->DisableProcessing();
+  rocksdb::SyncPoint::GetInstance()->ClearAllCallBacks();
+
+  db->Get(read_options, "foo", &value);
+  ASSERT_EQ(value, "bar");
+
+  delete txn;
+}
+
 TEST_F(OptimisticTransactionTest, ReadConflictTest) {
   WriteOptions write_options;
   ReadOptions read_options, snapshot_read_options;